@@ -0,0 +1,160 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "capi.h"
+#include "engine.h"
+#include <string.h>
+
+// frames handed to nextBuf at once
+#define CAPI_CHUNK 1024
+
+struct FurnaceEngine {
+  DivEngine engine;
+  String lastError;
+  int loops;
+  unsigned int rate;
+  float bufL[CAPI_CHUNK];
+  float bufR[CAPI_CHUNK];
+  FurnaceEngine():
+    loops(1),
+    rate(44100) {}
+};
+
+static thread_local String loadError;
+
+FurnaceEngine* furnace_engine_load(const void* data, size_t len, unsigned int rate) {
+  if (data==NULL || len<1) {
+    loadError="no data";
+    return NULL;
+  }
+  if (rate<1) {
+    loadError="invalid sample rate";
+    return NULL;
+  }
+
+  FurnaceEngine* e=new FurnaceEngine;
+  e->engine.setConfigReadOnly(true);
+  e->engine.setConsoleMode(true);
+  e->engine.setAudio(DIV_AUDIO_DUMMY);
+  e->engine.setConf("audioRate",(int)rate);
+  e->rate=rate;
+
+  // load() takes ownership of the buffer
+  unsigned char* file=new unsigned char[len];
+  memcpy(file,data,len);
+  if (!e->engine.load(file,len)) {
+    loadError=e->engine.getLastError();
+    delete e;
+    return NULL;
+  }
+  if (!e->engine.init()) {
+    loadError="could not initialize engine";
+    e->engine.quit();
+    delete e;
+    return NULL;
+  }
+  furnace_engine_play(e);
+  return e;
+}
+
+void furnace_engine_free(FurnaceEngine* e) {
+  if (e==NULL) return;
+  e->engine.quit();
+  delete e;
+}
+
+const char* furnace_engine_last_error(FurnaceEngine* e) {
+  if (e==NULL) return loadError.c_str();
+  e->lastError=e->engine.getLastError();
+  return e->lastError.c_str();
+}
+
+void furnace_engine_set_loops(FurnaceEngine* e, int loops) {
+  e->loops=loops;
+  e->engine.setLoops(loops);
+}
+
+void furnace_engine_play(FurnaceEngine* e) {
+  e->engine.setOrder(0);
+  e->engine.play();
+  e->engine.setLoops(e->loops);
+}
+
+size_t furnace_engine_render(FurnaceEngine* e, float* out, size_t frames) {
+  float* buf[2]={e->bufL,e->bufR};
+  size_t done=0;
+  while (done<frames && e->engine.isPlaying()) {
+    size_t count=frames-done;
+    if (count>CAPI_CHUNK) count=CAPI_CHUNK;
+    e->engine.nextBuf(NULL,buf,0,2,count);
+    // the song may end partway through the chunk
+    size_t rendered=MIN(count,e->engine.getProcessedFrames());
+    for (size_t i=0; i<rendered; i++) {
+      *(out++)=e->bufL[i];
+      *(out++)=e->bufR[i];
+    }
+    done+=rendered;
+    if (rendered<count) break;
+  }
+  memset(out,0,(frames-done)*2*sizeof(float));
+  return done;
+}
+
+int furnace_engine_is_playing(FurnaceEngine* e) {
+  return e->engine.isPlaying();
+}
+
+void furnace_engine_get_position(FurnaceEngine* e, int* order, int* row, double* seconds) {
+  if (order!=NULL) *order=e->engine.getOrder();
+  if (row!=NULL) *row=e->engine.getRow();
+  if (seconds!=NULL) *seconds=(double)e->engine.getTotalSeconds()+(double)e->engine.getTotalTicks()/1000000.0;
+}
+
+void furnace_engine_get_length(FurnaceEngine* e, int* orders, int* rows, int* loopOrder, int* loopRow, double* seconds, double* loopSeconds, size_t* frames) {
+  int lo=0, lr=0, le=0;
+  e->engine.walkSong(lo,lr,le);
+  double loopTime=-1;
+  double length=e->engine.timeSong(loopTime);
+  if (orders!=NULL) *orders=e->engine.song.ordersLen;
+  if (rows!=NULL) *rows=e->engine.song.patLen;
+  if (loopOrder!=NULL) *loopOrder=lo;
+  if (loopRow!=NULL) *loopRow=lr;
+  if (seconds!=NULL) *seconds=length;
+  if (loopSeconds!=NULL) *loopSeconds=loopTime;
+  if (frames!=NULL) *frames=(size_t)(length*e->rate+0.5);
+}
+
+int furnace_engine_get_system_count(FurnaceEngine* e) {
+  return e->engine.song.systemLen;
+}
+
+const char* furnace_engine_get_system_name(FurnaceEngine* e, int sys) {
+  if (sys<0 || sys>=e->engine.song.systemLen) return NULL;
+  return e->engine.getSystemName(e->engine.song.system[sys]);
+}
+
+void furnace_engine_mute_system(FurnaceEngine* e, int sys, int mute) {
+  if (sys<0 || sys>=e->engine.song.systemLen) return;
+  int chans=e->engine.getTotalChannelCount();
+  for (int i=0; i<chans; i++) {
+    if (e->engine.dispatchOfChan[i]==sys) {
+      e->engine.muteChannel(i,mute);
+    }
+  }
+}
@@ -0,0 +1,137 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _CAPI_H
+#define _CAPI_H
+
+// C interface to the engine, for embedding playback in other programs.
+// no audio backend is started and no files are read or written.
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#ifdef FURNACE_ENGINE_SHARED
+#define FURNACE_API __declspec(dllexport)
+#else
+#define FURNACE_API
+#endif
+#else
+#define FURNACE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FurnaceEngine FurnaceEngine;
+
+/**
+ * load a song from memory and prepare it for rendering.
+ * @param data the song file (.fur, .dmf and anything else the engine can open).
+ * the data is copied, so it may be freed after this call.
+ * @param len the size of data.
+ * @param rate the output sample rate.
+ * @return a new engine, or NULL on failure. use furnace_engine_last_error()
+ * with NULL to get the reason.
+ */
+FURNACE_API FurnaceEngine* furnace_engine_load(const void* data, size_t len, unsigned int rate);
+
+/**
+ * stop and free an engine.
+ */
+FURNACE_API void furnace_engine_free(FurnaceEngine* e);
+
+/**
+ * get the last error.
+ * @param e the engine, or NULL for errors during furnace_engine_load().
+ * @return the error message. valid until the next call on the same engine.
+ */
+FURNACE_API const char* furnace_engine_last_error(FurnaceEngine* e);
+
+/**
+ * set how many times the song plays before rendering stops.
+ * @param loops the loop count, or -1 to loop forever.
+ */
+FURNACE_API void furnace_engine_set_loops(FurnaceEngine* e, int loops);
+
+/**
+ * start (or restart) playback from the beginning of the song.
+ * furnace_engine_load() already does this.
+ */
+FURNACE_API void furnace_engine_play(FurnaceEngine* e);
+
+/**
+ * render audio.
+ * @param out interleaved stereo output, of at least frames*2 floats.
+ * @param frames the number of frames to render.
+ * @return the number of frames rendered. this is less than frames once the
+ * song has ended; the rest of out is filled with silence.
+ */
+FURNACE_API size_t furnace_engine_render(FurnaceEngine* e, float* out, size_t frames);
+
+/**
+ * @return whether the song is still playing.
+ */
+FURNACE_API int furnace_engine_is_playing(FurnaceEngine* e);
+
+/**
+ * get the playback position.
+ * any of the pointers may be NULL.
+ * @param order the current order.
+ * @param row the current row.
+ * @param seconds the time played so far.
+ */
+FURNACE_API void furnace_engine_get_position(FurnaceEngine* e, int* order, int* row, double* seconds);
+
+/**
+ * get the song length.
+ * any of the pointers may be NULL.
+ * the duration covers one pass: from the start until the song stops or
+ * jumps back to its loop point. each further loop adds seconds-loopSeconds.
+ * @param orders the number of orders.
+ * @param rows the number of rows in a pattern.
+ * @param loopOrder the order the song loops to.
+ * @param loopRow the row the song loops to.
+ * @param seconds the duration of one pass.
+ * @param loopSeconds the time at which the loop point is first reached, or -1
+ * if the song stops instead of looping.
+ * @param frames the duration of one pass in frames at the output rate.
+ */
+FURNACE_API void furnace_engine_get_length(FurnaceEngine* e, int* orders, int* rows, int* loopOrder, int* loopRow, double* seconds, double* loopSeconds, size_t* frames);
+
+/**
+ * @return the number of systems (chips) in the song.
+ */
+FURNACE_API int furnace_engine_get_system_count(FurnaceEngine* e);
+
+/**
+ * @return the name of a system, or NULL if out of range.
+ */
+FURNACE_API const char* furnace_engine_get_system_name(FurnaceEngine* e, int sys);
+
+/**
+ * mute or unmute every channel of a system.
+ */
+FURNACE_API void furnace_engine_mute_system(FurnaceEngine* e, int sys, int mute);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "chipPlayer.h"
+#include "exportWriter.h"
+#include "mixer.h"
+#include "blip_buf.h"
+#include "../ta-log.h"
+#include <chrono>
+
+// blip_buf cannot tell how many clocks are needed for 4096 samples or more
+#define CHIP_PLAYER_BLOCK 2048
+
+int DivChipPlayer::addChip(DivSystem sys, unsigned int flags) {
+  if (chipCount>=32) return -1;
+  DivDispatchContainer& dc=disCont[chipCount];
+  dc.init(sys,parent,parent->getChannelCount(sys),rate,flags);
+  dc.setRates(rate);
+  dc.clear();
+  return chipCount++;
+}
+
+void DivChipPlayer::quitChips() {
+  for (int i=0; i<chipCount; i++) {
+    disCont[i].quit();
+  }
+  chipCount=0;
+  eventTime=0;
+  cycles=0;
+  ended=false;
+}
+
+size_t DivChipPlayer::renderBlock(float* outL, float* outR, size_t size) {
+  for (int i=0; i<chipCount; i++) {
+    DivDispatchContainer& dc=disCont[i];
+    dc.lastAvail=blip_samples_avail(dc.bb[0]);
+    if (dc.lastAvail>0) {
+      dc.flush(dc.lastAvail);
+    }
+    dc.runtotal=blip_clocks_needed(dc.bb[0],size-dc.lastAvail);
+    if (dc.runtotal>dc.bbInLen) {
+      delete[] dc.bbIn[0];
+      delete[] dc.bbIn[1];
+      dc.bbIn[0]=new short[dc.runtotal+256];
+      dc.bbIn[1]=new short[dc.runtotal+256];
+      dc.bbInLen=dc.runtotal+256;
+    }
+    dc.runPos=0;
+  }
+
+  // run the chips up to each event, then process it
+  size_t rendered=size;
+  double done=0;
+  while (done<size) {
+    if (cycles<=0) {
+      double next=ended?-1:runEvents();
+      if (next<0) {
+        ended=true;
+        if (rendered==size) rendered=(size_t)done;
+        cycles=size-done;
+      } else {
+        cycles+=(next-eventTime)*rate/eventRate;
+        eventTime=next;
+      }
+      continue;
+    }
+    double step=MIN(cycles,size-done);
+    done+=step;
+    cycles-=step;
+    for (int i=0; i<chipCount; i++) {
+      DivDispatchContainer& dc=disCont[i];
+      size_t target=(done>=size)?dc.runtotal:(size_t)(done*dc.runtotal/size);
+      if (target>dc.runPos) {
+        dc.acquire(dc.runPos,target-dc.runPos);
+        dc.runPos=target;
+      }
+    }
+  }
+
+  const DivMixFuncs* mix=divMixGetFuncs();
+  memset(outL,0,size*sizeof(float));
+  memset(outR,0,size*sizeof(float));
+  for (int i=0; i<chipCount; i++) {
+    DivDispatchContainer& dc=disCont[i];
+    dc.fillBuf(dc.runtotal,dc.lastAvail,size-dc.lastAvail);
+    float vol=dc.dispatch->getPostAmp();
+    short* inR=dc.bbOut[dc.dispatch->isStereo()?1:0];
+    mix->mixSystem(outL,outR,dc.bbOut[0],inR,vol,vol,size);
+  }
+  return rendered;
+}
+
+size_t DivChipPlayer::render(float* outL, float* outR, size_t len) {
+  size_t total=0;
+  while (total<len && !ended) {
+    size_t size=MIN(len-total,CHIP_PLAYER_BLOCK);
+    total+=renderBlock(outL+total,outR+total,size);
+  }
+  return total;
+}
+
+bool DivChipPlayer::renderWAV(const char* path) {
+  DivExportWriter writer;
+  if (path!=NULL) {
+    if (!writer.addOutput(path,rate,2,true)) {
+      lastError="could not open file";
+      return false;
+    }
+    writer.start(CHIP_PLAYER_BLOCK);
+  }
+
+  std::chrono::steady_clock::time_point timeStart=std::chrono::steady_clock::now();
+  float bufL[CHIP_PLAYER_BLOCK];
+  float bufR[CHIP_PLAYER_BLOCK];
+  size_t totalFrames=0;
+  while (!ended && !writer.hasFailed()) {
+    size_t got=render(bufL,bufR,CHIP_PLAYER_BLOCK);
+    totalFrames+=got;
+    if (path==NULL) continue;
+    DivExportBlock* block=writer.getBlock();
+    float* out=(float*)block->buf[0];
+    for (size_t i=0; i<got; i++) {
+      out[i<<1]=bufL[i];
+      out[(i<<1)|1]=bufR[i];
+    }
+    writer.putBlock(block,got);
+  }
+  if (!writer.finish()) {
+    lastError="could not write file";
+    return false;
+  }
+  double renderTime=std::chrono::duration<double>(std::chrono::steady_clock::now()-timeStart).count();
+  double audioTime=totalFrames/rate;
+  logI("rendered %.2fs of audio in %.2fs (%.1fx realtime).",audioTime,renderTime,(renderTime>0)?(audioTime/renderTime):0.0);
+  return true;
+}
+
+void DivChipPlayer::setTiming(bool enable) {
+  for (int i=0; i<chipCount; i++) {
+    disCont[i].timing=enable;
+    disCont[i].acquireTime=0;
+  }
+}
+
+int DivChipPlayer::getChipCount() {
+  return chipCount;
+}
+
+DivDispatch* DivChipPlayer::getChip(int index) {
+  if (index<0 || index>=chipCount) return NULL;
+  return disCont[index].dispatch;
+}
+
+double DivChipPlayer::getChipTime(int index) {
+  if (index<0 || index>=chipCount) return 0;
+  return disCont[index].acquireTime;
+}
+
+bool DivChipPlayer::isEnded() {
+  return ended;
+}
+
+const char* DivChipPlayer::getLastError() {
+  return lastError.c_str();
+}
+
+DivChipPlayer::DivChipPlayer():
+  parent(NULL),
+  chipCount(0),
+  rate(44100),
+  eventRate(44100),
+  eventTime(0),
+  cycles(0),
+  ended(false) {
+}
+
+DivChipPlayer::~DivChipPlayer() {
+  quitChips();
+}
@@ -0,0 +1,95 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _CHIPPLAYER_H
+#define _CHIPPLAYER_H
+#include "engine.h"
+
+/**
+ * runs a set of dispatches outside of the song, driven by timed events
+ * (register writes) instead of the sequencer.
+ * subclasses provide the events through runEvents().
+ */
+class DivChipPlayer {
+  size_t renderBlock(float* outL, float* outR, size_t size);
+
+  protected:
+    DivEngine* parent;
+    DivDispatchContainer disCont[32];
+    int chipCount;
+    // output rate, and the rate event times are in
+    double rate, eventRate;
+    // current event time
+    double eventTime;
+    // output samples until the next event
+    double cycles;
+    bool ended;
+    String lastError;
+
+    /**
+     * run the events due at eventTime.
+     * @return the time of the next event, or -1 if there are no more.
+     */
+    virtual double runEvents()=0;
+
+    /**
+     * add a chip.
+     * @return its index, or -1 if there are too many chips.
+     */
+    int addChip(DivSystem sys, unsigned int flags);
+
+    // quit all chips and rewind.
+    void quitChips();
+
+  public:
+    /**
+     * render audio.
+     * @return the number of frames rendered, which is less than len once the
+     * end is reached.
+     */
+    size_t render(float* outL, float* outR, size_t len);
+
+    /**
+     * render everything to a WAV file as fast as possible.
+     * if path is NULL, the output is discarded.
+     */
+    bool renderWAV(const char* path);
+
+    // measure the time spent in each chip core.
+    void setTiming(bool enable);
+
+    // get the number of chips.
+    int getChipCount();
+
+    // get a chip.
+    DivDispatch* getChip(int index);
+
+    // get the time spent in a chip core since timing was enabled, in seconds.
+    double getChipTime(int index);
+
+    // whether the end has been reached.
+    bool isEnded();
+
+    const char* getLastError();
+
+    DivChipPlayer();
+    virtual ~DivChipPlayer();
+};
+
+#endif
@@ -30,6 +30,10 @@
 
 bool DivEngine::saveConf() {
   configFile=configPath+String(CONFIG_FILE);
+  if (configReadOnly) {
+    logD("not saving config since it is read-only.");
+    return true;
+  }
   FILE* f=ps_fopen(configFile.c_str(),"wb");
   if (f==NULL) {
     logW("could not write config file! %s",strerror(errno));
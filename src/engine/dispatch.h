@@ -21,13 +21,15 @@
 #define _DISPATCH_H
 
 #include <stdlib.h>
+#include <string.h>
+#include <atomic>
 #include <vector>
 
 #define ONE_SEMITONE 2200
 
 #define DIV_NOTE_NULL 0x7fffffff
 
-#define addWrite(a,v) regWrites.push_back(DivRegWrite(a,v));
+#define addWrite(a,v) regWrites.push_back(DivRegWrite(a,v,regWriteTime));
 
 // HOW TO ADD A NEW COMMAND:
 // add it to this enum. then see playback.cpp.
@@ -196,11 +198,51 @@ struct DivRegWrite {
    */
   unsigned int addr;
   unsigned short val;
-  DivRegWrite(unsigned int a, unsigned short v):
-    addr(a), val(v) {}
+  /**
+   * when the write happened, in 44100Hz samples since the start of the tick.
+   * only set when the engine runs the chip during VGM export.
+   */
+  unsigned int time;
+  DivRegWrite(unsigned int a, unsigned short v, unsigned int t=0):
+    addr(a), val(v), time(t) {}
+};
+
+/**
+ * a ring buffer holding the output of a single channel at the dispatch's rate.
+ * only the audio thread writes to it. readers (oscilloscopes, stem export)
+ * may read up to readNeedle, which the engine publishes after rendering.
+ */
+struct DivDispatchOscBuffer {
+  unsigned short needle;
+  std::atomic<unsigned short> readNeedle;
+  unsigned int rate;
+  short data[65536];
+
+  void reset() {
+    memset(data,0,65536*sizeof(short));
+    needle=0;
+    readNeedle=0;
+  }
+  DivDispatchOscBuffer():
+    needle(0),
+    readNeedle(0),
+    rate(65536) {
+    memset(data,0,65536*sizeof(short));
+  }
+};
+
+/**
+ * the playback state of a dispatch (channel state, macros, effect memory...),
+ * without the state of the emulated chip.
+ * dispatches derive from this to hold a copy of their own state.
+ */
+struct DivDispatchSoftState {
+  virtual ~DivDispatchSoftState() {}
 };
 
 class DivEngine;
+class SafeReader;
+class SafeWriter;
 
 class DivDispatch {
   protected:
@@ -210,6 +252,48 @@ class DivDispatch {
      * please honor these variables if needed.
      */
     bool skipRegisterWrites, dumpWrites;
+    /**
+     * whether to write channel outputs to the oscilloscope buffers.
+     */
+    bool oscTap;
+
+    /**
+     * get the format of the chip states of this dispatch.
+     * @param version set to the version of the format. bump it whenever the
+     * body changes.
+     * @return a four-character chip ID, or NULL if chip states are not
+     * supported.
+     */
+    virtual const char* getStateFormat(int& version);
+
+    /**
+     * write the body of a chip state.
+     * write every field explicitly. pointers must not be written as they are.
+     */
+    virtual void writeState(SafeWriter* w);
+
+    /**
+     * read the body of a chip state and apply it.
+     * the whole body must be read and checked, including that nothing is
+     * left over, before anything is changed.
+     * @param r a SafeReader over the body only. reads past its end throw
+     * EndOfFileException.
+     * @return whether the body was valid and has been applied.
+     */
+    virtual bool readState(SafeReader& r);
+
+    /**
+     * enable or disable the output taps, allocating the buffers of the
+     * channels the first time taps are enabled.
+     * @param bufs the tap buffers of this dispatch, NULL until allocated.
+     * @param count the number of buffers.
+     */
+    void setOscBuffers(bool enable, DivDispatchOscBuffer** bufs, int count);
+
+    /**
+     * free the buffers allocated by setOscBuffers().
+     */
+    void freeOscBuffers(DivDispatchOscBuffer** bufs, int count);
   public:
     /**
      * the rate the samples are provided.
@@ -222,6 +306,11 @@ class DivDispatch {
      */
     int chipClock;
 
+    /**
+     * the time register writes are stamped with (see DivRegWrite::time).
+     */
+    unsigned int regWriteTime;
+
     /**
      * fill a buffer with sound data.
      * @param bufL the left or mono channel buffer.
@@ -287,6 +376,42 @@ class DivDispatch {
      */
     virtual void setState(void* state);
 
+    /**
+     * save the playback state of this dispatch, excluding the chip.
+     * used by the engine to build seek checkpoints.
+     * @return a new state (must be deleted by the caller), or NULL if not supported.
+     */
+    virtual DivDispatchSoftState* saveSoftState();
+
+    /**
+     * restore the playback state saved by saveSoftState().
+     * the state must have been saved by this same dispatch instance.
+     * the chip is not touched; call forceIns() afterwards.
+     * @param state the state.
+     */
+    virtual void loadSoftState(DivDispatchSoftState* state);
+
+    /**
+     * save the state of the emulated chip (registers, queued writes and
+     * emulator internals) as a binary blob.
+     * the blob starts with a header holding the chip ID, the version of the
+     * state format and the length of the body.
+     * the playback state is not included (see saveSoftState()).
+     * @param w the SafeWriter to write to.
+     * @return whether this dispatch supports chip states.
+     */
+    bool saveState(SafeWriter* w);
+
+    /**
+     * restore a chip state written by saveState(), possibly by another
+     * dispatch instance of the same kind.
+     * the whole blob is checked first. if it is rejected, neither the
+     * dispatch nor the reader are changed.
+     * @param r the SafeReader to read from.
+     * @return whether the state was loaded.
+     */
+    bool loadState(SafeReader& r);
+
     /**
      * mute a channel.
      * @param ch the channel to mute.
@@ -346,6 +471,43 @@ class DivDispatch {
      */
     virtual void setFlags(unsigned int flags);
 
+    /**
+     * get the number of emulation cores this dispatch can use.
+     * @return the count. cores are numbered from 0.
+     */
+    virtual int getCoreCount();
+
+    /**
+     * get the name of an emulation core.
+     * @param core the core.
+     * @return the name, or NULL if the dispatch has only one core.
+     */
+    virtual const char* getCoreName(int core);
+
+    /**
+     * get the core which uses the least CPU.
+     * @return the core.
+     */
+    virtual int getFastCore();
+
+    /**
+     * get the core which is the most accurate.
+     * @return the core.
+     */
+    virtual int getAccurateCore();
+
+    /**
+     * select the emulation core. must be called before init().
+     * @param core the core.
+     */
+    virtual void setCore(int core);
+
+    /**
+     * get the selected emulation core.
+     * @return the core.
+     */
+    virtual int getCore();
+
     /**
      * set skip reg writes.
      */
@@ -366,6 +528,11 @@ class DivDispatch {
      */
     virtual void notifyInsDeletion(void* ins);
 
+    /**
+     * notify that sample data changed (samples were rendered again).
+     */
+    virtual void notifySampleChange();
+
     /**
      * notify that playback stopped.
      */
@@ -381,6 +548,19 @@ class DivDispatch {
      */
     virtual void toggleRegisterDump(bool enable);
 
+    /**
+     * enable per-channel output taps.
+     * dispatches allocate their buffers the first time this is enabled.
+     */
+    virtual void toggleOscTap(bool enable);
+
+    /**
+     * get the output tap of a channel.
+     * @param chan the channel.
+     * @return a pointer, or NULL if this channel has no tap or taps were never enabled.
+     */
+    virtual DivDispatchOscBuffer* getOscBuffer(int chan);
+
     /**
      * get register writes.
      */
@@ -420,6 +600,7 @@ class DivDispatch {
      */
      virtual void quit();
 
+     DivDispatch();
      virtual ~DivDispatch();
 };
 
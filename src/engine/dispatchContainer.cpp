@@ -56,6 +56,7 @@
 #include "platform/dummy.h"
 #include "../ta-log.h"
 #include "song.h"
+#include <chrono>
 
 void DivDispatchContainer::setRates(double gotRate) {
   blip_set_rates(bb[0],dispatch->rate,gotRate);
@@ -67,7 +68,13 @@ void DivDispatchContainer::setQuality(bool lowQual) {
 }
 
 void DivDispatchContainer::acquire(size_t offset, size_t count) {
-  dispatch->acquire(bbIn[0],bbIn[1],offset,count);
+  if (timing) {
+    std::chrono::steady_clock::time_point timeStart=std::chrono::steady_clock::now();
+    dispatch->acquire(bbIn[0],bbIn[1],offset,count);
+    acquireTime+=std::chrono::duration<double>(std::chrono::steady_clock::now()-timeStart).count();
+  } else {
+    dispatch->acquire(bbIn[0],bbIn[1],offset,count);
+  }
 }
 
 void DivDispatchContainer::flush(size_t count) {
@@ -143,7 +150,7 @@ void DivDispatchContainer::clear() {
   prevSample[1]=temp[1];*/
 }
 
-void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, unsigned int flags) {
+void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, unsigned int flags, DivCoreQuality quality) {
   if (dispatch!=NULL) return;
 
   bb[0]=blip_new(32768);
@@ -171,11 +178,11 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       break;
     case DIV_SYSTEM_YM2612:
       dispatch=new DivPlatformGenesis;
-      ((DivPlatformGenesis*)dispatch)->setYMFM(eng->getConfInt("ym2612Core",0));
+      dispatch->setCore(eng->getConfInt("ym2612Core",0));
       break;
     case DIV_SYSTEM_YM2612_EXT:
       dispatch=new DivPlatformGenesisExt;
-      ((DivPlatformGenesisExt*)dispatch)->setYMFM(eng->getConfInt("ym2612Core",0));
+      dispatch->setCore(eng->getConfInt("ym2612Core",0));
       break;
     case DIV_SYSTEM_SMS:
       dispatch=new DivPlatformSMS;
@@ -199,7 +206,7 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       break;
     case DIV_SYSTEM_YM2151:
       dispatch=new DivPlatformArcade;
-      ((DivPlatformArcade*)dispatch)->setYMFM(eng->getConfInt("arcadeCore",0)==0);
+      dispatch->setCore(eng->getConfInt("arcadeCore",0));
       break;
     case DIV_SYSTEM_YM2610:
     case DIV_SYSTEM_YM2610_FULL:
@@ -268,7 +275,7 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       int saaCore=eng->getConfInt("saaCore",1);
       if (saaCore<0 || saaCore>2) saaCore=0;
       dispatch=new DivPlatformSAA1099;
-      ((DivPlatformSAA1099*)dispatch)->setCore((DivSAACores)saaCore);
+      dispatch->setCore(saaCore);
       break;
     }
     case DIV_SYSTEM_PCSPKR:
@@ -316,6 +323,12 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       dispatch=new DivPlatformDummy;
       break;
   }
+  // the core settings above are used unless a tier is requested
+  if (quality==DIV_CORE_FAST) {
+    dispatch->setCore(dispatch->getFastCore());
+  } else if (quality==DIV_CORE_ACCURATE) {
+    dispatch->setCore(dispatch->getAccurateCore());
+  }
   dispatch->init(eng,chanCount,gotRate,flags);
 }
 
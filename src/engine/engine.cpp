@@ -23,7 +23,10 @@
 #include "safeReader.h"
 #include "../ta-log.h"
 #include "../fileutils.h"
+#include "exportWriter.h"
+#ifdef HAVE_SDL2
 #include "../audio/sdl.h"
+#endif
 #include <stdexcept>
 #ifndef _WIN32
 #include <unistd.h>
@@ -171,6 +174,116 @@ void DivEngine::walkSong(int& loopOrder, int& loopRow, int& loopEnd) {
   }
 }
 
+double DivEngine::timeSong(double& loopSeconds) {
+  loopSeconds=-1;
+  if (song.ordersLen<1 || song.patLen<1) return 0;
+  // the time at which each row is first reached
+  std::vector<double> rowTime(song.ordersLen*song.patLen,-1.0);
+  double curTime=0;
+  double tickDivider=60;
+  if (song.customTempo) {
+    tickDivider=song.hz;
+  } else {
+    tickDivider=song.pal?60:50;
+  }
+  unsigned char walkSpeed1=song.speed1;
+  unsigned char walkSpeed2=song.speed2;
+  bool walkSpeedAB=false;
+  int order=0;
+  int row=0;
+  while (true) {
+    if (rowTime[order*song.patLen+row]>=0) {
+      // should not happen as jumps back end the pass, but stay safe
+      loopSeconds=rowTime[order*song.patLen+row];
+      return curTime;
+    }
+    rowTime[order*song.patLen+row]=curTime;
+
+    // same as processRow(), for the effects which change timing or position
+    int jumpOrder=-1;
+    int jumpRow=0;
+    for (int i=0; i<chans; i++) {
+      DivPattern* pat=song.pat[i].getPatternForRow(song.orders.ord[i][order],row);
+      for (int j=0; j<song.pat[i].effectRows; j++) {
+        short effect=pat->data[row][4+(j<<1)];
+        short effectVal=pat->data[row][5+(j<<1)];
+        if (effectVal==-1) effectVal=0;
+        switch (effect) {
+          case 0x09:
+            if (effectVal>0) walkSpeed1=effectVal;
+            break;
+          case 0x0f:
+            if (effectVal>0) walkSpeed2=effectVal;
+            break;
+          case 0x0b:
+            if (jumpOrder==-1) {
+              jumpOrder=effectVal;
+              jumpRow=0;
+            }
+            break;
+          case 0x0d:
+            if (jumpOrder<0 && (order<(song.ordersLen-1) || !song.ignoreJumpAtEnd)) {
+              jumpOrder=-2;
+              jumpRow=effectVal;
+            }
+            break;
+          case 0xc0: case 0xc1: case 0xc2: case 0xc3:
+            tickDivider=(double)(((effect&0x3)<<8)|effectVal);
+            if (tickDivider<10) tickDivider=10;
+            break;
+          case 0xf0:
+            tickDivider=(double)effectVal*2.0/5.0;
+            if (tickDivider<10) tickDivider=10;
+            break;
+          case 0xff:
+            // the song stops before this row plays
+            return curTime;
+        }
+      }
+    }
+
+    // go to the next row, same as nextRow()
+    bool endOfSong=false;
+    if (jumpOrder!=-1) {
+      row=jumpRow;
+      if (jumpOrder==-2) jumpOrder=order+1;
+      if (jumpOrder<=order) endOfSong=true;
+      order=jumpOrder;
+      if (order>=song.ordersLen) {
+        order=0;
+        endOfSong=true;
+      }
+    } else if (++row>=song.patLen) {
+      row=0;
+      if (++order>=song.ordersLen) {
+        order=0;
+        endOfSong=true;
+      }
+    }
+    if (row>=song.patLen) row=song.patLen-1;
+
+    int rowTicks;
+    if (song.brokenSpeedSel) {
+      if ((song.patLen&1) && order&1) {
+        rowTicks=((row&1)?walkSpeed2:walkSpeed1)*(song.timeBase+1);
+      } else {
+        rowTicks=((row&1)?walkSpeed1:walkSpeed2)*(song.timeBase+1);
+      }
+    } else {
+      rowTicks=(walkSpeedAB?walkSpeed2:walkSpeed1)*(song.timeBase+1);
+      walkSpeedAB=!walkSpeedAB;
+    }
+    curTime+=(double)rowTicks/tickDivider;
+
+    if (endOfSong) {
+      // a loop point this pass never reached can't be timed. report it at the end
+      loopSeconds=rowTime[order*song.patLen+row];
+      if (loopSeconds<0) loopSeconds=curTime;
+      return curTime;
+    }
+  }
+}
+
 void _runExportThread(DivEngine* caller) {
   caller->runExportThread();
 }
@@ -179,151 +292,228 @@ bool DivEngine::isExporting() {
   return exporting;
 }
 
-#define EXPORT_BUFSIZE 2048
+void DivEngine::restoreAudioAfterExport() {
+  if (initAudioBackend()) {
+    for (int i=0; i<song.systemLen; i++) {
+      disCont[i].setRates(got.rate);
+      disCont[i].setQuality(lowQuality);
+    }
+    if (!output->setRun(true)) {
+      logE("error while activating audio!");
+    }
+  }
+}
+
+struct DivExportStem {
+  DivDispatchOscBuffer* buf;
+  blip_buffer_t* bb;
+  unsigned short readPos;
+  short prevSample, lastOut;
+  float volL, volR;
+};
+
+void DivEngine::runStemExport(size_t bufSize) {
+  std::vector<DivExportStem> stems;
+  DivExportWriter writer;
+  double maxRate=got.rate;
+  bool success=true;
 
-void DivEngine::runExportThread() {
+  for (int i=0; i<chans; i++) {
+    isMuted[i]=false;
+    if (disCont[dispatchOfChan[i]].dispatch!=NULL) {
+      disCont[dispatchOfChan[i]].dispatch->muteChannel(dispatchChanOfChan[i],false);
+    }
+  }
+
+  for (int i=0; i<chans; i++) {
+    // extended channels share the output of their parent
+    if (i>0 && getChannelType(i)==5 && getChannelType(i-1)==5) continue;
+    String fname=fmt::sprintf("%s_c%02d.wav",exportPath,i+1);
+    logI("- %s",fname.c_str());
+    if (!writer.addOutput(fname,got.rate,2,true)) {
+      success=false;
+      break;
+    }
+
+    int sys=dispatchOfChan[i];
+    DivDispatch* disp=disCont[sys].dispatch;
+    DivExportStem stem;
+    stem.buf=getOscBuffer(i);
+    stem.bb=blip_new(32768);
+    blip_set_rates(stem.bb,disp->rate,got.rate);
+    stem.readPos=0;
+    stem.prevSample=0;
+    stem.lastOut=0;
+    stem.volL=((float)song.systemVol[sys]/64.0f)*((float)MIN(127,127-(int)song.systemPan[sys])/127.0f)*song.masterVol*disp->getPostAmp()/32768.0f;
+    stem.volR=((float)song.systemVol[sys]/64.0f)*((float)MIN(127,127+(int)song.systemPan[sys])/127.0f)*song.masterVol*disp->getPostAmp()/32768.0f;
+    stems.push_back(stem);
+    if (disp->rate>maxRate) maxRate=disp->rate;
+  }
+
+  if (success) {
+    // the taps hold 65536 samples. keep well below that between reads,
+    // and within what blip_buf renders at once.
+    size_t maxSize=(size_t)(16384.0*got.rate/maxRate);
+    if (maxSize>blip_max_frame) maxSize=blip_max_frame;
+    if (maxSize<64) maxSize=64;
+    if (bufSize>maxSize) bufSize=maxSize;
+
+    float* outBuf[2];
+    outBuf[0]=new float[bufSize];
+    outBuf[1]=new float[bufSize];
+    short* stemBuf=new short[bufSize];
+
+    playSub(false);
+    for (DivExportStem& i: stems) {
+      i.readPos=i.buf->readNeedle;
+    }
+    writer.start(bufSize);
+
+    logI("rendering to files...");
+
+    while (playing) {
+      nextBuf(NULL,outBuf,0,2,bufSize);
+      DivExportBlock* block=writer.getBlock();
+      for (size_t i=0; i<stems.size(); i++) {
+        DivExportStem& stem=stems[i];
+        unsigned short needle=stem.buf->readNeedle;
+        unsigned short count=needle-stem.readPos;
+        for (unsigned short j=0; j<count; j++) {
+          short sample=stem.buf->data[stem.readPos++];
+          if (sample!=stem.prevSample) {
+            blip_add_delta(stem.bb,j,sample-stem.prevSample);
+            stem.prevSample=sample;
+          }
+        }
+        blip_end_frame(stem.bb,count);
+
+        size_t avail=MIN((size_t)blip_samples_avail(stem.bb),totalProcessed);
+        blip_read_samples(stem.bb,stemBuf,avail,0);
+        if (avail>0) stem.lastOut=stemBuf[avail-1];
+        // rounding may leave us a sample short; hold the last one
+        for (size_t j=avail; j<totalProcessed; j++) {
+          stemBuf[j]=stem.lastOut;
+        }
+
+        float* dest=(float*)block->buf[i];
+        for (size_t j=0; j<totalProcessed; j++) {
+          dest[j<<1]=MAX(-1.0f,MIN(1.0f,stemBuf[j]*stem.volL));
+          dest[1+(j<<1)]=MAX(-1.0f,MIN(1.0f,stemBuf[j]*stem.volR));
+        }
+      }
+      writer.putBlock(block,totalProcessed);
+      if (writer.hasFailed() || stopExport) break;
+    }
+
+    delete[] outBuf[0];
+    delete[] outBuf[1];
+    delete[] stemBuf;
+  }
+
+  writer.finish();
+
+  for (DivExportStem& i: stems) {
+    blip_delete(i.bb);
+  }
+}
+
+void DivEngine::renderExport() {
+  size_t bufSize=exportBufSize;
   switch (exportMode) {
     case DIV_EXPORT_MODE_ONE: {
-      SNDFILE* sf;
-      SF_INFO si;
-      si.samplerate=got.rate;
-      si.channels=2;
-      si.format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
-
-      sf=sf_open(exportPath.c_str(),SFM_WRITE,&si);
-      if (sf==NULL) {
-        logE("could not open file for writing! (%s)",sf_strerror(NULL));
+      DivExportWriter writer;
+      if (!writer.addOutput(exportPath,got.rate,2,true)) {
         exporting=false;
         return;
       }
 
-      float* outBuf[3];
-      outBuf[0]=new float[EXPORT_BUFSIZE];
-      outBuf[1]=new float[EXPORT_BUFSIZE];
-      outBuf[2]=new float[EXPORT_BUFSIZE*2];
+      float* outBuf[2];
+      outBuf[0]=new float[bufSize];
+      outBuf[1]=new float[bufSize];
 
       // take control of audio output
       deinitAudioBackend();
       playSub(false);
+      writer.start(bufSize);
 
       logI("rendering to file...");
 
       while (playing) {
-        nextBuf(NULL,outBuf,0,2,EXPORT_BUFSIZE);
-        for (int i=0; i<EXPORT_BUFSIZE; i++) {
-          outBuf[2][i<<1]=MAX(-1.0f,MIN(1.0f,outBuf[0][i]));
-          outBuf[2][1+(i<<1)]=MAX(-1.0f,MIN(1.0f,outBuf[1][i]));
-        }
-        if (totalProcessed>EXPORT_BUFSIZE) {
-          logE("error: total processed is bigger than export bufsize! %d>%d",totalProcessed,EXPORT_BUFSIZE);
-        }
-        if (sf_writef_float(sf,outBuf[2],totalProcessed)!=(int)totalProcessed) {
-          logE("error: failed to write entire buffer!");
-          break;
+        nextBuf(NULL,outBuf,0,2,bufSize);
+        DivExportBlock* block=writer.getBlock();
+        float* dest=(float*)block->buf[0];
+        for (size_t i=0; i<totalProcessed; i++) {
+          dest[i<<1]=MAX(-1.0f,MIN(1.0f,outBuf[0][i]));
+          dest[1+(i<<1)]=MAX(-1.0f,MIN(1.0f,outBuf[1][i]));
         }
+        writer.putBlock(block,totalProcessed);
+        if (writer.hasFailed()) break;
       }
 
+      writer.finish();
+
       delete[] outBuf[0];
       delete[] outBuf[1];
-      delete[] outBuf[2];
 
-      if (sf_close(sf)!=0) {
-        logE("could not close audio file!");
-      }
       exporting=false;
-
-      if (initAudioBackend()) {
-        for (int i=0; i<song.systemLen; i++) {
-          disCont[i].setRates(got.rate);
-          disCont[i].setQuality(lowQuality);
-        }
-        if (!output->setRun(true)) {
-          logE("error while activating audio!");
-        }
-      }
+      restoreAudioAfterExport();
       logI("done!");
       break;
     }
     case DIV_EXPORT_MODE_MANY_SYS: {
-      SNDFILE* sf[32];
-      SF_INFO si[32];
-      String fname[32];
+      DivExportWriter writer;
       for (int i=0; i<song.systemLen; i++) {
-        sf[i]=NULL;
-        si[i].samplerate=got.rate;
-        if (disCont[i].dispatch->isStereo()) {
-          si[i].channels=2;
-        } else {
-          si[i].channels=1;
-        }
-        si[i].format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
-      }
-
-      for (int i=0; i<song.systemLen; i++) {
-        fname[i]=fmt::sprintf("%s_s%02d.wav",exportPath,i+1);
-        logI("- %s",fname[i].c_str());
-        sf[i]=sf_open(fname[i].c_str(),SFM_WRITE,&si[i]);
-        if (sf[i]==NULL) {
-          logE("could not open file for writing! (%s)",sf_strerror(NULL));
-          for (int j=0; j<i; j++) {
-            sf_close(sf[i]);
-          }
+        String fname=fmt::sprintf("%s_s%02d.wav",exportPath,i+1);
+        logI("- %s",fname.c_str());
+        if (!writer.addOutput(fname,got.rate,disCont[i].dispatch->isStereo()?2:1,false)) {
+          writer.finish();
+          exporting=false;
           return;
         }
       }
 
       float* outBuf[2];
-      outBuf[0]=new float[EXPORT_BUFSIZE];
-      outBuf[1]=new float[EXPORT_BUFSIZE];
-      short* sysBuf=new short[EXPORT_BUFSIZE*2];
+      outBuf[0]=new float[bufSize];
+      outBuf[1]=new float[bufSize];
 
       // take control of audio output
       deinitAudioBackend();
       playSub(false);
+      writer.start(bufSize);
 
       logI("rendering to files...");
 
       while (playing) {
-        nextBuf(NULL,outBuf,0,2,EXPORT_BUFSIZE);
-        for (int i=0; i<song.systemLen; i++) {
-          for (int j=0; j<EXPORT_BUFSIZE; j++) {
+        DivExportBlock* block=writer.getBlock();
+        // the system outputs only hold as much as blip_buf renders at once,
+        // so fill the block in several steps
+        size_t blockLen=0;
+        while (playing && blockLen<bufSize) {
+          nextBuf(NULL,outBuf,0,2,MIN(bufSize-blockLen,(size_t)blip_max_frame));
+          for (int i=0; i<song.systemLen; i++) {
+            short* sysBuf=(short*)block->buf[i];
             if (!disCont[i].dispatch->isStereo()) {
-              sysBuf[j]=disCont[i].bbOut[0][j];
+              memcpy(sysBuf+blockLen,disCont[i].bbOut[0],totalProcessed*sizeof(short));
             } else {
-              sysBuf[j<<1]=disCont[i].bbOut[0][j];
-              sysBuf[1+(j<<1)]=disCont[i].bbOut[1][j];
+              for (size_t j=0; j<totalProcessed; j++) {
+                sysBuf[(blockLen+j)<<1]=disCont[i].bbOut[0][j];
+                sysBuf[1+((blockLen+j)<<1)]=disCont[i].bbOut[1][j];
+              }
             }
           }
-          if (totalProcessed>EXPORT_BUFSIZE) {
-            logE("error: total processed is bigger than export bufsize! (%d) %d>%d",i,totalProcessed,EXPORT_BUFSIZE);
-          }
-          if (sf_writef_short(sf[i],sysBuf,totalProcessed)!=(int)totalProcessed) {
-            logE("error: failed to write entire buffer! (%d)",i);
-            break;
-          }
+          blockLen+=totalProcessed;
         }
+        writer.putBlock(block,blockLen);
+        if (writer.hasFailed()) break;
       }
 
+      writer.finish();
+
       delete[] outBuf[0];
       delete[] outBuf[1];
-      delete[] sysBuf;
 
-      for (int i=0; i<song.systemLen; i++) {
-        if (sf_close(sf[i])!=0) {
-          logE("could not close audio file!");
-        }
-      }
       exporting=false;
-
-      if (initAudioBackend()) {
-        for (int i=0; i<song.systemLen; i++) {
-          disCont[i].setRates(got.rate);
-          disCont[i].setQuality(lowQuality);
-        }
-        if (!output->setRun(true)) {
-          logE("error while activating audio!");
-        }
-      }
+      restoreAudioAfterExport();
       logI("done!");
       break;
     }
@@ -331,26 +521,38 @@ void DivEngine::runExportThread() {
       // take control of audio output
       deinitAudioBackend();
 
-      float* outBuf[3];
-      outBuf[0]=new float[EXPORT_BUFSIZE];
-      outBuf[1]=new float[EXPORT_BUFSIZE];
-      outBuf[2]=new float[EXPORT_BUFSIZE*2];
+      // render all channels at once if every one of them has an output tap
+      enableChanOsc(true);
+      bool singlePass=true;
+      for (int i=0; i<chans; i++) {
+        if (i>0 && getChannelType(i)==5 && getChannelType(i-1)==5) continue;
+        if (getOscBuffer(i)==NULL) {
+          singlePass=false;
+          break;
+        }
+      }
+      if (singlePass) {
+        runStemExport(bufSize);
+        enableChanOsc(false);
+        exporting=false;
+        restoreAudioAfterExport();
+        logI("done!");
+        break;
+      }
+      enableChanOsc(false);
+
+      float* outBuf[2];
+      outBuf[0]=new float[bufSize];
+      outBuf[1]=new float[bufSize];
       int loopCount=remainingLoops;
 
       logI("rendering to files...");
       
       for (int i=0; i<chans; i++) {
-        SNDFILE* sf;
-        SF_INFO si;
+        DivExportWriter writer;
         String fname=fmt::sprintf("%s_c%02d.wav",exportPath,i+1);
         logI("- %s",fname.c_str());
-        si.samplerate=got.rate;
-        si.channels=2;
-        si.format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
-
-        sf=sf_open(fname.c_str(),SFM_WRITE,&si);
-        if (sf==NULL) {
-          logE("could not open file for writing! (%s)",sf_strerror(NULL));
+        if (!writer.addOutput(fname,got.rate,2,true)) {
           break;
         }
 
@@ -373,31 +575,28 @@ void DivEngine::runExportThread() {
         curOrder=0;
         remainingLoops=loopCount;
         playSub(false);
+        writer.start(bufSize);
 
         while (playing) {
-          nextBuf(NULL,outBuf,0,2,EXPORT_BUFSIZE);
-          for (int j=0; j<EXPORT_BUFSIZE; j++) {
-            outBuf[2][j<<1]=MAX(-1.0f,MIN(1.0f,outBuf[0][j]));
-            outBuf[2][1+(j<<1)]=MAX(-1.0f,MIN(1.0f,outBuf[1][j]));
-          }
-          if (totalProcessed>EXPORT_BUFSIZE) {
-            logE("error: total processed is bigger than export bufsize! %d>%d",totalProcessed,EXPORT_BUFSIZE);
-          }
-          if (sf_writef_float(sf,outBuf[2],totalProcessed)!=(int)totalProcessed) {
-            logE("error: failed to write entire buffer!");
-            break;
+          nextBuf(NULL,outBuf,0,2,bufSize);
+          DivExportBlock* block=writer.getBlock();
+          float* dest=(float*)block->buf[0];
+          for (size_t j=0; j<totalProcessed; j++) {
+            dest[j<<1]=MAX(-1.0f,MIN(1.0f,outBuf[0][j]));
+            dest[1+(j<<1)]=MAX(-1.0f,MIN(1.0f,outBuf[1][j]));
           }
+          writer.putBlock(block,totalProcessed);
+          if (writer.hasFailed()) break;
         }
 
-        if (sf_close(sf)!=0) {
-          logE("could not close audio file!");
-        }
+        writer.finish();
 
         if (getChannelType(i)==5) {
           i++;
           while (true) {
             if (i>=chans) break;
             if (getChannelType(i)!=5) break;
+            i++;
           }
           i--;
         }
@@ -408,7 +607,6 @@ void DivEngine::runExportThread() {
 
       delete[] outBuf[0];
       delete[] outBuf[1];
-      delete[] outBuf[2];
 
       for (int i=0; i<chans; i++) {
         isMuted[i]=false;
@@ -417,25 +615,26 @@ void DivEngine::runExportThread() {
         }
       }
 
-      if (initAudioBackend()) {
-        for (int i=0; i<song.systemLen; i++) {
-          disCont[i].setRates(got.rate);
-          disCont[i].setQuality(lowQuality);
-        }
-        if (!output->setRun(true)) {
-          logE("error while activating audio!");
-        }
-      }
+      restoreAudioAfterExport();
       logI("done!");
       break;
     }
   }
+}
+
+void DivEngine::runExportThread() {
+  renderExport();
+  // go back to the cores used for live playback
+  setCoreQuality(getConfCoreQuality("liveCoreQuality",DIV_CORE_DEFAULT));
   stopExport=false;
 }
 
 bool DivEngine::saveAudio(const char* path, int loops, DivAudioExportModes mode) {
   exportPath=path;
   exportMode=mode;
+  exportBufSize=getConfInt("exportBufSize",8192);
+  if (exportBufSize<512) exportBufSize=512;
+  if (exportBufSize>16384) exportBufSize=16384;
   if (exportMode!=DIV_EXPORT_MODE_ONE) {
     // remove extension
     String lowerCase=exportPath;
@@ -450,6 +649,8 @@ bool DivEngine::saveAudio(const char* path, int loops, DivAudioExportModes mode)
   exporting=true;
   stopExport=false;
   stop();
+  // render with the accurate cores unless told otherwise
+  setCoreQuality(getConfCoreQuality("exportCoreQuality",DIV_CORE_ACCURATE));
   repeatPattern=false;
   setOrder(0);
   remainingLoops=loops;
@@ -470,19 +671,11 @@ bool DivEngine::haltAudioFile() {
 }
 
 void DivEngine::notifyInsChange(int ins) {
-  BUSY_BEGIN;
-  for (int i=0; i<song.systemLen; i++) {
-    disCont[i].dispatch->notifyInsChange(ins);
-  }
-  BUSY_END;
+  pushLiveEvent(DivLiveEvent(DIV_LIVE_INS_CHANGE,ins));
 }
 
 void DivEngine::notifyWaveChange(int wave) {
-  BUSY_BEGIN;
-  for (int i=0; i<song.systemLen; i++) {
-    disCont[i].dispatch->notifyWaveChange(wave);
-  }
-  BUSY_END;
+  pushLiveEvent(DivLiveEvent(DIV_LIVE_WAVE_CHANGE,wave));
 }
 
 void DivEngine::renderSamplesP() {
@@ -491,13 +684,28 @@ void DivEngine::renderSamplesP() {
   BUSY_END;
 }
 
+static void _renderSample(void* s) {
+  ((DivSample*)s)->render();
+}
+
 void DivEngine::renderSamples() {
   sPreview.sample=-1;
   sPreview.pos=0;
 
-  // step 1: render samples
+  // step 1: render samples which changed since the last time
+  std::chrono::high_resolution_clock::time_point renderStart=std::chrono::high_resolution_clock::now();
+  int rendered=0;
   for (int i=0; i<song.sampleLen; i++) {
-    song.sample[i]->render();
+    DivSample* s=song.sample[i];
+    uint64_t hash=s->getDataHash();
+    if (hash==s->renderHash) continue;
+    s->renderHash=hash;
+    renderPool->push(_renderSample,s);
+    rendered++;
+  }
+  renderPool->wait();
+  if (rendered>0) {
+    logD("rendered %d/%d samples in %.2fms",rendered,song.sampleLen,std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-renderStart).count());
   }
 
   // step 2: allocate ADPCM-A samples
@@ -612,6 +820,11 @@ void DivEngine::renderSamples() {
     memPos+=paddedLen;
   }
   x1_010MemLen=memPos+256;
+
+  // step 6: let dispatches resolve their samples again
+  for (int i=0; i<song.systemLen; i++) {
+    if (disCont[i].dispatch!=NULL) disCont[i].dispatch->notifySampleChange();
+  }
 }
 
 void DivEngine::createNew(const int* description) {
@@ -718,16 +931,20 @@ bool DivEngine::removeSystem(int index) {
 
 void DivEngine::poke(int sys, unsigned int addr, unsigned short val) {
   if (sys<0 || sys>=song.systemLen) return;
-  BUSY_BEGIN;
-  disCont[sys].dispatch->poke(addr,val);
-  BUSY_END;
+  DivLiveEvent ev(DIV_LIVE_POKE,sys);
+  ev.addr=addr;
+  ev.val=val;
+  pushLiveEvent(ev);
 }
 
 void DivEngine::poke(int sys, std::vector<DivRegWrite>& wlist) {
   if (sys<0 || sys>=song.systemLen) return;
-  BUSY_BEGIN;
-  disCont[sys].dispatch->poke(wlist);
-  BUSY_END;
+  for (DivRegWrite& i: wlist) {
+    DivLiveEvent ev(DIV_LIVE_POKE,sys);
+    ev.addr=i.addr;
+    ev.val=i.val;
+    pushLiveEvent(ev);
+  }
 }
 
 String DivEngine::getLastError() {
@@ -775,6 +992,26 @@ void DivEngine::setLoops(int loops) {
   remainingLoops=loops;
 }
 
+void DivEngine::enableChanOsc(bool enable) {
+  BUSY_BEGIN;
+  if (enable) {
+    chanOscUsers++;
+  } else if (chanOscUsers>0) {
+    chanOscUsers--;
+  }
+  for (int i=0; i<song.systemLen; i++) {
+    if (disCont[i].dispatch!=NULL) {
+      disCont[i].dispatch->toggleOscTap(chanOscUsers>0);
+    }
+  }
+  BUSY_END;
+}
+
+DivDispatchOscBuffer* DivEngine::getOscBuffer(int ch) {
+  if (ch<0 || ch>=chans) return NULL;
+  return disCont[dispatchOfChan[ch]].dispatch->getOscBuffer(dispatchChanOfChan[ch]);
+}
+
 DivChannelState* DivEngine::getChanState(int ch) {
   if (ch<0 || ch>=chans) return NULL;
   return &chan[ch];
@@ -785,6 +1022,11 @@ void* DivEngine::getDispatchChanState(int ch) {
   return disCont[dispatchOfChan[ch]].dispatch->getChanState(dispatchChanOfChan[ch]);
 }
 
+DivDispatch* DivEngine::getDispatch(int index) {
+  if (index<0 || index>=song.systemLen) return NULL;
+  return disCont[index].dispatch;
+}
+
 unsigned char* DivEngine::getRegisterPool(int sys, int& size, int& depth) {
   if (sys<0 || sys>=song.systemLen) return NULL;
   if (disCont[sys].dispatch==NULL) return NULL;
@@ -834,11 +1076,26 @@ void DivEngine::playSub(bool preserveDrift, int goalRow) {
   playing=true;
   skipping=true;
   for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(true);
+  // resume from the closest checkpoint and record new ones on the way
+  bool useSeekIndex=(!preserveDrift && goal>0 && seekIndexInterval>0);
+  std::vector<uint64_t> orderHash;
+  if (useSeekIndex) {
+    seekPath.clear();
+    seekPath.push_back(0);
+    seekSongHash=hashSeekSong();
+    loadSeekCheckpoint(goal);
+    orderHash.resize(song.ordersLen,0);
+  }
   while (playing && curOrder<goal) {
+    int prevOrder=curOrder;
     if (nextTick(preserveDrift)) {
       skipping=false;
       return;
     }
+    if (useSeekIndex && curOrder!=prevOrder) {
+      seekPath.push_back(curOrder);
+      saveSeekCheckpoint(orderHash);
+    }
   }
   int oldOrder=curOrder;
   while (playing && curRow<goalRow) {
@@ -1009,6 +1266,7 @@ const char** DivEngine::getRegisterSheet(int sys) {
 }
 
 void DivEngine::recalcChans() {
+  resetSeekIndex();
   chans=0;
   int chanIndex=0;
   for (int i=0; i<song.systemLen; i++) {
@@ -1214,6 +1472,10 @@ int DivEngine::getTotalSeconds() {
   return totalSeconds;
 }
 
+size_t DivEngine::getProcessedFrames() {
+  return totalProcessed;
+}
+
 int DivEngine::getTotalTicks() {
   return totalTicks;
 }
@@ -1322,6 +1584,7 @@ int DivEngine::addInstrument(int refChan) {
   ins->name=fmt::sprintf("Instrument %d",insCount);
   ins->type=prefType;
   saveLock.lock();
+  resetSeekIndex();
   song.ins.push_back(ins);
   song.insLen=insCount+1;
   saveLock.unlock();
@@ -1332,6 +1595,7 @@ int DivEngine::addInstrument(int refChan) {
 int DivEngine::addInstrumentPtr(DivInstrument* which) {
   BUSY_BEGIN;
   saveLock.lock();
+  resetSeekIndex();
   song.ins.push_back(which);
   song.insLen=song.ins.size();
   saveLock.unlock();
@@ -1346,6 +1610,7 @@ void DivEngine::delInstrument(int index) {
     for (int i=0; i<song.systemLen; i++) {
       disCont[i].dispatch->notifyInsDeletion(song.ins[index]);
     }
+    resetSeekIndex();
     delete song.ins[index];
     song.ins.erase(song.ins.begin()+index);
     song.insLen=song.ins.size();
@@ -1369,6 +1634,7 @@ int DivEngine::addWave() {
   saveLock.lock();
   DivWavetable* wave=new DivWavetable;
   int waveCount=(int)song.wave.size();
+  resetSeekIndex();
   song.wave.push_back(wave);
   song.waveLen=waveCount+1;
   saveLock.unlock();
@@ -1489,6 +1755,7 @@ bool DivEngine::addWaveFromFile(const char* path) {
   BUSY_BEGIN;
   saveLock.lock();
   int waveCount=(int)song.wave.size();
+  resetSeekIndex();
   song.wave.push_back(wave);
   song.waveLen=waveCount+1;
   saveLock.unlock();
@@ -1500,6 +1767,7 @@ void DivEngine::delWave(int index) {
   BUSY_BEGIN;
   saveLock.lock();
   if (index>=0 && index<(int)song.wave.size()) {
+    resetSeekIndex();
     delete song.wave[index];
     song.wave.erase(song.wave.begin()+index);
     song.waveLen=song.wave.size();
@@ -1699,6 +1967,7 @@ void DivEngine::delSample(int index) {
   BUSY_BEGIN;
   saveLock.lock();
   if (index>=0 && index<(int)song.sample.size()) {
+    resetSeekIndex();
     delete song.sample[index];
     song.sample.erase(song.sample.begin()+index);
     song.sampleLen=song.sample.size();
@@ -1774,7 +2043,7 @@ void DivEngine::deepCloneOrder(bool where) {
         order[i]=j;
         DivPattern* oldPat=song.pat[i].getPattern(origOrd,false);
         DivPattern* pat=song.pat[i].getPattern(j,true);
-        memcpy(pat->data,oldPat->data,256*32*sizeof(short));
+        memcpy(pat->data,oldPat->data,MIN(pat->rows,oldPat->rows)*sizeof(*pat->data));
         logD("found at %d",j);
         didNotFind=false;
         break;
@@ -1887,6 +2156,7 @@ bool DivEngine::moveInsUp(int which) {
   BUSY_BEGIN;
   DivInstrument* prev=song.ins[which];
   saveLock.lock();
+  resetSeekIndex();
   song.ins[which]=song.ins[which-1];
   song.ins[which-1]=prev;
   exchangeIns(which,which-1);
@@ -1900,6 +2170,7 @@ bool DivEngine::moveWaveUp(int which) {
   BUSY_BEGIN;
   DivWavetable* prev=song.wave[which];
   saveLock.lock();
+  resetSeekIndex();
   song.wave[which]=song.wave[which-1];
   song.wave[which-1]=prev;
   saveLock.unlock();
@@ -1915,6 +2186,9 @@ bool DivEngine::moveSampleUp(int which) {
   song.sample[which]=song.sample[which-1];
   song.sample[which-1]=prev;
   saveLock.unlock();
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].dispatch->notifySampleChange();
+  }
   BUSY_END;
   return true;
 }
@@ -1924,6 +2198,7 @@ bool DivEngine::moveInsDown(int which) {
   BUSY_BEGIN;
   DivInstrument* prev=song.ins[which];
   saveLock.lock();
+  resetSeekIndex();
   song.ins[which]=song.ins[which+1];
   song.ins[which+1]=prev;
   exchangeIns(which,which+1);
@@ -1937,6 +2212,7 @@ bool DivEngine::moveWaveDown(int which) {
   BUSY_BEGIN;
   DivWavetable* prev=song.wave[which];
   saveLock.lock();
+  resetSeekIndex();
   song.wave[which]=song.wave[which+1];
   song.wave[which+1]=prev;
   saveLock.unlock();
@@ -1952,35 +2228,105 @@ bool DivEngine::moveSampleDown(int which) {
   song.sample[which]=song.sample[which+1];
   song.sample[which+1]=prev;
   saveLock.unlock();
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].dispatch->notifySampleChange();
+  }
   BUSY_END;
   return true;
 }
 
+bool DivEngine::isRendering() {
+  if (exporting) return true;
+  return (output!=NULL && audioEngine!=DIV_AUDIO_DUMMY);
+}
+
+void DivEngine::pushLiveEvent(const DivLiveEvent& ev) {
+  liveLock.lock();
+  if (!isRendering() || !liveEvents.push(ev)) {
+    // nothing drains the queue, or the audio thread is not keeping up.
+    // apply the queue and the event here.
+    BUSY_BEGIN;
+    processLiveEvents();
+    liveEvents.push(ev);
+    processLiveEvents();
+    BUSY_END;
+  }
+  liveLock.unlock();
+}
+
+void DivEngine::processLiveEvents() {
+  DivLiveEvent ev;
+  while (liveEvents.pop(ev)) {
+    switch (ev.type) {
+      case DIV_LIVE_NOTE_ON:
+      case DIV_LIVE_NOTE_OFF:
+        if (ev.target<0 || ev.target>=chans) break;
+        if (ev.type==DIV_LIVE_NOTE_ON) {
+          pendingNotes.push(DivNoteEvent(ev.target,ev.ins,ev.note,ev.vol,true));
+        } else {
+          pendingNotes.push(DivNoteEvent(ev.target,-1,-1,-1,false));
+        }
+        if (!playing) {
+          reset();
+          freelance=true;
+          playing=true;
+        }
+        break;
+      case DIV_LIVE_AUTO_NOTE_ON:
+        doAutoNoteOn(ev.target,ev.ins,ev.note,ev.vol);
+        break;
+      case DIV_LIVE_AUTO_NOTE_OFF:
+        doAutoNoteOff(ev.target,ev.note,ev.vol);
+        break;
+      case DIV_LIVE_AUTO_NOTE_OFF_ALL:
+        doAutoNoteOffAll();
+        break;
+      case DIV_LIVE_POKE:
+        if (ev.target<0 || ev.target>=song.systemLen) break;
+        disCont[ev.target].dispatch->poke(ev.addr,ev.val);
+        break;
+      case DIV_LIVE_INS_CHANGE:
+        resetSeekIndex();
+        if (ev.target>=0 && ev.target<(int)song.ins.size()) {
+          song.ins[ev.target]->std.notifyMacroChange();
+        }
+        for (int i=0; i<song.systemLen; i++) {
+          disCont[i].dispatch->notifyInsChange(ev.target);
+        }
+        break;
+      case DIV_LIVE_WAVE_CHANGE:
+        resetSeekIndex();
+        for (int i=0; i<song.systemLen; i++) {
+          disCont[i].dispatch->notifyWaveChange(ev.target);
+        }
+        break;
+    }
+  }
+}
+
 void DivEngine::noteOn(int chan, int ins, int note, int vol) {
   if (chan<0 || chan>=chans) return;
-  BUSY_BEGIN;
-  pendingNotes.push(DivNoteEvent(chan,ins,note,vol,true));
-  if (!playing) {
-    reset();
-    freelance=true;
-    playing=true;
-  }
-  BUSY_END;
+  pushLiveEvent(DivLiveEvent(DIV_LIVE_NOTE_ON,chan,ins,note,vol));
 }
 
 void DivEngine::noteOff(int chan) {
   if (chan<0 || chan>=chans) return;
-  BUSY_BEGIN;
-  pendingNotes.push(DivNoteEvent(chan,-1,-1,-1,false));
-  if (!playing) {
-    reset();
-    freelance=true;
-    playing=true;
-  }
-  BUSY_END;
+  pushLiveEvent(DivLiveEvent(DIV_LIVE_NOTE_OFF,chan));
 }
 
 void DivEngine::autoNoteOn(int ch, int ins, int note, int vol) {
+  pushLiveEvent(DivLiveEvent(DIV_LIVE_AUTO_NOTE_ON,ch,ins,note,vol));
+}
+
+void DivEngine::autoNoteOff(int ch, int note, int vol) {
+  pushLiveEvent(DivLiveEvent(DIV_LIVE_AUTO_NOTE_OFF,ch,-1,note,vol));
+}
+
+void DivEngine::autoNoteOffAll() {
+  pushLiveEvent(DivLiveEvent(DIV_LIVE_AUTO_NOTE_OFF_ALL,0));
+}
+
+void DivEngine::doAutoNoteOn(int ch, int ins, int note, int vol) {
   //if (ch<0 || ch>=chans) return;
   if (midiBaseChan<0) midiBaseChan=0;
   if (midiBaseChan>=chans) midiBaseChan=chans-1;
@@ -2004,7 +2350,7 @@ void DivEngine::autoNoteOn(int ch, int ins, int note, int vol) {
   } while (finalChan!=midiBaseChan);
 }
 
-void DivEngine::autoNoteOff(int ch, int note, int vol) {
+void DivEngine::doAutoNoteOff(int ch, int note, int vol) {
   if (!playing) {
     reset();
     freelance=true;
@@ -2019,7 +2365,7 @@ void DivEngine::autoNoteOff(int ch, int note, int vol) {
   }
 }
 
-void DivEngine::autoNoteOffAll() {
+void DivEngine::doAutoNoteOffAll() {
   if (!playing) {
     reset();
     freelance=true;
@@ -2098,13 +2444,76 @@ void DivEngine::setMetronomeVol(float vol) {
   metroVol=vol;
 }
 
+void DivEngine::setConfigReadOnly(bool value) {
+  configReadOnly=value;
+}
+
 void DivEngine::setConsoleMode(bool enable) {
   consoleMode=enable;
 }
 
+DivCoreQuality DivEngine::getConfCoreQuality(const char* key, DivCoreQuality def) {
+  int val=getConfInt(key,def);
+  if (val<DIV_CORE_DEFAULT || val>DIV_CORE_ACCURATE) return def;
+  return (DivCoreQuality)val;
+}
+
+void DivEngine::setCoreQuality(DivCoreQuality quality) {
+  if (quality==coreQuality) return;
+  BUSY_BEGIN;
+  coreQuality=quality;
+  bool needsInit=false;
+  for (int i=0; i<song.systemLen; i++) {
+    if (disCont[i].dispatch->getCoreCount()>1) needsInit=true;
+  }
+  if (needsInit) {
+    logD("switching emulation cores...");
+    resetSeekIndex();
+    for (int i=0; i<song.systemLen; i++) {
+      if (disCont[i].dispatch->getCoreCount()<2) continue;
+      disCont[i].quit();
+      disCont[i].init(song.system[i],this,getChannelCount(song.system[i]),got.rate,song.systemFlags[i],coreQuality);
+      disCont[i].dispatch->toggleOscTap(chanOscUsers>0);
+      disCont[i].setRates(got.rate);
+      disCont[i].setQuality(lowQuality);
+    }
+    for (int i=0; i<chans; i++) {
+      disCont[dispatchOfChan[i]].dispatch->muteChannel(dispatchChanOfChan[i],isMuted[i]);
+    }
+    reset();
+  }
+  BUSY_END;
+}
+
+const char* DivEngine::getSystemCoreName(int sys) {
+  if (sys<0 || sys>=song.systemLen) return NULL;
+  DivDispatch* dispatch=disCont[sys].dispatch;
+  if (dispatch==NULL || dispatch->getCoreCount()<2) return NULL;
+  return dispatch->getCoreName(dispatch->getCore());
+}
+
+void DivEngine::setCoreTiming(bool enable) {
+  BUSY_BEGIN;
+  coreTiming=enable;
+  // containers keep the flag when systems are added later
+  for (int i=0; i<32; i++) {
+    // keep timing while the profiler needs it
+    disCont[i].timing=coreTiming || profiling;
+    disCont[i].acquireTime=0;
+    disCont[i].fillTime=0;
+  }
+  BUSY_END;
+}
+
+double DivEngine::getCoreTime(int sys) {
+  if (sys<0 || sys>=song.systemLen) return 0;
+  return disCont[sys].acquireTime;
+}
+
 bool DivEngine::switchMaster() {
   deinitAudioBackend();
   quitDispatch();
+  coreQuality=getConfCoreQuality("liveCoreQuality",DIV_CORE_DEFAULT);
   initDispatch();
   if (initAudioBackend()) {
     for (int i=0; i<song.systemLen; i++) {
@@ -2190,7 +2599,8 @@ void DivEngine::rescanAudioDevices() {
 void DivEngine::initDispatch() {
   BUSY_BEGIN;
   for (int i=0; i<song.systemLen; i++) {
-    disCont[i].init(song.system[i],this,getChannelCount(song.system[i]),got.rate,song.systemFlags[i]);
+    disCont[i].init(song.system[i],this,getChannelCount(song.system[i]),got.rate,song.systemFlags[i],coreQuality);
+    disCont[i].dispatch->toggleOscTap(chanOscUsers>0);
     disCont[i].setRates(got.rate);
     disCont[i].setQuality(lowQuality);
   }
@@ -2200,6 +2610,8 @@ void DivEngine::initDispatch() {
 
 void DivEngine::quitDispatch() {
   BUSY_BEGIN;
+  resetSeekIndex();
+  if (regLog!=NULL) finishRegLog();
   for (int i=0; i<song.systemLen; i++) {
     disCont[i].quit();
   }
@@ -2276,19 +2688,47 @@ bool DivEngine::initAudioBackend() {
 
   if (lowLatency) logI("using low latency mode.");
 
+  seekIndexInterval=getConfInt("seekIndexInterval",4);
+  if (seekIndexInterval<0) seekIndexInterval=0;
+
+  int sampleUndoBudget=getConfInt("sampleUndoBudget",64);
+  if (sampleUndoBudget<1) sampleUndoBudget=1;
+  if (sampleUndoBudget>4096) sampleUndoBudget=4096;
+  DivSample::undoBudget=(size_t)sampleUndoBudget<<20;
+  DivSample::undoCompress=getConfInt("sampleUndoCompress",1);
+
+  renderPoolThreads=getConfInt("renderPoolThreads",0);
+  if (renderPoolThreads<0) renderPoolThreads=0;
+  if (renderPoolThreads>32) renderPoolThreads=32;
+  if (renderPool->count!=(unsigned int)renderPoolThreads) {
+    if (renderPoolThreads>0) logI("rendering chips using %d threads.",renderPoolThreads);
+    delete renderPool;
+    renderPool=new DivWorkPool(renderPoolThreads);
+  }
+  logV("using %s mixer.",mixFuncs->name);
+
   switch (audioEngine) {
     case DIV_AUDIO_JACK:
 #ifndef HAVE_JACK
       logE("Furnace was not compiled with JACK support!");
       setConf("audioEngine","SDL");
       saveConf();
+#ifdef HAVE_SDL2
       output=new TAAudioSDL;
+#else
+      output=new TAAudio;
+#endif
 #else
       output=new TAAudioJACK;
 #endif
       break;
     case DIV_AUDIO_SDL:
+#ifdef HAVE_SDL2
       output=new TAAudioSDL;
+#else
+      logE("Furnace was not compiled with SDL support!");
+      output=new TAAudio;
+#endif
       break;
     case DIV_AUDIO_DUMMY:
       output=new TAAudio;
@@ -2378,37 +2818,41 @@ bool DivEngine::deinitAudioBackend() {
 
 bool DivEngine::init() {
   // init config
+  if (configReadOnly) {
+    logD("using in-memory config.");
+  } else {
 #ifdef _WIN32
-  configPath=getWinConfigPath();
+    configPath=getWinConfigPath();
+#else
+    struct stat st;
+    char* home=getenv("HOME");
+    if (home==NULL) {
+      int uid=getuid();
+      struct passwd* entry=getpwuid(uid);
+      if (entry==NULL) {
+        logW("unable to determine config directory! (%s)",strerror(errno));
+        configPath=".";
+      } else {
+        configPath=entry->pw_dir;
+#ifdef __APPLE__
+        CHECK_CONFIG_DIR_MAC();
 #else
-  struct stat st;
-  char* home=getenv("HOME");
-  if (home==NULL) {
-    int uid=getuid();
-    struct passwd* entry=getpwuid(uid);
-    if (entry==NULL) {
-      logW("unable to determine config directory! (%s)",strerror(errno));
-      configPath=".";
+        CHECK_CONFIG_DIR();
+#endif
+      }
     } else {
-      configPath=entry->pw_dir;
+      configPath=home;
 #ifdef __APPLE__
       CHECK_CONFIG_DIR_MAC();
 #else
       CHECK_CONFIG_DIR();
 #endif
     }
-  } else {
-    configPath=home;
-#ifdef __APPLE__
-    CHECK_CONFIG_DIR_MAC();
-#else
-    CHECK_CONFIG_DIR();
 #endif
-  }
-#endif
-  logD("config path: %s",configPath.c_str());
+    logD("config path: %s",configPath.c_str());
 
-  loadConf();
+    loadConf();
+  }
 
   // init the rest of engine
   bool haveAudio=false;
@@ -2447,6 +2891,7 @@ bool DivEngine::init() {
   oscBuf[0]=new float[32768];
   oscBuf[1]=new float[32768];
 
+  coreQuality=getConfCoreQuality("liveCoreQuality",DIV_CORE_DEFAULT);
   initDispatch();
   reset();
   active=true;
@@ -2470,5 +2915,10 @@ bool DivEngine::quit() {
   active=false;
   delete[] oscBuf[0];
   delete[] oscBuf[1];
+  // stop the workers. rendering goes on in place
+  if (renderPool->count>0) {
+    delete renderPool;
+    renderPool=new DivWorkPool;
+  }
   return true;
 }
@@ -26,6 +26,10 @@
 #include "safeWriter.h"
 #include "../audio/taAudio.h"
 #include "blip_buf.h"
+#include "workPool.h"
+#include "mixer.h"
+#include "spscQueue.h"
+#include "profiler.h"
 #include <functional>
 #include <thread>
 #include <mutex>
@@ -68,6 +72,14 @@ enum DivAudioExportModes {
   DIV_EXPORT_MODE_MANY_CHAN
 };
 
+// which emulation core each system uses.
+enum DivCoreQuality {
+  // the core chosen in the settings
+  DIV_CORE_DEFAULT=0,
+  DIV_CORE_FAST,
+  DIV_CORE_ACCURATE
+};
+
 enum DivHaltPositions {
   DIV_HALT_NONE=0,
   DIV_HALT_TICK,
@@ -148,6 +160,81 @@ struct DivNoteEvent {
     on(o) {}
 };
 
+enum DivLiveEventType {
+  DIV_LIVE_NOTE_ON=0,
+  DIV_LIVE_NOTE_OFF,
+  DIV_LIVE_AUTO_NOTE_ON,
+  DIV_LIVE_AUTO_NOTE_OFF,
+  DIV_LIVE_AUTO_NOTE_OFF_ALL,
+  DIV_LIVE_POKE,
+  DIV_LIVE_INS_CHANGE,
+  DIV_LIVE_WAVE_CHANGE
+};
+
+// an edit made while playing, which is applied by the audio thread.
+struct DivLiveEvent {
+  DivLiveEventType type;
+  // channel, system, instrument or wavetable depending on type
+  int target;
+  int ins, note, vol;
+  unsigned int addr;
+  unsigned short val;
+  DivLiveEvent(DivLiveEventType t=DIV_LIVE_NOTE_ON, int tg=0, int i=-1, int n=-1, int v=-1):
+    type(t),
+    target(tg),
+    ins(i),
+    note(n),
+    vol(v),
+    addr(0),
+    val(0) {}
+};
+
+// playback state at the start of an order, recorded while seeking so that
+// the next seek past it does not have to play the song from the beginning.
+struct DivSeekCheckpoint {
+  int order, maxOrder;
+  // the orders which were played to get here, and a hash of their contents.
+  std::vector<unsigned char> path;
+  uint64_t hash;
+  std::vector<DivChannelState> chan;
+  DivDispatchSoftState* disState[32];
+  int subticks, ticks, curRow, nextSpeed, changeOrd, changePos;
+  int totalSeconds, totalTicks, totalTicksR, totalCmds, globalPitch;
+  double divider;
+  unsigned char extValue, speed1, speed2;
+  bool speedAB, endOfSong, extValuePresent, firstTick;
+
+  DivSeekCheckpoint():
+    order(0),
+    maxOrder(0),
+    hash(0),
+    disState{NULL},
+    subticks(0),
+    ticks(0),
+    curRow(0),
+    nextSpeed(0),
+    changeOrd(-1),
+    changePos(0),
+    totalSeconds(0),
+    totalTicks(0),
+    totalTicksR(0),
+    totalCmds(0),
+    globalPitch(0),
+    divider(60),
+    extValue(0),
+    speed1(0),
+    speed2(0),
+    speedAB(false),
+    endOfSong(false),
+    extValuePresent(false),
+    firstTick(false) {}
+  ~DivSeekCheckpoint() {
+    for (int i=0; i<32; i++) {
+      if (disState[i]!=NULL) delete disState[i];
+    }
+  }
+};
+
 struct DivDispatchContainer {
   DivDispatch* dispatch;
   blip_buffer_t* bb[2];
@@ -155,7 +242,10 @@ struct DivDispatchContainer {
   int temp[2], prevSample[2];
   short* bbIn[2];
   short* bbOut[2];
-  bool lowQuality, dcOffCompensation;
+  size_t runtotal, runLeft, runPos, runNext, lastAvail;
+  // CPU time spent in acquire() and fillBuf() while timing is on, in seconds
+  double acquireTime, fillTime;
+  bool lowQuality, dcOffCompensation, timing;
 
   void setRates(double gotRate);
   void setQuality(bool lowQual);
@@ -163,7 +253,7 @@ struct DivDispatchContainer {
   void flush(size_t count);
   void fillBuf(size_t runtotal, size_t offset, size_t size);
   void clear();
-  void init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, unsigned int flags);
+  void init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, unsigned int flags, DivCoreQuality quality=DIV_CORE_DEFAULT);
   void quit();
   DivDispatchContainer():
     dispatch(NULL),
@@ -173,13 +263,25 @@ struct DivDispatchContainer {
     prevSample{0,0},
     bbIn{NULL,NULL},
     bbOut{NULL,NULL},
+    runtotal(0),
+    runLeft(0),
+    runPos(0),
+    runNext(0),
+    lastAvail(0),
+    acquireTime(0),
+    fillTime(0),
     lowQuality(false),
-    dcOffCompensation(false) {}
+    dcOffCompensation(false),
+    timing(false) {}
 };
 
+class DivVGMStream;
+
 class DivEngine {
   DivDispatchContainer disCont[32];
   TAAudio* output;
+  DivWorkPool* renderPool;
+  const DivMixFuncs* mixFuncs;
   TAAudioDesc want, got;
   String exportPath;
   std::thread* exportThread;
@@ -204,7 +306,11 @@ class DivEngine {
   bool skipping;
   bool midiIsDirect;
   bool lowLatency;
+  bool configReadOnly;
   int softLockCount;
+  int chanOscUsers;
+  int renderPoolThreads;
+  size_t exportBufSize;
   int subticks, ticks, curRow, curOrder, remainingLoops, nextSpeed;
   double divider;
   int cycles;
@@ -216,12 +322,22 @@ class DivEngine {
   DivStatusView view;
   DivHaltPositions haltOn;
   DivChannelState chan[DIV_MAX_CHANS];
+  // seek checkpoints by order, and the orders played since the last reset.
+  std::map<int,DivSeekCheckpoint*> seekIndex;
+  std::vector<unsigned char> seekPath;
+  // hash of everything besides the orders which affects playback, taken when a seek starts
+  uint64_t seekSongHash;
+  // hash of the instruments and wavetables. 0 if they changed since it was taken
+  uint64_t seekInsHash;
+  int seekIndexInterval;
   DivAudioEngines audioEngine;
   DivAudioExportModes exportMode;
+  DivCoreQuality coreQuality;
   std::map<String,String> conf;
   std::queue<DivNoteEvent> pendingNotes;
+  DivSPSCQueue<DivLiveEvent,1024> liveEvents;
   bool isMuted[DIV_MAX_CHANS];
-  std::mutex isBusy, saveLock;
+  std::mutex isBusy, saveLock, liveLock;
   String configPath;
   String configFile;
   String lastError;
@@ -259,11 +375,20 @@ class DivEngine {
 
   size_t totalProcessed;
 
+  // register log being captured, or NULL
+  SafeWriter* regLog;
+  FILE* regLogFile;
+  uint64_t regLogPos, regLogLastTime;
+
+  // where the audio thread spends its time, while profiling is on
+  DivProfile profile;
+  bool profiling;
+  // whether setCoreTiming() is on. the containers time themselves if this or profiling is
+  bool coreTiming;
+
   // MIDI stuff
   std::function<int(const TAMidiMessage&)> midiCallback=[](const TAMidiMessage&) -> int {return -2;};
 
-  DivSystem systemFromFileFur(unsigned char val);
-  unsigned char systemToFileFur(DivSystem val);
   DivSystem systemFromFileDMF(unsigned char val);
   unsigned char systemToFileDMF(DivSystem val);
   int dispatchCmd(DivCommand c);
@@ -271,6 +396,9 @@ class DivEngine {
   void nextOrder();
   void nextRow();
   void performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool isSecond);
+  // generate a VGM. if stream is not NULL, the data is written to it as it is
+  // generated and the returned writer is empty.
+  SafeWriter* writeVGM(DivVGMStream* stream, bool* sysToExport, bool loop, int version, bool highRes);
   // returns true if end of song.
   bool nextTick(bool noAccum=false, bool inhibitLowLat=false);
   bool perSystemEffect(int ch, unsigned char effect, unsigned char effectVal);
@@ -278,9 +406,23 @@ class DivEngine {
   void recalcChans();
   void reset();
   void playSub(bool preserveDrift, int goalRow=0);
+  uint64_t hashSeekSong();
+  uint64_t hashSeekOrder(int order, uint64_t hash);
+  uint64_t hashSeekPath(const std::vector<unsigned char>& path, std::vector<uint64_t>& orderHash);
+  void saveSeekCheckpoint(std::vector<uint64_t>& orderHash);
+  bool loadSeekCheckpoint(int goal);
+  void resetSeekIndex();
+  void renderExport();
+  // add the pending register writes to the log, at the specified offset into
+  // the current buffer.
+  void flushRegLog(size_t offset);
+  bool finishRegLog();
+  void profileBegin();
+  void profileEnd(unsigned int size, double totalTime, double tickTime, double mixTime);
+  DivCoreQuality getConfCoreQuality(const char* key, DivCoreQuality def);
 
   bool loadDMF(unsigned char* file, size_t len);
-  bool loadFur(unsigned char* file, size_t len);
+  bool loadFur(SafeReader& reader);
   bool loadMod(unsigned char* file, size_t len);
 
   void loadDMP(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
@@ -294,6 +436,20 @@ class DivEngine {
 
   bool initAudioBackend();
   bool deinitAudioBackend();
+  void restoreAudioAfterExport();
+  void nextBufSplit(float** in, float** out, int inChans, int outChans, unsigned int size);
+  void runStemExport(size_t bufSize);
+  void mixOutput(float** out, size_t size, bool mono);
+
+  // whether buffers are being rendered, by the audio thread or an export.
+  bool isRendering();
+  // queue a live edit for the audio thread, or apply it if nothing renders.
+  void pushLiveEvent(const DivLiveEvent& ev);
+  // apply queued live edits. isBusy must be held.
+  void processLiveEvents();
+  void doAutoNoteOn(int chan, int ins, int note, int vol);
+  void doAutoNoteOff(int chan, int note, int vol);
+  void doAutoNoteOffAll();
 
   void exchangeIns(int one, int two);
 
@@ -326,11 +482,20 @@ class DivEngine {
     // specify system to build ROM for.
     SafeWriter* buildROM(int sys);
     // dump to VGM.
-    SafeWriter* saveVGM(bool* sysToExport=NULL, bool loop=true, int version=0x171);
+    // if highRes is true, register writes are placed at the sample they happen
+    // at, and sample playback is written as DAC writes instead of streams.
+    SafeWriter* saveVGM(bool* sysToExport=NULL, bool loop=true, int version=0x171, bool highRes=false);
+    // dump to a VGM file while it is being generated. compress writes .vgz.
+    bool saveVGMFile(const char* path, bool* sysToExport=NULL, bool loop=true, int version=0x171, bool compress=false, bool highRes=false);
     // export to an audio file
     bool saveAudio(const char* path, int loops, DivAudioExportModes mode);
     // wait for audio export to finish
     void waitAudioFile();
+    // start capturing the register writes of every system to a log file.
+    // the log is written when stopped, or when the dispatches are destroyed.
+    bool startRegLog(const char* path);
+    // stop capturing register writes and write the log.
+    bool stopRegLog();
     // stop audio file export
     bool haltAudioFile();
     // notify instrument parameter change
@@ -344,6 +509,10 @@ class DivEngine {
     // save config
     bool saveConf();
 
+    // never read or write the config file. only values set through setConf are used
+    // (for when several engines run at once, or when embedded). must be called before init().
+    void setConfigReadOnly(bool value);
+
     // load config
     bool loadConf();
 
@@ -370,6 +539,10 @@ class DivEngine {
     // find song loop position
     void walkSong(int& loopOrder, int& loopRow, int& loopEnd);
 
+    // time one pass of the song, from the start until it ends or jumps back to its loop point.
+    // loopSeconds is set to when the loop point is first reached, or -1 if the song stops instead.
+    double timeSong(double& loopSeconds);
+
     // play
     void play();
 
@@ -385,6 +558,10 @@ class DivEngine {
     // reset playback state
     void syncReset();
 
+    // forget all seek checkpoints to free their memory. checkpoints are
+    // checked against the song before use, so this is not needed after edits.
+    void clearSeekIndex();
+
     // trigger sample preview
     void previewSample(int sample, int note=-1);
     void stopSamplePreview();
@@ -399,6 +576,10 @@ class DivEngine {
     // get sys channel count
     int getChannelCount(DivSystem sys);
 
+    // convert between systems and their IDs in .fur files
+    DivSystem systemFromFileFur(unsigned char val);
+    unsigned char systemToFileFur(DivSystem val);
+
     // get channel count
     int getTotalChannelCount();
 
@@ -487,6 +668,8 @@ class DivEngine {
     // get time
     int getTotalTicks(); // 1/1000000th of a second
     int getTotalSeconds();
+    // get how many frames the last nextBuf() call rendered before playback stopped.
+    size_t getProcessedFrames();
 
     // get repeat pattern
     bool getRepeatPattern();
@@ -565,7 +748,8 @@ class DivEngine {
     bool moveWaveDown(int which);
     bool moveSampleDown(int which);
 
-    // play note
+    // play note. this and the other note/poke/notify functions below don't
+    // lock the audio thread; they queue the event to be applied on the next buffer.
     void noteOn(int chan, int ins, int note, int vol=-1);
 
     // stop note
@@ -592,6 +776,16 @@ class DivEngine {
 
     // get dispatch channel state
     void* getDispatchChanState(int chan);
+
+    // get the dispatch of a system
+    DivDispatch* getDispatch(int index);
+
+    // enable or disable the per-channel output taps. calls are counted, so
+    // every enableChanOsc(true) must be paired with an enableChanOsc(false).
+    void enableChanOsc(bool enable);
+
+    // get the output tap of a channel, or NULL if it has none.
+    DivDispatchOscBuffer* getOscBuffer(int chan);
     
     // get register pool
     unsigned char* getRegisterPool(int sys, int& size, int& depth);
@@ -677,6 +871,30 @@ class DivEngine {
     // switch master
     bool switchMaster();
 
+    // select which emulation cores the systems use. recreates them if needed.
+    void setCoreQuality(DivCoreQuality quality);
+
+    // get the name of the emulation core a system uses, or NULL if it has only one.
+    const char* getSystemCoreName(int sys);
+
+    // start measuring the CPU time taken by each system (resets it).
+    void setCoreTiming(bool enable);
+
+    // get the CPU time taken by a system since timing started, in seconds.
+    double getCoreTime(int sys);
+
+    // start measuring where the audio thread spends its time (resets the profile).
+    void setProfiling(bool enable);
+
+    // whether profiling is on.
+    bool isProfiling();
+
+    // get the profile. its averages and peaks may be read from any thread.
+    DivProfile& getProfile();
+
+    // log the CPU time taken by each stage since profiling started.
+    void reportProfile();
+
     // set MIDI base channel
     void setMidiBaseChan(int chan);
 
@@ -729,6 +947,8 @@ class DivEngine {
 
     DivEngine():
       output(NULL),
+      renderPool(new DivWorkPool),
+      mixFuncs(divMixGetFuncs()),
       exportThread(NULL),
       chans(0),
       active(false),
@@ -751,7 +971,11 @@ class DivEngine {
       skipping(false),
       midiIsDirect(false),
       lowLatency(false),
+      configReadOnly(false),
       softLockCount(0),
+      chanOscUsers(0),
+      renderPoolThreads(0),
+      exportBufSize(8192),
       subticks(0),
       ticks(0),
       curRow(0),
@@ -776,8 +1000,12 @@ class DivEngine {
       speed2(3),
       view(DIV_STATUS_NOTHING),
       haltOn(DIV_HALT_NONE),
+      seekSongHash(0),
+      seekInsHash(0),
+      seekIndexInterval(4),
       audioEngine(DIV_AUDIO_NULL),
       exportMode(DIV_EXPORT_MODE_ONE),
+      coreQuality(DIV_CORE_DEFAULT),
       midiBaseChan(0),
       samp_bb(NULL),
       samp_bbInLen(0),
@@ -792,6 +1020,12 @@ class DivEngine {
       metroAmp(0.0f),
       metroVol(1.0f),
       totalProcessed(0),
+      regLog(NULL),
+      regLogFile(NULL),
+      regLogPos(0),
+      regLogLastTime(0),
+      profiling(false),
+      coreTiming(false),
       oscBuf{NULL,NULL},
       oscSize(1),
       oscReadPos(0),
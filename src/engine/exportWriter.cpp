@@ -0,0 +1,144 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "exportWriter.h"
+#include "../ta-log.h"
+
+static void _runExportWriter(DivExportWriter* w) {
+  w->run();
+}
+
+void DivExportWriter::run() {
+  std::unique_lock<std::mutex> l(lock);
+  while (true) {
+    notify.wait(l,[this]{
+      return quitting || !filled.empty();
+    });
+    if (filled.empty()) break;
+    DivExportBlock* block=filled.front();
+    filled.pop_front();
+    l.unlock();
+
+    for (size_t i=0; i<outputs.size(); i++) {
+      sf_count_t written;
+      if (outputs[i].isFloat) {
+        written=sf_writef_float(outputs[i].sf,(float*)block->buf[i],block->frames);
+      } else {
+        written=sf_writef_short(outputs[i].sf,(short*)block->buf[i],block->frames);
+      }
+      if (written!=(sf_count_t)block->frames) {
+        logE("error: failed to write entire buffer! (%d)",(int)i);
+        failed=true;
+      }
+    }
+
+    l.lock();
+    available.push_back(block);
+    notify.notify_all();
+  }
+}
+
+bool DivExportWriter::addOutput(const String& path, int rate, int channels, bool isFloat) {
+  SF_INFO si;
+  memset(&si,0,sizeof(SF_INFO));
+  si.samplerate=rate;
+  si.channels=channels;
+  si.format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
+
+  SNDFILE* sf=sf_open(path.c_str(),SFM_WRITE,&si);
+  if (sf==NULL) {
+    logE("could not open file for writing! (%s)",sf_strerror(NULL));
+    return false;
+  }
+  outputs.push_back(DivExportOutput(sf,channels,isFloat));
+  return true;
+}
+
+size_t DivExportWriter::getOutputCount() {
+  return outputs.size();
+}
+
+void DivExportWriter::start(size_t frames) {
+  blockSize=frames;
+  for (int i=0; i<DIV_EXPORT_BLOCKS; i++) {
+    for (DivExportOutput& j: outputs) {
+      blocks[i].buf.push_back(new unsigned char[blockSize*j.channels*(j.isFloat?sizeof(float):sizeof(short))]);
+    }
+    available.push_back(&blocks[i]);
+  }
+  thread=new std::thread(_runExportWriter,this);
+}
+
+DivExportBlock* DivExportWriter::getBlock() {
+  std::unique_lock<std::mutex> l(lock);
+  notify.wait(l,[this]{
+    return !available.empty();
+  });
+  DivExportBlock* ret=available.front();
+  available.pop_front();
+  return ret;
+}
+
+void DivExportWriter::putBlock(DivExportBlock* block, size_t frames) {
+  if (frames>blockSize) {
+    logE("error: block is bigger than export bufsize! %d>%d",(int)frames,(int)blockSize);
+    frames=blockSize;
+  }
+  block->frames=frames;
+  lock.lock();
+  filled.push_back(block);
+  lock.unlock();
+  notify.notify_all();
+}
+
+bool DivExportWriter::hasFailed() {
+  return failed;
+}
+
+bool DivExportWriter::finish() {
+  if (thread!=NULL) {
+    lock.lock();
+    quitting=true;
+    lock.unlock();
+    notify.notify_all();
+    thread->join();
+    delete thread;
+    thread=NULL;
+  }
+
+  bool ret=!failed;
+  for (DivExportOutput& i: outputs) {
+    if (sf_close(i.sf)!=0) {
+      logE("could not close audio file!");
+      ret=false;
+    }
+  }
+  outputs.clear();
+  return ret;
+}
+
+DivExportWriter::~DivExportWriter() {
+  finish();
+  for (int i=0; i<DIV_EXPORT_BLOCKS; i++) {
+    for (void* j: blocks[i].buf) {
+      delete[] (unsigned char*)j;
+    }
+    blocks[i].buf.clear();
+  }
+}
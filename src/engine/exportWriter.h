@@ -0,0 +1,99 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _EXPORTWRITER_H
+#define _EXPORTWRITER_H
+#include "../ta-utils.h"
+#include <sndfile.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <deque>
+
+// number of blocks in flight between the renderer and the writer thread
+#define DIV_EXPORT_BLOCKS 4
+
+struct DivExportOutput {
+  SNDFILE* sf;
+  int channels;
+  bool isFloat;
+  DivExportOutput(SNDFILE* s, int c, bool f):
+    sf(s),
+    channels(c),
+    isFloat(f) {}
+};
+
+struct DivExportBlock {
+  // one interleaved buffer per output (float or short depending on output).
+  std::vector<void*> buf;
+  size_t frames;
+  DivExportBlock():
+    frames(0) {}
+};
+
+/**
+ * writes rendered audio to one or more files on a separate thread,
+ * so that rendering never waits on disk I/O.
+ */
+class DivExportWriter {
+  std::vector<DivExportOutput> outputs;
+  DivExportBlock blocks[DIV_EXPORT_BLOCKS];
+  std::deque<DivExportBlock*> filled, available;
+  std::mutex lock;
+  std::condition_variable notify;
+  std::thread* thread;
+  size_t blockSize;
+  bool quitting;
+  std::atomic<bool> failed;
+
+  public:
+    void run();
+
+    // add an output file. must be called before start().
+    bool addOutput(const String& path, int rate, int channels, bool isFloat);
+
+    // get the number of outputs.
+    size_t getOutputCount();
+
+    // allocate blocks of the specified size (in frames) and start the writer thread.
+    void start(size_t frames);
+
+    // get an empty block to fill. waits if the writer is behind.
+    DivExportBlock* getBlock();
+
+    // queue a filled block for writing.
+    void putBlock(DivExportBlock* block, size_t frames);
+
+    // check whether a write failed.
+    bool hasFailed();
+
+    // write everything that is left and close all files.
+    bool finish();
+
+    DivExportWriter():
+      thread(NULL),
+      blockSize(0),
+      quitting(false),
+      failed(false) {}
+    ~DivExportWriter();
+};
+
+#endif
@@ -21,32 +21,168 @@
 #include "../ta-log.h"
 #include "song.h"
 #include <zlib.h>
+#include <chrono>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 #include <fmt/printf.h>
 
 #define DIV_READ_SIZE 131072
 #define DIV_DMF_MAGIC ".DelekDefleMask."
 #define DIV_FUR_MAGIC "-Furnace module-"
 
-struct InflateBlock {
-  unsigned char* buf;
-  size_t len;
-  size_t blockSize;
-  InflateBlock(size_t s) {
-    buf=new unsigned char[s];
-    len=s;
-    blockSize=0;
+// inflates a zlib stream as the reader asks for data, so that parsing
+// overlaps decompression and the song is never held twice in memory.
+class DivInflateSource: public SafeReaderSource {
+  z_stream zl;
+  unsigned char* in;
+  unsigned char* out;
+  size_t outLen, outCap;
+  bool ownsInput, ended;
+
+  void finish();
+
+  public:
+    String error;
+
+    // start inflating. returns false if zlib could not be initialized.
+    bool init(unsigned char* data, size_t len);
+    // free the input (allocated with new[]) once it has been inflated.
+    void takeInput();
+    void fill(size_t until, unsigned char*& buf, size_t& len);
+    // inflate everything and return a copy allocated with new[].
+    unsigned char* release(size_t& len);
+    DivInflateSource():
+      in(NULL),
+      out(NULL),
+      outLen(0),
+      outCap(0),
+      ownsInput(false),
+      ended(true) {
+      memset(&zl,0,sizeof(z_stream));
+    }
+    ~DivInflateSource();
+};
+
+bool DivInflateSource::init(unsigned char* data, size_t len) {
+  in=data;
+  zl.avail_in=len;
+  zl.next_in=(Bytef*)data;
+  zl.zalloc=NULL;
+  zl.zfree=NULL;
+  zl.opaque=NULL;
+
+  int nextErr=inflateInit(&zl);
+  if (nextErr!=Z_OK) {
+    if (zl.msg==NULL) {
+      logD("zlib error: unknown! %d",nextErr);
+    } else {
+      logD("zlib error: %s",zl.msg);
+    }
+    inflateEnd(&zl);
+    return false;
   }
-  ~InflateBlock() {
-    delete[] buf;
-    len=0;
+  ended=false;
+  return true;
+}
+
+void DivInflateSource::takeInput() {
+  ownsInput=true;
+  if (ended && in!=NULL) {
+    delete[] in;
+    in=NULL;
   }
-};
+}
 
-struct NotZlibException {
-  int what;
-  NotZlibException(int w):
-    what(w) {}
-};
+void DivInflateSource::finish() {
+  if (ended) return;
+  ended=true;
+  int nextErr=inflateEnd(&zl);
+  if (nextErr!=Z_OK && error.empty()) {
+    if (zl.msg==NULL) {
+      logD("zlib end error: unknown error! %d",nextErr);
+      error="unknown decompression finish error";
+    } else {
+      logD("zlib end: %s",zl.msg);
+      error=fmt::sprintf("decompression finish error: %s",zl.msg);
+    }
+  }
+  if (ownsInput && in!=NULL) {
+    delete[] in;
+    in=NULL;
+  }
+}
+
+void DivInflateSource::fill(size_t until, unsigned char*& buf, size_t& len) {
+  while (outLen<until && !ended) {
+    if (outLen>=outCap) {
+      // realloc can usually grow large blocks in place
+      size_t newCap=(outCap<DIV_READ_SIZE)?DIV_READ_SIZE:(outCap<<1);
+      unsigned char* newOut=(unsigned char*)realloc(out,newCap);
+      if (newOut==NULL) {
+        logE("out of memory while decompressing!");
+        error="out of memory";
+        finish();
+        break;
+      }
+      out=newOut;
+      outCap=newCap;
+    }
+    zl.next_out=out+outLen;
+    zl.avail_out=outCap-outLen;
+
+    int nextErr=inflate(&zl,Z_SYNC_FLUSH);
+    outLen=outCap-zl.avail_out;
+    if (nextErr==Z_STREAM_END) {
+      finish();
+      break;
+    }
+    if (nextErr!=Z_OK) {
+      if (zl.msg==NULL) {
+        logD("zlib error: unknown error! %d",nextErr);
+        error="unknown decompression error";
+      } else {
+        logD("zlib inflate: %s",zl.msg);
+        error=fmt::sprintf("decompression error: %s",zl.msg);
+      }
+      finish();
+      break;
+    }
+  }
+  buf=out;
+  len=outLen;
+}
+
+unsigned char* DivInflateSource::release(size_t& len) {
+  unsigned char* buf=NULL;
+  fill(SIZE_MAX,buf,len);
+  unsigned char* ret=new unsigned char[len];
+  memcpy(ret,out,len);
+  return ret;
+}
+
+DivInflateSource::~DivInflateSource() {
+  finish();
+  if (out!=NULL) {
+    free(out);
+    out=NULL;
+  }
+}
+
+// peak resident memory of the process in KB, or 0 if unknown.
+static long getPeakRSS() {
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF,&ru)!=0) return 0;
+#ifdef __APPLE__
+  return ru.ru_maxrss>>10;
+#else
+  return ru.ru_maxrss;
+#endif
+#endif
+}
 
 static double samplePitches[11]={
   0.1666666666, 0.2, 0.25, 0.333333333, 0.5,
@@ -222,6 +358,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
       delete[] file;
       return false;
     }
+    ds.setPatternRows(ds.patLen);
     if (ds.ordersLen<0) {
       logE("song length is negative!");
       lastError="song length is negative!";
@@ -904,14 +1041,13 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
   return true;
 }
 
-bool DivEngine::loadFur(unsigned char* file, size_t len) {
+bool DivEngine::loadFur(SafeReader& reader) {
   unsigned int insPtr[256];
   unsigned int wavePtr[256];
   unsigned int samplePtr[256];
   std::vector<int> patPtr;
   char magic[5];
   memset(magic,0,5);
-  SafeReader reader=SafeReader(file,len);
   warnings="";
   try {
     DivSong ds;
@@ -919,7 +1055,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
     if (!reader.seek(16,SEEK_SET)) {
       logE("premature end of file!");
       lastError="incomplete file";
-      delete[] file;
       return false;
     }
     ds.version=reader.readS();
@@ -1001,7 +1136,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
     if (!reader.seek(infoSeek,SEEK_SET)) {
       logE("couldn't seek to info header at %d!",infoSeek);
       lastError="couldn't seek to info header!";
-      delete[] file;
       return false;
     }
 
@@ -1010,7 +1144,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
     if (strcmp(magic,"INFO")!=0) {
       logE("invalid info header!");
       lastError="invalid info header!";
-      delete[] file;
       return false;
     }
     reader.readI();
@@ -1037,49 +1170,42 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
     if (ds.patLen<0) {
       logE("pattern length is negative!");
       lastError="pattern lengrh is negative!";
-      delete[] file;
       return false;
     }
     if (ds.patLen>256) {
       logE("pattern length is too large!");
       lastError="pattern length is too large!";
-      delete[] file;
       return false;
     }
+    ds.setPatternRows(ds.patLen);
     if (ds.ordersLen<0) {
       logE("song length is negative!");
       lastError="song length is negative!";
-      delete[] file;
       return false;
     }
     if (ds.ordersLen>256) {
       logE("song is too long!");
       lastError="song is too long!";
-      delete[] file;
       return false;
     }
     if (ds.insLen<0 || ds.insLen>256) {
       logE("invalid instrument count!");
       lastError="invalid instrument count!";
-      delete[] file;
       return false;
     }
     if (ds.waveLen<0 || ds.waveLen>256) {
       logE("invalid wavetable count!");
       lastError="invalid wavetable count!";
-      delete[] file;
       return false;
     }
     if (ds.sampleLen<0 || ds.sampleLen>256) {
       logE("invalid sample count!");
       lastError="invalid sample count!";
-      delete[] file;
       return false;
     }
     if (numberOfPats<0) {
       logE("invalid pattern count!");
       lastError="invalid pattern count!";
-      delete[] file;
       return false;
     }
 
@@ -1089,7 +1215,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
       if (sysID!=0 && systemToFileFur(ds.system[i])==0) {
         logE("unrecognized system ID %.2x",ds.system[i]);
         lastError=fmt::sprintf("unrecognized system ID %.2x!",ds.system[i]);
-        delete[] file;
         return false;
       }
       if (ds.system[i]!=DIV_SYSTEM_NULL) ds.systemLen=i+1;
@@ -1275,7 +1400,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
       if (ds.pat[i].effectRows<1 || ds.pat[i].effectRows>8) {
         logE("channel %d has zero or too many effect columns! (%d)",i,ds.pat[i].effectRows);
         lastError=fmt::sprintf("channel %d has too many effect columns! (%d)",i,ds.pat[i].effectRows);
-        delete[] file;
         return false;
       }
     }
@@ -1356,7 +1480,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         lastError=fmt::sprintf("couldn't seek to instrument %d!",i);
         ds.unload();
         delete ins;
-        delete[] file;
         return false;
       }
       
@@ -1364,7 +1487,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         lastError="invalid instrument header/data!";
         ds.unload();
         delete ins;
-        delete[] file;
         return false;
       }
 
@@ -1380,7 +1502,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         lastError=fmt::sprintf("couldn't seek to wavetable %d!",i);
         ds.unload();
         delete wave;
-        delete[] file;
         return false;
       }
 
@@ -1388,7 +1509,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         lastError="invalid wavetable header/data!";
         ds.unload();
         delete wave;
-        delete[] file;
         return false;
       }
 
@@ -1404,7 +1524,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         logE("couldn't seek to sample %d!",i);
         lastError=fmt::sprintf("couldn't seek to sample %d!",i);
         ds.unload();
-        delete[] file;
         return false;
       }
 
@@ -1413,7 +1532,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         logE("%d: invalid sample header!",i);
         lastError="invalid sample header!";
         ds.unload();
-        delete[] file;
         return false;
       }
       reader.readI();
@@ -1494,7 +1612,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         logE("couldn't seek to pattern in %x!",i);
         lastError=fmt::sprintf("couldn't seek to pattern in %x!",i);
         ds.unload();
-        delete[] file;
         return false;
       }
       reader.read(magic,4);
@@ -1503,7 +1620,6 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         logE("%x: invalid pattern header!",i);
         lastError="invalid pattern header!";
         ds.unload();
-        delete[] file;
         return false;
       }
       reader.readI();
@@ -1518,14 +1634,12 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         logE("pattern channel out of range!",i);
         lastError="pattern channel out of range!";
         ds.unload();
-        delete[] file;
         return false;
       }
       if (index<0 || index>255) {
         logE("pattern index out of range!",i);
         lastError="pattern index out of range!";
         ds.unload();
-        delete[] file;
         return false;
       }
 
@@ -1568,10 +1682,8 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
   } catch (EndOfFileException& e) {
     logE("premature end of file!");
     lastError="incomplete file";
-    delete[] file;
     return false;
   }
-  delete[] file;
   return true;
 }
 
@@ -1721,6 +1833,7 @@ bool DivEngine::loadMod(unsigned char* file, size_t len) {
 
     // patterns
     ds.patLen=64;
+    ds.setPatternRows(ds.patLen);
     for (int ch=0; ch<chCount; ch++) {
       for (int i=0; i<5; i++) {
         fxUsage[ch][i]=false;
@@ -1986,8 +2099,8 @@ bool DivEngine::loadMod(unsigned char* file, size_t len) {
 }
 
 bool DivEngine::load(unsigned char* f, size_t slen) {
-  unsigned char* file;
-  size_t len;
+  std::chrono::steady_clock::time_point timeStart=std::chrono::steady_clock::now();
+  bool ret=false;
   if (slen<16) {
     logE("too small!");
     lastError="file is too small";
@@ -1996,116 +2109,68 @@ bool DivEngine::load(unsigned char* f, size_t slen) {
   }
 
   // step 1: try loading as a zlib-compressed file
+  // the song is parsed while it is being decompressed.
   logD("trying zlib...");
-  try {
-    z_stream zl;
-    memset(&zl,0,sizeof(z_stream));
-
-    zl.avail_in=slen;
-    zl.next_in=(Bytef*)f;
-    zl.zalloc=NULL;
-    zl.zfree=NULL;
-    zl.opaque=NULL;
-
-    int nextErr;
-    nextErr=inflateInit(&zl);
-    if (nextErr!=Z_OK) {
-      if (zl.msg==NULL) {
-        logD("zlib error: unknown! %d",nextErr);
+  DivInflateSource* zl=new DivInflateSource;
+  unsigned char* head=NULL;
+  size_t headLen=0;
+  if (zl->init(f,slen)) {
+    zl->fill(16,head,headLen);
+  }
+  if (headLen>=16) {
+    zl->takeInput();
+    // step 2: try loading as .fur or .dmf
+    if (memcmp(head,DIV_DMF_MAGIC,16)==0) {
+      size_t len=0;
+      unsigned char* file=zl->release(len);
+      if (!zl->error.empty()) {
+        logE("could not decompress song! %s",zl->error);
+        lastError=zl->error;
+        delete[] file;
       } else {
-        logD("zlib error: %s",zl.msg);
+        ret=loadDMF(file,len);
       }
-      inflateEnd(&zl);
-      lastError="not a .dmf/.fur song";
-      throw NotZlibException(0);
+    } else if (memcmp(head,DIV_FUR_MAGIC,16)==0) {
+      SafeReader reader=SafeReader(zl);
+      ret=loadFur(reader);
+      if (!ret && !zl->error.empty()) lastError=zl->error;
+    } else {
+      logE("not a valid module!");
+      lastError="not a compatible song";
     }
-
-    std::vector<InflateBlock*> blocks;
-    while (true) {
-      InflateBlock* ib=new InflateBlock(DIV_READ_SIZE);
-      zl.next_out=ib->buf;
-      zl.avail_out=ib->len;
-
-      nextErr=inflate(&zl,Z_SYNC_FLUSH);
-      if (nextErr!=Z_OK && nextErr!=Z_STREAM_END) {
-        if (zl.msg==NULL) {
-          logD("zlib error: unknown error! %d",nextErr);
-          lastError="unknown decompression error";
-        } else {
-          logD("zlib inflate: %s",zl.msg);
-          lastError=fmt::sprintf("decompression error: %s",zl.msg);
-        }
-        for (InflateBlock* i: blocks) delete i;
-        blocks.clear();
-        delete ib;
-        inflateEnd(&zl);
-        throw NotZlibException(0);
-      }
-      ib->blockSize=ib->len-zl.avail_out;
-      blocks.push_back(ib);
-      if (nextErr==Z_STREAM_END) {
-        break;
+    delete zl;
+  } else {
+    delete zl;
+    logD("not zlib. loading as raw...");
+    // step 2: try loading as .fur or .dmf
+    if (memcmp(f,DIV_DMF_MAGIC,16)==0) {
+      ret=loadDMF(f,slen);
+    } else if (memcmp(f,DIV_FUR_MAGIC,16)==0) {
+      SafeReader reader=SafeReader(f,slen);
+      ret=loadFur(reader);
+      delete[] f;
+    } else {
+      // step 3: try loading as .mod
+      ret=loadMod(f,slen);
+      delete[] f;
+      if (!ret) {
+        // step 4: not a valid file
+        logE("not a valid module!");
+        lastError="not a compatible song";
       }
     }
-    nextErr=inflateEnd(&zl);
-    if (nextErr!=Z_OK) {
-      if (zl.msg==NULL) {
-        logD("zlib end error: unknown error! %d",nextErr);
-        lastError="unknown decompression finish error";
-      } else {
-        logD("zlib end: %s",zl.msg);
-        lastError=fmt::sprintf("decompression finish error: %s",zl.msg);
-      }
-      for (InflateBlock* i: blocks) delete i;
-      blocks.clear();
-      throw NotZlibException(0);
-    }
-
-    size_t finalSize=0;
-    size_t curSeek=0;
-    for (InflateBlock* i: blocks) {
-      finalSize+=i->blockSize;
-    }
-    if (finalSize<1) {
-      logD("compressed too small!");
-      lastError="file too small";
-      for (InflateBlock* i: blocks) delete i;
-      blocks.clear();
-      throw NotZlibException(0);
-    }
-    file=new unsigned char[finalSize];
-    for (InflateBlock* i: blocks) {
-      memcpy(&file[curSeek],i->buf,i->blockSize);
-      curSeek+=i->blockSize;
-      delete i;
-    }
-    blocks.clear();
-    len=finalSize;
-    delete[] f;
-  } catch (NotZlibException& e) {
-    logD("not zlib. loading as raw...");
-    file=f;
-    len=slen;
-  }
-
-  // step 2: try loading as .fur or .dmf
-  if (memcmp(file,DIV_DMF_MAGIC,16)==0) {
-    return loadDMF(file,len); 
-  } else if (memcmp(file,DIV_FUR_MAGIC,16)==0) {
-    return loadFur(file,len);
   }
 
-  // step 3: try loading as .mod
-  if (loadMod(f,slen)) {
-    delete[] f;
-    return true;
+  if (ret) {
+    double loadTime=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-timeStart).count();
+    long peakRSS=getPeakRSS();
+    if (peakRSS>0) {
+      logI("song loaded in %.1fms (peak RSS %ldKB).",loadTime,peakRSS);
+    } else {
+      logI("song loaded in %.1fms.",loadTime);
+    }
   }
-  
-  // step 4: not a valid file
-  logE("not a valid module!");
-  lastError="not a compatible song";
-  delete[] file;
-  return false;
+  return ret;
 }
 
 SafeWriter* DivEngine::saveFur(bool notPrimary) {
@@ -19,16 +19,22 @@
 
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <mutex>
 #include "filter.h"
 #include "../ta-log.h"
 
 float* DivFilterTables::cubicTable=NULL;
 float* DivFilterTables::sincTable=NULL;
 float* DivFilterTables::sincIntegralTable=NULL;
+float* DivFilterTables::sincPolyphaseTable=NULL;
+
+// tables may be requested by several engines at once
+static std::mutex filterTableLock;
 
 // portions from Schism Tracker (scripts/lutgen.c)
 // licensed under same license as this program.
 float* DivFilterTables::getCubicTable() {
+  std::lock_guard<std::mutex> lock(filterTableLock);
   if (cubicTable==NULL) {
     logD("initializing cubic spline table.");
     cubicTable=new float[4096];
@@ -44,7 +50,8 @@ float* DivFilterTables::getCubicTable() {
   return cubicTable;
 }
 
-float* DivFilterTables:: getSincTable() {
+float* DivFilterTables::getSincTable() {
+  std::lock_guard<std::mutex> lock(filterTableLock);
   if (sincTable==NULL) {
     logD("initializing sinc table.");
     sincTable=new float[65536];
@@ -65,6 +72,7 @@ float* DivFilterTables:: getSincTable() {
 }
 
 float* DivFilterTables::getSincIntegralTable() {
+  std::lock_guard<std::mutex> lock(filterTableLock);
   if (sincIntegralTable==NULL) {
     logD("initializing sinc integral table.");
     sincIntegralTable=new float[65536];
@@ -85,3 +93,21 @@ float* DivFilterTables::getSincIntegralTable() {
   }
   return sincIntegralTable;
 }
+
+float* DivFilterTables::getSincPolyphaseTable() {
+  float* sinc=getSincTable();
+  std::lock_guard<std::mutex> lock(filterTableLock);
+  if (sincPolyphaseTable==NULL) {
+    logD("initializing sinc polyphase table.");
+    sincPolyphaseTable=new float[131072];
+
+    for (int i=0; i<8192; i++) {
+      float* t=&sincPolyphaseTable[i<<4];
+      for (int j=0; j<8; j++) {
+        t[j]=sinc[(i<<3)+7-j];
+        t[8+j]=sinc[((8191-i)<<3)+j];
+      }
+    }
+  }
+  return sincPolyphaseTable;
+}
@@ -22,6 +22,7 @@ class DivFilterTables {
     static float* cubicTable;
     static float* sincTable;
     static float* sincIntegralTable;
+    static float* sincPolyphaseTable;
 
     /**
      * get a 1024x4 cubic spline table.
@@ -40,4 +41,11 @@ class DivFilterTables {
      * @return the table.
      */
     static float* getSincIntegralTable();
+
+    /**
+     * get a 8192x16 two-side sinc table, laid out so that each phase is a
+     * contiguous row of taps (derived from the sinc table).
+     * @return the table.
+     */
+    static float* getSincPolyphaseTable();
 };
\ No newline at end of file
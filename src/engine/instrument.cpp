@@ -23,6 +23,43 @@
 #include "../ta-log.h"
 #include "../fileutils.h"
 
+static DivInstrumentMacro DivInstrumentSTD::* const stdMacros[20]={
+  &DivInstrumentSTD::volMacro, &DivInstrumentSTD::arpMacro, &DivInstrumentSTD::dutyMacro, &DivInstrumentSTD::waveMacro,
+  &DivInstrumentSTD::pitchMacro, &DivInstrumentSTD::ex1Macro, &DivInstrumentSTD::ex2Macro, &DivInstrumentSTD::ex3Macro,
+  &DivInstrumentSTD::algMacro, &DivInstrumentSTD::fbMacro, &DivInstrumentSTD::fmsMacro, &DivInstrumentSTD::amsMacro,
+  &DivInstrumentSTD::panLMacro, &DivInstrumentSTD::panRMacro, &DivInstrumentSTD::phaseResetMacro, &DivInstrumentSTD::ex4Macro,
+  &DivInstrumentSTD::ex5Macro, &DivInstrumentSTD::ex6Macro, &DivInstrumentSTD::ex7Macro, &DivInstrumentSTD::ex8Macro
+};
+
+static DivInstrumentMacro DivInstrumentSTD::OpMacro::* const stdOpMacros[20]={
+  &DivInstrumentSTD::OpMacro::amMacro, &DivInstrumentSTD::OpMacro::arMacro, &DivInstrumentSTD::OpMacro::drMacro, &DivInstrumentSTD::OpMacro::multMacro,
+  &DivInstrumentSTD::OpMacro::rrMacro, &DivInstrumentSTD::OpMacro::slMacro, &DivInstrumentSTD::OpMacro::tlMacro, &DivInstrumentSTD::OpMacro::dt2Macro,
+  &DivInstrumentSTD::OpMacro::rsMacro, &DivInstrumentSTD::OpMacro::dtMacro, &DivInstrumentSTD::OpMacro::d2rMacro, &DivInstrumentSTD::OpMacro::ssgMacro,
+  &DivInstrumentSTD::OpMacro::damMacro, &DivInstrumentSTD::OpMacro::dvbMacro, &DivInstrumentSTD::OpMacro::egtMacro, &DivInstrumentSTD::OpMacro::kslMacro,
+  &DivInstrumentSTD::OpMacro::susMacro, &DivInstrumentSTD::OpMacro::vibMacro, &DivInstrumentSTD::OpMacro::wsMacro, &DivInstrumentSTD::OpMacro::ksrMacro
+};
+
+DivInstrumentMacro& DivInstrumentSTD::getMacro(int index) {
+  if (index<20) return this->*stdMacros[index];
+  index-=20;
+  return opMacros[index/20].*stdOpMacros[index%20];
+}
+
+const unsigned char* DivInstrumentSTD::getMacroList(int& count) {
+  if (macroListLen<0) {
+    macroListLen=0;
+    for (int i=0; i<DIV_MACRO_COUNT; i++) {
+      if (getMacro(i).len>0) macroList[macroListLen++]=i;
+    }
+  }
+  count=macroListLen;
+  return macroList;
+}
+
+void DivInstrumentSTD::notifyMacroChange() {
+  macroListLen=-1;
+}
+
 void DivInstrument::putInsData(SafeWriter* w) {
   w->write("INST",4);
   w->writeI(0);
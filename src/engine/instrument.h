@@ -172,6 +172,9 @@ struct DivInstrumentMacro {
   }
 };
 
+// 20 common macros and 20 for each FM operator
+#define DIV_MACRO_COUNT 100
+
 struct DivInstrumentSTD {
   DivInstrumentMacro volMacro;
   DivInstrumentMacro arpMacro;
@@ -223,6 +226,32 @@ struct DivInstrumentSTD {
       damMacro("dam"), dvbMacro("dvb"), egtMacro("egt"), kslMacro("ksl"),
       susMacro("sus"), vibMacro("vib"), wsMacro("ws"), ksrMacro("ksr") {}
   } opMacros[4];
+
+  // indices of the macros which have a length, or macroListLen=-1 if stale
+  unsigned char macroList[DIV_MACRO_COUNT];
+  int macroListLen;
+
+  /**
+   * get a macro by index. 0 to 19 are the common macros in the order they
+   * are declared in, then come 20 for each operator.
+   * @param index the index, from 0 to DIV_MACRO_COUNT-1.
+   * @return the macro.
+   */
+  DivInstrumentMacro& getMacro(int index);
+
+  /**
+   * get the indices of the macros which have a length.
+   * the list is kept until notifyMacroChange() is called.
+   * @param count set to the number of macros in the list.
+   * @return the list.
+   */
+  const unsigned char* getMacroList(int& count);
+
+  /**
+   * forget the macro list after a macro has changed.
+   */
+  void notifyMacroChange();
+
   DivInstrumentSTD():
     volMacro("vol",true),
     arpMacro("arp"),
@@ -243,7 +272,10 @@ struct DivInstrumentSTD {
     ex5Macro("ex5"),
     ex6Macro("ex6"), 
     ex7Macro("ex7"),
-    ex8Macro("ex8") {}
+    ex8Macro("ex8"),
+    macroListLen(-1) {
+    memset(macroList,0,DIV_MACRO_COUNT);
+  }
 };
 
 struct DivInstrumentGB {
@@ -20,6 +20,8 @@
 #include "macroInt.h"
 #include "instrument.h"
 #include "engine.h"
+#include "../ta-log.h"
+#include <chrono>
 
 void DivMacroStruct::doMacro(DivInstrumentMacro& source, bool released, bool tick) {
   if (!tick) {
@@ -56,11 +58,15 @@ void DivMacroStruct::doMacro(DivInstrumentMacro& source, bool released, bool tic
 void DivMacroInt::next() {
   if (ins==NULL) return;
   // run macros
-  // TODO: potentially get rid of list to avoid allocations
   subTick--;
-  for (size_t i=0; i<macroListLen; i++) {
-    if (macroList[i]!=NULL && macroSource[i]!=NULL) {
-      macroList[i]->doMacro(*macroSource[i],released,subTick==0);
+  bool tick=(subTick==0);
+  for (size_t i=0; i<activeListLen; i++) {
+    unsigned char index=activeList[i];
+    DivMacroStruct* m=macroList[index];
+    m->doMacro(*macroSource[index],released,tick);
+    // a macro which ended stops running once it has settled
+    if (m->idle()) {
+      activeList[i--]=activeList[--activeListLen];
     }
   }
   if (subTick<=0) {
@@ -80,9 +86,27 @@ void DivMacroInt::setEngine(DivEngine* eng) {
   e=eng;
 }
 
-#define ADD_MACRO(m,s) \
-  macroList[macroListLen]=&m; \
-  macroSource[macroListLen++]=&s;
+static DivMacroStruct DivMacroInt::* const intMacros[20]={
+  &DivMacroInt::vol, &DivMacroInt::arp, &DivMacroInt::duty, &DivMacroInt::wave,
+  &DivMacroInt::pitch, &DivMacroInt::ex1, &DivMacroInt::ex2, &DivMacroInt::ex3,
+  &DivMacroInt::alg, &DivMacroInt::fb, &DivMacroInt::fms, &DivMacroInt::ams,
+  &DivMacroInt::panL, &DivMacroInt::panR, &DivMacroInt::phaseReset, &DivMacroInt::ex4,
+  &DivMacroInt::ex5, &DivMacroInt::ex6, &DivMacroInt::ex7, &DivMacroInt::ex8
+};
+
+static DivMacroStruct DivMacroInt::IntOp::* const intOpMacros[20]={
+  &DivMacroInt::IntOp::am, &DivMacroInt::IntOp::ar, &DivMacroInt::IntOp::dr, &DivMacroInt::IntOp::mult,
+  &DivMacroInt::IntOp::rr, &DivMacroInt::IntOp::sl, &DivMacroInt::IntOp::tl, &DivMacroInt::IntOp::dt2,
+  &DivMacroInt::IntOp::rs, &DivMacroInt::IntOp::dt, &DivMacroInt::IntOp::d2r, &DivMacroInt::IntOp::ssg,
+  &DivMacroInt::IntOp::dam, &DivMacroInt::IntOp::dvb, &DivMacroInt::IntOp::egt, &DivMacroInt::IntOp::ksl,
+  &DivMacroInt::IntOp::sus, &DivMacroInt::IntOp::vib, &DivMacroInt::IntOp::ws, &DivMacroInt::IntOp::ksr
+};
+
+DivMacroStruct& DivMacroInt::getMacro(int index) {
+  if (index<20) return this->*intMacros[index];
+  index-=20;
+  return op[index/20].*intOpMacros[index%20];
+}
 
 void DivMacroInt::init(DivInstrument* which) {
   ins=which;
@@ -91,149 +115,96 @@ void DivMacroInt::init(DivInstrument* which) {
     if (macroList[i]!=NULL) macroList[i]->init();
   }
   macroListLen=0;
+  activeListLen=0;
   subTick=1;
 
   released=false;
 
   if (ins==NULL) return;
 
-  // prepare common macro
-  if (ins->std.volMacro.len>0) {
-    ADD_MACRO(vol,ins->std.volMacro);
-  }
-  if (ins->std.arpMacro.len>0) {
-    ADD_MACRO(arp,ins->std.arpMacro);
-  }
-  if (ins->std.dutyMacro.len>0) {
-    ADD_MACRO(duty,ins->std.dutyMacro);
-  }
-  if (ins->std.waveMacro.len>0) {
-    ADD_MACRO(wave,ins->std.waveMacro);
-  }
-  if (ins->std.pitchMacro.len>0) {
-    ADD_MACRO(pitch,ins->std.pitchMacro);
-  }
-  if (ins->std.ex1Macro.len>0) {
-    ADD_MACRO(ex1,ins->std.ex1Macro);
-  }
-  if (ins->std.ex2Macro.len>0) {
-    ADD_MACRO(ex2,ins->std.ex2Macro);
-  }
-  if (ins->std.ex3Macro.len>0) {
-    ADD_MACRO(ex3,ins->std.ex3Macro);
-  }
-  if (ins->std.algMacro.len>0) {
-    ADD_MACRO(alg,ins->std.algMacro);
-  }
-  if (ins->std.fbMacro.len>0) {
-    ADD_MACRO(fb,ins->std.fbMacro);
-  }
-  if (ins->std.fmsMacro.len>0) {
-    ADD_MACRO(fms,ins->std.fmsMacro);
-  }
-  if (ins->std.amsMacro.len>0) {
-    ADD_MACRO(ams,ins->std.amsMacro);
+  // the instrument keeps the list of macros which have a length
+  int count;
+  const unsigned char* list=ins->std.getMacroList(count);
+  for (int i=0; i<count; i++) {
+    macroList[i]=&getMacro(list[i]);
+    macroSource[i]=&ins->std.getMacro(list[i]);
+    macroList[i]->prepare(*macroSource[i]);
+    activeList[i]=i;
   }
+  macroListLen=count;
+  activeListLen=count;
+}
 
-  if (ins->std.panLMacro.len>0) {
-    ADD_MACRO(panL,ins->std.panLMacro);
-  }
-  if (ins->std.panRMacro.len>0) {
-    ADD_MACRO(panR,ins->std.panRMacro);
-  }
-  if (ins->std.phaseResetMacro.len>0) {
-    ADD_MACRO(phaseReset,ins->std.phaseResetMacro);
-  }
-  if (ins->std.ex4Macro.len>0) {
-    ADD_MACRO(ex4,ins->std.ex4Macro);
-  }
-  if (ins->std.ex5Macro.len>0) {
-    ADD_MACRO(ex5,ins->std.ex5Macro);
-  }
-  if (ins->std.ex6Macro.len>0) {
-    ADD_MACRO(ex6,ins->std.ex6Macro);
-  }
-  if (ins->std.ex7Macro.len>0) {
-    ADD_MACRO(ex7,ins->std.ex7Macro);
+void DivMacroInt::notifyInsDeletion(DivInstrument* which) {
+  if (ins==which) {
+    init(NULL);
   }
-  if (ins->std.ex8Macro.len>0) {
-    ADD_MACRO(ex8,ins->std.ex8Macro);
+}
+
+static void fillMacro(DivInstrumentMacro& m, int len, int loop, int rel, int seed) {
+  m.len=len;
+  m.loop=loop;
+  m.rel=rel;
+  for (int i=0; i<len; i++) {
+    m.val[i]=(i*seed+7)&127;
   }
+}
 
-  // prepare FM operator macros
+void divMacroBenchmark(int chans, int ticks) {
+  if (chans<1) chans=1;
+  if (chans>DIV_MAX_CHANS) chans=DIV_MAX_CHANS;
+  // a mix of typical instruments: short envelopes which end, looping
+  // arpeggios/vibratos and FM operator level envelopes.
+  DivInstrument* ins[3];
+  for (int i=0; i<3; i++) ins[i]=new DivInstrument;
+  fillMacro(ins[0]->std.volMacro,16,-1,-1,3);
+  fillMacro(ins[0]->std.arpMacro,3,0,-1,12);
+  fillMacro(ins[0]->std.dutyMacro,8,-1,-1,1);
+  fillMacro(ins[1]->std.volMacro,32,24,28,5);
+  fillMacro(ins[1]->std.pitchMacro,8,0,-1,2);
+  fillMacro(ins[1]->std.waveMacro,4,-1,-1,9);
+  fillMacro(ins[1]->std.panLMacro,2,-1,-1,1);
   for (int i=0; i<4; i++) {
-    DivInstrumentSTD::OpMacro& m=ins->std.opMacros[i];
-    IntOp& o=op[i];
-    if (m.amMacro.len>0) {
-      ADD_MACRO(o.am,m.amMacro);
-    }
-    if (m.arMacro.len>0) {
-      ADD_MACRO(o.ar,m.arMacro);
-    }
-    if (m.drMacro.len>0) {
-      ADD_MACRO(o.dr,m.drMacro);
-    }
-    if (m.multMacro.len>0) {
-      ADD_MACRO(o.mult,m.multMacro);
-    }
-    if (m.rrMacro.len>0) {
-      ADD_MACRO(o.rr,m.rrMacro);
-    }
-    if (m.slMacro.len>0) {
-      ADD_MACRO(o.sl,m.slMacro);
-    }
-    if (m.tlMacro.len>0) {
-      ADD_MACRO(o.tl,m.tlMacro);
-    }
-    if (m.dt2Macro.len>0) {
-      ADD_MACRO(o.dt2,m.dt2Macro);
-    }
-    if (m.rsMacro.len>0) {
-      ADD_MACRO(o.rs,m.rsMacro);
-    }
-    if (m.dtMacro.len>0) {
-      ADD_MACRO(o.dt,m.dtMacro);
-    }
-    if (m.d2rMacro.len>0) {
-      ADD_MACRO(o.d2r,m.d2rMacro);
-    }
-    if (m.ssgMacro.len>0) {
-      ADD_MACRO(o.ssg,m.ssgMacro);
-    }
-
-    if (m.damMacro.len>0) {
-      ADD_MACRO(o.dam,m.damMacro);
-    }
-    if (m.dvbMacro.len>0) {
-      ADD_MACRO(o.dvb,m.dvbMacro);
-    }
-    if (m.egtMacro.len>0) {
-      ADD_MACRO(o.egt,m.egtMacro);
-    }
-    if (m.kslMacro.len>0) {
-      ADD_MACRO(o.ksl,m.kslMacro);
-    }
-    if (m.susMacro.len>0) {
-      ADD_MACRO(o.sus,m.susMacro);
-    }
-    if (m.vibMacro.len>0) {
-      ADD_MACRO(o.vib,m.vibMacro);
-    }
-    if (m.wsMacro.len>0) {
-      ADD_MACRO(o.ws,m.wsMacro);
-    }
-    if (m.ksrMacro.len>0) {
-      ADD_MACRO(o.ksr,m.ksrMacro);
-    }
+    fillMacro(ins[2]->std.opMacros[i].tlMacro,24,-1,-1,i+1);
+    fillMacro(ins[2]->std.opMacros[i].arMacro,2,-1,-1,i+1);
   }
+  fillMacro(ins[2]->std.algMacro,1,-1,-1,1);
+  fillMacro(ins[2]->std.fbMacro,6,4,-1,1);
 
-  for (size_t i=0; i<macroListLen; i++) {
-    macroList[i]->prepare(*macroSource[i]);
+  DivMacroInt* macros=new DivMacroInt[chans];
+  for (int i=0; i<chans; i++) {
+    macros[i].setEngine(NULL);
   }
-}
 
-void DivMacroInt::notifyInsDeletion(DivInstrument* which) {
-  if (ins==which) {
-    init(NULL);
+  logI("macro benchmark: %d channels, %d ticks",chans,ticks);
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  double initTime=0;
+  int notes=0;
+  int sink=0;
+  for (int t=0; t<ticks; t++) {
+    // a note every 12 ticks, released after 8
+    if ((t%12)==0) {
+      std::chrono::steady_clock::time_point initStart=std::chrono::steady_clock::now();
+      for (int i=0; i<chans; i++) {
+        macros[i].init(ins[(i+t/12)%3]);
+      }
+      initTime+=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-initStart).count();
+      notes+=chans;
+    } else if ((t%12)==8) {
+      for (int i=0; i<chans; i++) {
+        macros[i].release();
+      }
+    }
+    for (int i=0; i<chans; i++) {
+      macros[i].next();
+      sink+=macros[i].vol.val+macros[i].op[0].tl.val;
+    }
   }
+  double elapsed=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+  logI("- next(): %.1fns per channel per tick",1000000.0*(elapsed-initTime)/((double)ticks*chans));
+  logI("- init(): %.1fns per note",1000000.0*initTime/notes);
+  logD("(%d)",sink);
+
+  delete[] macros;
+  for (int i=0; i<3; i++) delete ins[i];
 }
@@ -40,6 +40,10 @@ struct DivMacroStruct {
     has=had=actualHad=will=true;
     mode=source.mode;
   }
+  // whether running the macro would no longer change anything
+  bool idle() {
+    return !(has || had || actualHad || finished);
+  }
   DivMacroStruct():
     pos(0),
     val(0),
@@ -54,9 +58,13 @@ struct DivMacroStruct {
 class DivMacroInt {
   DivEngine* e;
   DivInstrument* ins;
-  DivMacroStruct* macroList[128];
-  DivInstrumentMacro* macroSource[128];
+  // macros set up by init(), one after another
+  DivMacroStruct* macroList[DIV_MACRO_COUNT];
+  DivInstrumentMacro* macroSource[DIV_MACRO_COUNT];
   size_t macroListLen;
+  // the ones among them which still have to run, as indexes into macroList
+  unsigned char activeList[DIV_MACRO_COUNT];
+  size_t activeListLen;
   int subTick;
   bool released;
   public:
@@ -113,6 +121,13 @@ class DivMacroInt {
      */
     void setEngine(DivEngine* eng);
 
+    /**
+     * get a macro by index, in the order of DivInstrumentSTD::getMacro().
+     * @param index the index, from 0 to DIV_MACRO_COUNT-1.
+     * @return the macro.
+     */
+    DivMacroStruct& getMacro(int index);
+
     /**
      * initialize the macro interpreter.
      * @param which an instrument, or NULL.
@@ -129,6 +144,7 @@ class DivMacroInt {
       e(NULL),
       ins(NULL),
       macroListLen(0),
+      activeListLen(0),
       subTick(1),
       released(false),
       vol(),
@@ -151,9 +167,17 @@ class DivMacroInt {
       ex6(),
       ex7(),
       ex8() {
-      memset(macroList,0,128*sizeof(void*));
-      memset(macroSource,0,128*sizeof(void*));
+      memset(macroList,0,DIV_MACRO_COUNT*sizeof(void*));
+      memset(macroSource,0,DIV_MACRO_COUNT*sizeof(void*));
+      memset(activeList,0,DIV_MACRO_COUNT);
     }
 };
 
+/**
+ * measure the speed of the macro interpreter.
+ * @param chans the number of channels.
+ * @param ticks the number of ticks to run.
+ */
+void divMacroBenchmark(int chans, int ticks);
+
 #endif
@@ -0,0 +1,316 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "mixer.h"
+#include "../ta-log.h"
+#include <chrono>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DIV_MIX_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define DIV_MIX_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DIV_MIX_TARGET(x) __attribute__((target(x)))
+#else
+#define DIV_MIX_TARGET(x)
+#endif
+
+#define DIV_MIX_SCALE (1.0f/32768.0f)
+
+// scalar
+
+static void mixSystemScalar(float* outL, float* outR, const short* inL, const short* inR, float volL, float volR, size_t len) {
+  volL*=DIV_MIX_SCALE;
+  volR*=DIV_MIX_SCALE;
+  for (size_t i=0; i<len; i++) {
+    outL[i]+=(float)inL[i]*volL;
+    outR[i]+=(float)inR[i]*volR;
+  }
+}
+
+static void mixOutputScalar(float* outL, float* outR, float* oscL, float* oscR, size_t len, bool mono) {
+  if (mono) {
+    for (size_t i=0; i<len; i++) {
+      oscL[i]=outL[i];
+      oscR[i]=outR[i];
+      outL[i]=(outL[i]+outR[i])*0.5f;
+      outR[i]=outL[i];
+    }
+  } else {
+    memcpy(oscL,outL,len*sizeof(float));
+    memcpy(oscR,outR,len*sizeof(float));
+  }
+}
+
+#ifdef DIV_MIX_X86
+// SSE2
+
+DIV_MIX_TARGET("sse2") static void mixSystemSSE2(float* outL, float* outR, const short* inL, const short* inR, float volL, float volR, size_t len) {
+  volL*=DIV_MIX_SCALE;
+  volR*=DIV_MIX_SCALE;
+  const __m128 vL=_mm_set1_ps(volL);
+  const __m128 vR=_mm_set1_ps(volR);
+  size_t i=0;
+  for (; i+8<=len; i+=8) {
+    __m128i sL=_mm_loadu_si128((const __m128i*)(inL+i));
+    __m128i sR=_mm_loadu_si128((const __m128i*)(inR+i));
+    __m128 l0=_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(sL,sL),16));
+    __m128 l1=_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(sL,sL),16));
+    __m128 r0=_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(sR,sR),16));
+    __m128 r1=_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(sR,sR),16));
+    _mm_storeu_ps(outL+i,_mm_add_ps(_mm_loadu_ps(outL+i),_mm_mul_ps(l0,vL)));
+    _mm_storeu_ps(outL+i+4,_mm_add_ps(_mm_loadu_ps(outL+i+4),_mm_mul_ps(l1,vL)));
+    _mm_storeu_ps(outR+i,_mm_add_ps(_mm_loadu_ps(outR+i),_mm_mul_ps(r0,vR)));
+    _mm_storeu_ps(outR+i+4,_mm_add_ps(_mm_loadu_ps(outR+i+4),_mm_mul_ps(r1,vR)));
+  }
+  for (; i<len; i++) {
+    outL[i]+=(float)inL[i]*volL;
+    outR[i]+=(float)inR[i]*volR;
+  }
+}
+
+DIV_MIX_TARGET("sse2") static void mixOutputSSE2(float* outL, float* outR, float* oscL, float* oscR, size_t len, bool mono) {
+  if (!mono) {
+    mixOutputScalar(outL,outR,oscL,oscR,len,false);
+    return;
+  }
+  const __m128 half=_mm_set1_ps(0.5f);
+  size_t i=0;
+  for (; i+4<=len; i+=4) {
+    __m128 l=_mm_loadu_ps(outL+i);
+    __m128 r=_mm_loadu_ps(outR+i);
+    _mm_storeu_ps(oscL+i,l);
+    _mm_storeu_ps(oscR+i,r);
+    __m128 m=_mm_mul_ps(_mm_add_ps(l,r),half);
+    _mm_storeu_ps(outL+i,m);
+    _mm_storeu_ps(outR+i,m);
+  }
+  mixOutputScalar(outL+i,outR+i,oscL+i,oscR+i,len-i,true);
+}
+
+// AVX2
+
+DIV_MIX_TARGET("avx2") static void mixSystemAVX2(float* outL, float* outR, const short* inL, const short* inR, float volL, float volR, size_t len) {
+  volL*=DIV_MIX_SCALE;
+  volR*=DIV_MIX_SCALE;
+  const __m256 vL=_mm256_set1_ps(volL);
+  const __m256 vR=_mm256_set1_ps(volR);
+  size_t i=0;
+  for (; i+8<=len; i+=8) {
+    __m256 l=_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(inL+i))));
+    __m256 r=_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(inR+i))));
+    _mm256_storeu_ps(outL+i,_mm256_add_ps(_mm256_loadu_ps(outL+i),_mm256_mul_ps(l,vL)));
+    _mm256_storeu_ps(outR+i,_mm256_add_ps(_mm256_loadu_ps(outR+i),_mm256_mul_ps(r,vR)));
+  }
+  for (; i<len; i++) {
+    outL[i]+=(float)inL[i]*volL;
+    outR[i]+=(float)inR[i]*volR;
+  }
+}
+
+DIV_MIX_TARGET("avx2") static void mixOutputAVX2(float* outL, float* outR, float* oscL, float* oscR, size_t len, bool mono) {
+  if (!mono) {
+    mixOutputScalar(outL,outR,oscL,oscR,len,false);
+    return;
+  }
+  const __m256 half=_mm256_set1_ps(0.5f);
+  size_t i=0;
+  for (; i+8<=len; i+=8) {
+    __m256 l=_mm256_loadu_ps(outL+i);
+    __m256 r=_mm256_loadu_ps(outR+i);
+    _mm256_storeu_ps(oscL+i,l);
+    _mm256_storeu_ps(oscR+i,r);
+    __m256 m=_mm256_mul_ps(_mm256_add_ps(l,r),half);
+    _mm256_storeu_ps(outL+i,m);
+    _mm256_storeu_ps(outR+i,m);
+  }
+  mixOutputScalar(outL+i,outR+i,oscL+i,oscR+i,len-i,true);
+}
+
+static bool cpuHasSSE2() {
+#if defined(__x86_64__) || defined(_M_X64)
+  return true;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info,1);
+  return (info[3]&(1<<26))!=0;
+#else
+  return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpuHasAVX2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info,0);
+  if (info[0]<7) return false;
+  __cpuid(info,1);
+  // OSXSAVE and AVX, then check that the OS saves the YMM state
+  if ((info[2]&(1<<27))==0 || (info[2]&(1<<28))==0) return false;
+  if ((_xgetbv(0)&6)!=6) return false;
+  __cpuidex(info,7,0);
+  return (info[1]&(1<<5))!=0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#ifdef DIV_MIX_NEON
+// NEON
+
+static void mixSystemNEON(float* outL, float* outR, const short* inL, const short* inR, float volL, float volR, size_t len) {
+  volL*=DIV_MIX_SCALE;
+  volR*=DIV_MIX_SCALE;
+  const float32x4_t vL=vdupq_n_f32(volL);
+  const float32x4_t vR=vdupq_n_f32(volR);
+  size_t i=0;
+  for (; i+8<=len; i+=8) {
+    int16x8_t sL=vld1q_s16(inL+i);
+    int16x8_t sR=vld1q_s16(inR+i);
+    float32x4_t l0=vcvtq_f32_s32(vmovl_s16(vget_low_s16(sL)));
+    float32x4_t l1=vcvtq_f32_s32(vmovl_s16(vget_high_s16(sL)));
+    float32x4_t r0=vcvtq_f32_s32(vmovl_s16(vget_low_s16(sR)));
+    float32x4_t r1=vcvtq_f32_s32(vmovl_s16(vget_high_s16(sR)));
+    vst1q_f32(outL+i,vmlaq_f32(vld1q_f32(outL+i),l0,vL));
+    vst1q_f32(outL+i+4,vmlaq_f32(vld1q_f32(outL+i+4),l1,vL));
+    vst1q_f32(outR+i,vmlaq_f32(vld1q_f32(outR+i),r0,vR));
+    vst1q_f32(outR+i+4,vmlaq_f32(vld1q_f32(outR+i+4),r1,vR));
+  }
+  for (; i<len; i++) {
+    outL[i]+=(float)inL[i]*volL;
+    outR[i]+=(float)inR[i]*volR;
+  }
+}
+
+static void mixOutputNEON(float* outL, float* outR, float* oscL, float* oscR, size_t len, bool mono) {
+  if (!mono) {
+    mixOutputScalar(outL,outR,oscL,oscR,len,false);
+    return;
+  }
+  const float32x4_t half=vdupq_n_f32(0.5f);
+  size_t i=0;
+  for (; i+4<=len; i+=4) {
+    float32x4_t l=vld1q_f32(outL+i);
+    float32x4_t r=vld1q_f32(outR+i);
+    vst1q_f32(oscL+i,l);
+    vst1q_f32(oscR+i,r);
+    float32x4_t m=vmulq_f32(vaddq_f32(l,r),half);
+    vst1q_f32(outL+i,m);
+    vst1q_f32(outR+i,m);
+  }
+  mixOutputScalar(outL+i,outR+i,oscL+i,oscR+i,len-i,true);
+}
+#endif
+
+struct DivMixTable {
+  DivMixFuncs funcs[4];
+  int count;
+
+  DivMixTable():
+    count(0) {
+    funcs[count++]={"scalar",mixSystemScalar,mixOutputScalar};
+#ifdef DIV_MIX_X86
+    if (cpuHasSSE2()) {
+      funcs[count++]={"SSE2",mixSystemSSE2,mixOutputSSE2};
+    }
+    if (cpuHasAVX2()) {
+      funcs[count++]={"AVX2",mixSystemAVX2,mixOutputAVX2};
+    }
+#endif
+#ifdef DIV_MIX_NEON
+    funcs[count++]={"NEON",mixSystemNEON,mixOutputNEON};
+#endif
+  }
+};
+
+static const DivMixTable& getMixTable() {
+  static const DivMixTable table;
+  return table;
+}
+
+const DivMixFuncs* divMixGetFuncs() {
+  const DivMixTable& t=getMixTable();
+  return &t.funcs[t.count-1];
+}
+
+const DivMixFuncs* divMixGetAll(int& count) {
+  const DivMixTable& t=getMixTable();
+  count=t.count;
+  return t.funcs;
+}
+
+void divMixBenchmark(int systems, size_t size, int iterations) {
+  if (systems<1) systems=1;
+  if (size<1) size=1;
+  if (iterations<1) iterations=1;
+
+  short** in=new short*[systems];
+  for (int i=0; i<systems; i++) {
+    in[i]=new short[size];
+    for (size_t j=0; j<size; j++) {
+      in[i][j]=(short)(((j*(i+3)*2654435761u)>>16)&0xffff);
+    }
+  }
+  float* outL=new float[size];
+  float* outR=new float[size];
+  float* oscL=new float[size];
+  float* oscR=new float[size];
+
+  logI("mix benchmark: %d systems, %d samples, %d buffers",systems,(int)size,iterations);
+
+  int count=0;
+  const DivMixFuncs* all=divMixGetAll(count);
+  double base=0;
+  for (int k=0; k<count; k++) {
+    const DivMixFuncs& f=all[k];
+    std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+    for (int it=0; it<iterations; it++) {
+      memset(outL,0,size*sizeof(float));
+      memset(outR,0,size*sizeof(float));
+      for (int i=0; i<systems; i++) {
+        // alternate between stereo and mono systems
+        f.mixSystem(outL,outR,in[i],in[(i&1)?i:((i+1)%systems)],0.5f,0.7f,size);
+      }
+      f.mixOutput(outL,outR,oscL,oscR,size,it&1);
+    }
+    double elapsed=std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/iterations;
+    if (k==0) base=elapsed;
+    logI("- %s: %.2fµs per buffer (%.2fx)",f.name,elapsed,(elapsed>0)?(base/elapsed):0.0);
+  }
+
+  delete[] outL;
+  delete[] outR;
+  delete[] oscL;
+  delete[] oscR;
+  for (int i=0; i<systems; i++) {
+    delete[] in[i];
+  }
+  delete[] in;
+}
@@ -0,0 +1,57 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _MIXER_H
+#define _MIXER_H
+#include <stddef.h>
+
+// add a system's output to the mix, converting from 16-bit and applying volume.
+// for mono systems inR is the same as inL.
+typedef void (*DivMixSystemFunc)(float* outL, float* outR, const short* inL, const short* inR, float volL, float volR, size_t len);
+
+// copy the mix to the oscilloscope buffers and fold it to mono if requested.
+typedef void (*DivMixOutputFunc)(float* outL, float* outR, float* oscL, float* oscR, size_t len, bool mono);
+
+struct DivMixFuncs {
+  const char* name;
+  DivMixSystemFunc mixSystem;
+  DivMixOutputFunc mixOutput;
+};
+
+/**
+ * get the fastest mix functions supported by this CPU.
+ * the choice is made once on first call.
+ */
+const DivMixFuncs* divMixGetFuncs();
+
+/**
+ * get every mix implementation supported by this CPU (scalar first).
+ * @param count receives the number of entries.
+ */
+const DivMixFuncs* divMixGetAll(int& count);
+
+/**
+ * time the mix stage of each implementation and log the results.
+ * @param systems number of systems to mix.
+ * @param size buffer size in samples.
+ * @param iterations number of buffers to mix per implementation.
+ */
+void divMixBenchmark(int systems, size_t size, int iterations);
+
+#endif
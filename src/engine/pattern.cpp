@@ -21,18 +21,43 @@
 
 static DivPattern emptyPat;
 
-DivPattern::DivPattern() {
-  memset(data,-1,256*32*sizeof(short));
-  for (int i=0; i<256; i++) {
+static void clearRows(short (*data)[DIV_PAT_COLS], int from, int to) {
+  if (to<=from) return;
+  memset(data[from],-1,(to-from)*DIV_PAT_COLS*sizeof(short));
+  for (int i=from; i<to; i++) {
     data[i][0]=0;
     data[i][1]=0;
   }
 }
 
+DivPattern::DivPattern(int r) {
+  if (r<1) r=1;
+  if (r>256) r=256;
+  rows=r;
+  data=new short[rows][DIV_PAT_COLS];
+  clearRows(data,0,rows);
+}
+
+DivPattern::~DivPattern() {
+  delete[] data;
+}
+
+void DivPattern::resize(int newRows) {
+  if (newRows<1) newRows=1;
+  if (newRows>256) newRows=256;
+  if (newRows==rows) return;
+  short (*newData)[DIV_PAT_COLS]=new short[newRows][DIV_PAT_COLS];
+  memcpy(newData,data,MIN(rows,newRows)*sizeof(*data));
+  clearRows(newData,rows,newRows);
+  delete[] data;
+  data=newData;
+  rows=newRows;
+}
+
 DivPattern* DivChannelData::getPattern(int index, bool create) {
   if (data[index]==NULL) {
     if (create) {
-      data[index]=new DivPattern;
+      data[index]=new DivPattern(rows);
     } else {
       return &emptyPat;
     }
@@ -40,6 +65,22 @@ DivPattern* DivChannelData::getPattern(int index, bool create) {
   return data[index];
 }
 
+DivPattern* DivChannelData::getPatternForRow(int index, int row) {
+  DivPattern* ret=getPattern(index,false);
+  // rows past the end were never written, so they are empty
+  if (row>=ret->rows) return &emptyPat;
+  return ret;
+}
+
+void DivChannelData::setRows(int newRows) {
+  if (newRows<1) newRows=1;
+  if (newRows>256) newRows=256;
+  rows=newRows;
+  for (int i=0; i<256; i++) {
+    if (data[i]!=NULL) data[i]->resize(rows);
+  }
+}
+
 void DivChannelData::wipePatterns() {
   for (int i=0; i<256; i++) {
     if (data[i]!=NULL) {
@@ -51,14 +92,15 @@ void DivChannelData::wipePatterns() {
 
 void DivPattern::copyOn(DivPattern *dest) {
   dest->name=name;
-  memcpy(dest->data,data,sizeof(data));
+  memcpy(dest->data,data,MIN(rows,dest->rows)*sizeof(*data));
 }
 
 SafeReader* DivPattern::compile(int len, int fxRows) {
   SafeWriter w;
   w.init();
+  if (len>rows) len=rows;
   short lastNote, lastOctave, lastInstr, lastVolume, lastEffect[8], lastEffectVal[8];
-  unsigned char rows=0;
+  unsigned char skipRows=0;
 
   lastNote=0;
   lastOctave=0;
@@ -91,14 +133,14 @@ SafeReader* DivPattern::compile(int len, int fxRows) {
     }
 
     if (!mask) {
-      rows++;
+      skipRows++;
       continue;
     }
 
-    if (rows!=0) {
-      w.writeC(rows);
+    if (skipRows!=0) {
+      w.writeC(skipRows);
     }
-    rows=1;
+    skipRows=1;
 
     w.writeC(mask);
     if (mask&128) {
@@ -123,13 +165,14 @@ SafeReader* DivPattern::compile(int len, int fxRows) {
       }
     }
   }
-  w.writeC(rows);
+  w.writeC(skipRows);
   w.writeC(0);
 
   return w.toReader();
 }
 
 DivChannelData::DivChannelData():
-  effectRows(1) {
+  effectRows(1),
+  rows(256) {
   memset(data,0,256*sizeof(void*));
 }
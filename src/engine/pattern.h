@@ -19,16 +19,28 @@
 
 #include "safeReader.h"
 
+// note, octave, instrument, volume and up to 8 effect/value pairs.
+#define DIV_PAT_COLS 20
+
 struct DivPattern {
   String name;
-  short data[256][32];
+  // rows are stored one after another, so data[ROW][TYPE] still works.
+  short (*data)[DIV_PAT_COLS];
+  int rows;
 
   /**
    * copy this pattern to another.
+   * if they differ in size, only the rows both have are copied.
    * @param dest the destination pattern.
    */
   void copyOn(DivPattern* dest);
 
+  /**
+   * change the number of rows, keeping the existing ones.
+   * @param newRows the new row count.
+   */
+  void resize(int newRows);
+
   /**
    * don't use yet!
    * @param len the pattern length
@@ -36,11 +48,17 @@ struct DivPattern {
    * @return a SafeReader.
    */
   SafeReader* compile(int len=256, int fxRows=1);
-  DivPattern();
+  DivPattern(int r=256);
+  ~DivPattern();
+  // data is owned by the pattern. use copyOn() to copy one.
+  DivPattern(const DivPattern&)=delete;
+  DivPattern& operator=(const DivPattern&)=delete;
 };
 
 struct DivChannelData {
   unsigned char effectRows;
+  // rows allocated for each pattern. never less than the song's pattern length.
+  int rows;
   // data goes as follows: data[ROW][TYPE]
   // TYPE is:
   // 0: note
@@ -59,6 +77,21 @@ struct DivChannelData {
    */
   DivPattern* getPattern(int index, bool create);
 
+  /**
+   * get the pattern to read a row from during playback.
+   * @param index the pattern ID.
+   * @param row the row which will be read.
+   * @return the pattern, or the empty pattern if the row lies past its end.
+   */
+  DivPattern* getPatternForRow(int index, int row);
+
+  /**
+   * change the number of rows of every pattern in this channel.
+   * rows past the new size are lost.
+   * @param newRows the new row count.
+   */
+  void setRows(int newRows);
+
   /**
    * destroy all patterns on this DivChannelData.
    */
@@ -18,6 +18,7 @@
  */
 
 #include "../dispatch.h"
+#include "../safeWriter.h"
 
 void DivDispatch::acquire(short* bufL, short* bufR, size_t start, size_t len) {
 }
@@ -48,6 +49,76 @@ void* DivDispatch::getState() {
 void DivDispatch::setState(void* state) {
 }
 
+DivDispatchSoftState* DivDispatch::saveSoftState() {
+  return NULL;
+}
+
+void DivDispatch::loadSoftState(DivDispatchSoftState* state) {
+}
+
+const char* DivDispatch::getStateFormat(int& version) {
+  return NULL;
+}
+
+void DivDispatch::writeState(SafeWriter* w) {
+}
+
+bool DivDispatch::readState(SafeReader& r) {
+  return false;
+}
+
+bool DivDispatch::saveState(SafeWriter* w) {
+  int version=0;
+  const char* id=getStateFormat(version);
+  if (id==NULL) return false;
+  w->write("CHST",4);
+  w->write(id,4);
+  w->writeI(version);
+  size_t lenPos=w->tell();
+  w->writeI(0);
+  writeState(w);
+  size_t end=w->tell();
+  w->seek(lenPos,SEEK_SET);
+  w->writeI(end-lenPos-4);
+  w->seek(end,SEEK_SET);
+  return true;
+}
+
+bool DivDispatch::loadState(SafeReader& r) {
+  int version=0;
+  const char* id=getStateFormat(version);
+  if (id==NULL) return false;
+  size_t start=r.tell();
+  if (r.size()-start<16) return false;
+
+  char magic[4];
+  char stateID[4];
+  r.read(magic,4);
+  r.read(stateID,4);
+  int stateVersion=r.readI();
+  int len=r.readI();
+  if (memcmp(magic,"CHST",4)!=0 || memcmp(stateID,id,4)!=0 || stateVersion!=version || len<0 || (size_t)len>r.size()-r.tell()) {
+    r.seek(start,SEEK_SET);
+    return false;
+  }
+
+  // parse the body on its own so that a bad state can't read past it
+  std::vector<unsigned char> body(len);
+  r.read(body.data(),len);
+  SafeReader bodyReader(body.data(),len);
+  bool ok=false;
+  try {
+    ok=readState(bodyReader);
+  } catch (EndOfFileException& e) {
+    ok=false;
+  }
+  if (!ok) {
+    r.seek(start,SEEK_SET);
+    return false;
+  }
+  return true;
+}
+
 void DivDispatch::muteChannel(int ch, bool mute) {
 }
 
@@ -89,6 +160,29 @@ const char* DivDispatch::getEffectName(unsigned char effect) {
 void DivDispatch::setFlags(unsigned int flags) {
 }
 
+int DivDispatch::getCoreCount() {
+  return 1;
+}
+
+const char* DivDispatch::getCoreName(int core) {
+  return NULL;
+}
+
+int DivDispatch::getFastCore() {
+  return 0;
+}
+
+int DivDispatch::getAccurateCore() {
+  return 0;
+}
+
+void DivDispatch::setCore(int core) {
+}
+
+int DivDispatch::getCore() {
+  return 0;
+}
+
 void DivDispatch::setSkipRegisterWrites(bool value) {
   skipRegisterWrites=value;
 }
@@ -105,6 +199,10 @@ void DivDispatch::notifyInsDeletion(void* ins) {
 
 }
 
+void DivDispatch::notifySampleChange() {
+
+}
+
 void DivDispatch::notifyPlaybackStop() {
 
 }
@@ -115,6 +213,31 @@ void DivDispatch::forceIns() {
 
 void DivDispatch::toggleRegisterDump(bool enable) {
   dumpWrites=enable;
+  regWriteTime=0;
+}
+
+void DivDispatch::toggleOscTap(bool enable) {
+  oscTap=enable;
+}
+
+void DivDispatch::setOscBuffers(bool enable, DivDispatchOscBuffer** bufs, int count) {
+  // the buffers are only allocated once a tap is requested
+  if (enable) for (int i=0; i<count; i++) {
+    if (bufs[i]==NULL) bufs[i]=new DivDispatchOscBuffer;
+  }
+  oscTap=enable;
+}
+
+void DivDispatch::freeOscBuffers(DivDispatchOscBuffer** bufs, int count) {
+  for (int i=0; i<count; i++) {
+    delete bufs[i];
+    bufs[i]=NULL;
+  }
+  oscTap=false;
+}
+
+DivDispatchOscBuffer* DivDispatch::getOscBuffer(int chan) {
+  return NULL;
 }
 
 std::vector<DivRegWrite>& DivDispatch::getRegisterWrites() {
@@ -140,5 +263,9 @@ int DivDispatch::init(DivEngine* p, int channels, int sugRate, unsigned int flag
 void DivDispatch::quit() {
 }
 
+DivDispatch::DivDispatch():
+  regWriteTime(0) {
+}
+
 DivDispatch::~DivDispatch() {
 }
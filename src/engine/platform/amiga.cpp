@@ -91,13 +91,16 @@ const char* DivPlatformAmiga::getEffectName(unsigned char effect) {
   }
 
 void DivPlatformAmiga::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int outL, outR;
+  int outL, outR;
   for (size_t h=start; h<start+len; h++) {
     outL=0;
     outR=0;
     for (int i=0; i<4; i++) {
-      if (!chan[i].active) continue;
-      if (chan[i].useWave || (chan[i].sample>=0 && chan[i].sample<parent->song.sampleLen)) {
+      if (!chan[i].active) {
+        if (oscTap) oscBuf[i]->data[oscBuf[i]->needle++]=0;
+        continue;
+      }
+      if (chan[i].useWave || chan[i].sample>=0) {
         chan[i].audSub-=AMIGA_DIVIDER;
         if (chan[i].audSub<0) {
           if (chan[i].useWave) {
@@ -106,14 +109,15 @@ void DivPlatformAmiga::acquire(short* bufL, short* bufR, size_t start, size_t le
               chan[i].audPos=0;
             }
           } else {
-            DivSample* s=parent->getSample(chan[i].sample);
-            if (s->samples>0) {
-              if (chan[i].audPos<s->samples) {
-                writeAudDat(s->data8[chan[i].audPos++]);
+            DivSampleCursor& cur=chan[i].cursor;
+            if (cur.index!=chan[i].sample) cur.set(parent,chan[i].sample);
+            if (cur.valid()) {
+              if (chan[i].audPos<cur.len) {
+                writeAudDat(cur.data8[chan[i].audPos++]);
               }
-              if (chan[i].audPos>=s->samples || chan[i].audPos>=131071) {
-                if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-                  chan[i].audPos=s->loopStart;
+              if (chan[i].audPos>=cur.len || chan[i].audPos>=131071) {
+                if (cur.loopStart>=0) {
+                  chan[i].audPos=cur.loopStart;
                 } else {
                   chan[i].sample=-1;
                 }
@@ -138,6 +142,9 @@ void DivPlatformAmiga::acquire(short* bufL, short* bufR, size_t start, size_t le
           }
         }
       }
+      if (oscTap) {
+        oscBuf[i]->data[oscBuf[i]->needle++]=isMuted[i]?0:((chan[i].audDat*chan[i].outVol)<<2);
+      }
       if (!isMuted[i]) {
         if (i==0 || i==3) {
           outL+=((chan[i].audDat*chan[i].outVol)*sep1)>>7;
@@ -413,6 +420,85 @@ void* DivPlatformAmiga::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformAmiga::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<4; i++) s->chan[i]=chan[i];
+  s->filterOn=filterOn;
+  return s;
+}
+
+void DivPlatformAmiga::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<4; i++) {
+    chan[i]=s->chan[i];
+    chan[i].cursor.invalidate();
+  }
+  filterOn=s->filterOn;
+}
+
+const char* DivPlatformAmiga::getStateFormat(int& version) {
+  version=1;
+  return "PAUL";
+}
+
+void DivPlatformAmiga::writeState(SafeWriter* w) {
+  for (int i=0; i<4; i++) {
+    w->writeI(chan[i].audLoc);
+    w->writeS(chan[i].audLen);
+    w->writeI(chan[i].audPos);
+    w->writeI(chan[i].audSub);
+    w->writeC(chan[i].audDat);
+    w->writeI(chan[i].sample);
+    w->writeI(chan[i].busClock);
+    w->writeI(chan[i].freq);
+    w->writeC(chan[i].outVol);
+  }
+  for (int i=0; i<2; i++) {
+    for (int j=0; j<4; j++) {
+      w->writeI(filter[i][j]);
+    }
+  }
+}
+
+bool DivPlatformAmiga::readState(SafeReader& r) {
+  Channel newChan[4];
+  int newFilter[2][4];
+  for (int i=0; i<4; i++) {
+    newChan[i]=chan[i];
+    newChan[i].audLoc=r.readI();
+    newChan[i].audLen=r.readS();
+    newChan[i].audPos=r.readI();
+    newChan[i].audSub=r.readI();
+    newChan[i].audDat=r.readC();
+    newChan[i].sample=r.readI();
+    newChan[i].busClock=r.readI();
+    newChan[i].freq=r.readI();
+    newChan[i].outVol=r.readC();
+    if (newChan[i].sample<-1 || newChan[i].sample>=parent->song.sampleLen) return false;
+    if (newChan[i].audPos>=131072) return false;
+    if (newChan[i].useWave && (newChan[i].audPos>=(unsigned int)(newChan[i].audLen<<1) || (newChan[i].audLen<<1)>256)) return false;
+  }
+  for (int i=0; i<2; i++) {
+    for (int j=0; j<4; j++) {
+      newFilter[i][j]=r.readI();
+    }
+  }
+  if (r.tell()!=r.size()) return false;
+
+  for (int i=0; i<4; i++) chan[i]=newChan[i];
+  memcpy(filter,newFilter,sizeof(filter));
+  return true;
+}
+
+DivDispatchOscBuffer* DivPlatformAmiga::getOscBuffer(int ch) {
+  if (ch<0 || ch>=4) return NULL;
+  return oscBuf[ch];
+}
+
+void DivPlatformAmiga::toggleOscTap(bool enable) {
+  setOscBuffers(enable,oscBuf,4);
+}
+
 void DivPlatformAmiga::reset() {
   for (int i=0; i<4; i++) {
     chan[i]=DivPlatformAmiga::Channel();
@@ -456,6 +542,12 @@ void DivPlatformAmiga::notifyInsDeletion(void* ins) {
   }
 }
 
+void DivPlatformAmiga::notifySampleChange() {
+  for (int i=0; i<4; i++) {
+    chan[i].cursor.invalidate();
+  }
+}
+
 void DivPlatformAmiga::setFlags(unsigned int flags) {
   if (flags&1) {
     chipClock=COLOR_PAL*4.0/5.0;
@@ -480,8 +572,10 @@ int DivPlatformAmiga::init(DivEngine* p, int channels, int sugRate, unsigned int
   parent=p;
   dumpWrites=false;
   skipRegisterWrites=false;
+  oscTap=false;
   for (int i=0; i<4; i++) {
     isMuted[i]=false;
+    oscBuf[i]=NULL;
   }
   setFlags(flags);
   reset();
@@ -489,4 +583,5 @@ int DivPlatformAmiga::init(DivEngine* p, int channels, int sugRate, unsigned int
 }
 
 void DivPlatformAmiga::quit() {
+  freeOscBuffers(oscBuf,4);
 }
@@ -24,6 +24,7 @@
 #include <queue>
 #include "../macroInt.h"
 #include "../waveSynth.h"
+#include "sampleCursor.h"
 
 class DivPlatformAmiga: public DivDispatch {
   struct Channel {
@@ -41,6 +42,7 @@ class DivPlatformAmiga: public DivDispatch {
     signed char vol, outVol;
     DivMacroInt std;
     DivWaveSynth ws;
+    DivSampleCursor cursor;
     Channel():
       freq(0),
       baseFreq(0),
@@ -69,6 +71,11 @@ class DivPlatformAmiga: public DivDispatch {
       outVol(64) {}
   };
   Channel chan[4];
+  struct SoftState: public DivDispatchSoftState {
+    Channel chan[4];
+    bool filterOn;
+  };
+  DivDispatchOscBuffer* oscBuf[4];
   bool isMuted[4];
   bool bypassLimits;
   bool amigaModel;
@@ -82,10 +89,18 @@ class DivPlatformAmiga: public DivDispatch {
 
   friend void putDispatchChan(void*,int,int);
 
+  const char* getStateFormat(int& version);
+  void writeState(SafeWriter* w);
+  bool readState(SafeReader& r);
+
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
+    DivDispatchOscBuffer* getOscBuffer(int chan);
+    void toggleOscTap(bool enable);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
@@ -96,6 +111,7 @@ class DivPlatformAmiga: public DivDispatch {
     void notifyInsChange(int ins);
     void notifyWaveChange(int wave);
     void notifyInsDeletion(void* ins);
+    void notifySampleChange();
     const char** getRegisterSheet();
     const char* getEffectName(unsigned char effect);
     int init(DivEngine* parent, int channels, int sugRate, unsigned int flags);
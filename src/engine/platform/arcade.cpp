@@ -140,7 +140,7 @@ const char* DivPlatformArcade::getEffectName(unsigned char effect) {
 }
 
 void DivPlatformArcade::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static int o[2];
+  int o[2]={0,0};
 
   for (size_t h=start; h<start+len; h++) {
     if (!writes.empty() && !fm.write_busy) {
@@ -173,7 +173,7 @@ void DivPlatformArcade::acquire_nuked(short* bufL, short* bufR, size_t start, si
 }
 
 void DivPlatformArcade::acquire_ymfm(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     os[0]=0; os[1]=0;
@@ -797,8 +797,28 @@ bool DivPlatformArcade::isStereo() {
   return true;
 }
 
-void DivPlatformArcade::setYMFM(bool use) {
-  useYMFM=use;
+int DivPlatformArcade::getCoreCount() {
+  return 2;
+}
+
+const char* DivPlatformArcade::getCoreName(int core) {
+  return (core==1)?"Nuked-OPM":"ymfm";
+}
+
+int DivPlatformArcade::getFastCore() {
+  return 0;
+}
+
+int DivPlatformArcade::getAccurateCore() {
+  return 1;
+}
+
+void DivPlatformArcade::setCore(int core) {
+  useYMFM=(core==0);
+}
+
+int DivPlatformArcade::getCore() {
+  return useYMFM?0:1;
 }
 
 int DivPlatformArcade::init(DivEngine* p, int channels, int sugRate, unsigned int flags) {
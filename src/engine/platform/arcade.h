@@ -112,7 +112,12 @@ class DivPlatformArcade: public DivDispatch {
     void notifyInsChange(int ins);
     void setFlags(unsigned int flags);
     bool isStereo();
-    void setYMFM(bool use);
+    int getCoreCount();
+    const char* getCoreName(int core);
+    int getFastCore();
+    int getAccurateCore();
+    void setCore(int core);
+    int getCore();
     void poke(unsigned int addr, unsigned short val);
     void poke(std::vector<DivRegWrite>& wlist);
     const char** getRegisterSheet();
@@ -494,6 +494,212 @@ void* DivPlatformAY8910::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformAY8910::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<3; i++) s->chan[i]=chan[i];
+  s->dacMode=dacMode;
+  s->dacPeriod=dacPeriod;
+  s->dacRate=dacRate;
+  s->dacPos=dacPos;
+  s->dacSample=dacSample;
+  s->sampleBank=sampleBank;
+  s->ioPortA=ioPortA;
+  s->ioPortB=ioPortB;
+  s->portAVal=portAVal;
+  s->portBVal=portBVal;
+  s->ayEnvMode=ayEnvMode;
+  s->ayEnvPeriod=ayEnvPeriod;
+  s->ayEnvSlideLow=ayEnvSlideLow;
+  s->ayEnvSlide=ayEnvSlide;
+  return s;
+}
+
+void DivPlatformAY8910::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<3; i++) chan[i]=s->chan[i];
+  dacMode=s->dacMode;
+  dacPeriod=s->dacPeriod;
+  dacRate=s->dacRate;
+  dacPos=s->dacPos;
+  dacSample=s->dacSample;
+  sampleBank=s->sampleBank;
+  ioPortA=s->ioPortA;
+  ioPortB=s->ioPortB;
+  portAVal=s->portAVal;
+  portBVal=s->portBVal;
+  ayEnvMode=s->ayEnvMode;
+  ayEnvPeriod=s->ayEnvPeriod;
+  ayEnvSlideLow=s->ayEnvSlideLow;
+  ayEnvSlide=s->ayEnvSlide;
+}
+
+const char* DivPlatformAY8910::getStateFormat(int& version) {
+  version=1;
+  return "AY38";
+}
+
+void DivPlatformAY8910::writeState(SafeWriter* w) {
+  // the variant, so that a state is only loaded into the same one
+  w->writeI(ay->chip_type);
+  w->writeI(ay->m_type);
+  w->writeI(ay->m_flags);
+  w->writeI(ay->m_feature);
+
+  w->writeI(ay->m_ready);
+  w->writeC(ay->m_active);
+  w->writeI(ay->m_register_latch);
+  w->write(ay->m_regs,sizeof(ay->m_regs));
+  w->writeI(ay->m_last_enable);
+  for (int i=0; i<3; i++) {
+    w->writeI(ay->m_tone[i].period);
+    w->writeC(ay->m_tone[i].volume);
+    w->writeC(ay->m_tone[i].duty);
+    w->writeI(ay->m_tone[i].count);
+    w->writeC(ay->m_tone[i].duty_cycle);
+    w->writeC(ay->m_tone[i].output);
+    w->writeI(ay->m_envelope[i].period);
+    w->writeI(ay->m_envelope[i].count);
+    w->writeC(ay->m_envelope[i].step);
+    w->writeI(ay->m_envelope[i].volume);
+    w->writeC(ay->m_envelope[i].hold);
+    w->writeC(ay->m_envelope[i].alternate);
+    w->writeC(ay->m_envelope[i].attack);
+    w->writeC(ay->m_envelope[i].holding);
+    w->writeC(ay->m_vol_enabled[i]);
+  }
+  w->writeC(ay->m_prescale_noise);
+  w->writeI(ay->m_count_noise);
+  w->writeI(ay->m_rng);
+  w->writeI(ay->m_noise_and);
+  w->writeI(ay->m_noise_or);
+  w->writeI(ay->m_noise_value);
+  w->writeI(ay->m_noise_latch);
+  w->writeC(ay->m_mode);
+
+  w->write(regPool,sizeof(regPool));
+  for (int i=0; i<16; i++) {
+    w->writeS(oldWrites[i]);
+    w->writeS(pendingWrites[i]);
+  }
+  std::queue<QueuedWrite> queued=writes;
+  w->writeI(queued.size());
+  while (!queued.empty()) {
+    QueuedWrite& i=queued.front();
+    w->writeS(i.addr);
+    w->writeC(i.val);
+    w->writeC(i.addrOrVal);
+    queued.pop();
+  }
+  w->writeI(delay);
+  w->writeC(lastBusy);
+  w->writeI(dacPeriod);
+  w->writeI(dacRate);
+  w->writeI(dacPos);
+  w->writeI(dacSample);
+}
+
+bool DivPlatformAY8910::readState(SafeReader& r) {
+  if (r.readI()!=(int)ay->chip_type) return false;
+  if (r.readI()!=(int)ay->m_type) return false;
+  if (r.readI()!=ay->m_flags) return false;
+  if (r.readI()!=ay->m_feature) return false;
+
+  int ready=r.readI();
+  bool active=r.readC();
+  int registerLatch=r.readI();
+  unsigned char regs[sizeof(ay->m_regs)];
+  r.read(regs,sizeof(regs));
+  int lastEnable=r.readI();
+  ay8910_device::tone_t tone[3];
+  ay8910_device::envelope_t envelope[3];
+  unsigned char volEnabled[3];
+  for (int i=0; i<3; i++) {
+    tone[i].period=r.readI();
+    tone[i].volume=r.readC();
+    tone[i].duty=r.readC();
+    tone[i].count=r.readI();
+    tone[i].duty_cycle=r.readC();
+    tone[i].output=r.readC();
+    envelope[i].period=r.readI();
+    envelope[i].count=r.readI();
+    envelope[i].step=r.readC();
+    envelope[i].volume=r.readI();
+    envelope[i].hold=r.readC();
+    envelope[i].alternate=r.readC();
+    envelope[i].attack=r.readC();
+    envelope[i].holding=r.readC();
+    volEnabled[i]=r.readC();
+    if (envelope[i].volume>=32) return false;
+  }
+  unsigned char prescaleNoise=r.readC();
+  int countNoise=r.readI();
+  int rng=r.readI();
+  unsigned int noiseAnd=r.readI();
+  unsigned int noiseOr=r.readI();
+  unsigned int noiseValue=r.readI();
+  unsigned int noiseLatch=r.readI();
+  unsigned char mode=r.readC();
+  if (registerLatch<0 || registerLatch>=16) return false;
+
+  unsigned char newRegPool[16];
+  short newOldWrites[16];
+  short newPendingWrites[16];
+  r.read(newRegPool,16);
+  for (int i=0; i<16; i++) {
+    newOldWrites[i]=r.readS();
+    newPendingWrites[i]=r.readS();
+  }
+  int queuedLen=r.readI();
+  if (queuedLen<0 || (size_t)queuedLen>(r.size()-r.tell())/4) return false;
+  std::queue<QueuedWrite> newWrites;
+  for (int i=0; i<queuedLen; i++) {
+    unsigned short addr=r.readS();
+    unsigned char val=r.readC();
+    newWrites.emplace(addr,val);
+    newWrites.back().addrOrVal=r.readC();
+  }
+  int newDelay=r.readI();
+  unsigned char newLastBusy=r.readC();
+  int newDacPeriod=r.readI();
+  int newDacRate=r.readI();
+  int newDacPos=r.readI();
+  int newDacSample=r.readI();
+  if (r.tell()!=r.size()) return false;
+  if (newDacSample<-1 || newDacSample>=parent->song.sampleLen) return false;
+  if (newDacSample>=0 && (newDacPos<0 || (unsigned int)newDacPos>=parent->getSample(newDacSample)->samples)) return false;
+
+  ay->m_ready=ready;
+  ay->m_active=active;
+  ay->m_register_latch=registerLatch;
+  memcpy(ay->m_regs,regs,sizeof(regs));
+  ay->m_last_enable=lastEnable;
+  for (int i=0; i<3; i++) {
+    ay->m_tone[i]=tone[i];
+    ay->m_envelope[i]=envelope[i];
+    ay->m_vol_enabled[i]=volEnabled[i];
+  }
+  ay->m_prescale_noise=prescaleNoise;
+  ay->m_count_noise=countNoise;
+  ay->m_rng=rng;
+  ay->m_noise_and=noiseAnd;
+  ay->m_noise_or=noiseOr;
+  ay->m_noise_value=noiseValue;
+  ay->m_noise_latch=noiseLatch;
+  ay->m_mode=mode;
+
+  memcpy(regPool,newRegPool,16);
+  memcpy(oldWrites,newOldWrites,16*sizeof(short));
+  memcpy(pendingWrites,newPendingWrites,16*sizeof(short));
+  writes=newWrites;
+  delay=newDelay;
+  lastBusy=newLastBusy;
+  dacPeriod=newDacPeriod;
+  dacRate=newDacRate;
+  dacPos=newDacPos;
+  dacSample=newDacSample;
+  return true;
+}
+
 unsigned char* DivPlatformAY8910::getRegisterPool() {
   return regPool;
 }
@@ -42,6 +42,23 @@ class DivPlatformAY8910: public DivDispatch {
       Channel(): freqH(0), freqL(0), freq(0), baseFreq(0), note(0), pitch(0), ins(-1), psgMode(1), autoEnvNum(0), autoEnvDen(0), active(false), insChanged(true), freqChanged(false), keyOn(false), keyOff(false), portaPause(false), inPorta(false), vol(0), outVol(15), pan(3) {}
     };
     Channel chan[3];
+    struct SoftState: public DivDispatchSoftState {
+      Channel chan[3];
+      bool dacMode;
+      int dacPeriod;
+      int dacRate;
+      int dacPos;
+      int dacSample;
+      unsigned char sampleBank;
+      bool ioPortA;
+      bool ioPortB;
+      unsigned char portAVal;
+      unsigned char portBVal;
+      unsigned char ayEnvMode;
+      unsigned short ayEnvPeriod;
+      short ayEnvSlideLow;
+      short ayEnvSlide;
+    };
     bool isMuted[3];
     struct QueuedWrite {
       unsigned short addr;
@@ -80,11 +97,17 @@ class DivPlatformAY8910: public DivDispatch {
     void updateOutSel(bool immediate=false);
 
     friend void putDispatchChan(void*,int,int);
+
+    const char* getStateFormat(int& version);
+    void writeState(SafeWriter* w);
+    bool readState(SafeReader& r);
   
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     void flushWrites();
@@ -421,6 +421,216 @@ void* DivPlatformGB::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformGB::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<4; i++) s->chan[i]=chan[i];
+  s->lastPan=lastPan;
+  s->ws=ws;
+  return s;
+}
+
+void DivPlatformGB::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<4; i++) chan[i]=s->chan[i];
+  lastPan=s->lastPan;
+  ws=s->ws;
+}
+
+const char* DivPlatformGB::getStateFormat(int& version) {
+  version=1;
+  return "GBAP";
+}
+
+void DivPlatformGB::writeState(SafeWriter* w) {
+  w->writeI(gb->model);
+  w->writeC(gb->cgb_mode);
+  w->writeC(gb->cgb_double_speed);
+  w->write(gb->io_registers,sizeof(gb->io_registers));
+  w->writeI(gb->div_cycles);
+  w->writeI(gb->div_state);
+  w->writeS(gb->div_counter);
+  w->writeC(gb->tima_reload_state);
+
+  GB_apu_t& apu=gb->apu;
+  w->writeC(apu.global_enable);
+  w->writeC(apu.apu_cycles);
+  w->write(apu.samples,GB_N_CHANNELS);
+  for (int i=0; i<GB_N_CHANNELS; i++) w->writeC(apu.is_active[i]);
+  w->writeC(apu.div_divider);
+  w->writeC(apu.lf_div);
+  w->writeC(apu.square_sweep_countdown);
+  w->writeC(apu.square_sweep_calculate_countdown);
+  w->writeS(apu.sweep_length_addend);
+  w->writeS(apu.shadow_sweep_sample_length);
+  w->writeC(apu.unshifted_sweep);
+  w->writeC(apu.enable_zombie_calculate_stepping);
+  for (int i=0; i<2; i++) {
+    w->writeS(apu.square_channels[i].pulse_length);
+    w->writeC(apu.square_channels[i].current_volume);
+    w->writeC(apu.square_channels[i].volume_countdown);
+    w->writeC(apu.square_channels[i].current_sample_index);
+    w->writeS(apu.square_channels[i].sample_countdown);
+    w->writeS(apu.square_channels[i].sample_length);
+    w->writeC(apu.square_channels[i].length_enabled);
+  }
+  w->writeC(apu.wave_channel.enable);
+  w->writeS(apu.wave_channel.pulse_length);
+  w->writeC(apu.wave_channel.shift);
+  w->writeS(apu.wave_channel.sample_length);
+  w->writeC(apu.wave_channel.length_enabled);
+  w->writeS(apu.wave_channel.sample_countdown);
+  w->writeC(apu.wave_channel.current_sample_index);
+  w->writeC(apu.wave_channel.current_sample);
+  w->write(apu.wave_channel.wave_form,32);
+  w->writeC(apu.wave_channel.wave_form_just_read);
+  w->writeS(apu.noise_channel.pulse_length);
+  w->writeC(apu.noise_channel.current_volume);
+  w->writeC(apu.noise_channel.volume_countdown);
+  w->writeS(apu.noise_channel.lfsr);
+  w->writeC(apu.noise_channel.narrow);
+  w->writeC(apu.noise_channel.counter_countdown);
+  w->writeS(apu.noise_channel.counter);
+  w->writeC(apu.noise_channel.length_enabled);
+  w->writeC(apu.noise_channel.alignment);
+  w->writeC(apu.skip_div_event);
+  w->writeC(apu.current_lfsr_sample);
+  w->write(apu.pcm_mask,2);
+  w->writeC(apu.channel_1_restart_hold);
+  w->writeC(apu.channel_4_delta);
+  w->writeC(apu.channel_4_countdown_reloaded);
+  w->writeC(apu.channel_4_dmg_delayed_start);
+  w->writeS(apu.channel1_completed_addend);
+  for (int i=0; i<2; i++) {
+    w->writeC(apu.square_envelope_clock[i].locked);
+    w->writeC(apu.square_envelope_clock[i].clock);
+  }
+  w->writeC(apu.noise_envelope_clock.locked);
+  w->writeC(apu.noise_envelope_clock.clock);
+
+  // the rest of the output state is set up by init()
+  GB_apu_output_t& out=gb->apu_output;
+  w->writeD(out.sample_cycles);
+  w->writeI(out.cycles_since_render);
+  for (int i=0; i<GB_N_CHANNELS; i++) {
+    w->writeI(out.last_update[i]);
+    w->writeS(out.current_sample[i].left);
+    w->writeS(out.current_sample[i].right);
+    w->writeS(out.summed_samples[i].left);
+    w->writeS(out.summed_samples[i].right);
+    w->writeD(out.dac_discharge[i]);
+  }
+  w->writeD(out.highpass_diff.left);
+  w->writeD(out.highpass_diff.right);
+  w->writeS(out.final_sample.left);
+  w->writeS(out.final_sample.right);
+
+  w->write(regPool,sizeof(regPool));
+}
+
+bool DivPlatformGB::readState(SafeReader& r) {
+  // fill a copy of the chip, which keeps the callback and the output rate
+  GB_gameboy_t newGB=*gb;
+  unsigned char newRegPool[128];
+
+  if (r.readI()!=(int)gb->model) return false;
+  newGB.cgb_mode=r.readC();
+  newGB.cgb_double_speed=r.readC();
+  r.read(newGB.io_registers,sizeof(newGB.io_registers));
+  newGB.div_cycles=r.readI();
+  newGB.div_state=r.readI();
+  newGB.div_counter=r.readS();
+  newGB.tima_reload_state=r.readC();
+
+  GB_apu_t& apu=newGB.apu;
+  apu.global_enable=r.readC();
+  apu.apu_cycles=r.readC();
+  r.read(apu.samples,GB_N_CHANNELS);
+  for (int i=0; i<GB_N_CHANNELS; i++) apu.is_active[i]=r.readC();
+  apu.div_divider=r.readC();
+  apu.lf_div=r.readC();
+  apu.square_sweep_countdown=r.readC();
+  apu.square_sweep_calculate_countdown=r.readC();
+  apu.sweep_length_addend=r.readS();
+  apu.shadow_sweep_sample_length=r.readS();
+  apu.unshifted_sweep=r.readC();
+  apu.enable_zombie_calculate_stepping=r.readC();
+  for (int i=0; i<2; i++) {
+    apu.square_channels[i].pulse_length=r.readS();
+    apu.square_channels[i].current_volume=r.readC();
+    apu.square_channels[i].volume_countdown=r.readC();
+    apu.square_channels[i].current_sample_index=r.readC();
+    apu.square_channels[i].sample_countdown=r.readS();
+    apu.square_channels[i].sample_length=r.readS();
+    apu.square_channels[i].length_enabled=r.readC();
+  }
+  apu.wave_channel.enable=r.readC();
+  apu.wave_channel.pulse_length=r.readS();
+  apu.wave_channel.shift=r.readC();
+  apu.wave_channel.sample_length=r.readS();
+  apu.wave_channel.length_enabled=r.readC();
+  apu.wave_channel.sample_countdown=r.readS();
+  apu.wave_channel.current_sample_index=r.readC();
+  apu.wave_channel.current_sample=r.readC();
+  r.read(apu.wave_channel.wave_form,32);
+  apu.wave_channel.wave_form_just_read=r.readC();
+  apu.noise_channel.pulse_length=r.readS();
+  apu.noise_channel.current_volume=r.readC();
+  apu.noise_channel.volume_countdown=r.readC();
+  apu.noise_channel.lfsr=r.readS();
+  apu.noise_channel.narrow=r.readC();
+  apu.noise_channel.counter_countdown=r.readC();
+  apu.noise_channel.counter=r.readS();
+  apu.noise_channel.length_enabled=r.readC();
+  apu.noise_channel.alignment=r.readC();
+  apu.skip_div_event=r.readC();
+  apu.current_lfsr_sample=r.readC();
+  r.read(apu.pcm_mask,2);
+  apu.channel_1_restart_hold=r.readC();
+  apu.channel_4_delta=r.readC();
+  apu.channel_4_countdown_reloaded=r.readC();
+  apu.channel_4_dmg_delayed_start=r.readC();
+  apu.channel1_completed_addend=r.readS();
+  for (int i=0; i<2; i++) {
+    apu.square_envelope_clock[i].locked=r.readC();
+    apu.square_envelope_clock[i].clock=r.readC();
+  }
+  apu.noise_envelope_clock.locked=r.readC();
+  apu.noise_envelope_clock.clock=r.readC();
+
+  // these index the duty table and the wave RAM
+  for (int i=0; i<2; i++) {
+    if ((apu.square_channels[i].current_sample_index&0x7f)>7) return false;
+    if (apu.square_channels[i].current_volume>15) return false;
+  }
+  if (apu.wave_channel.current_sample_index>31 || apu.noise_channel.current_volume>15) return false;
+  for (int i=0; i<32; i++) {
+    if (apu.wave_channel.wave_form[i]<0 || apu.wave_channel.wave_form[i]>15) return false;
+  }
+
+  GB_apu_output_t& out=newGB.apu_output;
+  out.sample_cycles=r.readD();
+  out.cycles_since_render=r.readI();
+  for (int i=0; i<GB_N_CHANNELS; i++) {
+    out.last_update[i]=r.readI();
+    out.current_sample[i].left=r.readS();
+    out.current_sample[i].right=r.readS();
+    out.summed_samples[i].left=r.readS();
+    out.summed_samples[i].right=r.readS();
+    out.dac_discharge[i]=r.readD();
+  }
+  out.highpass_diff.left=r.readD();
+  out.highpass_diff.right=r.readD();
+  out.final_sample.left=r.readS();
+  out.final_sample.right=r.readS();
+
+  r.read(newRegPool,sizeof(newRegPool));
+  if (r.tell()!=r.size()) return false;
+
+  *gb=newGB;
+  memcpy(regPool,newRegPool,sizeof(regPool));
+  return true;
+}
+
 unsigned char* DivPlatformGB::getRegisterPool() {
   return regPool;
 }
@@ -52,6 +52,11 @@ class DivPlatformGB: public DivDispatch {
       wave(-1) {}
   };
   Channel chan[4];
+  struct SoftState: public DivDispatchSoftState {
+    Channel chan[4];
+    unsigned char lastPan;
+    DivWaveSynth ws;
+  };
   bool isMuted[4];
   unsigned char lastPan;
   DivWaveSynth ws;
@@ -62,10 +67,16 @@ class DivPlatformGB: public DivDispatch {
   unsigned char procMute();
   void updateWave();
   friend void putDispatchChan(void*,int,int);
+
+  const char* getStateFormat(int& version);
+  void writeState(SafeWriter* w);
+  bool readState(SafeReader& r);
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     void reset();
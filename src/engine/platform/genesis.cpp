@@ -82,23 +82,23 @@ const char* DivPlatformGenesis::getEffectName(unsigned char effect) {
 }
 
 void DivPlatformGenesis::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static short o[2];
-  static int os[2];
+  short o[2]={0,0};
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     if (dacMode && dacSample!=-1) {
       dacPeriod-=6;
       if (dacPeriod<1) {
-        DivSample* s=parent->getSample(dacSample);
-        if (s->samples>0) {
+        if (dacCursor.index!=dacSample) dacCursor.set(parent,dacSample);
+        if (dacCursor.valid()) {
           if (!isMuted[5]) {
             if (writes.size()<16) {
-              urgentWrite(0x2a,(unsigned char)s->data8[dacPos]+0x80);
+              urgentWrite(0x2a,(unsigned char)dacCursor.data8[dacPos]+0x80);
             }
           }
-          if (++dacPos>=s->samples) {
-            if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-              dacPos=s->loopStart;
+          if (++dacPos>=dacCursor.len) {
+            if (dacCursor.loopStart>=0) {
+              dacPos=dacCursor.loopStart;
             } else {
               dacSample=-1;
               if (parent->song.brokenDACMode) {
@@ -138,6 +138,15 @@ void DivPlatformGenesis::acquire_nuked(short* bufL, short* bufR, size_t start, s
       //OPN2_Write(&fm,0,0);
       }
     
+    if (oscTap) {
+      for (int i=0; i<6; i++) {
+        int chOut=fm.ch_out[i];
+        // the DAC replaces the output of channel 6 when enabled
+        if (i==5 && dacMode) chOut=fm.dacen?((short)(fm.dacdata<<7)>>7):0;
+        oscBuf[i]->data[oscBuf[i]->needle++]=isMuted[i]?0:(chOut<<7);
+      }
+    }
+
     os[0]=(os[0]<<5);
     if (os[0]<-32768) os[0]=-32768;
     if (os[0]>32767) os[0]=32767;
@@ -152,22 +161,22 @@ void DivPlatformGenesis::acquire_nuked(short* bufL, short* bufR, size_t start, s
 }
 
 void DivPlatformGenesis::acquire_ymfm(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     if (dacMode && dacSample!=-1) {
       dacPeriod-=24;
       if (dacPeriod<1) {
-        DivSample* s=parent->getSample(dacSample);
-        if (s->samples>0) {
+        if (dacCursor.index!=dacSample) dacCursor.set(parent,dacSample);
+        if (dacCursor.valid()) {
           if (!isMuted[5]) {
             if (writes.size()<16) {
-              urgentWrite(0x2a,(unsigned char)s->data8[dacPos]+0x80);
+              urgentWrite(0x2a,(unsigned char)dacCursor.data8[dacPos]+0x80);
             }
           }
-          if (++dacPos>=s->samples) {
-            if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-              dacPos=s->loopStart;
+          if (++dacPos>=dacCursor.len) {
+            if (dacCursor.loopStart>=0) {
+              dacPos=dacCursor.loopStart;
             } else {
               dacSample=-1;
               if (parent->song.brokenDACMode) {
@@ -199,6 +208,15 @@ void DivPlatformGenesis::acquire_ymfm(short* bufL, short* bufR, size_t start, si
     }
     os[0]=out_ymfm.data[0];
     os[1]=out_ymfm.data[1];
+
+    if (oscTap) {
+      ymfm::ym2612::fm_engine& fme=fm_ymfm->debug_fm_engine();
+      for (int i=0; i<6; i++) {
+        int chOut=fme.debug_channel(i)->debug_output();
+        if (i==5 && dacMode) chOut=fm_ymfm->debug_dac_output();
+        oscBuf[i]->data[oscBuf[i]->needle++]=isMuted[i]?0:(chOut<<7);
+      }
+    }
     //OPN2_Write(&fm,0,0);
     
     if (os[0]<-32768) os[0]=-32768;
@@ -815,6 +833,213 @@ void* DivPlatformGenesis::getChanState(int ch) {
   return &chan[ch];
 }
 
+void DivPlatformGenesis::storeSoftState(SoftState* s) {
+  for (int i=0; i<10; i++) s->chan[i]=chan[i];
+  s->dacMode=dacMode;
+  s->dacPeriod=dacPeriod;
+  s->dacRate=dacRate;
+  s->dacPos=dacPos;
+  s->dacSample=dacSample;
+  s->sampleBank=sampleBank;
+  s->lfoValue=lfoValue;
+}
+
+void DivPlatformGenesis::restoreSoftState(SoftState* s) {
+  for (int i=0; i<10; i++) chan[i]=s->chan[i];
+  dacMode=s->dacMode;
+  dacPeriod=s->dacPeriod;
+  dacRate=s->dacRate;
+  dacPos=s->dacPos;
+  dacSample=s->dacSample;
+  sampleBank=s->sampleBank;
+  lfoValue=s->lfoValue;
+}
+
+DivDispatchSoftState* DivPlatformGenesis::saveSoftState() {
+  SoftState* s=new SoftState;
+  storeSoftState(s);
+  return s;
+}
+
+void DivPlatformGenesis::loadSoftState(DivDispatchSoftState* state) {
+  restoreSoftState((SoftState*)state);
+}
+
+// Nuked-OPN2 chip state, written field by field at each field's own size
+#define OPN2_STATE_FIELDS(_) \
+  _(cycles) _(channel) _(mol) _(mor) \
+  _(write_data) _(write_a) _(write_d) _(write_a_en) _(write_d_en) _(write_busy) _(write_busy_cnt) \
+  _(write_fm_address) _(write_fm_data) _(write_fm_mode_a) _(address) _(data) _(pin_test_in) _(pin_irq) _(busy) \
+  _(lfo_en) _(lfo_freq) _(lfo_pm) _(lfo_am) _(lfo_cnt) _(lfo_inc) _(lfo_quotient) \
+  _(pg_fnum) _(pg_block) _(pg_kcode) _(pg_inc) _(pg_phase) _(pg_reset) _(pg_read) \
+  _(eg_cycle) _(eg_cycle_stop) _(eg_shift) _(eg_shift_lock) _(eg_timer_low_lock) _(eg_timer) _(eg_timer_inc) \
+  _(eg_quotient) _(eg_custom_timer) _(eg_rate) _(eg_ksv) _(eg_inc) _(eg_ratemax) _(eg_sl) _(eg_lfo_am) _(eg_tl) \
+  _(eg_state) _(eg_level) _(eg_out) _(eg_kon) _(eg_kon_csm) _(eg_kon_latch) _(eg_csm_mode) \
+  _(eg_ssg_enable) _(eg_ssg_pgrst_latch) _(eg_ssg_repeat_latch) _(eg_ssg_hold_up_latch) _(eg_ssg_dir) _(eg_ssg_inv) \
+  _(eg_read) _(eg_read_inc) \
+  _(fm_op1) _(fm_op2) _(fm_out) _(fm_mod) \
+  _(ch_acc) _(ch_out) _(ch_lock) _(ch_lock_l) _(ch_lock_r) _(ch_read) \
+  _(timer_a_cnt) _(timer_a_reg) _(timer_a_load_lock) _(timer_a_load) _(timer_a_enable) _(timer_a_reset) \
+  _(timer_a_load_latch) _(timer_a_overflow_flag) _(timer_a_overflow) \
+  _(timer_b_cnt) _(timer_b_subcnt) _(timer_b_reg) _(timer_b_load_lock) _(timer_b_load) _(timer_b_enable) \
+  _(timer_b_reset) _(timer_b_load_latch) _(timer_b_overflow_flag) _(timer_b_overflow) \
+  _(mode_test_21) _(mode_test_2c) _(mode_ch3) _(mode_kon_channel) _(mode_kon_operator) _(mode_kon) \
+  _(mode_csm) _(mode_kon_csm) _(dacen) _(dacdata) \
+  _(ks) _(ar) _(sr) _(dt) _(multi) _(sl) _(rr) _(dr) _(am) _(tl) _(ssg_eg) \
+  _(fnum) _(block) _(kcode) _(fnum_3ch) _(block_3ch) _(kcode_3ch) _(reg_a4) _(reg_ac) \
+  _(connect) _(fb) _(pan_l) _(pan_r) _(ams) _(pms) _(status) _(status_time)
+
+template<typename T> static void writeOPN2Field(SafeWriter* w, const T& v) {
+  static_assert(sizeof(T)<=4,"unexpected OPN2 field size");
+  switch (sizeof(T)) {
+    case 1: w->writeC(v); break;
+    case 2: w->writeS(v); break;
+    default: w->writeI(v); break;
+  }
+}
+
+template<typename T, size_t N> static void writeOPN2Field(SafeWriter* w, const T (&v)[N]) {
+  for (size_t i=0; i<N; i++) writeOPN2Field(w,v[i]);
+}
+
+template<typename T> static void readOPN2Field(SafeReader& r, T& v) {
+  static_assert(sizeof(T)<=4,"unexpected OPN2 field size");
+  switch (sizeof(T)) {
+    case 1: v=(T)r.readC(); break;
+    case 2: v=(T)r.readS(); break;
+    default: v=(T)r.readI(); break;
+  }
+}
+
+template<typename T, size_t N> static void readOPN2Field(SafeReader& r, T (&v)[N]) {
+  for (size_t i=0; i<N; i++) readOPN2Field(r,v[i]);
+}
+
+// these are used as indices into the chip's arrays and tables
+static bool validOPN2State(const ym3438_t& c) {
+  if (c.cycles>=24 || c.channel>=6) return false;
+  if (c.pg_fnum>=0x800 || c.pg_block>=8 || c.pg_kcode>=32) return false;
+  if (c.eg_rate>=64 || c.eg_ksv>=32 || c.lfo_cnt>=128 || c.lfo_freq>=8) return false;
+  if (c.mode_kon_channel>=8 || c.address>=0x200) return false;
+  for (int i=0; i<24; i++) {
+    if (c.eg_state[i]>=4 || c.ks[i]>=4 || c.dt[i]>=8 || c.multi[i]>=16) return false;
+    if (c.ar[i]>=32 || c.dr[i]>=32 || c.sr[i]>=32 || c.rr[i]>=16 || c.sl[i]>=16) return false;
+    if (c.tl[i]>=128 || c.ssg_eg[i]>=16 || c.am[i]>=2) return false;
+  }
+  for (int i=0; i<6; i++) {
+    if (c.fnum[i]>=0x800 || c.fnum_3ch[i]>=0x800) return false;
+    if (c.block[i]>=8 || c.block_3ch[i]>=8 || c.kcode[i]>=32 || c.kcode_3ch[i]>=32) return false;
+    if (c.connect[i]>=8 || c.fb[i]>=8 || c.ams[i]>=4 || c.pms[i]>=8) return false;
+  }
+  return true;
+}
+
+const char* DivPlatformGenesis::getStateFormat(int& version) {
+  version=1;
+  return useYMFM?"OPNY":"OPN2";
+}
+
+void DivPlatformGenesis::writeState(SafeWriter* w) {
+  if (useYMFM) {
+    std::vector<uint8_t> data;
+    ymfm::ymfm_saved_state state(data,true);
+    fm_ymfm->save_restore(state);
+    w->writeI(data.size());
+    w->write(data.data(),data.size());
+  } else {
+#define OPN2_WRITE(x) writeOPN2Field(w,fm.x);
+    OPN2_STATE_FIELDS(OPN2_WRITE)
+#undef OPN2_WRITE
+  }
+  w->write(regPool,sizeof(regPool));
+  for (int i=0; i<512; i++) {
+    w->writeS(oldWrites[i]);
+    w->writeS(pendingWrites[i]);
+  }
+  w->writeI(writes.size());
+  for (QueuedWrite& i: writes) {
+    w->writeS(i.addr);
+    w->writeC(i.val);
+    w->writeC(i.addrOrVal);
+  }
+  w->writeI(delay);
+  w->writeC(lastBusy);
+  w->writeI(dacPeriod);
+  w->writeI(dacPos);
+  w->writeI(dacSample);
+}
+
+bool DivPlatformGenesis::readState(SafeReader& r) {
+  std::vector<uint8_t> chipData;
+  ym3438_t newFM=fm;
+  if (useYMFM) {
+    // ymfm states have a fixed layout, so a good one is as long as ours
+    std::vector<uint8_t> cur;
+    ymfm::ymfm_saved_state curState(cur,true);
+    fm_ymfm->save_restore(curState);
+    if ((size_t)r.readI()!=cur.size()) return false;
+    chipData.resize(cur.size());
+    r.read(chipData.data(),chipData.size());
+  } else {
+#define OPN2_READ(x) readOPN2Field(r,newFM.x);
+    OPN2_STATE_FIELDS(OPN2_READ)
+#undef OPN2_READ
+    if (!validOPN2State(newFM)) return false;
+  }
+
+  unsigned char newRegPool[512];
+  short newOldWrites[512];
+  short newPendingWrites[512];
+  r.read(newRegPool,512);
+  for (int i=0; i<512; i++) {
+    newOldWrites[i]=r.readS();
+    newPendingWrites[i]=r.readS();
+  }
+  int queuedLen=r.readI();
+  if (queuedLen<0 || (size_t)queuedLen>(r.size()-r.tell())/4) return false;
+  std::deque<QueuedWrite> newWrites;
+  for (int i=0; i<queuedLen; i++) {
+    unsigned short addr=r.readS();
+    unsigned char val=r.readC();
+    newWrites.push_back(QueuedWrite(addr,val));
+    newWrites.back().addrOrVal=r.readC();
+  }
+  int newDelay=r.readI();
+  unsigned char newLastBusy=r.readC();
+  int newDacPeriod=r.readI();
+  unsigned int newDacPos=r.readI();
+  int newDacSample=r.readI();
+  if (r.tell()!=r.size()) return false;
+  if (newDacSample<-1 || newDacSample>=parent->song.sampleLen) return false;
+  if (newDacSample>=0 && newDacPos>=parent->getSample(newDacSample)->samples) return false;
+
+  if (useYMFM) {
+    ymfm::ymfm_saved_state state(chipData,false);
+    fm_ymfm->save_restore(state);
+  } else {
+    fm=newFM;
+  }
+  memcpy(regPool,newRegPool,512);
+  memcpy(oldWrites,newOldWrites,512*sizeof(short));
+  memcpy(pendingWrites,newPendingWrites,512*sizeof(short));
+  writes=newWrites;
+  delay=newDelay;
+  lastBusy=newLastBusy;
+  dacPeriod=newDacPeriod;
+  dacPos=newDacPos;
+  dacSample=newDacSample;
+  return true;
+}
+
+DivDispatchOscBuffer* DivPlatformGenesis::getOscBuffer(int ch) {
+  if (ch<0 || ch>=6) return NULL;
+  return oscBuf[ch];
+}
+
+void DivPlatformGenesis::toggleOscTap(bool enable) {
+  setOscBuffers(enable,oscBuf,6);
+}
+
 unsigned char* DivPlatformGenesis::getRegisterPool() {
   return regPool;
 }
@@ -886,6 +1111,10 @@ void DivPlatformGenesis::notifyInsChange(int ins) {
 void DivPlatformGenesis::notifyInsDeletion(void* ins) {
 }
 
+void DivPlatformGenesis::notifySampleChange() {
+  dacCursor.invalidate();
+}
+
 void DivPlatformGenesis::poke(unsigned int addr, unsigned short val) {
   immWrite(addr,val);
 }
@@ -898,8 +1127,28 @@ int DivPlatformGenesis::getPortaFloor(int ch) {
   return (ch>5)?12:0;
 }
 
-void DivPlatformGenesis::setYMFM(bool use) {
-  useYMFM=use;
+int DivPlatformGenesis::getCoreCount() {
+  return 2;
+}
+
+const char* DivPlatformGenesis::getCoreName(int core) {
+  return (core==1)?"ymfm":"Nuked-OPN2";
+}
+
+int DivPlatformGenesis::getFastCore() {
+  return 1;
+}
+
+int DivPlatformGenesis::getAccurateCore() {
+  return 0;
+}
+
+void DivPlatformGenesis::setCore(int core) {
+  useYMFM=(core==1);
+}
+
+int DivPlatformGenesis::getCore() {
+  return useYMFM?1:0;
 }
 
 void DivPlatformGenesis::setFlags(unsigned int flags) {
@@ -932,9 +1181,13 @@ int DivPlatformGenesis::init(DivEngine* p, int channels, int sugRate, unsigned i
   dumpWrites=false;
   ladder=false;
   skipRegisterWrites=false;
+  oscTap=false;
   for (int i=0; i<10; i++) {
     isMuted[i]=false;
   }
+  for (int i=0; i<6; i++) {
+    oscBuf[i]=NULL;
+  }
   fm_ymfm=NULL;
   setFlags(flags);
 
@@ -943,6 +1196,7 @@ int DivPlatformGenesis::init(DivEngine* p, int channels, int sugRate, unsigned i
 }
 
 void DivPlatformGenesis::quit() {
+  freeOscBuffers(oscBuf,6);
   if (fm_ymfm!=NULL) delete fm_ymfm;
 }
 
@@ -23,6 +23,7 @@
 #include <deque>
 #include "../../../extern/Nuked-OPN2/ym3438.h"
 #include "sound/ymfm/ymfm_opn.h"
+#include "sampleCursor.h"
 
 #include "sms.h"
 
@@ -62,6 +63,17 @@ class DivPlatformGenesis: public DivDispatch {
         pan(3) {}
     };
     Channel chan[10];
+    struct SoftState: public DivDispatchSoftState {
+      Channel chan[10];
+      bool dacMode;
+      int dacPeriod;
+      int dacRate;
+      unsigned int dacPos;
+      int dacSample;
+      unsigned char sampleBank;
+      unsigned char lfoValue;
+    };
+    DivDispatchOscBuffer* oscBuf[6];
     bool isMuted[10];
     struct QueuedWrite {
       unsigned short addr;
@@ -84,6 +96,7 @@ class DivPlatformGenesis: public DivDispatch {
     int dacRate;
     unsigned int dacPos;
     int dacSample;
+    DivSampleCursor dacCursor;
     unsigned char sampleBank;
     unsigned char lfoValue;
 
@@ -96,15 +109,26 @@ class DivPlatformGenesis: public DivDispatch {
     int octave(int freq);
     int toFreq(int freq);
 
+    void storeSoftState(SoftState* s);
+    void restoreSoftState(SoftState* s);
+
     friend void putDispatchChan(void*,int,int);
 
     void acquire_nuked(short* bufL, short* bufR, size_t start, size_t len);
     void acquire_ymfm(short* bufL, short* bufR, size_t start, size_t len);
+
+    const char* getStateFormat(int& version);
+    void writeState(SafeWriter* w);
+    bool readState(SafeReader& r);
   
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
+    DivDispatchOscBuffer* getOscBuffer(int chan);
+    void toggleOscTap(bool enable);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     void reset();
@@ -112,13 +136,19 @@ class DivPlatformGenesis: public DivDispatch {
     void tick(bool sysTick=true);
     void muteChannel(int ch, bool mute);
     bool isStereo();
-    void setYMFM(bool use);
+    int getCoreCount();
+    const char* getCoreName(int core);
+    int getFastCore();
+    int getAccurateCore();
+    void setCore(int core);
+    int getCore();
     bool keyOffAffectsArp(int ch);
     bool keyOffAffectsPorta(int ch);
     void toggleRegisterDump(bool enable);
     void setFlags(unsigned int flags);
     void notifyInsChange(int ins);
     void notifyInsDeletion(void* ins);
+    void notifySampleChange();
     int getPortaFloor(int ch);
     void poke(unsigned int addr, unsigned short val);
     void poke(std::vector<DivRegWrite>& wlist);
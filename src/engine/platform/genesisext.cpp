@@ -388,6 +388,28 @@ void* DivPlatformGenesisExt::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformGenesisExt::saveSoftState() {
+  ExtSoftState* s=new ExtSoftState;
+  storeSoftState(s);
+  for (int i=0; i<4; i++) s->opChan[i]=opChan[i];
+  return s;
+}
+
+void DivPlatformGenesisExt::loadSoftState(DivDispatchSoftState* state) {
+  ExtSoftState* s=(ExtSoftState*)state;
+  restoreSoftState(s);
+  for (int i=0; i<4; i++) opChan[i]=s->opChan[i];
+}
+
+DivDispatchOscBuffer* DivPlatformGenesisExt::getOscBuffer(int ch) {
+  if (ch<0 || ch>=9) return NULL;
+  // the operators of the extended channel share its output
+  if (ch>=6) return oscBuf[ch-3];
+  if (ch==2) return oscBuf[2];
+  if (ch>2) return NULL;
+  return oscBuf[ch];
+}
+
 void DivPlatformGenesisExt::reset() {
   DivPlatformGenesis::reset();
 
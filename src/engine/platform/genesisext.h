@@ -34,11 +34,17 @@ class DivPlatformGenesisExt: public DivPlatformGenesis {
     OpChannel(): freqH(0), freqL(0), freq(0), baseFreq(0), pitch(0), ins(-1), active(false), insChanged(true), freqChanged(false), keyOn(false), keyOff(false), portaPause(false), vol(0), pan(3) {}
   };
   OpChannel opChan[4];
+  struct ExtSoftState: public SoftState {
+    OpChannel opChan[4];
+  };
   bool isOpMuted[4];
   friend void putDispatchChan(void*,int,int);
   public:
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
+    DivDispatchOscBuffer* getOscBuffer(int chan);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
@@ -18,6 +18,7 @@
  */
 
 #include "mmc5.h"
+#include "nes.h"
 #include "sound/nes/mmc5.h"
 #include "../engine.h"
 #include <math.h>
@@ -57,14 +58,14 @@ void DivPlatformMMC5::acquire(short* bufL, short* bufR, size_t start, size_t len
     if (dacSample!=-1) {
       dacPeriod+=dacRate;
       if (dacPeriod>=rate) {
-        DivSample* s=parent->getSample(dacSample);
-        if (s->samples>0) {
+        if (dacCursor.index!=dacSample) dacCursor.set(parent,dacSample);
+        if (dacCursor.valid()) {
           if (!isMuted[4]) {
-            rWrite(0x5011,((unsigned char)s->data8[dacPos]+0x80));
+            rWrite(0x5011,((unsigned char)dacCursor.data8[dacPos]+0x80));
           }
-          if (++dacPos>=s->samples) {
-            if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-              dacPos=s->loopStart;
+          if (++dacPos>=dacCursor.len) {
+            if (dacCursor.loopStart>=0) {
+              dacPos=dacCursor.loopStart;
             } else {
               dacSample=-1;
             }
@@ -391,6 +392,10 @@ void DivPlatformMMC5::notifyInsDeletion(void* ins) {
   }
 }
 
+void DivPlatformMMC5::notifySampleChange() {
+  dacCursor.invalidate();
+}
+
 void DivPlatformMMC5::poke(unsigned int addr, unsigned short val) {
   rWrite(addr,val);
 }
@@ -411,7 +416,7 @@ int DivPlatformMMC5::init(DivEngine* p, int channels, int sugRate, unsigned int
   }
   setFlags(flags);
 
-  init_nla_table(500,500);
+  divNESInitNLATable();
   reset();
   return 5;
 }
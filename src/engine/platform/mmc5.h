@@ -22,6 +22,7 @@
 
 #include "../dispatch.h"
 #include "../macroInt.h"
+#include "sampleCursor.h"
 
 class DivPlatformMMC5: public DivDispatch {
   struct Channel {
@@ -56,6 +57,7 @@ class DivPlatformMMC5: public DivDispatch {
   int dacPeriod, dacRate;
   unsigned int dacPos;
   int dacSample;
+  DivSampleCursor dacCursor;
   unsigned char sampleBank;
   unsigned char apuType;
   struct _mmc5* mmc5;
@@ -77,6 +79,7 @@ class DivPlatformMMC5: public DivDispatch {
     float getPostAmp();
     void setFlags(unsigned int flags);
     void notifyInsDeletion(void* ins);
+    void notifySampleChange();
     void poke(unsigned int addr, unsigned short val);
     void poke(std::vector<DivRegWrite>& wlist);
     const char** getRegisterSheet();
@@ -22,9 +22,18 @@
 #include "../engine.h"
 #include <cstddef>
 #include <math.h>
+#include <mutex>
 
 struct _nla_table nla_table;
 
+static std::once_flag nlaTableOnce;
+
+void divNESInitNLATable() {
+  std::call_once(nlaTableOnce,[]() {
+    init_nla_table(500,500);
+  });
+}
+
 #define CHIP_DIVIDER 16
 
 #define rWrite(a,v) if (!skipRegisterWrites) {apu_wr_reg(nes,a,v); regPool[(a)&0x7f]=v; if (dumpWrites) {addWrite(a,v);} }
@@ -77,10 +86,10 @@ void DivPlatformNES::acquire(short* bufL, short* bufR, size_t start, size_t len)
     if (dacSample!=-1) {
       dacPeriod+=dacRate;
       if (dacPeriod>=rate) {
-        DivSample* s=parent->getSample(dacSample);
-        if (s->samples>0) {
+        if (dacCursor.index!=dacSample) dacCursor.set(parent,dacSample);
+        if (dacCursor.valid()) {
           if (!isMuted[4]) {
-            unsigned char next=((unsigned char)s->data8[dacPos]+0x80)>>1;
+            unsigned char next=((unsigned char)dacCursor.data8[dacPos]+0x80)>>1;
             if (dacAntiClickOn && dacAntiClick<next) {
               dacAntiClick+=8;
               rWrite(0x4011,dacAntiClick);
@@ -89,9 +98,9 @@ void DivPlatformNES::acquire(short* bufL, short* bufR, size_t start, size_t len)
               rWrite(0x4011,next);
             }
           }
-          if (++dacPos>=s->samples) {
-            if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-              dacPos=s->loopStart;
+          if (++dacPos>=dacCursor.len) {
+            if (dacCursor.loopStart>=0) {
+              dacPos=dacCursor.loopStart;
             } else {
               dacSample=-1;
             }
@@ -462,6 +471,263 @@ void* DivPlatformNES::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformNES::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<5; i++) s->chan[i]=chan[i];
+  s->dacPeriod=dacPeriod;
+  s->dacRate=dacRate;
+  s->dacPos=dacPos;
+  s->dacSample=dacSample;
+  s->sampleBank=sampleBank;
+  return s;
+}
+
+void DivPlatformNES::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<5; i++) chan[i]=s->chan[i];
+  dacPeriod=s->dacPeriod;
+  dacRate=s->dacRate;
+  dacPos=s->dacPos;
+  dacSample=s->dacSample;
+  sampleBank=s->sampleBank;
+}
+
+const char* DivPlatformNES::getStateFormat(int& version) {
+  version=1;
+  return "2A03";
+}
+
+static void writeEnvelope(SafeWriter* w, const _envelope& e) {
+  w->writeC(e.enabled);
+  w->writeC(e.divider);
+  w->writeC(e.counter);
+  w->writeC(e.constant_volume);
+  w->writeC(e.delay);
+}
+
+static void readEnvelope(SafeReader& r, _envelope& e) {
+  e.enabled=r.readC();
+  e.divider=r.readC();
+  e.counter=r.readC();
+  e.constant_volume=r.readC();
+  e.delay=r.readC();
+}
+
+static void writeLength(SafeWriter* w, const _length_counter& l) {
+  w->writeC(l.value);
+  w->writeC(l.enabled);
+  w->writeC(l.halt);
+}
+
+static void readLength(SafeReader& r, _length_counter& l) {
+  l.value=r.readC();
+  l.enabled=r.readC();
+  l.halt=r.readC();
+}
+
+static void writeSquare(SafeWriter* w, const _apuSquare& s) {
+  w->writeI(s.timer);
+  w->writeS(s.frequency);
+  w->writeC(s.duty);
+  writeEnvelope(w,s.envelope);
+  w->writeC(s.volume);
+  w->writeC(s.sequencer);
+  w->writeC(s.sweep.enabled);
+  w->writeC(s.sweep.negate);
+  w->writeC(s.sweep.divider);
+  w->writeC(s.sweep.shift);
+  w->writeC(s.sweep.reload);
+  w->writeC(s.sweep.silence);
+  w->writeC(s.sweep.delay);
+  writeLength(w,s.length);
+  w->writeS(s.output);
+}
+
+static void readSquare(SafeReader& r, _apuSquare& s) {
+  s.timer=r.readI();
+  s.frequency=r.readS();
+  s.duty=r.readC();
+  readEnvelope(r,s.envelope);
+  s.volume=r.readC();
+  s.sequencer=r.readC();
+  s.sweep.enabled=r.readC();
+  s.sweep.negate=r.readC();
+  s.sweep.divider=r.readC();
+  s.sweep.shift=r.readC();
+  s.sweep.reload=r.readC();
+  s.sweep.silence=r.readC();
+  s.sweep.delay=r.readC();
+  readLength(r,s.length);
+  s.output=r.readS();
+}
+
+void DivPlatformNES::writeState(SafeWriter* w) {
+  w->writeC(nes->apu.mode);
+  w->writeC(nes->apu.type);
+  w->writeC(nes->apu.step);
+  w->writeC(nes->apu.length_clocked);
+  w->writeC(nes->apu.DMC);
+  w->writeS(nes->apu.cycles);
+  w->writeI(nes->apu.cpu_cycles);
+  w->writeI(nes->apu.cpu_opcode_cycle);
+  w->writeC(nes->apu.odd_cycle);
+
+  w->writeC(nes->r4011.value);
+  w->writeI(nes->r4011.frames);
+  w->writeI(nes->r4011.cycles);
+  w->writeS(nes->r4011.output);
+  w->writeC(nes->r4015.value);
+  w->writeC(nes->r4017.value);
+  w->writeC(nes->r4017.jitter.value);
+  w->writeC(nes->r4017.jitter.delay);
+  w->writeC(nes->r4017.reset_frame_delay);
+
+  writeSquare(w,nes->S1);
+  writeSquare(w,nes->S2);
+
+  w->writeI(nes->TR.timer);
+  w->writeS(nes->TR.frequency);
+  w->writeC(nes->TR.linear.value);
+  w->writeC(nes->TR.linear.reload);
+  w->writeC(nes->TR.linear.halt);
+  writeLength(w,nes->TR.length);
+  w->writeC(nes->TR.sequencer);
+  w->writeS(nes->TR.output);
+
+  w->writeI(nes->NS.timer);
+  w->writeS(nes->NS.frequency);
+  writeEnvelope(w,nes->NS.envelope);
+  w->writeC(nes->NS.mode);
+  w->writeC(nes->NS.volume);
+  w->writeS(nes->NS.shift);
+  writeLength(w,nes->NS.length);
+  w->writeC(nes->NS.sequencer);
+  w->writeS(nes->NS.output);
+
+  w->writeS(nes->DMC.frequency);
+  w->writeS(nes->DMC.remain);
+  w->writeC(nes->DMC.irq_enabled);
+  w->writeC(nes->DMC.loop);
+  w->writeC(nes->DMC.rate_index);
+  w->writeS(nes->DMC.address_start);
+  w->writeI(nes->DMC.address);
+  w->writeS(nes->DMC.length);
+  w->writeC(nes->DMC.counter);
+  w->writeC(nes->DMC.empty);
+  w->writeC(nes->DMC.buffer);
+  w->writeC(nes->DMC.dma_cycle);
+  w->writeC(nes->DMC.silence);
+  w->writeC(nes->DMC.shift);
+  w->writeC(nes->DMC.counter_out);
+  w->writeS(nes->DMC.output);
+  w->writeC(nes->DMC.tick_type);
+
+  w->write(regPool,sizeof(regPool));
+  w->writeI(dacPeriod);
+  w->writeI(dacRate);
+  w->writeI(dacPos);
+  w->writeI(dacAntiClick);
+  w->writeI(dacSample);
+}
+
+bool DivPlatformNES::readState(SafeReader& r) {
+  // start from the current chip, which keeps the mute state
+  struct NESAPU newAPU=*nes;
+  unsigned char newRegPool[128];
+
+  newAPU.apu.mode=r.readC();
+  newAPU.apu.type=r.readC();
+  newAPU.apu.step=r.readC();
+  newAPU.apu.length_clocked=r.readC();
+  newAPU.apu.DMC=r.readC();
+  newAPU.apu.cycles=r.readS();
+  newAPU.apu.cpu_cycles=r.readI();
+  newAPU.apu.cpu_opcode_cycle=r.readI();
+  newAPU.apu.odd_cycle=r.readC();
+
+  newAPU.r4011.value=r.readC();
+  newAPU.r4011.frames=r.readI();
+  newAPU.r4011.cycles=r.readI();
+  newAPU.r4011.output=r.readS();
+  newAPU.r4015.value=r.readC();
+  newAPU.r4017.value=r.readC();
+  newAPU.r4017.jitter.value=r.readC();
+  newAPU.r4017.jitter.delay=r.readC();
+  newAPU.r4017.reset_frame_delay=r.readC();
+
+  readSquare(r,newAPU.S1);
+  readSquare(r,newAPU.S2);
+
+  newAPU.TR.timer=r.readI();
+  newAPU.TR.frequency=r.readS();
+  newAPU.TR.linear.value=r.readC();
+  newAPU.TR.linear.reload=r.readC();
+  newAPU.TR.linear.halt=r.readC();
+  readLength(r,newAPU.TR.length);
+  newAPU.TR.sequencer=r.readC();
+  newAPU.TR.output=r.readS();
+
+  newAPU.NS.timer=r.readI();
+  newAPU.NS.frequency=r.readS();
+  readEnvelope(r,newAPU.NS.envelope);
+  newAPU.NS.mode=r.readC();
+  newAPU.NS.volume=r.readC();
+  newAPU.NS.shift=r.readS();
+  readLength(r,newAPU.NS.length);
+  newAPU.NS.sequencer=r.readC();
+  newAPU.NS.output=r.readS();
+
+  newAPU.DMC.frequency=r.readS();
+  newAPU.DMC.remain=r.readS();
+  newAPU.DMC.irq_enabled=r.readC();
+  newAPU.DMC.loop=r.readC();
+  newAPU.DMC.rate_index=r.readC();
+  newAPU.DMC.address_start=r.readS();
+  newAPU.DMC.address=r.readI();
+  newAPU.DMC.length=r.readS();
+  newAPU.DMC.counter=r.readC();
+  newAPU.DMC.empty=r.readC();
+  newAPU.DMC.buffer=r.readC();
+  newAPU.DMC.dma_cycle=r.readC();
+  newAPU.DMC.silence=r.readC();
+  newAPU.DMC.shift=r.readC();
+  newAPU.DMC.counter_out=r.readC();
+  newAPU.DMC.output=r.readS();
+  newAPU.DMC.tick_type=r.readC();
+
+  r.read(newRegPool,sizeof(newRegPool));
+  int newDacPeriod=r.readI();
+  int newDacRate=r.readI();
+  unsigned int newDacPos=r.readI();
+  unsigned int newDacAntiClick=r.readI();
+  int newDacSample=r.readI();
+  if (r.tell()!=r.size()) return false;
+
+  // these index the period, duty and mixing tables
+  if (newAPU.apu.mode>1 || newAPU.apu.type>2 || newAPU.apu.step>6) return false;
+  if (newAPU.NS.timer>15 || newAPU.DMC.rate_index>15) return false;
+  if (newAPU.TR.sequencer>31 || newAPU.DMC.counter>127) return false;
+  _apuSquare* squares[2]={&newAPU.S1,&newAPU.S2};
+  for (_apuSquare* i: squares) {
+    if (i->duty>3 || i->sequencer>7 || i->volume>15) return false;
+    if (i->output<0 || i->output>15) return false;
+  }
+  if (newAPU.NS.volume>15 || newAPU.NS.output<0 || newAPU.NS.output>15) return false;
+  if (newAPU.TR.output<0 || newAPU.TR.output>15) return false;
+  if (newAPU.DMC.output<0 || newAPU.DMC.output>127) return false;
+  if (newDacSample<-1 || newDacSample>=parent->song.sampleLen) return false;
+  if (newDacSample>=0 && newDacPos>=parent->getSample(newDacSample)->samples) return false;
+
+  *nes=newAPU;
+  memcpy(regPool,newRegPool,sizeof(regPool));
+  dacPeriod=newDacPeriod;
+  dacRate=newDacRate;
+  dacPos=newDacPos;
+  dacAntiClick=newDacAntiClick;
+  dacSample=newDacSample;
+  return true;
+}
+
 unsigned char* DivPlatformNES::getRegisterPool() {
   return regPool;
 }
@@ -529,6 +795,10 @@ void DivPlatformNES::notifyInsDeletion(void* ins) {
   }
 }
 
+void DivPlatformNES::notifySampleChange() {
+  dacCursor.invalidate();
+}
+
 void DivPlatformNES::poke(unsigned int addr, unsigned short val) {
   rWrite(addr,val);
 }
@@ -549,7 +819,7 @@ int DivPlatformNES::init(DivEngine* p, int channels, int sugRate, unsigned int f
   }
   setFlags(flags);
 
-  init_nla_table(500,500);
+  divNESInitNLATable();
   reset();
   return 5;
 }
@@ -22,6 +22,7 @@
 
 #include "../dispatch.h"
 #include "../macroInt.h"
+#include "sampleCursor.h"
 
 class DivPlatformNES: public DivDispatch {
   struct Channel {
@@ -52,10 +53,19 @@ class DivPlatformNES: public DivDispatch {
       wave(-1) {}
   };
   Channel chan[5];
+  struct SoftState: public DivDispatchSoftState {
+    Channel chan[5];
+    int dacPeriod;
+    int dacRate;
+    unsigned int dacPos;
+    int dacSample;
+    unsigned char sampleBank;
+  };
   bool isMuted[5];
   int dacPeriod, dacRate;
   unsigned int dacPos, dacAntiClick;
   int dacSample;
+  DivSampleCursor dacCursor;
   unsigned char sampleBank;
   unsigned char apuType;
   bool dacAntiClickOn;
@@ -64,10 +74,16 @@ class DivPlatformNES: public DivDispatch {
 
   friend void putDispatchChan(void*,int,int);
 
+  const char* getStateFormat(int& version);
+  void writeState(SafeWriter* w);
+  bool readState(SafeReader& r);
+
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     void reset();
@@ -78,6 +94,7 @@ class DivPlatformNES: public DivDispatch {
     float getPostAmp();
     void setFlags(unsigned int flags);
     void notifyInsDeletion(void* ins);
+    void notifySampleChange();
     void poke(unsigned int addr, unsigned short val);
     void poke(std::vector<DivRegWrite>& wlist);
     const char** getRegisterSheet();
@@ -87,4 +104,7 @@ class DivPlatformNES: public DivDispatch {
     ~DivPlatformNES();
 };
 
+// initializes the shared NES mixer lookup table exactly once.
+void divNESInitNLATable();
+
 #endif
@@ -194,8 +194,8 @@ const char* DivPlatformOPL::getEffectName(unsigned char effect) {
 }
 
 void DivPlatformOPL::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static short o[2];
-  static int os[2];
+  short o[2]={0,0};
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     os[0]=0; os[1]=0;
@@ -908,6 +908,176 @@ void* DivPlatformOPL::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformOPL::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<20; i++) s->chan[i]=chan[i];
+  s->slots=slots;
+  s->chanMap=chanMap;
+  s->melodicChans=melodicChans;
+  s->totalChans=totalChans;
+  s->drumState=drumState;
+  memcpy(s->drumVol,drumVol,sizeof(drumVol));
+  s->properDrums=properDrums;
+  s->dam=dam;
+  s->dvb=dvb;
+  s->lfoValue=lfoValue;
+  return s;
+}
+
+void DivPlatformOPL::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<20; i++) chan[i]=s->chan[i];
+  slots=s->slots;
+  chanMap=s->chanMap;
+  melodicChans=s->melodicChans;
+  totalChans=s->totalChans;
+  drumState=s->drumState;
+  memcpy(drumVol,s->drumVol,sizeof(drumVol));
+  properDrums=s->properDrums;
+  dam=s->dam;
+  dvb=s->dvb;
+  lfoValue=s->lfoValue;
+}
+
+// Nuked-OPL3 links its slots and channels together with pointers into the
+// chip. a chip state holds their offsets from the start of the chip instead.
+#define OPL3_POINTERS (18*8+36*4)
+
+template<typename T> static int oplPointerToOffset(const opl3_chip* chip, T* p) {
+  if (p==NULL) return -1;
+  return (const unsigned char*)p-(const unsigned char*)chip;
+}
+
+template<typename T> static bool oplOffsetToPointer(opl3_chip* chip, int offset, T*& p) {
+  if (offset==-1) {
+    p=NULL;
+    return true;
+  }
+  if (offset<0 || (size_t)offset+sizeof(T)>sizeof(opl3_chip) || (offset%alignof(T))!=0) return false;
+  p=(T*)((unsigned char*)chip+offset);
+  return true;
+}
+
+static void oplGetPointers(const opl3_chip* chip, int* offsets) {
+  int* o=offsets;
+  for (int i=0; i<18; i++) {
+    const opl3_channel& ch=chip->channel[i];
+    *(o++)=oplPointerToOffset(chip,ch.slots[0]);
+    *(o++)=oplPointerToOffset(chip,ch.slots[1]);
+    *(o++)=oplPointerToOffset(chip,ch.pair);
+    *(o++)=oplPointerToOffset(chip,ch.chip);
+    for (int j=0; j<4; j++) *(o++)=oplPointerToOffset(chip,ch.out[j]);
+  }
+  for (int i=0; i<36; i++) {
+    const opl3_slot& slot=chip->slot[i];
+    *(o++)=oplPointerToOffset(chip,slot.channel);
+    *(o++)=oplPointerToOffset(chip,slot.chip);
+    *(o++)=oplPointerToOffset(chip,slot.mod);
+    *(o++)=oplPointerToOffset(chip,slot.trem);
+  }
+}
+
+// point the pointers of dest into chip at the given offsets (-1 is NULL).
+static bool oplSetPointers(opl3_chip* dest, opl3_chip* chip, const int* offsets) {
+  const int* o=offsets;
+  for (int i=0; i<18; i++) {
+    opl3_channel& ch=dest->channel[i];
+    if (!oplOffsetToPointer(chip,*(o++),ch.slots[0])) return false;
+    if (!oplOffsetToPointer(chip,*(o++),ch.slots[1])) return false;
+    if (!oplOffsetToPointer(chip,*(o++),ch.pair)) return false;
+    if (!oplOffsetToPointer(chip,*(o++),ch.chip)) return false;
+    for (int j=0; j<4; j++) {
+      if (!oplOffsetToPointer(chip,*(o++),ch.out[j])) return false;
+    }
+  }
+  for (int i=0; i<36; i++) {
+    opl3_slot& slot=dest->slot[i];
+    if (!oplOffsetToPointer(chip,*(o++),slot.channel)) return false;
+    if (!oplOffsetToPointer(chip,*(o++),slot.chip)) return false;
+    if (!oplOffsetToPointer(chip,*(o++),slot.mod)) return false;
+    if (!oplOffsetToPointer(chip,*(o++),slot.trem)) return false;
+  }
+  return true;
+}
+
+const char* DivPlatformOPL::getStateFormat(int& version) {
+  version=1;
+  return "OPL3";
+}
+
+void DivPlatformOPL::writeState(SafeWriter* w) {
+  w->write(regPool,sizeof(regPool));
+  for (int i=0; i<512; i++) {
+    w->writeS(oldWrites[i]);
+    w->writeS(pendingWrites[i]);
+  }
+  std::queue<QueuedWrite> queued=writes;
+  w->writeI(queued.size());
+  while (!queued.empty()) {
+    QueuedWrite& i=queued.front();
+    w->writeS(i.addr);
+    w->writeC(i.val);
+    w->writeC(i.addrOrVal);
+    queued.pop();
+  }
+  w->writeI(delay);
+  w->writeC(lastBusy);
+
+  int offsets[OPL3_POINTERS];
+  oplGetPointers(&fm,offsets);
+  for (int i=0; i<OPL3_POINTERS; i++) w->writeI(offsets[i]);
+  // the rest of the chip holds no pointers. it goes last.
+  int noPointers[OPL3_POINTERS];
+  for (int i=0; i<OPL3_POINTERS; i++) noPointers[i]=-1;
+  opl3_chip* chip=new opl3_chip;
+  memcpy(chip,&fm,sizeof(opl3_chip));
+  oplSetPointers(chip,&fm,noPointers);
+  w->write(chip,sizeof(opl3_chip));
+  delete chip;
+}
+
+bool DivPlatformOPL::readState(SafeReader& r) {
+  unsigned char newRegPool[512];
+  short newOldWrites[512];
+  short newPendingWrites[512];
+  r.read(newRegPool,512);
+  for (int i=0; i<512; i++) {
+    newOldWrites[i]=r.readS();
+    newPendingWrites[i]=r.readS();
+  }
+  int queuedLen=r.readI();
+  if (queuedLen<0 || (size_t)queuedLen>(r.size()-r.tell())/4) return false;
+  std::queue<QueuedWrite> newWrites;
+  for (int i=0; i<queuedLen; i++) {
+    unsigned short addr=r.readS();
+    unsigned char val=r.readC();
+    newWrites.emplace(addr,val);
+    newWrites.back().addrOrVal=r.readC();
+  }
+  int newDelay=r.readI();
+  unsigned char newLastBusy=r.readC();
+
+  int offsets[OPL3_POINTERS];
+  for (int i=0; i<OPL3_POINTERS; i++) offsets[i]=r.readI();
+  if (r.size()-r.tell()!=sizeof(opl3_chip)) return false;
+  opl3_chip* chip=new opl3_chip;
+  r.read(chip,sizeof(opl3_chip));
+  if (!oplSetPointers(chip,&fm,offsets)) {
+    delete chip;
+    return false;
+  }
+
+  memcpy(&fm,chip,sizeof(opl3_chip));
+  delete chip;
+  memcpy(regPool,newRegPool,512);
+  memcpy(oldWrites,newOldWrites,512*sizeof(short));
+  memcpy(pendingWrites,newPendingWrites,512*sizeof(short));
+  writes=newWrites;
+  delay=newDelay;
+  lastBusy=newLastBusy;
+  return true;
+}
+
 unsigned char* DivPlatformOPL::getRegisterPool() {
   return regPool;
 }
@@ -58,6 +58,19 @@ class DivPlatformOPL: public DivDispatch {
       }
     };
     Channel chan[20];
+    struct SoftState: public DivDispatchSoftState {
+      Channel chan[20];
+      const unsigned char** slots;
+      const unsigned short* chanMap;
+      int melodicChans;
+      int totalChans;
+      unsigned char drumState;
+      unsigned char drumVol[5];
+      bool properDrums;
+      bool dam;
+      bool dvb;
+      unsigned char lfoValue;
+    };
     bool isMuted[20];
     struct QueuedWrite {
       unsigned short addr;
@@ -95,11 +108,17 @@ class DivPlatformOPL: public DivDispatch {
 
     void acquire_nuked(short* bufL, short* bufR, size_t start, size_t len);
     //void acquire_ymfm(short* bufL, short* bufR, size_t start, size_t len);
+
+    const char* getStateFormat(int& version);
+    void writeState(SafeWriter* w);
+    bool readState(SafeReader& r);
   
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     void reset();
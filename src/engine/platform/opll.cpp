@@ -68,8 +68,8 @@ const unsigned char drumSlot[11]={
 };
 
 void DivPlatformOPLL::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static int o[2];
-  static int os;
+  int o[2]={0,0};
+  int os;
 
   for (size_t h=start; h<start+len; h++) {
     os=0;
@@ -725,6 +725,92 @@ void* DivPlatformOPLL::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformOPLL::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<11; i++) s->chan[i]=chan[i];
+  s->lastCustomMemory=lastCustomMemory;
+  s->drumState=drumState;
+  memcpy(s->drumVol,drumVol,sizeof(drumVol));
+  s->properDrums=properDrums;
+  return s;
+}
+
+void DivPlatformOPLL::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<11; i++) chan[i]=s->chan[i];
+  lastCustomMemory=s->lastCustomMemory;
+  drumState=s->drumState;
+  memcpy(drumVol,s->drumVol,sizeof(drumVol));
+  properDrums=s->properDrums;
+}
+
+const char* DivPlatformOPLL::getStateFormat(int& version) {
+  version=1;
+  return "OPLL";
+}
+
+void DivPlatformOPLL::writeState(SafeWriter* w) {
+  w->write(regPool,sizeof(regPool));
+  for (int i=0; i<256; i++) {
+    w->writeS(oldWrites[i]);
+    w->writeS(pendingWrites[i]);
+  }
+  std::queue<QueuedWrite> queued=writes;
+  w->writeI(queued.size());
+  while (!queued.empty()) {
+    QueuedWrite& i=queued.front();
+    w->writeS(i.addr);
+    w->writeC(i.val);
+    w->writeC(i.addrOrVal);
+    queued.pop();
+  }
+  w->writeI(delay);
+  w->writeC(lastBusy);
+
+  // the only pointer in the chip is its patch ROM, which follows the chip
+  // type. it goes last.
+  opll_t chip=fm;
+  chip.patchrom=NULL;
+  w->write(&chip,sizeof(opll_t));
+}
+
+bool DivPlatformOPLL::readState(SafeReader& r) {
+  unsigned char newRegPool[256];
+  short newOldWrites[256];
+  short newPendingWrites[256];
+  r.read(newRegPool,256);
+  for (int i=0; i<256; i++) {
+    newOldWrites[i]=r.readS();
+    newPendingWrites[i]=r.readS();
+  }
+  int queuedLen=r.readI();
+  if (queuedLen<0 || (size_t)queuedLen>(r.size()-r.tell())/4) return false;
+  std::queue<QueuedWrite> newWrites;
+  for (int i=0; i<queuedLen; i++) {
+    unsigned short addr=r.readS();
+    unsigned char val=r.readC();
+    newWrites.emplace(addr,val);
+    newWrites.back().addrOrVal=r.readC();
+  }
+  int newDelay=r.readI();
+  unsigned char newLastBusy=r.readC();
+
+  if (r.size()-r.tell()!=sizeof(opll_t)) return false;
+  opll_t chip;
+  r.read(&chip,sizeof(opll_t));
+  if (chip.chip_type!=fm.chip_type || chip.cycles>=18) return false;
+  chip.patchrom=fm.patchrom;
+
+  fm=chip;
+  memcpy(regPool,newRegPool,256);
+  memcpy(oldWrites,newOldWrites,256*sizeof(short));
+  memcpy(pendingWrites,newPendingWrites,256*sizeof(short));
+  writes=newWrites;
+  delay=newDelay;
+  lastBusy=newLastBusy;
+  return true;
+}
+
 unsigned char* DivPlatformOPLL::getRegisterPool() {
   return regPool;
 }
@@ -58,6 +58,13 @@ class DivPlatformOPLL: public DivDispatch {
         pan(3) {}
     };
     Channel chan[11];
+    struct SoftState: public DivDispatchSoftState {
+      Channel chan[11];
+      int lastCustomMemory;
+      unsigned char drumState;
+      unsigned char drumVol[5];
+      bool properDrums;
+    };
     bool isMuted[11];
     struct QueuedWrite {
       unsigned short addr;
@@ -91,11 +98,17 @@ class DivPlatformOPLL: public DivDispatch {
 
     void acquire_nuked(short* bufL, short* bufR, size_t start, size_t len);
     void acquire_ymfm(short* bufL, short* bufR, size_t start, size_t len);
+
+    const char* getStateFormat(int& version);
+    void writeState(SafeWriter* w);
+    bool readState(SafeReader& r);
   
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     void reset();
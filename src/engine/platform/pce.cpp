@@ -81,18 +81,19 @@ void DivPlatformPCE::acquire(short* bufL, short* bufR, size_t start, size_t len)
       if (chan[i].pcm && chan[i].dacSample!=-1) {
         chan[i].dacPeriod+=chan[i].dacRate;
         if (chan[i].dacPeriod>rate) {
-          DivSample* s=parent->getSample(chan[i].dacSample);
-          if (s->samples<=0) {
+          DivSampleCursor& cur=chan[i].dacCursor;
+          if (cur.index!=chan[i].dacSample) cur.set(parent,chan[i].dacSample);
+          if (!cur.valid()) {
             chan[i].dacSample=-1;
             continue;
           }
           chWrite(i,0x07,0);
           chWrite(i,0x04,0xdf);
-          chWrite(i,0x06,(((unsigned char)s->data8[chan[i].dacPos]+0x80)>>3));
+          chWrite(i,0x06,(((unsigned char)cur.data8[chan[i].dacPos]+0x80)>>3));
           chan[i].dacPos++;
-          if (chan[i].dacPos>=s->samples) {
-            if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-              chan[i].dacPos=s->loopStart;
+          if (chan[i].dacPos>=cur.len) {
+            if (cur.loopStart>=0) {
+              chan[i].dacPos=cur.loopStart;
             } else {
               chan[i].dacSample=-1;
             }
@@ -463,6 +464,179 @@ void* DivPlatformPCE::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformPCE::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<6; i++) s->chan[i]=chan[i];
+  s->lastPan=lastPan;
+  s->sampleBank=sampleBank;
+  s->lfoMode=lfoMode;
+  s->lfoSpeed=lfoSpeed;
+  return s;
+}
+
+void DivPlatformPCE::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<6; i++) {
+    chan[i]=s->chan[i];
+    chan[i].dacCursor.invalidate();
+  }
+  lastPan=s->lastPan;
+  sampleBank=s->sampleBank;
+  lfoMode=s->lfoMode;
+  lfoSpeed=s->lfoSpeed;
+}
+
+const char* DivPlatformPCE::getStateFormat(int& version) {
+  version=1;
+  return "PCE ";
+}
+
+void DivPlatformPCE::writeState(SafeWriter* w) {
+  // the output buffers, volume tables and output functions are set up by the
+  // dispatch and by the chip itself, so they are left out
+  w->writeI(pce->revision);
+  w->writeC(pce->select);
+  w->writeC(pce->globalbalance);
+  w->writeC(pce->lfofreq);
+  w->writeC(pce->lfoctrl);
+  w->writeI(pce->vol_update_counter);
+  w->writeI(pce->vol_update_which);
+  w->writeI(pce->vol_update_vllatch);
+  w->writeC(pce->vol_pending);
+  w->writeI(pce->lastts);
+  for (int i=0; i<6; i++) {
+    psg_channel& ch=pce->channel[i];
+    w->write(ch.waveform,32);
+    w->writeC(ch.waveform_index);
+    w->writeC(ch.dda);
+    w->writeC(ch.control);
+    w->writeC(ch.noisectrl);
+    w->writeI(ch.vl[0]);
+    w->writeI(ch.vl[1]);
+    w->writeI(ch.counter);
+    w->writeI(ch.freq_cache);
+    w->writeI(ch.noise_freq_cache);
+    w->writeI(ch.noisecount);
+    w->writeI(ch.lfsr);
+    w->writeI(ch.samp_accum);
+    w->writeI(ch.blip_prev_samp[0]);
+    w->writeI(ch.blip_prev_samp[1]);
+    w->writeI(ch.lastts);
+    w->writeS(ch.frequency);
+    w->writeC(ch.balance);
+  }
+
+  w->write(regPool,sizeof(regPool));
+  std::queue<QueuedWrite> queued=writes;
+  w->writeI(queued.size());
+  while (!queued.empty()) {
+    QueuedWrite& i=queued.front();
+    w->writeC(i.addr);
+    w->writeC(i.val);
+    queued.pop();
+  }
+  w->writeI(cycles);
+  w->writeI(curChan);
+  w->writeI(delay);
+  for (int i=0; i<6; i++) {
+    w->writeI(chan[i].dacPeriod);
+    w->writeI(chan[i].dacRate);
+    w->writeI(chan[i].dacPos);
+    w->writeI(chan[i].dacSample);
+  }
+}
+
+bool DivPlatformPCE::readState(SafeReader& r) {
+  if (r.readI()!=pce->revision) return false;
+  unsigned char select=r.readC();
+  unsigned char globalBalance=r.readC();
+  unsigned char lfoFreq=r.readC();
+  unsigned char lfoCtrl=r.readC();
+  int volUpdateCounter=r.readI();
+  int volUpdateWhich=r.readI();
+  int volUpdateLatch=r.readI();
+  bool volPending=r.readC();
+  int lastTS=r.readI();
+  psg_channel psgChan[6];
+  for (int i=0; i<6; i++) {
+    psg_channel& ch=psgChan[i];
+    ch=pce->channel[i];
+    r.read(ch.waveform,32);
+    ch.waveform_index=r.readC();
+    ch.dda=r.readC();
+    ch.control=r.readC();
+    ch.noisectrl=r.readC();
+    ch.vl[0]=r.readI();
+    ch.vl[1]=r.readI();
+    ch.counter=r.readI();
+    ch.freq_cache=r.readI();
+    ch.noise_freq_cache=r.readI();
+    ch.noisecount=r.readI();
+    ch.lfsr=r.readI();
+    ch.samp_accum=r.readI();
+    ch.blip_prev_samp[0]=r.readI();
+    ch.blip_prev_samp[1]=r.readI();
+    ch.lastts=r.readI();
+    ch.frequency=r.readS();
+    ch.balance=r.readC();
+    if (ch.waveform_index>=32) return false;
+  }
+  if (select>=8 || volUpdateWhich<0) return false;
+
+  unsigned char newRegPool[128];
+  r.read(newRegPool,sizeof(newRegPool));
+  int queuedLen=r.readI();
+  if (queuedLen<0 || (size_t)queuedLen>(r.size()-r.tell())/2) return false;
+  std::queue<QueuedWrite> newWrites;
+  for (int i=0; i<queuedLen; i++) {
+    unsigned char addr=r.readC();
+    unsigned char val=r.readC();
+    newWrites.emplace(addr,val);
+  }
+  int newCycles=r.readI();
+  int newCurChan=r.readI();
+  int newDelay=r.readI();
+  int dacPeriod[6];
+  int dacRate[6];
+  unsigned int dacPos[6];
+  int dacSample[6];
+  for (int i=0; i<6; i++) {
+    dacPeriod[i]=r.readI();
+    dacRate[i]=r.readI();
+    dacPos[i]=r.readI();
+    dacSample[i]=r.readI();
+    if (dacSample[i]<-1 || dacSample[i]>=parent->song.sampleLen) return false;
+    if (dacSample[i]>=0 && dacPos[i]>=parent->getSample(dacSample[i])->samples) return false;
+  }
+  if (r.tell()!=r.size()) return false;
+
+  pce->select=select;
+  pce->globalbalance=globalBalance;
+  pce->lfofreq=lfoFreq;
+  pce->lfoctrl=lfoCtrl;
+  pce->vol_update_counter=volUpdateCounter;
+  pce->vol_update_which=volUpdateWhich;
+  pce->vol_update_vllatch=volUpdateLatch;
+  pce->vol_pending=volPending;
+  pce->lastts=lastTS;
+  for (int i=0; i<6; i++) {
+    pce->channel[i]=psgChan[i];
+    pce->RecalcUOFunc(i);
+  }
+  memcpy(regPool,newRegPool,sizeof(regPool));
+  writes=newWrites;
+  cycles=newCycles;
+  curChan=newCurChan;
+  delay=newDelay;
+  for (int i=0; i<6; i++) {
+    chan[i].dacPeriod=dacPeriod[i];
+    chan[i].dacRate=dacRate[i];
+    chan[i].dacPos=dacPos[i];
+    chan[i].dacSample=dacSample[i];
+  }
+  return true;
+}
+
 unsigned char* DivPlatformPCE::getRegisterPool() {
   return regPool;
 }
@@ -528,6 +702,12 @@ void DivPlatformPCE::notifyInsDeletion(void* ins) {
   }
 }
 
+void DivPlatformPCE::notifySampleChange() {
+  for (int i=0; i<6; i++) {
+    chan[i].dacCursor.invalidate();
+  }
+}
+
 void DivPlatformPCE::setFlags(unsigned int flags) {
   if (flags&1) { // technically there is no PAL PC Engine but oh well...
     chipClock=COLOR_PAL*4.0/5.0;
@@ -24,6 +24,7 @@
 #include <queue>
 #include "../macroInt.h"
 #include "../waveSynth.h"
+#include "sampleCursor.h"
 #include "sound/pce_psg.h"
 
 class DivPlatformPCE: public DivDispatch {
@@ -37,6 +38,7 @@ class DivPlatformPCE: public DivDispatch {
     signed char vol, outVol, wave;
     DivMacroInt std;
     DivWaveSynth ws;
+    DivSampleCursor dacCursor;
     Channel():
       freq(0),
       baseFreq(0),
@@ -62,6 +64,13 @@ class DivPlatformPCE: public DivDispatch {
       wave(-1) {}
   };
   Channel chan[6];
+  struct SoftState: public DivDispatchSoftState {
+    Channel chan[6];
+    unsigned char lastPan;
+    unsigned char sampleBank;
+    unsigned char lfoMode;
+    unsigned char lfoSpeed;
+  };
   bool isMuted[6];
   struct QueuedWrite {
       unsigned char addr;
@@ -79,10 +88,16 @@ class DivPlatformPCE: public DivDispatch {
   unsigned char regPool[128];
   void updateWave(int ch);
   friend void putDispatchChan(void*,int,int);
+
+  const char* getStateFormat(int& version);
+  void writeState(SafeWriter* w);
+  bool readState(SafeReader& r);
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     void reset();
@@ -94,6 +109,7 @@ class DivPlatformPCE: public DivDispatch {
     void setFlags(unsigned int flags);
     void notifyWaveChange(int wave);
     void notifyInsDeletion(void* ins);
+    void notifySampleChange();
     void poke(unsigned int addr, unsigned short val);
     void poke(std::vector<DivRegWrite>& wlist);
     const char** getRegisterSheet();
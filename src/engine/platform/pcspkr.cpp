@@ -20,6 +20,7 @@
 #include "pcspkr.h"
 #include "../engine.h"
 #include <math.h>
+#include <string.h>
 
 #ifdef __linux__
 #include <sys/ioctl.h>
@@ -117,7 +118,8 @@ void DivPlatformPCSpeaker::acquire_piezo(short* bufL, short* bufR, size_t start,
 
 void DivPlatformPCSpeaker::beepFreq(int freq) {
 #ifdef __linux__
-  static struct input_event ie;
+  struct input_event ie;
+  memset(&ie,0,sizeof(struct input_event));
   if (beepFD>=0) {
     gettimeofday(&ie.time,NULL);
     ie.type=EV_SND;
@@ -271,6 +271,11 @@ void DivPlatformQSound::acquire(short* bufL, short* bufR, size_t start, size_t l
     qsound_update(&chip);
     bufL[h]=chip.out[0];
     bufR[h]=chip.out[1];
+    if (oscTap) {
+      for (int i=0; i<19; i++) {
+        oscBuf[i]->data[oscBuf[i]->needle++]=chip.voice_output[i];
+      }
+    }
   }
 }
 
@@ -523,6 +528,190 @@ void* DivPlatformQSound::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformQSound::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<19; i++) s->chan[i]=chan[i];
+  s->echoDelay=echoDelay;
+  s->echoFeedback=echoFeedback;
+  return s;
+}
+
+void DivPlatformQSound::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<19; i++) chan[i]=s->chan[i];
+  echoDelay=s->echoDelay;
+  echoFeedback=s->echoFeedback;
+}
+
+static void writeQSoundFIR(SafeWriter* w, const struct qsound_fir& f) {
+  w->writeI(f.tap_count);
+  w->writeI(f.delay_pos);
+  w->writeS(f.table_pos);
+  for (int i=0; i<95; i++) w->writeS(f.taps[i]);
+  for (int i=0; i<95; i++) w->writeS(f.delay_line[i]);
+}
+
+static bool readQSoundFIR(SafeReader& r, struct qsound_fir& f) {
+  f.tap_count=r.readI();
+  f.delay_pos=r.readI();
+  f.table_pos=r.readS();
+  for (int i=0; i<95; i++) f.taps[i]=r.readS();
+  for (int i=0; i<95; i++) f.delay_line[i]=r.readS();
+  return (f.tap_count>=0 && f.tap_count<=95 && f.delay_pos>=0 && f.delay_pos<95);
+}
+
+static void writeQSoundDelay(SafeWriter* w, const struct qsound_delay& d) {
+  w->writeS(d.delay);
+  w->writeS(d.volume);
+  w->writeS(d.write_pos);
+  w->writeS(d.read_pos);
+  for (int i=0; i<51; i++) w->writeS(d.delay_line[i]);
+}
+
+static bool readQSoundDelay(SafeReader& r, struct qsound_delay& d) {
+  d.delay=r.readS();
+  d.volume=r.readS();
+  d.write_pos=r.readS();
+  d.read_pos=r.readS();
+  for (int i=0; i<51; i++) d.delay_line[i]=r.readS();
+  return (d.write_pos>=0 && d.write_pos<51 && d.read_pos>=0 && d.read_pos<51);
+}
+
+const char* DivPlatformQSound::getStateFormat(int& version) {
+  version=1;
+  return "QSND";
+}
+
+void DivPlatformQSound::writeState(SafeWriter* w) {
+  // the sample ROM, the register map and the pan tables are set up by init()
+  w->writeS(chip.data_latch);
+  w->writeS(chip.out[0]);
+  w->writeS(chip.out[1]);
+  for (int i=0; i<16; i++) {
+    struct qsound_voice& v=chip.voice[i];
+    w->writeS(v.bank);
+    w->writeS(v.addr);
+    w->writeS(v.phase);
+    w->writeS(v.rate);
+    w->writeS(v.loop_len);
+    w->writeS(v.end_addr);
+    w->writeS(v.volume);
+    w->writeS(v.echo);
+  }
+  for (int i=0; i<3; i++) {
+    struct qsound_adpcm& a=chip.adpcm[i];
+    w->writeS(a.start_addr);
+    w->writeS(a.end_addr);
+    w->writeS(a.bank);
+    w->writeS(a.volume);
+    w->writeS(a.flag);
+    w->writeS(a.cur_vol);
+    w->writeS(a.step_size);
+    w->writeS(a.cur_addr);
+  }
+  for (int i=0; i<19; i++) {
+    w->writeS(chip.voice_pan[i]);
+    w->writeS(chip.voice_output[i]);
+  }
+  w->writeS(chip.echo.end_pos);
+  w->writeS(chip.echo.feedback);
+  w->writeS(chip.echo.length);
+  w->writeS(chip.echo.last_sample);
+  for (int i=0; i<1024; i++) w->writeS(chip.echo.delay_line[i]);
+  w->writeS(chip.echo.delay_pos);
+  for (int i=0; i<2; i++) {
+    writeQSoundFIR(w,chip.filter[i]);
+    writeQSoundFIR(w,chip.alt_filter[i]);
+    writeQSoundDelay(w,chip.wet[i]);
+    writeQSoundDelay(w,chip.dry[i]);
+  }
+  w->writeS(chip.state);
+  w->writeS(chip.next_state);
+  w->writeS(chip.delay_update);
+  w->writeI(chip.state_counter);
+  w->writeI(chip.ready_flag);
+
+  for (int i=0; i<512; i++) w->writeS(regPool[i]);
+}
+
+bool DivPlatformQSound::readState(SafeReader& r) {
+  // fill a copy of the chip, which keeps the pointers and the pan tables
+  struct qsound_chip* newChip=new struct qsound_chip;
+  memcpy(newChip,&chip,sizeof(struct qsound_chip));
+  bool ok=true;
+  unsigned short newRegPool[512];
+  try {
+    newChip->data_latch=r.readS();
+    newChip->out[0]=r.readS();
+    newChip->out[1]=r.readS();
+    for (int i=0; i<16; i++) {
+      struct qsound_voice& v=newChip->voice[i];
+      v.bank=r.readS();
+      v.addr=r.readS();
+      v.phase=r.readS();
+      v.rate=r.readS();
+      v.loop_len=r.readS();
+      v.end_addr=r.readS();
+      v.volume=r.readS();
+      v.echo=r.readS();
+    }
+    for (int i=0; i<3; i++) {
+      struct qsound_adpcm& a=newChip->adpcm[i];
+      a.start_addr=r.readS();
+      a.end_addr=r.readS();
+      a.bank=r.readS();
+      a.volume=r.readS();
+      a.flag=r.readS();
+      a.cur_vol=r.readS();
+      a.step_size=r.readS();
+      a.cur_addr=r.readS();
+    }
+    for (int i=0; i<19; i++) {
+      newChip->voice_pan[i]=r.readS();
+      newChip->voice_output[i]=r.readS();
+    }
+    newChip->echo.end_pos=r.readS();
+    newChip->echo.feedback=r.readS();
+    newChip->echo.length=r.readS();
+    newChip->echo.last_sample=r.readS();
+    for (int i=0; i<1024; i++) newChip->echo.delay_line[i]=r.readS();
+    newChip->echo.delay_pos=r.readS();
+    if (newChip->echo.delay_pos<0 || newChip->echo.delay_pos>=1024) ok=false;
+    for (int i=0; i<2; i++) {
+      if (!readQSoundFIR(r,newChip->filter[i])) ok=false;
+      if (!readQSoundFIR(r,newChip->alt_filter[i])) ok=false;
+      if (!readQSoundDelay(r,newChip->wet[i])) ok=false;
+      if (!readQSoundDelay(r,newChip->dry[i])) ok=false;
+    }
+    newChip->state=r.readS();
+    newChip->next_state=r.readS();
+    newChip->delay_update=r.readS();
+    newChip->state_counter=r.readI();
+    newChip->ready_flag=r.readI();
+
+    for (int i=0; i<512; i++) newRegPool[i]=r.readS();
+    if (r.tell()!=r.size()) ok=false;
+  } catch (EndOfFileException& e) {
+    ok=false;
+  }
+
+  if (ok) {
+    memcpy(&chip,newChip,sizeof(struct qsound_chip));
+    memcpy(regPool,newRegPool,sizeof(regPool));
+  }
+  delete newChip;
+  return ok;
+}
+
+DivDispatchOscBuffer* DivPlatformQSound::getOscBuffer(int ch) {
+  if (ch<0 || ch>=19) return NULL;
+  return oscBuf[ch];
+}
+
+void DivPlatformQSound::toggleOscTap(bool enable) {
+  setOscBuffers(enable,oscBuf,19);
+}
+
 void DivPlatformQSound::reset() {
   for (int i=0; i<16; i++) {
     chan[i]=DivPlatformQSound::Channel();
@@ -609,9 +798,14 @@ int DivPlatformQSound::init(DivEngine* p, int channels, int sugRate, unsigned in
   dumpWrites=false;
   skipRegisterWrites=false;
 
+  oscTap=false;
+
   //for (int i=0; i<16; i++) {
   //  isMuted[i]=false;
   //}
+  for (int i=0; i<19; i++) {
+    oscBuf[i]=NULL;
+  }
   setFlags(flags);
 
   chipClock=60000000;
@@ -623,4 +817,5 @@ int DivPlatformQSound::init(DivEngine* p, int channels, int sugRate, unsigned in
 }
 
 void DivPlatformQSound::quit() {
+  freeOscBuffers(oscBuf,19);
 }
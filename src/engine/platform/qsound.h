@@ -57,6 +57,12 @@ class DivPlatformQSound: public DivDispatch {
       outVol(255) {}
   };
   Channel chan[19];
+  struct SoftState: public DivDispatchSoftState {
+    Channel chan[19];
+    int echoDelay;
+    int echoFeedback;
+  };
+  DivDispatchOscBuffer* oscBuf[19];
   int echoDelay;
   int echoFeedback;
 
@@ -65,10 +71,18 @@ class DivPlatformQSound: public DivDispatch {
 
   friend void putDispatchChan(void*,int,int);
 
+  const char* getStateFormat(int& version);
+  void writeState(SafeWriter* w);
+  bool readState(SafeReader& r);
+
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
+    DivDispatchOscBuffer* getOscBuffer(int chan);
+    void toggleOscTap(bool enable);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
     int getRegisterPoolDepth();
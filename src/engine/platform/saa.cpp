@@ -499,8 +499,29 @@ void DivPlatformSAA1099::poke(std::vector<DivRegWrite>& wlist) {
   for (DivRegWrite& i: wlist) rWrite(i.addr,i.val);
 }
 
-void DivPlatformSAA1099::setCore(DivSAACores c) {
-  core=c;
+// the E core is not implemented yet, so it is not offered.
+int DivPlatformSAA1099::getCoreCount() {
+  return 2;
+}
+
+const char* DivPlatformSAA1099::getCoreName(int c) {
+  return (c==DIV_SAA_CORE_SAASOUND)?"SAASound":"MAME";
+}
+
+int DivPlatformSAA1099::getFastCore() {
+  return DIV_SAA_CORE_MAME;
+}
+
+int DivPlatformSAA1099::getAccurateCore() {
+  return DIV_SAA_CORE_SAASOUND;
+}
+
+void DivPlatformSAA1099::setCore(int c) {
+  core=(DivSAACores)c;
+}
+
+int DivPlatformSAA1099::getCore() {
+  return core;
 }
 
 int DivPlatformSAA1099::init(DivEngine* p, int channels, int sugRate, unsigned int flags) {
@@ -92,7 +92,12 @@ class DivPlatformSAA1099: public DivDispatch {
     void forceIns();
     void tick(bool sysTick=true);
     void muteChannel(int ch, bool mute);
-    void setCore(DivSAACores core);
+    int getCoreCount();
+    const char* getCoreName(int core);
+    int getFastCore();
+    int getAccurateCore();
+    void setCore(int core);
+    int getCore();
     void setFlags(unsigned int flags);
     bool isStereo();
     int getPortaFloor(int ch);
@@ -0,0 +1,76 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SAMPLECURSOR_H
+#define _SAMPLECURSOR_H
+
+#include "../engine.h"
+
+// a sample resolved for playback.
+// dispatches which stream sample data in acquire() keep one of these per
+// channel, so that the sample is only looked up and checked when it changes.
+struct DivSampleCursor {
+  const signed char* data8;
+  unsigned int len;
+  // -1 if the sample doesn't loop
+  int loopStart;
+  // sample this cursor was resolved from, or -2 if it has to be resolved again
+  int index;
+
+  /**
+   * point this cursor to a sample.
+   * @param e the engine.
+   * @param which the sample number.
+   */
+  void set(DivEngine* e, int which) {
+    DivSample* s=e->getSample(which);
+    index=which;
+    if (s==NULL || s->data8==NULL || s->samples==0) {
+      data8=NULL;
+      len=0;
+      loopStart=-1;
+      return;
+    }
+    data8=s->data8;
+    len=s->samples;
+    loopStart=(s->loopStart>=0 && s->loopStart<(int)s->samples)?s->loopStart:-1;
+  }
+
+  /**
+   * force the sample to be resolved again, e.g. after sample data changed.
+   */
+  void invalidate() {
+    index=-2;
+  }
+
+  /**
+   * @return whether there is sample data to play.
+   */
+  bool valid() {
+    return len>0;
+  }
+
+  DivSampleCursor():
+    data8(NULL),
+    len(0),
+    loopStart(-1),
+    index(-2) {}
+};
+
+#endif
@@ -35,27 +35,28 @@ const char* DivPlatformSegaPCM::getEffectName(unsigned char effect) {
 }
 
 void DivPlatformSegaPCM::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     os[0]=0; os[1]=0;
     // do a PCM cycle
     pcmL=0; pcmR=0;
     for (int i=0; i<16; i++) {
-      if (chan[i].pcm.sample>=0 && chan[i].pcm.sample<parent->song.sampleLen) {
-        DivSample* s=parent->getSample(chan[i].pcm.sample);
-        if (s->samples<=0) {
+      if (chan[i].pcm.sample>=0) {
+        DivSampleCursor& cur=chan[i].cursor;
+        if (cur.index!=chan[i].pcm.sample) cur.set(parent,chan[i].pcm.sample);
+        if (!cur.valid()) {
           chan[i].pcm.sample=-1;
           continue;
         }
         if (!isMuted[i]) {
-          pcmL+=(s->data8[chan[i].pcm.pos>>8]*chan[i].chVolL);
-          pcmR+=(s->data8[chan[i].pcm.pos>>8]*chan[i].chVolR);
+          pcmL+=(cur.data8[chan[i].pcm.pos>>8]*chan[i].chVolL);
+          pcmR+=(cur.data8[chan[i].pcm.pos>>8]*chan[i].chVolR);
         }
         chan[i].pcm.pos+=chan[i].pcm.freq;
-        if (chan[i].pcm.pos>=(s->samples<<8)) {
-          if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-            chan[i].pcm.pos=s->loopStart<<8;
+        if (chan[i].pcm.pos>=(cur.len<<8)) {
+          if (cur.loopStart>=0) {
+            chan[i].pcm.pos=cur.loopStart<<8;
           } else {
             chan[i].pcm.sample=-1;
           }
@@ -349,6 +350,12 @@ void DivPlatformSegaPCM::notifyInsChange(int ins) {
   }
 }
 
+void DivPlatformSegaPCM::notifySampleChange() {
+  for (int i=0; i<16; i++) {
+    chan[i].cursor.invalidate();
+  }
+}
+
 void* DivPlatformSegaPCM::getChanState(int ch) {
   return &chan[ch];
 }
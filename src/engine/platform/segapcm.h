@@ -23,6 +23,7 @@
 #include "../instrument.h"
 #include <queue>
 #include "../macroInt.h"
+#include "sampleCursor.h"
 
 class DivPlatformSegaPCM: public DivDispatch {
   protected:
@@ -43,6 +44,7 @@ class DivPlatformSegaPCM: public DivDispatch {
         unsigned char freq;
         PCMChannel(): sample(-1), pos(0), len(0), freq(0) {}
       } pcm;
+      DivSampleCursor cursor;
       Channel(): freqH(0), freqL(0), freq(0), baseFreq(0), pitch(0), note(0), ins(-1), active(false), insChanged(true), freqChanged(false), keyOn(false), keyOff(false), inPorta(false), portaPause(false), furnacePCM(false), vol(0), outVol(0), chVolL(127), chVolR(127) {}
     };
     Channel chan[16];
@@ -81,6 +83,7 @@ class DivPlatformSegaPCM: public DivDispatch {
     void tick(bool sysTick=true);
     void muteChannel(int ch, bool mute);
     void notifyInsChange(int ins);
+    void notifySampleChange();
     void setFlags(unsigned int flags);
     bool isStereo();
     void poke(unsigned int addr, unsigned short val);
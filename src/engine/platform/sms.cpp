@@ -42,7 +42,16 @@ const char* DivPlatformSMS::getEffectName(unsigned char effect) {
 }
 
 void DivPlatformSMS::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  sn->sound_stream_update(bufL+start,len);
+  if (!oscTap) {
+    sn->sound_stream_update(bufL+start,len);
+    return;
+  }
+  for (size_t h=start; h<start+len; h++) {
+    sn->sound_stream_update(bufL+h,1);
+    for (int i=0; i<4; i++) {
+      oscBuf[i]->data[oscBuf[i]->needle++]=sn->get_channel_output(i);
+    }
+  }
 }
 
 int DivPlatformSMS::acquireOne() {
@@ -279,6 +288,104 @@ void* DivPlatformSMS::getChanState(int ch) {
   return &chan[ch];
 }
 
+DivDispatchSoftState* DivPlatformSMS::saveSoftState() {
+  SoftState* s=new SoftState;
+  for (int i=0; i<4; i++) s->chan[i]=chan[i];
+  s->oldValue=oldValue;
+  s->snNoiseMode=snNoiseMode;
+  s->updateSNMode=updateSNMode;
+  s->resetPhase=resetPhase;
+  return s;
+}
+
+void DivPlatformSMS::loadSoftState(DivDispatchSoftState* state) {
+  SoftState* s=(SoftState*)state;
+  for (int i=0; i<4; i++) chan[i]=s->chan[i];
+  oldValue=s->oldValue;
+  snNoiseMode=s->snNoiseMode;
+  updateSNMode=s->updateSNMode;
+  resetPhase=s->resetPhase;
+}
+
+const char* DivPlatformSMS::getStateFormat(int& version) {
+  version=1;
+  return "SN76";
+}
+
+void DivPlatformSMS::writeState(SafeWriter* w) {
+  // the variant, so that a state is only loaded into the same one
+  w->writeI(sn->m_feedback_mask);
+  w->writeI(sn->m_noise_start);
+  w->writeI(sn->m_whitenoise_tap1);
+  w->writeI(sn->m_whitenoise_tap2);
+  w->writeI(sn->m_clock_divider);
+  w->writeC(sn->m_negate);
+  w->writeC(sn->m_ncr_style_psg);
+  w->writeC(sn->m_sega_style_psg);
+
+  w->writeC(sn->m_ready_state);
+  for (int i=0; i<8; i++) w->writeI(sn->m_register[i]);
+  w->writeI(sn->m_last_register);
+  for (int i=0; i<4; i++) w->writeI(sn->m_volume[i]);
+  w->writeI(sn->m_RNG);
+  w->writeI(sn->m_current_clock);
+  for (int i=0; i<4; i++) {
+    w->writeI(sn->m_period[i]);
+    w->writeI(sn->m_count[i]);
+    w->writeI(sn->m_output[i]);
+  }
+}
+
+bool DivPlatformSMS::readState(SafeReader& r) {
+  if (r.readI()!=sn->m_feedback_mask) return false;
+  if (r.readI()!=sn->m_noise_start) return false;
+  if (r.readI()!=sn->m_whitenoise_tap1) return false;
+  if (r.readI()!=sn->m_whitenoise_tap2) return false;
+  if (r.readI()!=sn->m_clock_divider) return false;
+  if ((bool)r.readC()!=sn->m_negate) return false;
+  if ((bool)r.readC()!=sn->m_ncr_style_psg) return false;
+  if ((bool)r.readC()!=sn->m_sega_style_psg) return false;
+
+  bool readyState=r.readC();
+  int32_t reg[8];
+  int32_t volume[4];
+  int32_t period[4];
+  int32_t count[4];
+  int32_t output[4];
+  for (int i=0; i<8; i++) reg[i]=r.readI();
+  int32_t lastRegister=r.readI();
+  for (int i=0; i<4; i++) volume[i]=r.readI();
+  uint32_t rng=r.readI();
+  int32_t currentClock=r.readI();
+  for (int i=0; i<4; i++) {
+    period[i]=r.readI();
+    count[i]=r.readI();
+    output[i]=r.readI();
+  }
+  if (r.tell()!=r.size()) return false;
+  if (lastRegister<0 || lastRegister>=8) return false;
+
+  sn->m_ready_state=readyState;
+  memcpy(sn->m_register,reg,sizeof(reg));
+  sn->m_last_register=lastRegister;
+  memcpy(sn->m_volume,volume,sizeof(volume));
+  sn->m_RNG=rng;
+  sn->m_current_clock=currentClock;
+  memcpy(sn->m_period,period,sizeof(period));
+  memcpy(sn->m_count,count,sizeof(count));
+  memcpy(sn->m_output,output,sizeof(output));
+  return true;
+}
+
+DivDispatchOscBuffer* DivPlatformSMS::getOscBuffer(int ch) {
+  if (ch<0 || ch>=4) return NULL;
+  return oscBuf[ch];
+}
+
+void DivPlatformSMS::toggleOscTap(bool enable) {
+  setOscBuffers(enable,oscBuf,4);
+}
+
 void DivPlatformSMS::reset() {
   for (int i=0; i<4; i++) {
     chan[i]=DivPlatformSMS::Channel();
@@ -359,8 +466,10 @@ int DivPlatformSMS::init(DivEngine* p, int channels, int sugRate, unsigned int f
   skipRegisterWrites=false;
   resetPhase=false;
   oldValue=0xff;
+  oscTap=false;
   for (int i=0; i<4; i++) {
     isMuted[i]=false;
+    oscBuf[i]=NULL;
   }
   sn=NULL;
   setFlags(flags);
@@ -369,6 +478,7 @@ int DivPlatformSMS::init(DivEngine* p, int channels, int sugRate, unsigned int f
 }
 
 void DivPlatformSMS::quit() {
+  freeOscBuffers(oscBuf,4);
   if (sn!=NULL) delete sn;
 }
 
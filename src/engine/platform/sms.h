@@ -48,6 +48,14 @@ class DivPlatformSMS: public DivDispatch {
       outVol(15) {}
   };
   Channel chan[4];
+  struct SoftState: public DivDispatchSoftState {
+    Channel chan[4];
+    unsigned char oldValue;
+    unsigned char snNoiseMode;
+    bool updateSNMode;
+    bool resetPhase;
+  };
+  DivDispatchOscBuffer* oscBuf[4];
   bool isMuted[4];
   unsigned char oldValue; 
   unsigned char snNoiseMode;
@@ -56,11 +64,19 @@ class DivPlatformSMS: public DivDispatch {
   bool isRealSN;
   sn76496_base_device* sn;
   friend void putDispatchChan(void*,int,int);
+
+  const char* getStateFormat(int& version);
+  void writeState(SafeWriter* w);
+  bool readState(SafeReader& r);
   public:
     int acquireOne();
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
+    DivDispatchSoftState* saveSoftState();
+    void loadSoftState(DivDispatchSoftState* state);
+    DivDispatchOscBuffer* getOscBuffer(int chan);
+    void toggleOscTap(bool enable);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
@@ -140,6 +140,9 @@ public:
 	unsigned char ay8910_read_ym();
 	void ay8910_reset_ym(bool ay8930);
 
+	// furnace: the dispatch saves and restores the chip state
+	friend class DivPlatformAY8910;
+
 private:
 	static constexpr int NUM_CHANNELS = 3;
   device_type chip_type;
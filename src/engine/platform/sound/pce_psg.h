@@ -148,6 +148,9 @@ class PCE_PSG
   void PeekWave(const unsigned int ch, uint32_t Address, uint32_t Length, uint8_t *Buffer);
   void PokeWave(const unsigned int ch, uint32_t Address, uint32_t Length, const uint8_t *Buffer);
 
+  // furnace: the dispatch saves and restores the chip state
+  friend class DivPlatformPCE;
+
   private:
 
   void UpdateSubLFO(int32_t timestamp);
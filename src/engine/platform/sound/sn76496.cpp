@@ -346,3 +346,9 @@ void sn76496_base_device::sound_stream_update(short* outputs, int outLen)
 		outputs[sampindex]=out;
 	}
 }
+
+int16_t sn76496_base_device::get_channel_output(int ch)
+{
+	int16_t out=(m_output[ch]!=0)?m_volume[ch]:0;
+	return m_negate?-out:out;
+}
@@ -16,6 +16,7 @@ public:
 	void write(u8 data);
   void device_start();
 	void sound_stream_update(short* outputs, int outLen);
+	int16_t get_channel_output(int ch);
 	//DECLARE_READ_LINE_MEMBER( ready_r ) { return m_ready_state ? 1 : 0; }
 
 	sn76496_base_device(
@@ -28,6 +29,9 @@ public:
 			bool ncr,
 			bool sega);
 
+	// furnace: the dispatch saves and restores the chip state
+	friend class DivPlatformSMS;
+
 private:
 	inline bool     in_noise_mode();
 
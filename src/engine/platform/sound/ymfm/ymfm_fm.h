@@ -301,11 +301,15 @@ public:
 
 	// simple getters for debugging
 	fm_operator<RegisterType> *debug_operator(uint32_t index) const { return m_op[index]; }
+	int32_t debug_output() const { return m_output; }
 
 private:
 	// helper to add values to the outputs based on channel enables
 	void add_to_output(uint32_t choffs, output_data &output, int32_t value) const
 	{
+		// remember the last output for per-channel oscilloscopes
+		m_output = value;
+
 		// create these constants to appease overzealous compilers checking array
 		// bounds in unreachable code (looking at you, clang)
 		constexpr int out0_index = 0;
@@ -327,6 +331,7 @@ private:
 	uint32_t m_choffs;                     // channel offset in registers
 	int16_t m_feedback[2];                 // feedback memory for operator 1
 	mutable int16_t m_feedback_in;         // next input value for op 1 feedback (set in output)
+	mutable int32_t m_output;              // last output of this channel (set in output)
 	fm_operator<RegisterType> *m_op[4];    // up to 4 operators
 	RegisterType &m_regs;                  // direct reference to registers
 	fm_engine_base<RegisterType> &m_owner; // reference to the owning engine
@@ -806,6 +806,7 @@ fm_channel<RegisterType>::fm_channel(fm_engine_base<RegisterType> &owner, uint32
 	m_choffs(choffs),
 	m_feedback{ 0, 0 },
 	m_feedback_in(0),
+	m_output(0),
 	m_op{ nullptr, nullptr, nullptr, nullptr },
 	m_regs(owner.regs()),
 	m_owner(owner)
@@ -823,6 +824,7 @@ void fm_channel<RegisterType>::reset()
 	// reset our data
 	m_feedback[0] = m_feedback[1] = 0;
 	m_feedback_in = 0;
+	m_output = 0;
 }
 
 
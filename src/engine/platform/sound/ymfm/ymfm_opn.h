@@ -761,6 +761,10 @@ public:
 	// generate one sample of sound
 	void generate(output_data *output, uint32_t numsamples = 1);
 
+	// simple getters for debugging
+	fm_engine &debug_fm_engine() { return m_fm; }
+	int32_t debug_dac_output() const { return m_dac_enable ? (int16_t(m_dac_data << 7) >> 7) : 0; }
+
 protected:
 	// simulate the DAC discontinuity
 	constexpr int32_t dac_discontinuity(int32_t value) const { return (value < 0) ? (value - 2) : (value + 3); }
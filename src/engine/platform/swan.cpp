@@ -77,15 +77,15 @@ void DivPlatformSwan::acquire(short* bufL, short* bufR, size_t start, size_t len
     if (pcm && dacSample!=-1) {
       dacPeriod+=dacRate;
       while (dacPeriod>rate) {
-        DivSample* s=parent->getSample(dacSample);
-        if (s->samples<=0) {
+        if (dacCursor.index!=dacSample) dacCursor.set(parent,dacSample);
+        if (!dacCursor.valid()) {
           dacSample=-1;
-          continue;
+          break;
         }
-        rWrite(0x09,(unsigned char)s->data8[dacPos++]+0x80);
-        if (dacPos>=s->samples) {
-          if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-            dacPos=s->loopStart;
+        rWrite(0x09,(unsigned char)dacCursor.data8[dacPos++]+0x80);
+        if (dacPos>=dacCursor.len) {
+          if (dacCursor.loopStart>=0) {
+            dacPos=dacCursor.loopStart;
           } else {
             dacSample=-1;
           }
@@ -508,6 +508,10 @@ void DivPlatformSwan::notifyInsDeletion(void* ins) {
   }
 }
 
+void DivPlatformSwan::notifySampleChange() {
+  dacCursor.invalidate();
+}
+
 void DivPlatformSwan::poke(unsigned int addr, unsigned short val) {
   rWrite(addr,val);
 }
@@ -23,6 +23,7 @@
 #include "../dispatch.h"
 #include "../macroInt.h"
 #include "../waveSynth.h"
+#include "sampleCursor.h"
 #include "sound/swan.h"
 #include <queue>
 
@@ -58,6 +59,7 @@ class DivPlatformSwan: public DivDispatch {
   int dacPeriod, dacRate;
   unsigned int dacPos;
   int dacSample;
+  DivSampleCursor dacCursor;
 
   unsigned char regPool[0x80];
   struct QueuedWrite {
@@ -81,6 +83,7 @@ class DivPlatformSwan: public DivDispatch {
     void muteChannel(int ch, bool mute);
     void notifyWaveChange(int wave);
     void notifyInsDeletion(void* ins);
+    void notifySampleChange();
     bool isStereo();
     void poke(unsigned int addr, unsigned short val);
     void poke(std::vector<DivRegWrite>& wlist);
@@ -145,7 +145,7 @@ const char* DivPlatformTX81Z::getEffectName(unsigned char effect) {
 }
 
 void DivPlatformTX81Z::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     os[0]=0; os[1]=0;
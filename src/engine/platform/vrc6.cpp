@@ -65,21 +65,22 @@ void DivPlatformVRC6::acquire(short* bufL, short* bufR, size_t start, size_t len
       if (chan[i].pcm && chan[i].dacSample!=-1) {
         chan[i].dacPeriod+=chan[i].dacRate;
         if (chan[i].dacPeriod>rate) {
-          DivSample* s=parent->getSample(chan[i].dacSample);
-          if (s->samples<=0) {
+          DivSampleCursor& cur=chan[i].dacCursor;
+          if (cur.index!=chan[i].dacSample) cur.set(parent,chan[i].dacSample);
+          if (!cur.valid()) {
             chan[i].dacSample=-1;
             chWrite(i,0,0);
             continue;
           }
-          unsigned char dacData=(((unsigned char)s->data8[chan[i].dacPos]^0x80)>>4);
+          unsigned char dacData=(((unsigned char)cur.data8[chan[i].dacPos]^0x80)>>4);
           chan[i].dacOut=MAX(0,MIN(15,(dacData*chan[i].outVol)>>4));
           if (!isMuted[i]) {
             chWrite(i,0,0x80|chan[i].dacOut);
           }
           chan[i].dacPos++;
-          if (chan[i].dacPos>=s->samples) {
-            if (s->loopStart>=0 && s->loopStart<(int)s->samples) {
-              chan[i].dacPos=s->loopStart;
+          if (chan[i].dacPos>=cur.len) {
+            if (cur.loopStart>=0) {
+              chan[i].dacPos=cur.loopStart;
             } else {
               chan[i].dacSample=-1;
               chWrite(i,0,0);
@@ -473,6 +474,12 @@ void DivPlatformVRC6::notifyInsDeletion(void* ins) {
   }
 }
 
+void DivPlatformVRC6::notifySampleChange() {
+  for (int i=0; i<2; i++) {
+    chan[i].dacCursor.invalidate();
+  }
+}
+
 void DivPlatformVRC6::poke(unsigned int addr, unsigned short val) {
   rWrite(addr,val);
 }
@@ -23,6 +23,7 @@
 #include <queue>
 #include "../dispatch.h"
 #include "../macroInt.h"
+#include "sampleCursor.h"
 #include "sound/vrcvi/vrcvi.hpp"
 
 
@@ -36,6 +37,7 @@ class DivPlatformVRC6: public DivDispatch {
     bool active, insChanged, freqChanged, keyOn, keyOff, inPorta, pcm, furnaceDac;
     signed char vol, outVol;
     DivMacroInt std;
+    DivSampleCursor dacCursor;
     Channel():
       freq(0),
       baseFreq(0),
@@ -87,6 +89,7 @@ class DivPlatformVRC6: public DivDispatch {
     bool keyOffAffectsArp(int ch);
     void setFlags(unsigned int flags);
     void notifyInsDeletion(void* ins);
+    void notifySampleChange();
     void poke(unsigned int addr, unsigned short val);
     void poke(std::vector<DivRegWrite>& wlist);
     const char** getRegisterSheet();
@@ -335,7 +335,7 @@ double DivPlatformYM2610::NOTE_ADPCMB(int note) {
 }
 
 void DivPlatformYM2610::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     os[0]=0; os[1]=0;
@@ -399,7 +399,7 @@ double DivPlatformYM2610B::NOTE_ADPCMB(int note) {
 }
 
 void DivPlatformYM2610B::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     os[0]=0; os[1]=0;
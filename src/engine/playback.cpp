@@ -22,6 +22,7 @@
 #include "engine.h"
 #include "../ta-log.h"
 #include <math.h>
+#include <chrono>
 #include <sndfile.h>
 
 constexpr int MASTER_CLOCK_PREC=(sizeof(void*)==8)?8:0;
@@ -157,7 +158,7 @@ const char* cmdName[]={
 static_assert((sizeof(cmdName)/sizeof(void*))==DIV_CMD_MAX,"update cmdName!");
 
 const char* formatNote(unsigned char note, unsigned char octave) {
-  static char ret[4];
+  static thread_local char ret[4];
   if (note==100) {
     return "OFF";
   } else if (note==101) {
@@ -908,7 +909,7 @@ bool DivEngine::perSystemPostEffect(int ch, unsigned char effect, unsigned char
 void DivEngine::processRow(int i, bool afterDelay) {
   int whatOrder=afterDelay?chan[i].delayOrder:curOrder;
   int whatRow=afterDelay?chan[i].delayRow:curRow;
-  DivPattern* pat=song.pat[i].getPattern(song.orders.ord[i][whatOrder],false);
+  DivPattern* pat=song.pat[i].getPatternForRow(song.orders.ord[i][whatOrder],whatRow);
   // pre effects
   if (!afterDelay) for (int j=0; j<song.pat[i].effectRows; j++) {
     short effect=pat->data[whatRow][4+(j<<1)];
@@ -1348,10 +1349,10 @@ void DivEngine::processRow(int i, bool afterDelay) {
 }
 
 void DivEngine::nextRow() {
-  static char pb[4096];
-  static char pb1[4096];
-  static char pb2[4096];
-  static char pb3[4096];
+  char pb[4096];
+  char pb1[4096];
+  char pb2[4096];
+  char pb3[4096];
   if (view==DIV_STATUS_PATTERN) {
     strcpy(pb1,"");
     strcpy(pb3,"");
@@ -1359,7 +1360,7 @@ void DivEngine::nextRow() {
       snprintf(pb,4095," %.2x",song.orders.ord[i][curOrder]);
       strcat(pb1,pb);
       
-      DivPattern* pat=song.pat[i].getPattern(song.orders.ord[i][curOrder],false);
+      DivPattern* pat=song.pat[i].getPatternForRow(song.orders.ord[i][curOrder],curRow);
       snprintf(pb2,4095,"\x1b[37m %s",
               formatNote(pat->data[curRow][0],pat->data[curRow][1]));
       strcat(pb3,pb2);
@@ -1440,7 +1441,7 @@ void DivEngine::nextRow() {
 
   // post row details
   for (int i=0; i<chans; i++) {
-    DivPattern* pat=song.pat[i].getPattern(song.orders.ord[i][curOrder],false);
+    DivPattern* pat=song.pat[i].getPatternForRow(song.orders.ord[i][curOrder],curRow);
     if (!(pat->data[curRow][0]==0 && pat->data[curRow][1]==0)) {
       if (pat->data[curRow][0]!=100 && pat->data[curRow][0]!=101 && pat->data[curRow][0]!=102) {
         if (!chan[i].legato) {
@@ -1667,7 +1668,69 @@ bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
   return ret;
 }
 
+// blip_buf renders at most blip_max_frame samples at once, so larger
+// buffers are rendered in several steps.
+void DivEngine::nextBufSplit(float** in, float** out, int inChans, int outChans, unsigned int size) {
+  // nextBuf() only writes to out[0] and out[1]
+  float* outSub[2];
+  size_t processed=0;
+  for (unsigned int pos=0; pos<size; pos+=blip_max_frame) {
+    unsigned int len=MIN(size-pos,(unsigned int)blip_max_frame);
+    if (out!=NULL) {
+      outSub[0]=out[0]+pos;
+      outSub[1]=out[1]+pos;
+    }
+    bool wasPlaying=playing;
+    nextBuf(in,(out==NULL)?NULL:outSub,inChans,outChans,len);
+    if (!wasPlaying) continue;
+    processed+=totalProcessed;
+    if (!playing) {
+      // the song ended. leave the rest silent
+      if (out!=NULL) {
+        memset(out[0]+pos+len,0,(size-pos-len)*sizeof(float));
+        memset(out[1]+pos+len,0,(size-pos-len)*sizeof(float));
+      }
+      break;
+    }
+  }
+  totalProcessed=processed;
+}
+
+static void _acquireContainer(void* d) {
+  DivDispatchContainer* dc=(DivDispatchContainer*)d;
+  dc->acquire(dc->runPos,dc->runNext);
+}
+
+static void _fillBufContainer(void* d) {
+  DivDispatchContainer* dc=(DivDispatchContainer*)d;
+  if (dc->timing) {
+    std::chrono::steady_clock::time_point timeStart=std::chrono::steady_clock::now();
+    dc->fillBuf(dc->runtotal,dc->lastAvail,dc->runNext);
+    dc->fillTime+=std::chrono::duration<double>(std::chrono::steady_clock::now()-timeStart).count();
+  } else {
+    dc->fillBuf(dc->runtotal,dc->lastAvail,dc->runNext);
+  }
+}
+
+void DivEngine::mixOutput(float** out, size_t size, bool mono) {
+  // copy to the oscilloscope ring, splitting where it wraps around
+  size_t pos=0;
+  while (pos<size) {
+    size_t len=MIN(size-pos,(size_t)(32768-oscWritePos));
+    mixFuncs->mixOutput(out[0]+pos,out[1]+pos,oscBuf[0]+oscWritePos,oscBuf[1]+oscWritePos,len,mono);
+    pos+=len;
+    oscWritePos+=len;
+    if (oscWritePos>=32768) oscWritePos=0;
+  }
+  oscSize=size;
+}
+
 void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsigned int size) {
+  if (size>blip_max_frame) {
+    nextBufSplit(in,out,inChans,outChans,size);
+    return;
+  }
+
   if (out!=NULL) {
     memset(out[0],0,size*sizeof(float));
     memset(out[1],0,size*sizeof(float));
@@ -1683,6 +1746,13 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
   }
   got.bufsize=size;
 
+  std::chrono::steady_clock::time_point profStart;
+  double profTick=0;
+  if (profiling) profStart=std::chrono::steady_clock::now();
+
+  // apply edits made since the last buffer
+  processLiveEvents();
+
   // process MIDI events (TODO: everything)
   if (output) if (output->midiIn) while (!output->midiIn->queue.empty()) {
     TAMidiMessage& msg=output->midiIn->queue.front();
@@ -1695,7 +1765,7 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
           if (midiIsDirect) {
             pendingNotes.push(DivNoteEvent(chan,-1,-1,-1,false));
           } else {
-            autoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
+            doAutoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
           }
           if (!playing) {
             reset();
@@ -1710,13 +1780,13 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
             if (midiIsDirect) {
               pendingNotes.push(DivNoteEvent(chan,-1,-1,-1,false));
             } else {
-              autoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
+              doAutoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
             }
           } else {
             if (midiIsDirect) {
               pendingNotes.push(DivNoteEvent(chan,ins,msg.data[0]-12,msg.data[1],true));
             } else {
-              autoNoteOn(msg.type&15,ins,msg.data[0]-12,msg.data[1]);
+              doAutoNoteOn(msg.type&15,ins,msg.data[0]-12,msg.data[1]);
             }
           }
           break;
@@ -1786,45 +1856,35 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
 
     blip_end_frame(samp_bb,prevtotal);
     blip_read_samples(samp_bb,samp_bbOut+samp_bbOff,size-samp_bbOff,0);
-    for (size_t i=0; i<size; i++) {
-      out[0][i]+=(float)samp_bbOut[i]/32768.0;
-      out[1][i]+=(float)samp_bbOut[i]/32768.0;
-    }
+    mixFuncs->mixSystem(out[0],out[1],samp_bbOut,samp_bbOut,1.0f,1.0f,size);
   }
 
   if (!playing) {
     if (out!=NULL) {
-      for (unsigned int i=0; i<size; i++) {
-        oscBuf[0][oscWritePos]=out[0][i];
-        oscBuf[1][oscWritePos]=out[1][i];
-        if (++oscWritePos>=32768) oscWritePos=0;
-      }
-      oscSize=size;
+      mixOutput(out,size,false);
     }
     isBusy.unlock();
     return;
   }
 
   // logic starts here
-  size_t runtotal[32];
-  size_t runLeft[32];
-  size_t runPos[32];
-  size_t lastAvail[32];
+  if (profiling) profileBegin();
   for (int i=0; i<song.systemLen; i++) {
-    lastAvail[i]=blip_samples_avail(disCont[i].bb[0]);
-    if (lastAvail[i]>0) {
-      disCont[i].flush(lastAvail[i]);
+    DivDispatchContainer& dc=disCont[i];
+    dc.lastAvail=blip_samples_avail(dc.bb[0]);
+    if (dc.lastAvail>0) {
+      dc.flush(dc.lastAvail);
     }
-    runtotal[i]=blip_clocks_needed(disCont[i].bb[0],size-lastAvail[i]);
-    if (runtotal[i]>disCont[i].bbInLen) {
-      delete disCont[i].bbIn[0];
-      delete disCont[i].bbIn[1];
-      disCont[i].bbIn[0]=new short[runtotal[i]+256];
-      disCont[i].bbIn[1]=new short[runtotal[i]+256];
-      disCont[i].bbInLen=runtotal[i]+256;
+    dc.runtotal=blip_clocks_needed(dc.bb[0],size-dc.lastAvail);
+    if (dc.runtotal>dc.bbInLen) {
+      delete dc.bbIn[0];
+      delete dc.bbIn[1];
+      dc.bbIn[0]=new short[dc.runtotal+256];
+      dc.bbIn[1]=new short[dc.runtotal+256];
+      dc.bbInLen=dc.runtotal+256;
     }
-    runLeft[i]=runtotal[i];
-    runPos[i]=0;
+    dc.runLeft=dc.runtotal;
+    dc.runPos=0;
   }
 
   if (metroTickLen<size) {
@@ -1856,7 +1916,14 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
           if ((curRow%song.hilightB)==0 && ticks==1) metroTick[realPos]=2;
         }
       }
-      if (nextTick()) {
+      std::chrono::steady_clock::time_point tickStart;
+      if (profiling) tickStart=std::chrono::steady_clock::now();
+      bool wasPlaying=playing;
+      bool songEnded=nextTick();
+      if (profiling) profTick+=std::chrono::duration<double>(std::chrono::steady_clock::now()-tickStart).count();
+      // stopped by FFxx
+      if (wasPlaying && !playing) break;
+      if (songEnded) {
         if (remainingLoops>0) {
           remainingLoops--;
           if (!remainingLoops) {
@@ -1869,14 +1936,21 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
           }
         }
       }
+      // the writes of this tick happen at its position in the buffer
+      if (regLog!=NULL) flushRegLog(size-(runLeftG>>MASTER_CLOCK_PREC));
     } else {
       // 3. tick the clock and fill buffers as needed
+      // each system renders its slice up to the next tick on its own.
+      // the render pool runs these in parallel (or in place if disabled).
       if (cycles<runLeftG) {
         for (int i=0; i<song.systemLen; i++) {
-          int total=(cycles*runtotal[i])/(size<<MASTER_CLOCK_PREC);
-          disCont[i].acquire(runPos[i],total);
-          runLeft[i]-=total;
-          runPos[i]+=total;
+          disCont[i].runNext=(cycles*disCont[i].runtotal)/(size<<MASTER_CLOCK_PREC);
+          renderPool->push(_acquireContainer,&disCont[i]);
+        }
+        renderPool->wait();
+        for (int i=0; i<song.systemLen; i++) {
+          disCont[i].runLeft-=disCont[i].runNext;
+          disCont[i].runPos+=disCont[i].runNext;
         }
         runLeftG-=cycles;
         cycles=0;
@@ -1884,13 +1958,19 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
         cycles-=runLeftG;
         runLeftG=0;
         for (int i=0; i<song.systemLen; i++) {
-          disCont[i].acquire(runPos[i],runLeft[i]);
-          runLeft[i]=0;
+          disCont[i].runNext=disCont[i].runLeft;
+          renderPool->push(_acquireContainer,&disCont[i]);
+        }
+        renderPool->wait();
+        for (int i=0; i<song.systemLen; i++) {
+          disCont[i].runLeft=0;
         }
       }
     }
   }
 
+  if (regLog!=NULL) regLogPos+=size-(runLeftG>>MASTER_CLOCK_PREC);
+
   if (out==NULL || halted) {
     isBusy.unlock();
     return;
@@ -1905,26 +1985,32 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
   }
   totalProcessed=size-(runLeftG>>MASTER_CLOCK_PREC);
 
+  // publish the per-channel outputs
+  if (chanOscUsers>0) {
+    for (int i=0; i<chans; i++) {
+      DivDispatchOscBuffer* buf=disCont[dispatchOfChan[i]].dispatch->getOscBuffer(dispatchChanOfChan[i]);
+      if (buf==NULL) continue;
+      buf->rate=disCont[dispatchOfChan[i]].dispatch->rate;
+      buf->readNeedle.store(buf->needle,std::memory_order_release);
+    }
+  }
+
   for (int i=0; i<song.systemLen; i++) {
-    disCont[i].fillBuf(runtotal[i],lastAvail[i],size-lastAvail[i]);
+    disCont[i].runNext=size-disCont[i].lastAvail;
+    renderPool->push(_fillBufContainer,&disCont[i]);
   }
+  renderPool->wait();
+
+  std::chrono::steady_clock::time_point mixStart;
+  if (profiling) mixStart=std::chrono::steady_clock::now();
 
   for (int i=0; i<song.systemLen; i++) {
     float volL=((float)song.systemVol[i]/64.0f)*((float)MIN(127,127-(int)song.systemPan[i])/127.0f)*song.masterVol;
     float volR=((float)song.systemVol[i]/64.0f)*((float)MIN(127,127+(int)song.systemPan[i])/127.0f)*song.masterVol;
     volL*=disCont[i].dispatch->getPostAmp();
     volR*=disCont[i].dispatch->getPostAmp();
-    if (disCont[i].dispatch->isStereo()) {
-      for (size_t j=0; j<size; j++) {
-        out[0][j]+=((float)disCont[i].bbOut[0][j]/32768.0)*volL;
-        out[1][j]+=((float)disCont[i].bbOut[1][j]/32768.0)*volR;
-      }
-    } else {
-      for (size_t j=0; j<size; j++) {
-        out[0][j]+=((float)disCont[i].bbOut[0][j]/32768.0)*volL;
-        out[1][j]+=((float)disCont[i].bbOut[0][j]/32768.0)*volR;
-      }
-    }
+    short* inR=disCont[i].bbOut[disCont[i].dispatch->isStereo()?1:0];
+    mixFuncs->mixSystem(out[0],out[1],disCont[i].bbOut[0],inR,volL,volR,size);
   }
 
   if (metronome) for (size_t i=0; i<size; i++) {
@@ -1947,18 +2033,16 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
     while (metroPos>=1) metroPos--;
   }
 
-  for (unsigned int i=0; i<size; i++) {
-    oscBuf[0][oscWritePos]=out[0][i];
-    oscBuf[1][oscWritePos]=out[1][i];
-    if (++oscWritePos>=32768) oscWritePos=0;
-  }
-  oscSize=size;
+  mixOutput(out,size,forceMono);
 
-  if (forceMono) {
-    for (size_t i=0; i<size; i++) {
-      out[0][i]=(out[0][i]+out[1][i])*0.5;
-      out[1][i]=out[0][i];
-    }
+  if (profiling) {
+    std::chrono::steady_clock::time_point profEnd=std::chrono::steady_clock::now();
+    profileEnd(
+      size,
+      std::chrono::duration<double>(profEnd-profStart).count(),
+      profTick,
+      std::chrono::duration<double>(profEnd-mixStart).count()
+    );
   }
   isBusy.unlock();
 }
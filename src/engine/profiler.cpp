@@ -0,0 +1,145 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "engine.h"
+#include "../ta-log.h"
+
+void DivProfileTime::put(double t) {
+  total+=t;
+  if (empty) {
+    avgVal=t;
+    empty=false;
+  } else {
+    avgVal+=(t-avgVal)*DIV_PROFILE_SMOOTH;
+  }
+  if (t>curPeak) curPeak=t;
+  if (t>highest) highest=t;
+  avg.store(avgVal,std::memory_order_relaxed);
+  peak.store(MAX(curPeak,lastPeak),std::memory_order_relaxed);
+}
+
+void DivProfileTime::nextWindow() {
+  lastPeak=curPeak;
+  curPeak=0;
+}
+
+void DivProfileTime::reset() {
+  avg.store(0,std::memory_order_relaxed);
+  peak.store(0,std::memory_order_relaxed);
+  total=0;
+  highest=0;
+  avgVal=0;
+  curPeak=0;
+  lastPeak=0;
+  empty=true;
+}
+
+void DivProfile::reset() {
+  for (int i=0; i<32; i++) {
+    acquire[i].reset();
+    fill[i].reset();
+  }
+  tick.reset();
+  mix.reset();
+  total.reset();
+  load.reset();
+  overruns.store(0,std::memory_order_relaxed);
+  buffers.store(0,std::memory_order_relaxed);
+  audioTime=0;
+  windowTime=0;
+}
+
+void DivEngine::profileBegin() {
+  for (int i=0; i<song.systemLen; i++) {
+    profile.acquireStart[i]=disCont[i].acquireTime;
+    profile.fillStart[i]=disCont[i].fillTime;
+  }
+}
+
+void DivEngine::profileEnd(unsigned int size, double totalTime, double tickTime, double mixTime) {
+  if (got.rate<=0) return;
+  double duration=(double)size/got.rate;
+
+  profile.windowTime+=duration;
+  if (profile.windowTime>=DIV_PROFILE_PEAK_HOLD) {
+    profile.windowTime=0;
+    for (int i=0; i<song.systemLen; i++) {
+      profile.acquire[i].nextWindow();
+      profile.fill[i].nextWindow();
+    }
+    profile.tick.nextWindow();
+    profile.mix.nextWindow();
+    profile.total.nextWindow();
+    profile.load.nextWindow();
+  }
+
+  for (int i=0; i<song.systemLen; i++) {
+    profile.acquire[i].put(disCont[i].acquireTime-profile.acquireStart[i]);
+    profile.fill[i].put(disCont[i].fillTime-profile.fillStart[i]);
+  }
+  profile.tick.put(tickTime);
+  profile.mix.put(mixTime);
+  profile.total.put(totalTime);
+  profile.load.put(totalTime/duration);
+  if (totalTime>duration) {
+    profile.overruns.fetch_add(1,std::memory_order_relaxed);
+  }
+  profile.buffers.fetch_add(1,std::memory_order_relaxed);
+  profile.audioTime+=duration;
+}
+
+void DivEngine::setProfiling(bool enable) {
+  BUSY_BEGIN;
+  profiling=enable;
+  profile.reset();
+  // containers keep the flag when systems are added later
+  for (int i=0; i<32; i++) {
+    disCont[i].timing=coreTiming || profiling;
+  }
+  BUSY_END;
+}
+
+bool DivEngine::isProfiling() {
+  return profiling;
+}
+
+DivProfile& DivEngine::getProfile() {
+  return profile;
+}
+
+void DivEngine::reportProfile() {
+  double seconds=profile.audioTime;
+  if (seconds<=0) {
+    logW("nothing was profiled.");
+    return;
+  }
+  logI("profile of %.2fs of audio (%d buffers):",seconds,profile.buffers.load());
+  logI("- sequencer: %.2fms per second (peak %.3fms per buffer)",1000.0*profile.tick.total/seconds,1000.0*profile.tick.highest);
+  for (int i=0; i<song.systemLen; i++) {
+    logI("- %s: %.2fms per second in the core (peak %.3fms per buffer), %.2fms per second resampling",
+      getSystemName(song.system[i]),
+      1000.0*profile.acquire[i].total/seconds,
+      1000.0*profile.acquire[i].highest,
+      1000.0*profile.fill[i].total/seconds
+    );
+  }
+  logI("- mixing: %.2fms per second",1000.0*profile.mix.total/seconds);
+  logI("- total: %.2fms per second (%.1fx realtime)",1000.0*profile.total.total/seconds,(profile.total.total>0)?(seconds/profile.total.total):0.0);
+  logI("- buffers over their deadline: %d (peak load %.0f%%)",profile.overruns.load(),100.0*profile.load.highest);
+}
@@ -0,0 +1,95 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+#include <atomic>
+
+// how quickly the averages follow new buffers
+#define DIV_PROFILE_SMOOTH 0.05
+// how long a peak is held for, in seconds of audio
+#define DIV_PROFILE_PEAK_HOLD 2.0
+
+/**
+ * a CPU time measured once per buffer.
+ * only the audio thread writes it. avg and peak may be read from any thread.
+ */
+struct DivProfileTime {
+  // in seconds
+  std::atomic<float> avg, peak;
+  // sum and highest value since profiling started, in seconds
+  double total, highest;
+  double avgVal, curPeak, lastPeak;
+  bool empty;
+
+  void put(double t);
+  // start a new peak hold window
+  void nextWindow();
+  void reset();
+  DivProfileTime():
+    avg(0),
+    peak(0),
+    total(0),
+    highest(0),
+    avgVal(0),
+    curPeak(0),
+    lastPeak(0),
+    empty(true) {}
+};
+
+/**
+ * where the audio thread spends its time, per system and per stage.
+ */
+struct DivProfile {
+  // dispatch acquire() (the chip cores)
+  DivProfileTime acquire[32];
+  // resampling the core output into the system buffer
+  DivProfileTime fill[32];
+  // the sequencer (nextTick() and processRow())
+  DivProfileTime tick;
+  // mixing the systems and the metronome
+  DivProfileTime mix;
+  // the whole buffer
+  DivProfileTime total;
+  // time taken to render a buffer divided by its duration
+  DivProfileTime load;
+  // buffers which took longer to render than to play
+  std::atomic<unsigned int> overruns;
+  std::atomic<unsigned int> buffers;
+  // seconds of audio profiled
+  double audioTime, windowTime;
+
+  // core times when the current buffer started (audio thread only)
+  double acquireStart[32];
+  double fillStart[32];
+
+  void reset();
+  DivProfile():
+    overruns(0),
+    buffers(0),
+    audioTime(0),
+    windowTime(0) {
+    for (int i=0; i<32; i++) {
+      acquireStart[i]=0;
+      fillStart[i]=0;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "regLog.h"
+#include "../ta-log.h"
+#include "../fileutils.h"
+#include <errno.h>
+#include <string.h>
+
+static void writeVarInt(SafeWriter* w, uint64_t val) {
+  while (val>=0x80) {
+    w->writeC(0x80|(val&0x7f));
+    val>>=7;
+  }
+  w->writeC(val);
+}
+
+void divRegLogPut(SafeWriter* w, uint64_t& lastTime, uint64_t time, unsigned char sys, const DivRegWrite& write) {
+  if (time>lastTime) {
+    w->writeC(0xff);
+    writeVarInt(w,time-lastTime);
+    lastTime=time;
+  }
+  unsigned char head=sys&31;
+  if (write.addr>0xffff) {
+    head|=0x40;
+  } else if (write.addr>0xff) {
+    head|=0x20;
+  }
+  if (write.val>0xff) head|=0x80;
+  w->writeC(head);
+  switch ((head>>5)&3) {
+    case 0:
+      w->writeC(write.addr);
+      break;
+    case 1:
+      w->writeS(write.addr);
+      break;
+    default:
+      w->writeI(write.addr);
+      break;
+  }
+  if (head&0x80) {
+    w->writeS(write.val);
+  } else {
+    w->writeC(write.val);
+  }
+}
+
+bool DivRegLog::read(DivEngine* eng, const unsigned char* buf, size_t len, String& error) {
+  systems.clear();
+  writes.clear();
+  length=0;
+  if (len<13 || memcmp(buf,DIV_REGLOG_MAGIC,4)!=0) {
+    error="not a register log";
+    return false;
+  }
+  unsigned short version=buf[4]|(buf[5]<<8);
+  if (version>DIV_REGLOG_VERSION) {
+    error="this register log is from a newer version";
+    return false;
+  }
+  rate=buf[8]|(buf[9]<<8)|(buf[10]<<16)|((unsigned int)buf[11]<<24);
+  if (rate<=0) {
+    error="invalid rate";
+    return false;
+  }
+  size_t pos=12;
+  int systemCount=buf[pos++];
+  if (pos+systemCount*5>len) {
+    error="register log is truncated";
+    return false;
+  }
+  for (int i=0; i<systemCount; i++) {
+    const unsigned char* s=buf+pos;
+    systems.push_back(DivRegLogSystem(eng->systemFromFileFur(s[0]),s[1]|(s[2]<<8)|(s[3]<<16)|((unsigned int)s[4]<<24)));
+    pos+=5;
+  }
+
+  uint64_t time=0;
+  while (pos<len) {
+    unsigned char head=buf[pos++];
+    if (head==0xff) {
+      uint64_t delta=0;
+      int shift=0;
+      while (true) {
+        if (pos>=len || shift>=64) {
+          error="register log is truncated";
+          return false;
+        }
+        unsigned char next=buf[pos++];
+        delta|=(uint64_t)(next&0x7f)<<shift;
+        shift+=7;
+        if (!(next&0x80)) break;
+      }
+      time+=delta;
+      continue;
+    }
+    size_t addrSize=(head>>5)&3;
+    if (addrSize==3) {
+      error="invalid register log record";
+      return false;
+    }
+    addrSize=1<<addrSize;
+    size_t valSize=(head&0x80)?2:1;
+    if (pos+addrSize+valSize>len) {
+      error="register log is truncated";
+      return false;
+    }
+    DivRegLogWrite w;
+    w.time=time;
+    w.sys=head&31;
+    w.addr=0;
+    for (size_t i=0; i<addrSize; i++) {
+      w.addr|=(unsigned int)buf[pos++]<<(i*8);
+    }
+    w.val=buf[pos++];
+    if (valSize==2) w.val|=buf[pos++]<<8;
+    writes.push_back(w);
+  }
+  length=time;
+  return true;
+}
+
+bool divRegLogDiff(const DivRegLog& a, const DivRegLog& b) {
+  bool ret=true;
+  if (a.rate!=b.rate) {
+    logW("rates differ: %g and %g",a.rate,b.rate);
+    ret=false;
+  }
+  if (a.systems.size()!=b.systems.size()) {
+    logW("system counts differ: %d and %d",(int)a.systems.size(),(int)b.systems.size());
+    ret=false;
+  } else {
+    for (size_t i=0; i<a.systems.size(); i++) {
+      if (a.systems[i].sys!=b.systems[i].sys || a.systems[i].flags!=b.systems[i].flags) {
+        logW("system %d differs",(int)i);
+        ret=false;
+      }
+    }
+  }
+  size_t count=MIN(a.writes.size(),b.writes.size());
+  for (size_t i=0; i<count; i++) {
+    const DivRegLogWrite& wa=a.writes[i];
+    const DivRegLogWrite& wb=b.writes[i];
+    if (wa.time!=wb.time || wa.sys!=wb.sys || wa.addr!=wb.addr || wa.val!=wb.val) {
+      logW("first difference at write %d:",(int)i);
+      logW("- %d: system %d, %.2x=%.2x",wa.time,wa.sys,wa.addr,wa.val);
+      logW("+ %d: system %d, %.2x=%.2x",wb.time,wb.sys,wb.addr,wb.val);
+      return false;
+    }
+  }
+  if (a.writes.size()!=b.writes.size()) {
+    logW("write counts differ: %d and %d",(int)a.writes.size(),(int)b.writes.size());
+    return false;
+  }
+  if (a.length!=b.length) {
+    logW("lengths differ: %d and %d",a.length,b.length);
+    return false;
+  }
+  return ret;
+}
+
+bool DivRegLogPlayer::load(DivEngine* eng, const unsigned char* buf, size_t len, double outRate) {
+  quitChips();
+  pos=0;
+  if (!log.read(eng,buf,len,lastError)) return false;
+  parent=eng;
+  rate=outRate;
+  eventRate=log.rate;
+  for (DivRegLogSystem& i: log.systems) {
+    if (addChip(i.sys,i.flags)<0) {
+      logW("register log has too many systems!");
+      break;
+    }
+  }
+  return true;
+}
+
+double DivRegLogPlayer::runEvents() {
+  while (pos<log.writes.size() && log.writes[pos].time<=eventTime) {
+    const DivRegLogWrite& w=log.writes[pos++];
+    // skip the sample commands and resets which only VGM export understands
+    if (w.addr>=0xffff0000) continue;
+    if (w.sys<chipCount) disCont[w.sys].dispatch->poke(w.addr,w.val);
+  }
+  if (pos<log.writes.size()) return log.writes[pos].time;
+  // run until the end of the log
+  if (eventTime<log.length) return log.length;
+  return -1;
+}
+
+const DivRegLog& DivRegLogPlayer::getLog() {
+  return log;
+}
+
+bool DivEngine::startRegLog(const char* path) {
+  FILE* f=ps_fopen(path,"wb");
+  if (f==NULL) {
+    lastError=fmt::sprintf("could not open file! (%s)",strerror(errno));
+    return false;
+  }
+  BUSY_BEGIN;
+  if (regLog!=NULL) finishRegLog();
+  regLogFile=f;
+  regLog=new SafeWriter;
+  regLog->init();
+  regLog->write(DIV_REGLOG_MAGIC,4);
+  regLog->writeS(DIV_REGLOG_VERSION);
+  regLog->writeS(0);
+  regLog->writeI(got.rate);
+  regLog->writeC(song.systemLen);
+  for (int i=0; i<song.systemLen; i++) {
+    regLog->writeC(systemToFileFur(song.system[i]));
+    regLog->writeI(song.systemFlags[i]);
+    if (disCont[i].dispatch!=NULL) {
+      disCont[i].dispatch->getRegisterWrites().clear();
+      disCont[i].dispatch->toggleRegisterDump(true);
+    }
+  }
+  regLogPos=0;
+  regLogLastTime=0;
+  BUSY_END;
+  logI("capturing register writes to %s.",path);
+  return true;
+}
+
+void DivEngine::flushRegLog(size_t offset) {
+  for (int i=0; i<song.systemLen; i++) {
+    if (disCont[i].dispatch==NULL) continue;
+    std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
+    for (DivRegWrite& j: writes) {
+      divRegLogPut(regLog,regLogLastTime,regLogPos+offset,i,j);
+    }
+    writes.clear();
+  }
+}
+
+bool DivEngine::finishRegLog() {
+  if (regLog==NULL) return false;
+  flushRegLog(0);
+  // mark the end
+  if (regLogPos>regLogLastTime) {
+    regLog->writeC(0xff);
+    writeVarInt(regLog,regLogPos-regLogLastTime);
+  }
+  for (int i=0; i<song.systemLen; i++) {
+    if (disCont[i].dispatch!=NULL) {
+      disCont[i].dispatch->toggleRegisterDump(false);
+    }
+  }
+  bool ret=true;
+  if (fwrite(regLog->getFinalBuf(),1,regLog->size(),regLogFile)!=regLog->size()) {
+    logE("could not write register log! %s",strerror(errno));
+    lastError="could not write register log";
+    ret=false;
+  }
+  fclose(regLogFile);
+  regLogFile=NULL;
+  logI("register log written (%d bytes).",(int)regLog->size());
+  regLog->finish();
+  delete regLog;
+  regLog=NULL;
+  return ret;
+}
+
+bool DivEngine::stopRegLog() {
+  BUSY_BEGIN;
+  if (regLog==NULL) {
+    BUSY_END;
+    lastError="not capturing register writes";
+    return false;
+  }
+  bool ret=finishRegLog();
+  BUSY_END;
+  return ret;
+}
@@ -0,0 +1,115 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _REGLOG_H
+#define _REGLOG_H
+#include "chipPlayer.h"
+#include <vector>
+
+#define DIV_REGLOG_MAGIC "FRLG"
+#define DIV_REGLOG_VERSION 1
+
+/*
+ * register log format (little-endian):
+ * - "FRLG"
+ * - version (2 bytes) and reserved (2 bytes)
+ * - rate the times are in (4 bytes)
+ * - system count (1 byte), then for each system its .fur ID (1 byte) and
+ *   flags (4 bytes)
+ * - records until the end of the file. each starts with a header byte:
+ *   - 0xff: time advance. followed by the number of samples as a varint
+ *     (7 bits per byte, low bits first, bit 7 set if more bytes follow).
+ *   - otherwise a register write:
+ *     - bits 0-4: system
+ *     - bits 5-6: address size (0: 1 byte, 1: 2 bytes, 2: 4 bytes)
+ *     - bit 7: value is 2 bytes (1 byte otherwise)
+ *     - followed by the address and the value.
+ */
+
+struct DivRegLogSystem {
+  DivSystem sys;
+  unsigned int flags;
+  DivRegLogSystem(DivSystem s, unsigned int f):
+    sys(s),
+    flags(f) {}
+};
+
+struct DivRegLogWrite {
+  // in samples since the start of the log
+  uint64_t time;
+  unsigned int addr;
+  unsigned short val;
+  unsigned char sys;
+};
+
+/**
+ * a decoded register log.
+ */
+struct DivRegLog {
+  double rate;
+  std::vector<DivRegLogSystem> systems;
+  std::vector<DivRegLogWrite> writes;
+  // time of the last record, including a trailing time advance
+  uint64_t length;
+
+  bool read(DivEngine* eng, const unsigned char* buf, size_t len, String& error);
+  DivRegLog():
+    rate(44100),
+    length(0) {}
+};
+
+/**
+ * encode a register write. lastTime is the time of the previous record.
+ */
+void divRegLogPut(SafeWriter* w, uint64_t& lastTime, uint64_t time, unsigned char sys, const DivRegWrite& write);
+
+/**
+ * compare two register logs and print where they differ.
+ * @return true if they contain the same writes.
+ */
+bool divRegLogDiff(const DivRegLog& a, const DivRegLog& b);
+
+/**
+ * replays a register log into the chip cores, without the sequencer.
+ */
+class DivRegLogPlayer: public DivChipPlayer {
+  DivRegLog log;
+  size_t pos;
+
+  protected:
+    double runEvents();
+
+  public:
+    /**
+     * load a register log and set up its systems.
+     * @param eng the engine the dispatches are initialized with.
+     * @param buf the log data.
+     * @param len the log length.
+     * @param outRate the output rate.
+     */
+    bool load(DivEngine* eng, const unsigned char* buf, size_t len, double outRate);
+
+    // get the decoded log.
+    const DivRegLog& getLog();
+
+    DivRegLogPlayer():
+      pos(0) {}
+};
+
+#endif
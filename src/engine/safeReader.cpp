@@ -22,21 +22,28 @@
 
 //#define READ_DEBUG
 
+bool SafeReader::fill(size_t until) {
+  if (source==NULL) return false;
+  source->fill(until,buf,len);
+  return until<=len;
+}
+
 bool SafeReader::seek(ssize_t where, int whence) {
   switch (whence) {
     case SEEK_SET:
       if (where<0) return false;
-      if (where>(ssize_t)len) return false;
+      if (where>(ssize_t)len && !fill(where)) return false;
       curSeek=where;
       break;
     case SEEK_CUR: {
       ssize_t finalSeek=curSeek+where;
       if (finalSeek<0) return false;
-      if (finalSeek>(ssize_t)len) return false;
+      if (finalSeek>(ssize_t)len && !fill(finalSeek)) return false;
       curSeek=finalSeek;
       break;
     }
     case SEEK_END: {
+      fill(SIZE_MAX);
       ssize_t finalSeek=len-where;
       if (finalSeek<0) return false;
       if (finalSeek>(ssize_t)len) return false;
@@ -52,6 +59,7 @@ size_t SafeReader::tell() {
 }
 
 size_t SafeReader::size() {
+  fill(SIZE_MAX);
   return len;
 }
 
@@ -60,7 +68,7 @@ int SafeReader::read(void* where, size_t count) {
   logD("SR: reading %d bytes at %x",count,curSeek);
 #endif
   if (count==0) return 0;
-  if (curSeek+count>len) throw EndOfFileException(this,len);
+  if (curSeek+count>len && !fill(curSeek+count)) throw EndOfFileException(this,len);
   memcpy(where,&buf[curSeek],count);
   curSeek+=count;
   return count;
@@ -70,7 +78,7 @@ signed char SafeReader::readC() {
 #ifdef READ_DEBUG
   logD("SR: reading char %x:",curSeek);
 #endif
-  if (curSeek+1>len) throw EndOfFileException(this,len);
+  if (curSeek+1>len && !fill(curSeek+1)) throw EndOfFileException(this,len);
 #ifdef READ_DEBUG
   logD("SR: %.2x",buf[curSeek]);
 #endif
@@ -81,7 +89,7 @@ short SafeReader::readS() {
 #ifdef READ_DEBUG
   logD("SR: reading short %x:",curSeek);
 #endif
-  if (curSeek+2>len) throw EndOfFileException(this,len);
+  if (curSeek+2>len && !fill(curSeek+2)) throw EndOfFileException(this,len);
   short ret=*(short*)(&buf[curSeek]);
 #ifdef READ_DEBUG
   logD("SR: %.4x",ret);
@@ -91,7 +99,7 @@ short SafeReader::readS() {
 }
 
 short SafeReader::readS_BE() {
-  if (curSeek+2>len) throw EndOfFileException(this,len);
+  if (curSeek+2>len && !fill(curSeek+2)) throw EndOfFileException(this,len);
   short ret=*(short*)(&buf[curSeek]);
   curSeek+=2;
   return ((ret>>8)&0xff)|(ret<<8);
@@ -101,7 +109,7 @@ int SafeReader::readI() {
 #ifdef READ_DEBUG
   logD("SR: reading int %x:",curSeek);
 #endif
-  if (curSeek+4>len) throw EndOfFileException(this,len);
+  if (curSeek+4>len && !fill(curSeek+4)) throw EndOfFileException(this,len);
   int ret=*(int*)(&buf[curSeek]);
   curSeek+=4;
 #ifdef READ_DEBUG
@@ -111,28 +119,28 @@ int SafeReader::readI() {
 }
 
 int SafeReader::readI_BE() {
-  if (curSeek+4>len) throw EndOfFileException(this,len);
+  if (curSeek+4>len && !fill(curSeek+4)) throw EndOfFileException(this,len);
   unsigned int ret=*(unsigned int*)(&buf[curSeek]);
   curSeek+=4;
   return (int)((ret>>24)|((ret&0xff0000)>>8)|((ret&0xff00)<<8)|((ret&0xff)<<24));
 }
 
 int64_t SafeReader::readL() {
-  if (curSeek+8>len) throw EndOfFileException(this,len);
+  if (curSeek+8>len && !fill(curSeek+8)) throw EndOfFileException(this,len);
   int64_t ret=*(int64_t*)(&buf[curSeek]);
   curSeek+=8;
   return ret;
 }
 
 float SafeReader::readF() {
-  if (curSeek+4>len) throw EndOfFileException(this,len);
+  if (curSeek+4>len && !fill(curSeek+4)) throw EndOfFileException(this,len);
   float ret=*(float*)(&buf[curSeek]);
   curSeek+=4;
   return ret;
 }
 
 double SafeReader::readD() {
-  if (curSeek+8>len) throw EndOfFileException(this,len);
+  if (curSeek+8>len && !fill(curSeek+8)) throw EndOfFileException(this,len);
   double ret=*(double*)(&buf[curSeek]);
   curSeek+=8;
   return ret;
@@ -31,6 +31,19 @@ enum Endianness {
 
 class SafeReader;
 
+// supplies data to a SafeReader as it is needed, e.g. while decompressing.
+class SafeReaderSource {
+  public:
+    /**
+     * make the first until bytes available, or all of them if there are fewer.
+     * @param until how many bytes are needed. SIZE_MAX means everything.
+     * @param buf the data. may be moved.
+     * @param len how many bytes are available.
+     */
+    virtual void fill(size_t until, unsigned char*& buf, size_t& len)=0;
+    virtual ~SafeReaderSource() {}
+};
+
 struct EndOfFileException {
   SafeReader* reader;
   size_t finalSize;
@@ -44,10 +57,15 @@ class SafeReader {
   size_t len;
 
   size_t curSeek;
+  SafeReaderSource* source;
+
+  // ask the source for more data. returns whether until bytes are available.
+  bool fill(size_t until);
 
   public:
     bool seek(ssize_t where, int whence);
     size_t tell();
+    // when reading from a source, this reads all remaining data first.
     size_t size();
 
     int read(void* where, size_t count);
@@ -70,7 +88,15 @@ class SafeReader {
     SafeReader(void* b, size_t l):
       buf((unsigned char*)b),
       len(l),
-      curSeek(0) {}
+      curSeek(0),
+      source(NULL) {}
+
+    // read data from a source as it comes in. the source owns the buffer.
+    SafeReader(SafeReaderSource* s):
+      buf(NULL),
+      len(0),
+      curSeek(0),
+      source(s) {}
 };
 
 #endif
@@ -22,7 +22,22 @@
 #include <math.h>
 #include <string.h>
 #include <sndfile.h>
+#include <zlib.h>
 #include "filter.h"
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define DIV_RESAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define DIV_RESAMPLE_NEON
+#include <arm_neon.h>
+#endif
 
 extern "C" {
 #include "../../extern/adpcm/bs_codec.h"
@@ -332,120 +347,262 @@ bool DivSample::insert(unsigned int pos, unsigned int length) {
     delete[] oldData8; \
   }
 
-bool DivSample::resampleNone(double r) {
-  RESAMPLE_BEGIN;
+// resampling kernels.
+// these are shared by 8 and 16-bit samples. sinc, cubic and no interpolation
+// can start at any output position, so long samples are split into chunks
+// which are resampled on several threads.
+
+// output samples per chunk
+#define RESAMPLE_CHUNK 65536
+
+// maximum number of resampling threads (0 means one per core)
+static unsigned int resampleThreadLimit=0;
+
+template<typename F> static void resampleParallel(int count, F& func) {
+  int chunks=(count+RESAMPLE_CHUNK-1)/RESAMPLE_CHUNK;
+  unsigned int threadCount=std::thread::hardware_concurrency();
+  if (resampleThreadLimit>0 && threadCount>resampleThreadLimit) threadCount=resampleThreadLimit;
+  if (threadCount>(unsigned int)chunks) threadCount=chunks;
+  if (threadCount<2) {
+    func(0,count);
+    return;
+  }
 
-  if (depth==16) {
-    for (int i=0; i<finalCount; i++) {
-      unsigned int pos=(unsigned int)((double)i*((double)rate/r));
-      if (pos>=samples) {
-        data16[i]=0;
-      } else {
-        data16[i]=oldData16[pos];
-      }
-    }
-  } else if (depth==8) {
-    for (int i=0; i<finalCount; i++) {
-      unsigned int pos=(unsigned int)((double)i*((double)rate/r));
-      if (pos>=samples) {
-        data8[i]=0;
-      } else {
-        data8[i]=oldData8[pos];
-      }
+  std::atomic<int> nextChunk(0);
+  auto worker=[&]() {
+    int c;
+    while ((c=nextChunk++)<chunks) {
+      int begin=c*RESAMPLE_CHUNK;
+      func(begin,MIN(begin+RESAMPLE_CHUNK,count));
     }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int i=1; i<threadCount; i++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (std::thread& i: threads) {
+    i.join();
   }
+}
 
-  RESAMPLE_END;
-  return true;
+// 16-tap dot product for the sinc filter
+static inline float sincDot(const float* s, const float* t) {
+#if defined(DIV_RESAMPLE_SSE2)
+  __m128 acc=_mm_mul_ps(_mm_loadu_ps(s),_mm_loadu_ps(t));
+  acc=_mm_add_ps(acc,_mm_mul_ps(_mm_loadu_ps(s+4),_mm_loadu_ps(t+4)));
+  acc=_mm_add_ps(acc,_mm_mul_ps(_mm_loadu_ps(s+8),_mm_loadu_ps(t+8)));
+  acc=_mm_add_ps(acc,_mm_mul_ps(_mm_loadu_ps(s+12),_mm_loadu_ps(t+12)));
+  acc=_mm_add_ps(acc,_mm_movehl_ps(acc,acc));
+  acc=_mm_add_ss(acc,_mm_shuffle_ps(acc,acc,1));
+  return _mm_cvtss_f32(acc);
+#elif defined(DIV_RESAMPLE_NEON)
+  float32x4_t acc=vmulq_f32(vld1q_f32(s),vld1q_f32(t));
+  acc=vmlaq_f32(acc,vld1q_f32(s+4),vld1q_f32(t+4));
+  acc=vmlaq_f32(acc,vld1q_f32(s+8),vld1q_f32(t+8));
+  acc=vmlaq_f32(acc,vld1q_f32(s+12),vld1q_f32(t+12));
+  float32x2_t sum=vadd_f32(vget_low_f32(acc),vget_high_f32(acc));
+  return vget_lane_f32(vpadd_f32(sum,sum),0);
+#else
+  float acc[4]={0,0,0,0};
+  for (int j=0; j<16; j+=4) {
+    acc[0]+=s[j]*t[j];
+    acc[1]+=s[j+1]*t[j+1];
+    acc[2]+=s[j+2]*t[j+2];
+    acc[3]+=s[j+3]*t[j+3];
+  }
+  return (acc[0]+acc[1])+(acc[2]+acc[3]);
+#endif
 }
 
-bool DivSample::resampleLinear(double r) {
-  RESAMPLE_BEGIN;
+template<typename T> static void resampleNoneT(const T* in, unsigned int len, T* out, int outCount, double factor) {
+  auto chunk=[&](int begin, int end) {
+    for (int i=begin; i<end; i++) {
+      unsigned int pos=(unsigned int)((double)i*factor);
+      out[i]=(pos>=len)?0:in[pos];
+    }
+  };
+  resampleParallel(outCount,chunk);
+}
 
+template<typename T> static void resampleLinearT(const T* in, unsigned int len, int loopStart, T* out, int outCount, double factor) {
   double posFrac=0;
   unsigned int posInt=0;
-  double factor=(double)rate/r;
+  // past the end, interpolate towards the loop start (or silence)
+  short loopVal=(loopStart>=0 && loopStart<(int)len)?in[loopStart]:0;
 
-  if (depth==16) {
-    for (int i=0; i<finalCount; i++) {
-      short s1=(posInt>=samples)?0:oldData16[posInt];
-      short s2=(posInt+1>=samples)?((loopStart>=0 && loopStart<(int)samples)?oldData16[loopStart]:0):oldData16[posInt+1];
+  for (int i=0; i<outCount; i++) {
+    short s1=(posInt>=len)?0:in[posInt];
+    short s2=(posInt+1>=len)?loopVal:in[posInt+1];
+
+    out[i]=s1+(float)(s2-s1)*posFrac;
+
+    posFrac+=factor;
+    while (posFrac>=1.0) {
+      posFrac-=1.0;
+      posInt++;
+    }
+  }
+}
 
-      data16[i]=s1+(float)(s2-s1)*posFrac;
+template<typename T> static void resampleCubicT(const T* in, unsigned int len, int loopStart, T* out, int outCount, double factor, float minVal, float maxVal) {
+  const float* cubicTable=DivFilterTables::getCubicTable();
+  // past the end, interpolate towards the loop start (or silence)
+  float loopVal=(loopStart>=0 && loopStart<(int)len)?in[loopStart]:0;
+
+  auto chunk=[&](int begin, int end) {
+    double posFrac=(double)begin*factor;
+    unsigned int posInt=(unsigned int)posFrac;
+    posFrac-=(double)posInt;
+    for (int i=begin; i<end; i++) {
+      unsigned int n=((unsigned int)(posFrac*1024.0))&1023;
+      const float* t=&cubicTable[n<<2];
+      float s0, s1, s2, s3;
+      if (posInt>=1 && posInt+2<len) {
+        s0=in[posInt-1];
+        s1=in[posInt];
+        s2=in[posInt+1];
+        s3=in[posInt+2];
+      } else {
+        s0=(posInt<1 || posInt-1>=len)?0:in[posInt-1];
+        s1=(posInt>=len)?0:in[posInt];
+        s2=(posInt+1>=len)?loopVal:in[posInt+1];
+        s3=(posInt+2>=len)?loopVal:in[posInt+2];
+      }
+
+      float result=s0*t[0]+s1*t[1]+s2*t[2]+s3*t[3];
+      if (result<minVal) result=minVal;
+      if (result>maxVal) result=maxVal;
+      out[i]=result;
 
       posFrac+=factor;
-      while (posFrac>=1.0) {
-        posFrac-=1.0;
-        posInt++;
+      if (posFrac>=1.0) {
+        unsigned int step=(unsigned int)posFrac;
+        posFrac-=(double)step;
+        posInt+=step;
       }
     }
-  } else if (depth==8) {
-    for (int i=0; i<finalCount; i++) {
-      short s1=(posInt>=samples)?0:oldData8[posInt];
-      short s2=(posInt+1>=samples)?((loopStart>=0 && loopStart<(int)samples)?oldData8[loopStart]:0):oldData8[posInt+1];
+  };
+  resampleParallel(outCount,chunk);
+}
+
+// band-limited steps are added to the neighbours of each output sample, so
+// this one runs on a single thread.
+template<typename T> static void resampleBlepT(const T* in, unsigned int len, T* out, int outCount, double factor, int minVal, int maxVal) {
+  const float* sincITable=DivFilterTables::getSincIntegralTable();
+  double posFrac=0;
+  unsigned int posInt=0;
+
+  memset(out,0,outCount*sizeof(T));
+  for (int i=0; i<outCount; i++) {
+    if (posInt<len) {
+      int result=out[i]+in[posInt];
+      if (result<minVal) result=minVal;
+      if (result>maxVal) result=maxVal;
+      out[i]=result;
+    }
+
+    posFrac+=1.0;
+    while (posFrac>=1.0) {
+      unsigned int n=((unsigned int)(posFrac*8192.0))&8191;
+      posFrac-=factor;
+      posInt++;
 
-      data8[i]=s1+(float)(s2-s1)*posFrac;
+      const float* t1=&sincITable[(8191-n)<<3];
+      const float* t2=&sincITable[n<<3];
+      float delta=(float)((posInt<len)?in[posInt]:0)-(float)((posInt-1<len)?in[posInt-1]:0);
+
+      for (int j=0; j<8; j++) {
+        if (i-j>0) {
+          float result=out[i-j]+t1[j]*-delta;
+          if (result<minVal) result=minVal;
+          if (result>maxVal) result=maxVal;
+          out[i-j]=result;
+        }
+        if (i+j+1<outCount) {
+          float result=out[i+j+1]+t2[j]*delta;
+          if (result<minVal) result=minVal;
+          if (result>maxVal) result=maxVal;
+          out[i+j+1]=result;
+        }
+      }
+    }
+  }
+}
+
+template<typename T> static void resampleSincT(const T* in, unsigned int len, T* out, int outCount, double factor, float minVal, float maxVal) {
+  const float* taps=DivFilterTables::getSincPolyphaseTable();
+
+  // the window for output sample i covers the 16 input samples up to
+  // (i+8)*factor.
+  auto chunk=[&](int begin, int end) {
+    double posFrac=(double)(begin+8)*factor;
+    long long posInt=(long long)posFrac;
+    posFrac-=(double)posInt;
+
+    // convert the input this chunk reads to float, with silence around it.
+    // one sample of headroom in case the position drifts while stepping.
+    long long lo=posInt-15;
+    long long hi=(long long)((double)(end+7)*factor)+1;
+    std::vector<float> buf(hi-lo+1);
+    for (long long x=lo; x<=hi; x++) {
+      buf[x-lo]=(x<1 || x>=(long long)len)?0.0f:(float)in[x];
+    }
+
+    for (int i=begin; i<end; i++) {
+      unsigned int n=((unsigned int)(posFrac*8192.0))&8191;
+      float result=sincDot(&buf[posInt-15-lo],&taps[n<<4]);
+      if (result<minVal) result=minVal;
+      if (result>maxVal) result=maxVal;
+      out[i]=result;
 
       posFrac+=factor;
-      while (posFrac>=1.0) {
-        posFrac-=1.0;
-        posInt++;
+      if (posFrac>=1.0) {
+        long long step=(long long)posFrac;
+        posFrac-=(double)step;
+        posInt+=step;
       }
     }
+  };
+  resampleParallel(outCount,chunk);
+}
+
+bool DivSample::resampleNone(double r) {
+  RESAMPLE_BEGIN;
+
+  double factor=(double)rate/r;
+  if (depth==16) {
+    resampleNoneT(oldData16,samples,data16,finalCount,factor);
+  } else if (depth==8) {
+    resampleNoneT(oldData8,samples,data8,finalCount,factor);
   }
 
   RESAMPLE_END;
   return true;
 }
 
-bool DivSample::resampleCubic(double r) {
+bool DivSample::resampleLinear(double r) {
   RESAMPLE_BEGIN;
 
-  double posFrac=0;
-  unsigned int posInt=0;
   double factor=(double)rate/r;
-  float* cubicTable=DivFilterTables::getCubicTable();
-
   if (depth==16) {
-    for (int i=0; i<finalCount; i++) {
-      unsigned int n=((unsigned int)(posFrac*1024.0))&1023;
-      float* t=&cubicTable[n<<2];
-      float s0=(posInt<1)?0:oldData16[posInt-1];
-      float s1=(posInt>=samples)?0:oldData16[posInt];
-      float s2=(posInt+1>=samples)?((loopStart>=0 && loopStart<(int)samples)?oldData16[loopStart]:0):oldData16[posInt+1];
-      float s3=(posInt+2>=samples)?((loopStart>=0 && loopStart<(int)samples)?oldData16[loopStart]:0):oldData16[posInt+2];
-
-      float result=s0*t[0]+s1*t[1]+s2*t[2]+s3*t[3];
-      if (result<-32768) result=-32768;
-      if (result>32767) result=32767;
-      data16[i]=result;
-
-      posFrac+=factor;
-      while (posFrac>=1.0) {
-        posFrac-=1.0;
-        posInt++;
-      }
-    }
+    resampleLinearT(oldData16,samples,loopStart,data16,finalCount,factor);
   } else if (depth==8) {
-    for (int i=0; i<finalCount; i++) {
-      unsigned int n=((unsigned int)(posFrac*1024.0))&1023;
-      float* t=&cubicTable[n<<2];
-      float s0=(posInt<1)?0:oldData8[posInt-1];
-      float s1=(posInt>=samples)?0:oldData8[posInt];
-      float s2=(posInt+1>=samples)?((loopStart>=0 && loopStart<(int)samples)?oldData8[loopStart]:0):oldData8[posInt+1];
-      float s3=(posInt+2>=samples)?((loopStart>=0 && loopStart<(int)samples)?oldData8[loopStart]:0):oldData8[posInt+2];
+    resampleLinearT(oldData8,samples,loopStart,data8,finalCount,factor);
+  }
 
-      float result=s0*t[0]+s1*t[1]+s2*t[2]+s3*t[3];
-      if (result<-128) result=-128;
-      if (result>127) result=127;
-      data8[i]=result;
+  RESAMPLE_END;
+  return true;
+}
 
-      posFrac+=factor;
-      while (posFrac>=1.0) {
-        posFrac-=1.0;
-        posInt++;
-      }
-    }
+bool DivSample::resampleCubic(double r) {
+  RESAMPLE_BEGIN;
+
+  double factor=(double)rate/r;
+  if (depth==16) {
+    resampleCubicT(oldData16,samples,loopStart,data16,finalCount,factor,-32768.0f,32767.0f);
+  } else if (depth==8) {
+    resampleCubicT(oldData8,samples,loopStart,data8,finalCount,factor,-128.0f,127.0f);
   }
 
   RESAMPLE_END;
@@ -455,86 +612,11 @@ bool DivSample::resampleCubic(double r) {
 bool DivSample::resampleBlep(double r) {
   RESAMPLE_BEGIN;
 
-  double posFrac=0;
-  unsigned int posInt=0;
   double factor=r/(double)rate;
-  float* sincITable=DivFilterTables::getSincIntegralTable();
-  float s[16];
-
-  memset(s,0,16*sizeof(float));
-
   if (depth==16) {
-    memset(data16,0,finalCount*sizeof(short));
-    for (int i=0; i<finalCount; i++) {
-      if (posInt<samples) {
-        int result=data16[i]+oldData16[posInt];
-        if (result<-32768) result=-32768;
-        if (result>32767) result=32767;
-        data16[i]=result;
-      }
-      
-      posFrac+=1.0;
-      while (posFrac>=1.0) {
-        unsigned int n=((unsigned int)(posFrac*8192.0))&8191;
-        posFrac-=factor;
-        posInt++;
-
-        float* t1=&sincITable[(8191-n)<<3];
-        float* t2=&sincITable[n<<3];
-        float delta=oldData16[posInt]-oldData16[posInt-1];
-
-        for (int j=0; j<8; j++) {
-          if (i-j>0) {
-            float result=data16[i-j]+t1[j]*-delta;
-            if (result<-32768) result=-32768;
-            if (result>32767) result=32767;
-            data16[i-j]=result;
-          }
-          if (i+j+1<finalCount) {
-            float result=data16[i+j+1]+t2[j]*delta;
-            if (result<-32768) result=-32768;
-            if (result>32767) result=32767;
-            data16[i+j+1]=result;
-          }
-        }
-      }
-    }
+    resampleBlepT(oldData16,samples,data16,finalCount,factor,-32768,32767);
   } else if (depth==8) {
-    memset(data8,0,finalCount);
-    for (int i=0; i<finalCount; i++) {
-      if (posInt<samples) {
-        int result=data8[i]+oldData8[posInt];
-        if (result<-128) result=-128;
-        if (result>127) result=127;
-        data8[i]=result;
-      }
-      
-      posFrac+=1.0;
-      while (posFrac>=1.0) {
-        unsigned int n=((unsigned int)(posFrac*8192.0))&8191;
-        posFrac-=factor;
-        posInt++;
-
-        float* t1=&sincITable[(8191-n)<<3];
-        float* t2=&sincITable[n<<3];
-        float delta=oldData8[posInt]-oldData8[posInt-1];
-
-        for (int j=0; j<8; j++) {
-          if (i-j>0) {
-            float result=data8[i-j]+t1[j]*-delta;
-            if (result<-128) result=-128;
-            if (result>127) result=127;
-            data8[i-j]=result;
-          }
-          if (i+j+1<finalCount) {
-            float result=data8[i+j+1]+t2[j]*delta;
-            if (result<-128) result=-128;
-            if (result>127) result=127;
-            data8[i+j+1]=result;
-          }
-        }
-      }
-    }
+    resampleBlepT(oldData8,samples,data8,finalCount,factor,-128,127);
   }
 
   RESAMPLE_END;
@@ -544,68 +626,63 @@ bool DivSample::resampleBlep(double r) {
 bool DivSample::resampleSinc(double r) {
   RESAMPLE_BEGIN;
 
-  double posFrac=0;
-  unsigned int posInt=0;
   double factor=(double)rate/r;
-  float* sincTable=DivFilterTables::getSincTable();
-  float s[16];
+  if (depth==16) {
+    resampleSincT(oldData16,samples,data16,finalCount,factor,-32768.0f,32767.0f);
+  } else if (depth==8) {
+    resampleSincT(oldData8,samples,data8,finalCount,factor,-128.0f,127.0f);
+  }
 
-  memset(s,0,16*sizeof(float));
+  RESAMPLE_END;
+  return true;
+}
 
-  if (depth==16) {
-    for (int i=0; i<finalCount+8; i++) {
-      unsigned int n=((unsigned int)(posFrac*8192.0))&8191;
-      float result=0;
-      float* t1=&sincTable[(8191-n)<<3];
-      float* t2=&sincTable[n<<3];
-      for (int j=0; j<8; j++) {
-        result+=s[j]*t2[7-j];
-        result+=s[8+j]*t1[j];
-      }
-      if (result<-32768) result=-32768;
-      if (result>32767) result=32767;
-      if (i>=8) {
-        data16[i-8]=result;
-      }
-      
-      posFrac+=factor;
-      while (posFrac>=1.0) {
-        posFrac-=1.0;
-        posInt++;
+void divResampleBenchmark(int seconds) {
+  if (seconds<1) seconds=1;
+  const int rateIn=44100;
+  const int rateOut=48000;
+  unsigned int count=seconds*rateIn;
 
-        for (int j=0; j<15; j++) s[j]=s[j+1];
-        s[15]=(posInt>=samples)?0:oldData16[posInt];
-      }
-    }
-  } else if (depth==8) {
-    for (int i=0; i<finalCount+8; i++) {
-      unsigned int n=((unsigned int)(posFrac*8192.0))&8191;
-      float result=0;
-      float* t1=&sincTable[(8191-n)<<3];
-      float* t2=&sincTable[n<<3];
-      for (int j=0; j<8; j++) {
-        result+=s[j]*t2[7-j];
-        result+=s[8+j]*t1[j];
-      }
-      if (result<-128) result=-128;
-      if (result>127) result=127;
-      if (i>=8) {
-        data8[i-8]=result;
-      }
-      
-      posFrac+=factor;
-      while (posFrac>=1.0) {
-        posFrac-=1.0;
-        posInt++;
+  short* source=new short[count];
+  for (unsigned int i=0; i<count; i++) {
+    // a sine plus some noise
+    source[i]=(short)(sin((double)i*0.0314)*16384.0)+(short)(((i*2654435761u)>>20)&2047)-1024;
+  }
 
-        for (int j=0; j<15; j++) s[j]=s[j+1];
-        s[15]=(posInt>=samples)?0:oldData8[posInt];
+  logI("resample benchmark: %d seconds of 16-bit audio, %dHz to %dHz",seconds,rateIn,rateOut);
+
+  const int filters[5]={DIV_RESAMPLE_NONE, DIV_RESAMPLE_LINEAR, DIV_RESAMPLE_CUBIC, DIV_RESAMPLE_BLEP, DIV_RESAMPLE_SINC};
+  const char* filterNames[5]={"none", "linear", "cubic", "blep", "sinc"};
+  // warm the filter tables up first
+  DivFilterTables::getCubicTable();
+  DivFilterTables::getSincIntegralTable();
+  DivFilterTables::getSincPolyphaseTable();
+
+  for (int i=0; i<5; i++) {
+    for (int threads=1; threads>=0; threads--) {
+      DivSample s;
+      s.depth=16;
+      s.rate=rateIn;
+      if (!s.init(count)) {
+        logE("could not allocate sample!");
+        delete[] source;
+        return;
       }
+      memcpy(s.data16,source,count*sizeof(short));
+
+      resampleThreadLimit=threads;
+      std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+      s.resample(rateOut,filters[i]);
+      double elapsed=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+      logI("- %s (%s): %.1fms",filterNames[i],threads?"1 thread":"all threads",elapsed);
+
+      // only these run on several threads
+      if (filters[i]==DIV_RESAMPLE_LINEAR || filters[i]==DIV_RESAMPLE_BLEP) break;
     }
   }
+  resampleThreadLimit=0;
 
-  RESAMPLE_END;
-  return true;
+  delete[] source;
 }
 
 bool DivSample::resample(double r, int filter) {
@@ -739,6 +816,30 @@ void DivSample::render() {
   }
 }
 
+uint64_t DivSample::getDataHash() {
+  // FNV-1a
+  uint64_t hash=0xcbf29ce484222325ULL;
+  unsigned char header[5];
+  header[0]=depth;
+  header[1]=samples&0xff;
+  header[2]=(samples>>8)&0xff;
+  header[3]=(samples>>16)&0xff;
+  header[4]=(samples>>24)&0xff;
+  for (int i=0; i<5; i++) {
+    hash^=header[i];
+    hash*=0x100000001b3ULL;
+  }
+  unsigned char* buf=(unsigned char*)getCurBuf();
+  if (buf!=NULL) {
+    unsigned int len=getCurBufLen();
+    for (unsigned int i=0; i<len; i++) {
+      hash^=buf[i];
+      hash*=0x100000001b3ULL;
+    }
+  }
+  return (hash==0)?1:hash;
+}
+
 void* DivSample::getCurBuf() {
   switch (depth) {
     case 0:
@@ -791,8 +892,27 @@ unsigned int DivSample::getCurBufLen() {
   return 0;
 }
 
+// deltas smaller than this are not worth compressing
+#define UNDO_COMPRESS_MIN 4096
+// maximum number of steps in the undo history
+#define UNDO_MAX_STEPS 100
+
+size_t DivSample::undoBudget=64<<20;
+bool DivSample::undoCompress=true;
+
+static void clearHistory(std::deque<DivSampleHistory*>& hist) {
+  while (!hist.empty()) {
+    delete hist.back();
+    hist.pop_back();
+  }
+}
+
 DivSampleHistory* DivSample::prepareUndo(bool data, bool doNotPush) {
   DivSampleHistory* h;
+  if (!doNotPush && !undoHist.empty()) {
+    // the data is now what the previous step changed it into
+    compactHistory(undoHist.back());
+  }
   if (data) {
     unsigned char* duplicate;
     if (getCurBuf()==NULL) {
@@ -806,35 +926,128 @@ DivSampleHistory* DivSample::prepareUndo(bool data, bool doNotPush) {
     h=new DivSampleHistory(depth,rate,centerRate,loopStart);
   }
   if (!doNotPush) {
-    while (!redoHist.empty()) {
-      DivSampleHistory* h=redoHist.back();
-      delete h;
-      redoHist.pop_back();
-    }
-    if (undoHist.size()>100) undoHist.pop_front();
+    clearHistory(redoHist);
     undoHist.push_back(h);
+    trimHistory();
   }
   return h;
 }
 
-#define applyHistory \
-  depth=h->depth; \
-  if (h->hasSample) { \
-    initInternal(h->depth,h->samples); \
-    samples=h->samples; \
-\
-    if (h->length!=getCurBufLen()) logW("undo buffer length not equal to current buffer length! %d != %d",h->length,getCurBufLen()); \
-\
-    void* buf=getCurBuf(); \
-\
-    if (buf!=NULL && h->data!=NULL) { \
-      memcpy(buf,h->data,h->length); \
-    } \
-  } \
-  rate=h->rate; \
-  centerRate=h->centerRate; \
+void DivSample::compactHistory(DivSampleHistory* h) {
+  if (!h->hasSample || h->isDelta || h->data==NULL) return;
+  unsigned char* cur=(unsigned char*)getCurBuf();
+  unsigned int curLen=(cur==NULL)?0:getCurBufLen();
+  unsigned int maxCommon=MIN(h->length,curLen);
+
+  // find the range which differs
+  unsigned int prefix=0;
+  while (prefix<maxCommon && h->data[prefix]==cur[prefix]) prefix++;
+  unsigned int suffix=0;
+  while (suffix<(maxCommon-prefix) && h->data[h->length-suffix-1]==cur[curLen-suffix-1]) suffix++;
+
+  unsigned int rawLen=h->length-prefix-suffix;
+  unsigned char* delta=NULL;
+  unsigned int deltaLen=rawLen;
+  bool compressed=false;
+  if (rawLen>0) {
+    if (undoCompress && rawLen>=UNDO_COMPRESS_MIN) {
+      uLongf compLen=compressBound(rawLen);
+      unsigned char* comp=new unsigned char[compLen];
+      if (compress2(comp,&compLen,h->data+prefix,rawLen,Z_BEST_SPEED)==Z_OK && compLen<rawLen) {
+        delta=new unsigned char[compLen];
+        memcpy(delta,comp,compLen);
+        deltaLen=compLen;
+        compressed=true;
+      }
+      delete[] comp;
+    }
+    if (!compressed) {
+      delta=new unsigned char[rawLen];
+      memcpy(delta,h->data+prefix,rawLen);
+    }
+  }
+
+  h->bufLength=h->length;
+  h->rawLength=rawLen;
+  h->prefix=prefix;
+  h->afterHash=getDataHash();
+  delete[] h->data;
+  h->data=delta;
+  h->length=deltaLen;
+  h->isCompressed=compressed;
+  h->isDelta=true;
+}
+
+bool DivSample::applyHistory(DivSampleHistory* h) {
+  if (h->hasSample) {
+    unsigned char* restored=h->data;
+    if (h->isDelta) {
+      if (getDataHash()!=h->afterHash) {
+        logW("sample data changed outside of the undo history! can't undo.");
+        return false;
+      }
+      // rebuild the whole buffer from the current data and the delta
+      unsigned char* cur=(unsigned char*)getCurBuf();
+      unsigned int curLen=getCurBufLen();
+      unsigned int suffix=h->bufLength-h->prefix-h->rawLength;
+      restored=new unsigned char[h->bufLength];
+      if (h->prefix>0) memcpy(restored,cur,h->prefix);
+      if (suffix>0) memcpy(restored+h->bufLength-suffix,cur+curLen-suffix,suffix);
+      if (h->isCompressed) {
+        uLongf rawLen=h->rawLength;
+        if (uncompress(restored+h->prefix,&rawLen,h->data,h->length)!=Z_OK || rawLen!=h->rawLength) {
+          logE("could not decompress undo step!");
+          delete[] restored;
+          return false;
+        }
+      } else if (h->rawLength>0) {
+        memcpy(restored+h->prefix,h->data,h->rawLength);
+      }
+    }
+
+    depth=h->depth;
+    initInternal(h->depth,h->samples);
+    samples=h->samples;
+
+    if (h->bufLength!=getCurBufLen()) logW("undo buffer length not equal to current buffer length! %d != %d",h->bufLength,getCurBufLen());
+
+    void* buf=getCurBuf();
+
+    if (buf!=NULL && restored!=NULL) {
+      memcpy(buf,restored,MIN(h->bufLength,getCurBufLen()));
+    }
+    if (restored!=h->data) delete[] restored;
+  } else {
+    depth=h->depth;
+  }
+  rate=h->rate;
+  centerRate=h->centerRate;
   loopStart=h->loopStart;
+  return true;
+}
 
+void DivSample::trimHistory() {
+  // the newest step may still hold a full copy until the next edit turns it
+  // into a delta. it is always kept, so it doesn't count.
+  size_t total=0;
+  for (DivSampleHistory* i: undoHist) {
+    if (i->isDelta) total+=sizeof(DivSampleHistory)+i->length;
+  }
+  for (DivSampleHistory* i: redoHist) total+=sizeof(DivSampleHistory)+i->length;
+  // evict the oldest undo steps first, then the furthest redo steps
+  while ((total>undoBudget || undoHist.size()>UNDO_MAX_STEPS) && undoHist.size()>1) {
+    DivSampleHistory* h=undoHist.front();
+    if (h->isDelta) total-=sizeof(DivSampleHistory)+h->length;
+    delete h;
+    undoHist.pop_front();
+  }
+  while (total>undoBudget && !redoHist.empty() && (redoHist.size()+undoHist.size())>1) {
+    DivSampleHistory* h=redoHist.front();
+    total-=sizeof(DivSampleHistory)+h->length;
+    delete h;
+    redoHist.pop_front();
+  }
+}
 
 int DivSample::undo() {
   if (undoHist.empty()) return 0;
@@ -843,11 +1056,19 @@ int DivSample::undo() {
 
   int ret=h->hasSample?2:1;
 
-  applyHistory;
+  if (!applyHistory(h)) {
+    // the history no longer matches the data
+    delete redo;
+    clearHistory(undoHist);
+    clearHistory(redoHist);
+    return 0;
+  }
+  compactHistory(redo);
 
   redoHist.push_back(redo);
   delete h;
   undoHist.pop_back();
+  trimHistory();
   return ret;
 }
 
@@ -858,11 +1079,19 @@ int DivSample::redo() {
 
   int ret=h->hasSample?2:1;
 
-  applyHistory;
+  if (!applyHistory(h)) {
+    // the history no longer matches the data
+    delete undo;
+    clearHistory(undoHist);
+    clearHistory(redoHist);
+    return 0;
+  }
+  compactHistory(undo);
 
   undoHist.push_back(undo);
   delete h;
   redoHist.pop_back();
+  trimHistory();
   return ret;
 }
 
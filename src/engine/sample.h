@@ -18,6 +18,7 @@
  */
 
 #include "../ta-utils.h"
+#include <stdint.h>
 #include <deque>
 
 enum DivResampleFilters {
@@ -31,10 +32,17 @@ enum DivResampleFilters {
 
 struct DivSampleHistory {
   unsigned char* data;
+  // length is the size of data, which may be compressed.
   unsigned int length, samples;
   unsigned char depth;
   int rate, centerRate, loopStart;
   bool hasSample;
+  // a delta step only keeps the bytes which differ from the state after it.
+  // the first prefix bytes and the ones after rawLength are taken from that
+  // state when undoing, as long as its hash matches afterHash.
+  bool isDelta, isCompressed;
+  unsigned int bufLength, rawLength, prefix;
+  uint64_t afterHash;
   DivSampleHistory(void* d, unsigned int l, unsigned int s, unsigned char de, int r, int cr, int ls):
     data((unsigned char*)d),
     length(l),
@@ -43,7 +51,13 @@ struct DivSampleHistory {
     rate(r),
     centerRate(cr),
     loopStart(ls),
-    hasSample(true) {}
+    hasSample(true),
+    isDelta(false),
+    isCompressed(false),
+    bufLength(l),
+    rawLength(l),
+    prefix(0),
+    afterHash(0) {}
   DivSampleHistory(unsigned char de, int r, int cr, int ls):
     data(NULL),
     length(0),
@@ -52,7 +66,13 @@ struct DivSampleHistory {
     rate(r),
     centerRate(cr),
     loopStart(ls),
-    hasSample(false) {}
+    hasSample(false),
+    isDelta(false),
+    isCompressed(false),
+    bufLength(0),
+    rawLength(0),
+    prefix(0),
+    afterHash(0) {}
   ~DivSampleHistory();
 };
 
@@ -90,9 +110,17 @@ struct DivSample {
 
   unsigned int samples;
 
+  // hash of the sample data as of the last render(), or 0 if not rendered yet
+  uint64_t renderHash;
+
   std::deque<DivSampleHistory*> undoHist;
   std::deque<DivSampleHistory*> redoHist;
 
+  // memory the undo history of a sample may use (the newest step is always
+  // kept), and whether to compress the steps.
+  static size_t undoBudget;
+  static bool undoCompress;
+
   /**
    * @warning DO NOT USE - internal functions
    */
@@ -174,6 +202,14 @@ struct DivSample {
    */
   void render();
 
+  /**
+   * hash the sample data in its current depth.
+   * DivEngine::renderSamples() compares this against renderHash to only render
+   * samples which changed.
+   * @return the hash (never 0).
+   */
+  uint64_t getDataHash();
+
   /**
    * get the sample data for the current depth.
    * @return the sample data, or NULL if not created.
@@ -194,6 +230,25 @@ struct DivSample {
    */
   DivSampleHistory* prepareUndo(bool data, bool doNotPush=false);
 
+  /**
+   * turn an undo step holding a copy of the sample data into a delta against
+   * the current data.
+   * @param h the undo step.
+   */
+  void compactHistory(DivSampleHistory* h);
+
+  /**
+   * restore the state of an undo step.
+   * @param h the undo step.
+   * @return false if the step doesn't apply to the current data.
+   */
+  bool applyHistory(DivSampleHistory* h);
+
+  /**
+   * evict the oldest steps until the history fits in undoBudget.
+   */
+  void trimHistory();
+
   /**
    * undo. you may need to call DivEngine::renderSamples afterwards.
    * @warning do not attempt to undo outside of a synchronized block!
@@ -247,6 +302,13 @@ struct DivSample {
     offSegaPCM(0),
     offQSound(0),
     offX1_010(0),
-    samples(0) {}
+    samples(0),
+    renderHash(0) {}
   ~DivSample();
 };
+
+/**
+ * time resampling a long 16-bit sample with each filter and log the results.
+ * @param seconds length of the sample (at 44100Hz).
+ */
+void divResampleBenchmark(int seconds);
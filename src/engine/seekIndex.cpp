@@ -0,0 +1,219 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "engine.h"
+#include "../ta-log.h"
+
+// FNV-1a
+#define SEEK_HASH_BEGIN 0xcbf29ce484222325ULL
+#define SEEK_HASH_PRIME 0x100000001b3ULL
+
+static uint64_t seekHash(uint64_t hash, const void* data, size_t len) {
+  const unsigned char* d=(const unsigned char*)data;
+  for (size_t i=0; i<len; i++) {
+    hash^=d[i];
+    hash*=SEEK_HASH_PRIME;
+  }
+  return hash;
+}
+
+uint64_t DivEngine::hashSeekSong() {
+  // song settings which change how the orders are played
+  int settings[]={
+    song.speed1, song.speed2, song.customTempo, song.pal, song.timeBase,
+    song.patLen, song.ordersLen, song.arpLen, song.linearPitch, chans
+  };
+  uint64_t hash=seekHash(SEEK_HASH_BEGIN,settings,sizeof(settings));
+  hash=seekHash(hash,&song.hz,sizeof(song.hz));
+  hash=seekHash(hash,&song.tuning,sizeof(song.tuning));
+
+  // compatibility flags
+  bool compat[]={
+    song.limitSlides, song.properNoiseLayout, song.waveDutyIsVol, song.resetMacroOnPorta,
+    song.legacyVolumeSlides, song.compatibleArpeggio, song.noteOffResetsSlides, song.targetResetsSlides,
+    song.arpNonPorta, song.algMacroBehavior, song.brokenShortcutSlides, song.ignoreDuplicateSlides,
+    song.stopPortaOnNoteOff, song.continuousVibrato, song.brokenDACMode, song.oneTickCut,
+    song.newInsTriggersInPorta, song.arp0Reset, song.brokenSpeedSel, song.noSlidesOnFirstTick,
+    song.rowResetsArpPos, song.ignoreJumpAtEnd, song.buggyPortaAfterSlide, song.gbInsAffectsEnvelope,
+    song.sharedExtStat, song.ignoreDACModeOutsideIntendedChannel, song.e1e2AlsoTakePriority, song.newSegaPCM
+  };
+  hash=seekHash(hash,compat,sizeof(compat));
+  hash=seekHash(hash,&song.loopModality,1);
+
+  // systems
+  for (int i=0; i<song.systemLen; i++) {
+    int sys=song.system[i];
+    hash=seekHash(hash,&sys,sizeof(int));
+    hash=seekHash(hash,&song.systemFlags[i],sizeof(unsigned int));
+  }
+
+  // instruments and wavetables, in their file format.
+  // this is kept until resetSeekIndex() since serializing them is slow.
+  if (seekInsHash==0) {
+    SafeWriter* w=new SafeWriter;
+    w->init();
+    for (DivInstrument* i: song.ins) i->putInsData(w);
+    for (DivWavetable* i: song.wave) i->putWaveData(w);
+    seekInsHash=seekHash(SEEK_HASH_BEGIN,w->getFinalBuf(),w->size());
+    if (seekInsHash==0) seekInsHash=1;
+    w->finish();
+    delete w;
+  }
+  hash=seekHash(hash,&seekInsHash,sizeof(uint64_t));
+
+  // samples. renderHash follows the data as last rendered for playback
+  for (DivSample* i: song.sample) {
+    int params[]={i->rate, i->centerRate, i->loopStart};
+    hash=seekHash(hash,params,sizeof(params));
+    hash=seekHash(hash,&i->renderHash,sizeof(uint64_t));
+  }
+  return hash;
+}
+
+uint64_t DivEngine::hashSeekOrder(int order, uint64_t hash) {
+  for (int i=0; i<chans; i++) {
+    unsigned char pat=song.orders.ord[i][order];
+    DivPattern* p=song.pat[i].getPattern(pat,false);
+    int rows=MIN(song.patLen,p->rows);
+    hash=seekHash(hash,&pat,1);
+    hash=seekHash(hash,&song.pat[i].effectRows,1);
+    hash=seekHash(hash,p->data,rows*DIV_PAT_COLS*sizeof(short));
+  }
+  return hash;
+}
+
+uint64_t DivEngine::hashSeekPath(const std::vector<unsigned char>& path, std::vector<uint64_t>& orderHash) {
+  uint64_t hash=seekSongHash;
+  for (unsigned char i: path) {
+    if (i>=song.ordersLen) return 0;
+    if (orderHash[i]==0) orderHash[i]=hashSeekOrder(i,SEEK_HASH_BEGIN);
+    hash=seekHash(hash,&orderHash[i],sizeof(uint64_t));
+  }
+  return hash;
+}
+
+void DivEngine::saveSeekCheckpoint(std::vector<uint64_t>& orderHash) {
+  if (seekIndexInterval<1) return;
+  if (curOrder%seekIndexInterval) return;
+  if (seekIndex.find(curOrder)!=seekIndex.end()) return;
+
+  DivSeekCheckpoint* c=new DivSeekCheckpoint;
+  for (int i=0; i<song.systemLen; i++) {
+    c->disState[i]=disCont[i].dispatch->saveSoftState();
+    if (c->disState[i]==NULL) {
+      // this dispatch can't save its state
+      delete c;
+      return;
+    }
+  }
+  c->order=curOrder;
+  c->path=seekPath;
+  c->maxOrder=0;
+  for (size_t i=0; i+1<c->path.size(); i++) {
+    if (c->path[i]>c->maxOrder) c->maxOrder=c->path[i];
+  }
+  c->hash=hashSeekPath(c->path,orderHash);
+  c->chan.assign(chan,chan+chans);
+  c->subticks=subticks;
+  c->ticks=ticks;
+  c->curRow=curRow;
+  c->nextSpeed=nextSpeed;
+  c->changeOrd=changeOrd;
+  c->changePos=changePos;
+  c->totalSeconds=totalSeconds;
+  c->totalTicks=totalTicks;
+  c->totalTicksR=totalTicksR;
+  c->totalCmds=totalCmds;
+  c->globalPitch=globalPitch;
+  c->divider=divider;
+  c->extValue=extValue;
+  c->speed1=speed1;
+  c->speed2=speed2;
+  c->speedAB=speedAB;
+  c->endOfSong=endOfSong;
+  c->extValuePresent=extValuePresent;
+  c->firstTick=firstTick;
+  seekIndex[curOrder]=c;
+}
+
+bool DivEngine::loadSeekCheckpoint(int goal) {
+  std::vector<uint64_t> orderHash(song.ordersLen,0);
+  DivSeekCheckpoint* best=NULL;
+  for (auto i=seekIndex.begin(); i!=seekIndex.end();) {
+    DivSeekCheckpoint* c=i->second;
+    // a seek to this goal must have passed through the checkpoint
+    if (c->order>goal || c->maxOrder>=goal) {
+      ++i;
+      continue;
+    }
+    // drop the checkpoint if an order it played was edited
+    if (hashSeekPath(c->path,orderHash)!=c->hash) {
+      delete c;
+      i=seekIndex.erase(i);
+      continue;
+    }
+    if (best==NULL || c->order>best->order) best=c;
+    ++i;
+  }
+  if (best==NULL) return false;
+
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].dispatch->loadSoftState(best->disState[i]);
+  }
+  for (size_t i=0; i<best->chan.size(); i++) {
+    chan[i]=best->chan[i];
+  }
+  seekPath=best->path;
+  curOrder=best->order;
+  subticks=best->subticks;
+  ticks=best->ticks;
+  curRow=best->curRow;
+  nextSpeed=best->nextSpeed;
+  changeOrd=best->changeOrd;
+  changePos=best->changePos;
+  totalSeconds=best->totalSeconds;
+  totalTicks=best->totalTicks;
+  totalTicksR=best->totalTicksR;
+  totalCmds=best->totalCmds;
+  globalPitch=best->globalPitch;
+  divider=best->divider;
+  extValue=best->extValue;
+  speed1=best->speed1;
+  speed2=best->speed2;
+  speedAB=best->speedAB;
+  endOfSong=best->endOfSong;
+  extValuePresent=best->extValuePresent;
+  firstTick=best->firstTick;
+  logD("seek: resuming from order %d",best->order);
+  return true;
+}
+
+void DivEngine::resetSeekIndex() {
+  for (auto& i: seekIndex) {
+    delete i.second;
+  }
+  seekIndex.clear();
+  seekInsHash=0;
+}
+
+void DivEngine::clearSeekIndex() {
+  BUSY_BEGIN;
+  resetSeekIndex();
+  BUSY_END;
+}
@@ -19,6 +19,12 @@
 
 #include "song.h"
 
+void DivSong::setPatternRows(int rows) {
+  for (int i=0; i<DIV_MAX_CHANS; i++) {
+    pat[i].setRows(rows);
+  }
+}
+
 void DivSong::unload() {
   for (DivInstrument* i: ins) {
     delete i;
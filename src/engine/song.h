@@ -344,6 +344,13 @@ struct DivSong {
    */
   void unload();
 
+  /**
+   * set the number of rows stored in every pattern.
+   * call after changing patLen. rows past the new size are lost.
+   * @param rows the row count.
+   */
+  void setPatternRows(int rows);
+
   DivSong():
     version(0),
     isDMF(false),
@@ -436,6 +443,8 @@ struct DivSong {
     nullInsOPL.fm.op[1].rr=12;
     nullInsOPL.fm.op[1].mult=1;
     nullInsOPL.name="This is a bug! Report!";
+
+    setPatternRows(patLen);
   }
 };
 
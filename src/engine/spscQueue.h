@@ -0,0 +1,63 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SPSCQUEUE_H
+#define _SPSCQUEUE_H
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * a fixed-size lock-free queue with one producer and one consumer.
+ * size must be a power of two. one slot is always kept free.
+ */
+template<typename T, size_t size> class DivSPSCQueue {
+  static_assert((size&(size-1))==0,"queue size must be a power of two");
+  T data[size];
+  std::atomic<size_t> readPos, writePos;
+
+  public:
+    // add an item. returns false if the queue is full. producer only.
+    bool push(const T& item) {
+      size_t w=writePos.load(std::memory_order_relaxed);
+      size_t next=(w+1)&(size-1);
+      if (next==readPos.load(std::memory_order_acquire)) return false;
+      data[w]=item;
+      writePos.store(next,std::memory_order_release);
+      return true;
+    }
+
+    // take an item. returns false if the queue is empty. consumer only.
+    bool pop(T& item) {
+      size_t r=readPos.load(std::memory_order_relaxed);
+      if (r==writePos.load(std::memory_order_acquire)) return false;
+      item=data[r];
+      readPos.store((r+1)&(size-1),std::memory_order_release);
+      return true;
+    }
+
+    bool empty() {
+      return readPos.load(std::memory_order_acquire)==writePos.load(std::memory_order_acquire);
+    }
+
+    DivSPSCQueue():
+      readPos(0),
+      writePos(0) {}
+};
+
+#endif
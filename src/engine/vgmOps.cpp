@@ -21,6 +21,7 @@
 #include "../ta-log.h"
 #include "../utfutils.h"
 #include "song.h"
+#include "vgmStream.h"
 
 constexpr int MASTER_CLOCK_PREC=(sizeof(void*)==8)?8:0;
 
@@ -604,7 +605,35 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
   }
 }
 
-SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
+// writes a wait using the shortest command that fits.
+static void writeVGMWait(SafeWriter* w, int wait) {
+  while (wait>0) {
+    if (wait<=16) {
+      w->writeC(0x70+wait-1);
+      return;
+    }
+    if (wait==735 || wait==882) {
+      w->writeC((wait==735)?0x62:0x63);
+      return;
+    }
+    if (wait>735 && wait<=735+16) {
+      w->writeC(0x62);
+      wait-=735;
+      continue;
+    }
+    if (wait>882 && wait<=882+16) {
+      w->writeC(0x63);
+      wait-=882;
+      continue;
+    }
+    int part=MIN(wait,65535);
+    w->writeC(0x61);
+    w->writeS(part);
+    wait-=part;
+  }
+}
+
+SafeWriter* DivEngine::writeVGM(DivVGMStream* stream, bool* sysToExport, bool loop, int version, bool highRes) {
   if (version<0x150) {
     lastError="VGM version is too low";
     return NULL;
@@ -692,6 +721,27 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
   SafeWriter* w=new SafeWriter;
   w->init();
 
+  // when streaming, everything in w is moved to the file now and then.
+  // streamPos is the file position w starts at.
+  size_t streamPos=0;
+  auto flushVGM=[&]() {
+    if (stream==NULL) return;
+    stream->write(w->getFinalBuf(),w->size());
+    streamPos+=w->size();
+    w->finish();
+    w->init();
+  };
+  // large data blocks go straight to the file
+  auto writeVGMData=[&](const unsigned char* data, size_t len) {
+    if (stream==NULL) {
+      w->write(data,len);
+      return;
+    }
+    flushVGM();
+    stream->write(data,len);
+    streamPos+=len;
+  };
+
   // write header
   w->write("Vgm ",4);
   w->writeI(0); // will be written later
@@ -996,6 +1046,14 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
     }
   }
 
+  // in high resolution mode the chips are run during export and write their
+  // sample data as it plays, so no sample blocks or streams are needed.
+  if (highRes) {
+    writeDACSamples=false;
+    writeNESSamples=false;
+    writePCESamples=false;
+  }
+
   //bool wantsExtraHeader=false;
   /*for (int i=0; i<song.systemLen; i++) {
     if (isSecond[i]) {
@@ -1161,6 +1219,12 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
   }*/
 
   unsigned int songOff=w->tell();
+  if (stream!=NULL) {
+    stream->writeHeader(w->getFinalBuf(),w->size());
+    streamPos=w->size();
+    w->finish();
+    w->init();
+  }
 
   // write samples
   unsigned int sampleSeek=0;
@@ -1180,6 +1244,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
     for (unsigned int j=0; j<sample->length8; j++) {
       w->writeC((unsigned char)sample->data8[j]+0x80);
     }
+    flushVGM();
   }
 
   if (writeNESSamples) for (int i=0; i<song.sampleLen; i++) {
@@ -1191,6 +1256,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
     for (unsigned int j=0; j<sample->length8; j++) {
       w->writeC(((unsigned char)sample->data8[j]+0x80)>>1);
     }
+    flushVGM();
   }
 
   if (writePCESamples) for (int i=0; i<song.sampleLen; i++) {
@@ -1202,6 +1268,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
     for (unsigned int j=0; j<sample->length8; j++) {
       w->writeC(((unsigned char)sample->data8[j]+0x80)>>3);
     }
+    flushVGM();
   }
 
   if (writeSegaPCM>0) {
@@ -1243,7 +1310,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
       w->writeI((memPos+8)|(i*0x80000000));
       w->writeI(memPos);
       w->writeI(0);
-      w->write(pcmMem,memPos);
+      writeVGMData(pcmMem,memPos);
     }
 
     delete[] pcmMem;
@@ -1257,7 +1324,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
       w->writeI((adpcmAMemLen+8)|(i*0x80000000));
       w->writeI(adpcmAMemLen);
       w->writeI(0);
-      w->write(adpcmAMem,adpcmAMemLen);
+      writeVGMData(adpcmAMem,adpcmAMemLen);
     }
   }
 
@@ -1269,7 +1336,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
       w->writeI((adpcmBMemLen+8)|(i*0x80000000));
       w->writeI(adpcmBMemLen);
       w->writeI(0);
-      w->write(adpcmBMem,adpcmBMemLen);
+      writeVGMData(adpcmBMem,adpcmBMemLen);
     }
   }
 
@@ -1286,7 +1353,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
       w->writeI((blockSize+8)|(i*0x80000000));
       w->writeI(0x1000000);
       w->writeI(0);
-      w->write(qsoundMem,blockSize);
+      writeVGMData(qsoundMem,blockSize);
     }
   }
 
@@ -1298,14 +1365,14 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
       w->writeI((x1_010MemLen+8)|(i*0x80000000));
       w->writeI(x1_010MemLen);
       w->writeI(0);
-      w->write(x1_010Mem,x1_010MemLen);
+      writeVGMData(x1_010Mem,x1_010MemLen);
     }
   }
 
   // initialize streams
   int streamID=0;
   for (int i=0; i<song.systemLen; i++) {
-    if (!willExport[i]) continue;
+    if (!willExport[i] || highRes) continue;
     streamIDs[i]=streamID;
     switch (song.system[i]) {
       case DIV_SYSTEM_YM2612:
@@ -1391,6 +1458,12 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
   // write song data
   playSub(false);
   size_t tickCount=0;
+  double acquirePos[32];
+  size_t writePos[32];
+  std::vector<short> acquireBufL, acquireBufR;
+  for (int i=0; i<32; i++) {
+    acquirePos[i]=0.0;
+  }
   bool writeLoop=false;
   while (!done) {
     if (loopPos==-1) {
@@ -1418,17 +1491,71 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
         loopPos=-1;
       }
     }
-    // get register dumps
-    for (int i=0; i<song.systemLen; i++) {
-      std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
-      for (DivRegWrite& j: writes) {
-        performVGMWrite(w,song.system[i],j,streamIDs[i],loopTimer,loopFreq,loopSample,isSecond[i]);
+    int totalWait=cycles>>MASTER_CLOCK_PREC;
+    if (highRes) {
+      // run the chips one VGM sample at a time so that the writes made while
+      // rendering (e.g. DAC writes) are stamped with their position in the tick
+      for (int i=0; i<song.systemLen; i++) {
+        if (!willExport[i]) continue;
+        DivDispatch* disp=disCont[i].dispatch;
+        double step=(double)disp->rate/44100.0;
+        for (int j=0; j<totalWait; j++) {
+          acquirePos[i]+=step;
+          size_t run=(size_t)acquirePos[i];
+          if (run==0) continue;
+          acquirePos[i]-=(double)run;
+          if (acquireBufL.size()<run) {
+            acquireBufL.resize(run);
+            acquireBufR.resize(run);
+          }
+          disp->regWriteTime=j;
+          disp->acquire(acquireBufL.data(),acquireBufR.data(),0,run);
+        }
+        disp->regWriteTime=0;
+        writePos[i]=0;
+      }
+      // merge the writes of all chips in time order
+      int curTime=0;
+      while (true) {
+        int next=-1;
+        unsigned int nextTime=0;
+        for (int i=0; i<song.systemLen; i++) {
+          if (!willExport[i]) continue;
+          std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
+          if (writePos[i]>=writes.size()) continue;
+          if (next<0 || writes[writePos[i]].time<nextTime) {
+            next=i;
+            nextTime=writes[writePos[i]].time;
+          }
+        }
+        if (next<0) break;
+        DivRegWrite& write=disCont[next].dispatch->getRegisterWrites()[writePos[next]++];
+        if ((int)write.time>curTime && (int)write.time<totalWait) {
+          writeVGMWait(w,write.time-curTime);
+          curTime=write.time;
+        }
+        // sample streams are not set up in this mode
+        if ((write.addr&0xffff0000)==0xffff0000 && write.addr!=0xffffffff) continue;
+        performVGMWrite(w,song.system[next],write,streamIDs[next],loopTimer,loopFreq,loopSample,isSecond[next]);
         writeCount++;
       }
-      writes.clear();
+      for (int i=0; i<song.systemLen; i++) {
+        disCont[i].dispatch->getRegisterWrites().clear();
+      }
+      totalWait-=curTime;
+      tickCount+=curTime;
+    } else {
+      // get register dumps
+      for (int i=0; i<song.systemLen; i++) {
+        std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
+        for (DivRegWrite& j: writes) {
+          performVGMWrite(w,song.system[i],j,streamIDs[i],loopTimer,loopFreq,loopSample,isSecond[i]);
+          writeCount++;
+        }
+        writes.clear();
+      }
     }
     // check whether we need to loop
-    int totalWait=cycles>>MASTER_CLOCK_PREC;
     for (int i=0; i<streamID; i++) {
       if (loopSample[i]>=0) {
         loopTimer[i]-=(loopFreq[i]/44100.0)*(double)totalWait;
@@ -1459,8 +1586,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
       if (nextToTouch>=0) {
         double waitTime=totalWait+(loopTimer[nextToTouch]*(44100.0/MAX(1,loopFreq[nextToTouch])));
         if (waitTime>0) {
-          w->writeC(0x61);
-          w->writeS(waitTime);
+          writeVGMWait(w,waitTime);
           logV("wait is: %f",waitTime);
           totalWait-=waitTime;
           tickCount+=waitTime;
@@ -1483,21 +1609,15 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
     }
     // write wait
     if (totalWait>0) {
-      if (totalWait==735) {
-        w->writeC(0x62);
-      } else if (totalWait==882) {
-        w->writeC(0x63);
-      } else {
-        w->writeC(0x61);
-        w->writeS(totalWait);
-      }
+      writeVGMWait(w,totalWait);
       tickCount+=totalWait;
     }
     if (writeLoop) {
       writeLoop=false;
-      loopPos=w->tell();
+      loopPos=streamPos+w->tell();
       loopTick=tickCount;
     }
+    if (w->size()>=65536) flushVGM();
   }
   // end of song
   w->writeC(0x66);
@@ -1505,11 +1625,12 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
   got.rate=origRate;
 
   for (int i=0; i<song.systemLen; i++) {
-    disCont[i].dispatch->toggleRegisterDump(false);
+    disCont[i].dispatch->toggleRegisterDump(regLog!=NULL);
   }
 
   // write GD3 tag
-  gd3Off=w->tell();
+  size_t gd3Start=w->tell();
+  gd3Off=streamPos+gd3Start;
   w->write("Gd3 ",4);
   w->writeI(0x100);
   w->writeI(0); // length. will be written later
@@ -1539,32 +1660,35 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
   w->writeWString(L"Furnace Tracker",false); // ripper
   w->writeS(0); // notes
 
-  int gd3Len=w->tell()-gd3Off-12;
+  int gd3Len=w->tell()-gd3Start-12;
 
-  w->seek(gd3Off+8,SEEK_SET);
+  w->seek(gd3Start+8,SEEK_SET);
   w->writeI(gd3Len);
+  w->seek(0,SEEK_END);
 
   // finish file
-  size_t len=w->size()-4;
-  w->seek(4,SEEK_SET);
-  w->writeI(len);
-  w->seek(0x14,SEEK_SET);
-  w->writeI(gd3Off-0x14);
-  w->writeI(tickCount);
-  if (loop) {
-    if (loopPos==-1) {
-      w->writeI(0);
-      w->writeI(0);
+  size_t len=streamPos+w->size()-4;
+  flushVGM();
+  // the header is either in w or in the stream
+  auto patchVGM=[&](size_t pos, int val) {
+    if (stream!=NULL) {
+      stream->patchI(pos,val);
     } else {
-      w->writeI(loopPos-0x1c);
-      w->writeI(tickCount-loopTick-1);
+      w->seek(pos,SEEK_SET);
+      w->writeI(val);
     }
+  };
+  patchVGM(4,len);
+  patchVGM(0x14,gd3Off-0x14);
+  patchVGM(0x18,tickCount);
+  if (loop && loopPos!=-1) {
+    patchVGM(0x1c,loopPos-0x1c);
+    patchVGM(0x20,tickCount-loopTick-1);
   } else {
-    w->writeI(0);
-    w->writeI(0);
+    patchVGM(0x1c,0);
+    patchVGM(0x20,0);
   }
-  w->seek(0x34,SEEK_SET);
-  w->writeI(songOff-0x34);
+  patchVGM(0x34,songOff-0x34);
   /*if (wantsExtraHeader) {
     w->seek(0xbc,SEEK_SET);
     w->writeI(exHeaderOff-0xbc);
@@ -1580,3 +1704,31 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version) {
   BUSY_END;
   return w;
 }
+
+SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool highRes) {
+  return writeVGM(NULL,sysToExport,loop,version,highRes);
+}
+
+bool DivEngine::saveVGMFile(const char* path, bool* sysToExport, bool loop, int version, bool compress, bool highRes) {
+  if (version<0x150) {
+    lastError="VGM version is too low";
+    return false;
+  }
+  DivVGMStream stream;
+  if (!stream.open(path,compress)) {
+    lastError="could not open file! ("+stream.getLastError()+")";
+    return false;
+  }
+  SafeWriter* w=writeVGM(&stream,sysToExport,loop,version,highRes);
+  if (w==NULL) {
+    stream.close();
+    return false;
+  }
+  w->finish();
+  delete w;
+  if (!stream.close()) {
+    lastError="could not write file! ("+stream.getLastError()+")";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,546 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "vgmPlayer.h"
+#include "../ta-log.h"
+#include <zlib.h>
+#include <string.h>
+
+#define VGM_RATE 44100.0
+
+struct DivVGMChipDef {
+  int id;
+  // offset of the clock in the header
+  size_t clockOff;
+  DivSystem sys;
+};
+
+// chips which can be played back.
+// these are the ones whose dispatch pokes the chip core directly.
+static const DivVGMChipDef vgmChips[]={
+  {0x00, 0x0c, DIV_SYSTEM_SMS},
+  {0x01, 0x10, DIV_SYSTEM_OPLL},
+  {0x02, 0x2c, DIV_SYSTEM_YM2612},
+  {0x03, 0x30, DIV_SYSTEM_YM2151},
+  {0x08, 0x4c, DIV_SYSTEM_YM2610_FULL},
+  {0x09, 0x50, DIV_SYSTEM_OPL2},
+  {0x0a, 0x54, DIV_SYSTEM_OPL},
+  {0x0c, 0x5c, DIV_SYSTEM_OPL3},
+  {0x12, 0x74, DIV_SYSTEM_AY8910},
+  {0x13, 0x80, DIV_SYSTEM_GB},
+  {0x14, 0x84, DIV_SYSTEM_NES},
+  {0x1b, 0xa4, DIV_SYSTEM_PCE},
+  {0x21, 0xc0, DIV_SYSTEM_SWAN},
+  {0x23, 0xc8, DIV_SYSTEM_SAA1099},
+  {0x29, 0xe4, DIV_SYSTEM_LYNX},
+  {-1, 0, DIV_SYSTEM_NULL}
+};
+
+// chip ID and port of the 0x5n/0xan commands
+static const int vgmYMChip[16]={
+  -1, 0x01, 0x02, 0x02, 0x03, 0x06, 0x07, 0x07, 0x08, 0x08, 0x09, 0x0a, 0x0b, 0x0f, 0x0c, 0x0c
+};
+static const int vgmYMPort[16]={
+  0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1
+};
+
+// chip ID of the 0xbn commands
+static const int vgmBChip[16]={
+  0x05, 0x10, 0x11, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x1b, 0x1d, 0x1e, 0x21, 0x23, 0x25, 0x28
+};
+
+// length of each command, or 0 if it is unknown. 0x67 is variable.
+static size_t vgmCmdLen(unsigned char c) {
+  if (c>=0x30 && c<=0x3f) return 2;
+  if (c>=0x40 && c<=0x4e) return 3;
+  if (c==0x4f || c==0x50) return 2;
+  if (c>=0x51 && c<=0x5f) return 3;
+  if (c>=0x70 && c<=0x8f) return 1;
+  if (c>=0xa0 && c<=0xbf) return 3;
+  if (c>=0xc0 && c<=0xdf) return 4;
+  if (c>=0xe0) return 5;
+  switch (c) {
+    case 0x61:
+      return 3;
+    case 0x62: case 0x63: case 0x66:
+      return 1;
+    case 0x67:
+      return 7;
+    case 0x68:
+      return 12;
+    case 0x90: case 0x91: case 0x95:
+      return 5;
+    case 0x92:
+      return 6;
+    case 0x93:
+      return 11;
+    case 0x94:
+      return 2;
+  }
+  return 0;
+}
+
+static inline unsigned int vgmReadI(const unsigned char* d) {
+  return d[0]|(d[1]<<8)|(d[2]<<16)|((unsigned int)d[3]<<24);
+}
+
+// decompress a .vgz. these may consist of more than one gzip member.
+static bool vgmInflate(const unsigned char* buf, size_t len, std::vector<unsigned char>& out, String& error) {
+  z_stream zl;
+  memset(&zl,0,sizeof(z_stream));
+  zl.next_in=(Bytef*)buf;
+  zl.avail_in=len;
+
+  int nextErr=inflateInit2(&zl,15+32);
+  if (nextErr!=Z_OK) {
+    error="could not start decompression";
+    return false;
+  }
+  size_t outLen=0;
+  while (true) {
+    out.resize(outLen+65536);
+    zl.next_out=&out[outLen];
+    zl.avail_out=65536;
+    nextErr=inflate(&zl,Z_NO_FLUSH);
+    outLen=out.size()-zl.avail_out;
+    if (nextErr==Z_STREAM_END) {
+      if (zl.avail_in==0) break;
+      inflateReset(&zl);
+      continue;
+    }
+    if (nextErr!=Z_OK) {
+      if (zl.msg==NULL) {
+        error="decompression error";
+      } else {
+        error=fmt::sprintf("decompression error: %s",zl.msg);
+      }
+      inflateEnd(&zl);
+      return false;
+    }
+  }
+  inflateEnd(&zl);
+  out.resize(outLen);
+  return true;
+}
+
+bool DivVGMPlayer::isVGM(const unsigned char* buf, size_t len) {
+  if (len>=4 && memcmp(buf,"Vgm ",4)==0) return true;
+  return (len>=2 && buf[0]==0x1f && buf[1]==0x8b);
+}
+
+bool DivVGMPlayer::load(DivEngine* eng, const unsigned char* buf, size_t len, double outRate, int loops) {
+  quit();
+  parent=eng;
+  rate=outRate;
+  eventRate=VGM_RATE;
+  loopsLeft=loops;
+
+  if (len>=2 && buf[0]==0x1f && buf[1]==0x8b) {
+    if (!vgmInflate(buf,len,data,lastError)) return false;
+  } else {
+    data.assign(buf,buf+len);
+  }
+  if (data.size()<0x40 || memcmp(&data[0],"Vgm ",4)!=0) {
+    lastError="not a VGM file";
+    return false;
+  }
+
+  const unsigned char* d=&data[0];
+  unsigned int version=vgmReadI(d+0x08);
+  dataEnd=0x04+(size_t)vgmReadI(d+0x04);
+  if (dataEnd>data.size() || dataEnd<0x40) dataEnd=data.size();
+  size_t dataStart=0x40;
+  if (version>=0x150 && vgmReadI(d+0x34)!=0) {
+    dataStart=0x34+(size_t)vgmReadI(d+0x34);
+  }
+  if (dataStart>=dataEnd) {
+    lastError="VGM has no data";
+    return false;
+  }
+  totalSamples=vgmReadI(d+0x18);
+  loopPos=0;
+  if (vgmReadI(d+0x1c)!=0) {
+    loopPos=0x1c+(size_t)vgmReadI(d+0x1c);
+    if (loopPos<dataStart || loopPos>=dataEnd) loopPos=0;
+  }
+  logI("VGM version %x.%.2x",version>>8,version&0xff);
+
+  // set up the chips
+  for (int i=0; vgmChips[i].id>=0; i++) {
+    const DivVGMChipDef& chip=vgmChips[i];
+    if (chip.clockOff+4>dataStart) continue;
+    // before 1.10 the YM2612 and YM2151 use the YM2413 clock
+    if (version<0x110 && (chip.id==0x02 || chip.id==0x03)) continue;
+    unsigned int clock=vgmReadI(d+chip.clockOff);
+    int chipClock=clock&0x3fffffff;
+    if (chipClock==0) continue;
+
+    DivSystem sys=chip.sys;
+    unsigned int extraFlags=0;
+    switch (chip.id) {
+      case 0x00: // TI noise feedback
+        if (vgmReadI(d+0x28)==0x0003) extraFlags=4;
+        break;
+      case 0x08:
+        if (clock&0x80000000) sys=DIV_SYSTEM_YM2610B;
+        break;
+      case 0x12:
+        if (version>=0x151) {
+          if (d[0x78]==0x03) {
+            sys=DIV_SYSTEM_AY8930;
+          } else if (d[0x78]>=0x10) {
+            extraFlags=0x10;
+          }
+        }
+        break;
+    }
+
+    for (int j=0; j<((clock&0x40000000)?2:1); j++) {
+      if (chipCount>=32) break;
+      // find the flags which give the closest clock
+      DivDispatchContainer& dc=disCont[chipCount];
+      dc.init(sys,parent,parent->getChannelCount(sys),rate,0);
+      unsigned int bestFlags=0;
+      int bestDiff=abs(dc.dispatch->chipClock-chipClock);
+      for (unsigned int k=1; k<16 && bestDiff>1; k++) {
+        dc.dispatch->setFlags(k);
+        int diff=abs(dc.dispatch->chipClock-chipClock);
+        if (diff<bestDiff) {
+          bestDiff=diff;
+          bestFlags=k;
+        }
+      }
+      dc.quit();
+
+      int index=addChip(sys,bestFlags|extraFlags);
+      if (bestDiff>1) {
+        logW("VGM: %s clock is %dHz, playing at %dHz",parent->getSystemName(sys),chipClock,dc.dispatch->chipClock);
+      }
+      logI("VGM: %s at %dHz",parent->getSystemName(sys),dc.dispatch->chipClock);
+
+      chipIndex[chip.id][j]=index;
+    }
+  }
+  if (chipCount==0) {
+    lastError="this VGM does not use any chip which can be played back";
+    return false;
+  }
+
+  pos=dataStart;
+  return true;
+}
+
+void DivVGMPlayer::pokeChip(int chip, bool second, int port, unsigned char reg, unsigned char val) {
+  if (chip<0 || chip>=DIV_VGM_CHIP_IDS) return;
+  int index=chipIndex[chip][second?1:0];
+  if (index<0) {
+    if (!warnedChip[chip]) {
+      logW("VGM: ignoring writes to chip %.2x",chip);
+      warnedChip[chip]=true;
+    }
+    return;
+  }
+  DivDispatch* disp=disCont[index].dispatch;
+  switch (chip) {
+    case 0x00: // SN76489
+      disp->poke(0,val);
+      break;
+    case 0x13: // GB: registers start at NR10 (0xff10)
+      disp->poke(0x10+reg,val);
+      break;
+    case 0x14: // NES: FDS registers are not supported
+      if (reg<0x20) disp->poke(0x4000+reg,val);
+      break;
+    case 0x21: // WonderSwan: port 1 is wave RAM
+      if (port) {
+        disp->poke(0x40|(reg&0x3f),val);
+      } else {
+        disp->poke(reg&0x3f,val);
+      }
+      break;
+    default:
+      disp->poke((port<<8)|reg,val);
+      break;
+  }
+}
+
+void DivVGMPlayer::startStream(DivVGMPlayerStream& s) {
+  if (s.stepSize==0) s.stepSize=1;
+  s.left=s.length;
+  if (s.reverse && s.length>0) {
+    s.pos=s.startPos+(size_t)(s.length-1)*s.stepSize;
+  } else {
+    s.pos=s.startPos;
+  }
+}
+
+void DivVGMPlayer::runStream(DivVGMPlayerStream& s) {
+  std::vector<unsigned char>& b=bank[s.bank&0x3f];
+  if (s.pos<b.size()) {
+    pokeChip(s.chip,s.second,s.port,s.reg,b[s.pos]);
+  }
+  if (s.reverse) {
+    s.pos-=s.stepSize;
+  } else {
+    s.pos+=s.stepSize;
+  }
+  if (--s.left==0 && s.loop) {
+    startStream(s);
+  }
+  s.nextTime+=VGM_RATE/s.freq;
+}
+
+void DivVGMPlayer::readDataBlock(size_t blockPos) {
+  unsigned char type=data[blockPos+2];
+  size_t size=vgmReadI(&data[blockPos+3])&0x7fffffff;
+  const unsigned char* blockData=&data[blockPos+7];
+  if (type<0x40) {
+    blockStart[type].push_back(bank[type].size());
+    blockLen[type].push_back(size);
+    bank[type].insert(bank[type].end(),blockData,blockData+size);
+  } else if (!warnedCmd[0x67]) {
+    // compressed streams, ROM and RAM data are not supported
+    logW("VGM: ignoring data block of type %.2x",type);
+    warnedCmd[0x67]=true;
+  }
+}
+
+void DivVGMPlayer::runCommands() {
+  while (true) {
+    if (pos>=dataEnd) {
+      ended=true;
+      return;
+    }
+    unsigned char c=data[pos];
+    size_t len=vgmCmdLen(c);
+    if (len==0) {
+      logE("VGM: unknown command %.2x at %x!",c,(int)pos);
+      ended=true;
+      return;
+    }
+    if (pos+len>dataEnd) {
+      ended=true;
+      return;
+    }
+    const unsigned char* d=&data[pos];
+    if (c==0x67) {
+      len+=vgmReadI(d+3)&0x7fffffff;
+      if (d[1]!=0x66 || pos+len>dataEnd) {
+        logE("VGM: bad data block at %x!",(int)pos);
+        ended=true;
+        return;
+      }
+      readDataBlock(pos);
+      pos+=len;
+      continue;
+    }
+    pos+=len;
+
+    unsigned int wait=0;
+    switch (c) {
+      case 0x30: case 0x50: // SN76489
+        pokeChip(0x00,c==0x30,0,0,d[1]);
+        break;
+      case 0x40: case 0x4e: // Mikey (0x4e is written by our exporter)
+        pokeChip(0x29,false,0,d[1],d[2]);
+        break;
+      case 0x61:
+        wait=d[1]|(d[2]<<8);
+        break;
+      case 0x62:
+        wait=735;
+        break;
+      case 0x63:
+        wait=882;
+        break;
+      case 0x66:
+        if (loopPos!=0 && loopsLeft!=0) {
+          // a pass through the loop which does not wait would never return
+          if (cmdTime==loopTime) {
+            logW("VGM: the looped part has no wait. stopping");
+            ended=true;
+            return;
+          }
+          loopTime=cmdTime;
+          if (loopsLeft>0) loopsLeft--;
+          pos=loopPos;
+          break;
+        }
+        ended=true;
+        return;
+      case 0x90: {
+        DivVGMPlayerStream& s=streams[d[1]];
+        s.chip=d[2]&0x7f;
+        s.second=d[2]&0x80;
+        s.port=d[3];
+        s.reg=d[4];
+        break;
+      }
+      case 0x91: {
+        DivVGMPlayerStream& s=streams[d[1]];
+        s.bank=d[2]&0x3f;
+        s.stepSize=d[3];
+        s.stepBase=d[4];
+        break;
+      }
+      case 0x92:
+        streams[d[1]].freq=vgmReadI(d+2);
+        break;
+      case 0x93: {
+        DivVGMPlayerStream& s=streams[d[1]];
+        unsigned int start=vgmReadI(d+2);
+        unsigned int length=vgmReadI(d+7);
+        unsigned char mode=d[6];
+        if (start!=0xffffffff) {
+          s.startPos=(size_t)start+s.stepBase;
+        }
+        if ((mode&3)==0) {
+          // only change the position
+          s.pos=s.startPos;
+          break;
+        }
+        if (s.stepSize==0) s.stepSize=1;
+        switch (mode&3) {
+          case 1: // commands
+            s.length=length;
+            break;
+          case 2: // milliseconds
+            s.length=((unsigned long long)length*s.freq)/1000;
+            break;
+          case 3: // until the end of the data
+            s.length=(s.startPos<bank[s.bank].size())?((bank[s.bank].size()-s.startPos)/s.stepSize):0;
+            break;
+        }
+        s.loop=mode&0x80;
+        s.reverse=mode&0x10;
+        startStream(s);
+        s.nextTime=cmdTime;
+        break;
+      }
+      case 0x94:
+        if (d[1]==0xff) {
+          for (int i=0; i<256; i++) streams[i].left=0;
+        } else {
+          streams[d[1]].left=0;
+        }
+        break;
+      case 0x95: {
+        DivVGMPlayerStream& s=streams[d[1]];
+        size_t block=d[2]|(d[3]<<8);
+        if (block>=blockStart[s.bank].size()) break;
+        if (s.stepSize==0) s.stepSize=1;
+        s.startPos=blockStart[s.bank][block]+s.stepBase;
+        s.length=blockLen[s.bank][block]/s.stepSize;
+        s.loop=d[4]&1;
+        s.reverse=d[4]&0x10;
+        startStream(s);
+        s.nextTime=cmdTime;
+        break;
+      }
+      case 0xa0: // AY8910
+        pokeChip(0x12,d[1]&0x80,0,d[1]&0x7f,d[2]);
+        break;
+      case 0xc6: // WonderSwan memory
+        pokeChip(0x21,d[1]&0x80,1,d[2],d[3]);
+        break;
+      case 0xe0:
+        pcmPos=vgmReadI(d+1);
+        break;
+      default:
+        if ((c>=0x51 && c<=0x5f) || (c>=0xa1 && c<=0xaf)) {
+          pokeChip(vgmYMChip[c&15],c>=0xa0,vgmYMPort[c&15],d[1],d[2]);
+        } else if (c>=0x70 && c<=0x7f) {
+          wait=(c&15)+1;
+        } else if (c>=0x80 && c<=0x8f) {
+          // YM2612 DAC write from the data bank
+          if (pcmPos<bank[0].size()) {
+            pokeChip(0x02,false,0,0x2a,bank[0][pcmPos]);
+          }
+          pcmPos++;
+          wait=c&15;
+        } else if (c>=0xb0 && c<=0xbf) {
+          pokeChip(vgmBChip[c&15],d[1]&0x80,0,d[1]&0x7f,d[2]);
+        } else if (!warnedCmd[c]) {
+          logW("VGM: ignoring command %.2x",c);
+          warnedCmd[c]=true;
+        }
+        break;
+    }
+    if (wait>0) {
+      cmdTime+=wait;
+      return;
+    }
+  }
+}
+
+double DivVGMPlayer::runEvents() {
+  while (!ended && cmdTime<=eventTime) {
+    runCommands();
+  }
+  if (ended) return -1;
+  double next=cmdTime;
+  for (int i=0; i<256; i++) {
+    DivVGMPlayerStream& s=streams[i];
+    if (s.left==0 || s.freq==0 || s.chip<0) continue;
+    while (s.left>0 && s.nextTime<=eventTime) {
+      runStream(s);
+    }
+    if (s.left>0 && s.nextTime<next) next=s.nextTime;
+  }
+  return next;
+}
+
+double DivVGMPlayer::getLength() {
+  return totalSamples/VGM_RATE;
+}
+
+void DivVGMPlayer::quit() {
+  quitChips();
+  for (int i=0; i<DIV_VGM_CHIP_IDS; i++) {
+    chipIndex[i][0]=-1;
+    chipIndex[i][1]=-1;
+    warnedChip[i]=false;
+  }
+  for (int i=0; i<0x40; i++) {
+    bank[i].clear();
+    blockStart[i].clear();
+    blockLen[i].clear();
+  }
+  for (int i=0; i<256; i++) {
+    streams[i]=DivVGMPlayerStream();
+    warnedCmd[i]=false;
+  }
+  data.clear();
+  pos=0;
+  dataEnd=0;
+  loopPos=0;
+  pcmPos=0;
+  totalSamples=0;
+  cmdTime=0;
+  loopTime=-1;
+}
+
+DivVGMPlayer::DivVGMPlayer():
+  loopsLeft(0) {
+  quit();
+}
+
+DivVGMPlayer::~DivVGMPlayer() {
+  quit();
+}
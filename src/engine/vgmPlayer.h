@@ -0,0 +1,120 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _VGMPLAYER_H
+#define _VGMPLAYER_H
+#include "chipPlayer.h"
+#include <vector>
+
+// number of VGM chip IDs (the order of the clocks in the header)
+#define DIV_VGM_CHIP_IDS 0x30
+
+struct DivVGMPlayerStream {
+  // VGM chip ID this stream writes to, or -1 if not set up
+  int chip;
+  bool second;
+  unsigned char port, reg;
+  // data bank (data block type), step size and step base
+  unsigned char bank, stepSize, stepBase;
+  unsigned int freq;
+  size_t pos, startPos;
+  // number of writes left, and the length used when looping
+  unsigned int left, length;
+  bool loop, reverse;
+  // time of the next write, in VGM samples
+  double nextTime;
+  DivVGMPlayerStream():
+    chip(-1),
+    second(false),
+    port(0),
+    reg(0),
+    bank(0),
+    stepSize(1),
+    stepBase(0),
+    freq(0),
+    pos(0),
+    startPos(0),
+    left(0),
+    length(0),
+    loop(false),
+    reverse(false),
+    nextTime(0) {}
+};
+
+/**
+ * plays a VGM/VGZ file by poking its register writes into the chip cores of
+ * the dispatches, at the sample they happen at.
+ * the dispatches are created by the player and are not part of the song.
+ */
+class DivVGMPlayer: public DivChipPlayer {
+  std::vector<unsigned char> data;
+  // container of each chip ID (first and second chip), or -1 if not present
+  int chipIndex[DIV_VGM_CHIP_IDS][2];
+  // stream data, by data block type, and where each block starts in it
+  std::vector<unsigned char> bank[0x40];
+  std::vector<size_t> blockStart[0x40];
+  std::vector<size_t> blockLen[0x40];
+  DivVGMPlayerStream streams[256];
+  size_t pos, dataEnd, loopPos, pcmPos;
+  unsigned int totalSamples;
+  int loopsLeft;
+  // time of the next command, in VGM samples
+  double cmdTime;
+  // command time at the last jump to the loop point, or -1
+  double loopTime;
+  bool warnedCmd[256];
+  bool warnedChip[DIV_VGM_CHIP_IDS];
+
+  void pokeChip(int chip, bool second, int port, unsigned char reg, unsigned char val);
+  void startStream(DivVGMPlayerStream& s);
+  void runStream(DivVGMPlayerStream& s);
+  void readDataBlock(size_t blockPos);
+  void runCommands();
+
+  protected:
+    double runEvents();
+
+  public:
+    /**
+     * check whether a file looks like a VGM (or a gzip file, which may be a VGZ).
+     */
+    static bool isVGM(const unsigned char* buf, size_t len);
+
+    /**
+     * load a VGM or VGZ file and set up its chips.
+     * @param eng the engine the dispatches are initialized with.
+     * @param buf the file data. it is copied.
+     * @param len the file length.
+     * @param outRate the output rate.
+     * @param loops how many times the looped part is played after the first
+     * time, or -1 to loop forever.
+     * @return whether the file could be loaded.
+     */
+    bool load(DivEngine* eng, const unsigned char* buf, size_t len, double outRate, int loops);
+
+    // get the length of the file (without loops) in seconds.
+    double getLength();
+
+    void quit();
+
+    DivVGMPlayer();
+    ~DivVGMPlayer();
+};
+
+#endif
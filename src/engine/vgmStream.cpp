@@ -0,0 +1,206 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "vgmStream.h"
+#include "../ta-log.h"
+#include "../fileutils.h"
+#include <string.h>
+#include <errno.h>
+
+#define VGM_STREAM_BUF_SIZE 65536
+
+bool DivVGMStream::writeHeaderMember() {
+  // gzip member holding a single stored (uncompressed) deflate block
+  unsigned char start[15]={
+    0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff,
+    1, (unsigned char)(headerLen&0xff), (unsigned char)(headerLen>>8), (unsigned char)(~headerLen&0xff), (unsigned char)((~headerLen>>8)&0xff)
+  };
+  unsigned int crc=crc32(0,header,headerLen);
+  unsigned char end[8]={
+    (unsigned char)(crc&0xff), (unsigned char)((crc>>8)&0xff), (unsigned char)((crc>>16)&0xff), (unsigned char)(crc>>24),
+    (unsigned char)(headerLen&0xff), (unsigned char)((headerLen>>8)&0xff), 0, 0
+  };
+  if (fwrite(start,1,15,f)!=15) return false;
+  if (fwrite(header,1,headerLen,f)!=headerLen) return false;
+  if (fwrite(end,1,8,f)!=8) return false;
+  return true;
+}
+
+bool DivVGMStream::deflateOut(int flush) {
+  while (true) {
+    zs.next_out=outBuf;
+    zs.avail_out=VGM_STREAM_BUF_SIZE;
+    int result=deflate(&zs,flush);
+    if (result==Z_STREAM_ERROR) {
+      lastError="compression error";
+      return false;
+    }
+    size_t produced=VGM_STREAM_BUF_SIZE-zs.avail_out;
+    if (produced>0) {
+      if (fwrite(outBuf,1,produced,f)!=produced) {
+        lastError=strerror(errno);
+        return false;
+      }
+    }
+    if (flush==Z_FINISH) {
+      if (result==Z_STREAM_END) break;
+    } else if (zs.avail_out!=0) {
+      break;
+    }
+  }
+  return true;
+}
+
+bool DivVGMStream::open(const char* path, bool gzip) {
+  f=ps_fopen(path,"wb");
+  if (f==NULL) {
+    lastError=strerror(errno);
+    return false;
+  }
+  compress=gzip;
+  if (compress) {
+    memset(&zs,0,sizeof(z_stream));
+    // 15+16: zlib window, gzip wrapper
+    if (deflateInit2(&zs,Z_BEST_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY)!=Z_OK) {
+      lastError="could not initialize compression";
+      fclose(f);
+      f=NULL;
+      return false;
+    }
+    zsActive=true;
+    outBuf=new unsigned char[VGM_STREAM_BUF_SIZE];
+  }
+  return true;
+}
+
+bool DivVGMStream::writeHeader(const unsigned char* data, size_t len) {
+  if (f==NULL || failed) return false;
+  if (header!=NULL || len>65535) {
+    lastError="invalid header";
+    failed=true;
+    return false;
+  }
+  header=new unsigned char[len];
+  memcpy(header,data,len);
+  headerLen=len;
+  written=len;
+  if (compress) {
+    if (!writeHeaderMember()) {
+      lastError=strerror(errno);
+      failed=true;
+    }
+  } else {
+    if (fwrite(header,1,headerLen,f)!=headerLen) {
+      lastError=strerror(errno);
+      failed=true;
+    }
+  }
+  return !failed;
+}
+
+bool DivVGMStream::write(const unsigned char* data, size_t len) {
+  if (f==NULL || failed) return false;
+  if (len==0) return true;
+  written+=len;
+  if (compress) {
+    zs.next_in=(Bytef*)data;
+    zs.avail_in=len;
+    if (!deflateOut(Z_NO_FLUSH)) failed=true;
+  } else {
+    if (fwrite(data,1,len,f)!=len) {
+      lastError=strerror(errno);
+      failed=true;
+    }
+  }
+  return !failed;
+}
+
+void DivVGMStream::patchI(size_t pos, int val) {
+  if (pos+4>headerLen) {
+    logW("VGM header patch out of range! (%d)",(int)pos);
+    return;
+  }
+  header[pos]=val&0xff;
+  header[pos+1]=(val>>8)&0xff;
+  header[pos+2]=(val>>16)&0xff;
+  header[pos+3]=(val>>24)&0xff;
+}
+
+size_t DivVGMStream::tell() {
+  return written;
+}
+
+bool DivVGMStream::close() {
+  if (f==NULL) return false;
+  if (compress && zsActive) {
+    if (!failed) {
+      zs.next_in=NULL;
+      zs.avail_in=0;
+      if (!deflateOut(Z_FINISH)) failed=true;
+    }
+    deflateEnd(&zs);
+    zsActive=false;
+  }
+  if (!failed && header!=NULL) {
+    // rewrite the header in place. it has the same size as before.
+    if (fseek(f,0,SEEK_SET)!=0) {
+      lastError=strerror(errno);
+      failed=true;
+    } else if (compress) {
+      if (!writeHeaderMember()) {
+        lastError=strerror(errno);
+        failed=true;
+      }
+    } else if (fwrite(header,1,headerLen,f)!=headerLen) {
+      lastError=strerror(errno);
+      failed=true;
+    }
+  }
+  if (fclose(f)!=0 && !failed) {
+    lastError=strerror(errno);
+    failed=true;
+  }
+  f=NULL;
+  return !failed;
+}
+
+String DivVGMStream::getLastError() {
+  return lastError;
+}
+
+DivVGMStream::DivVGMStream():
+  f(NULL),
+  compress(false),
+  failed(false),
+  zsActive(false),
+  header(NULL),
+  headerLen(0),
+  written(0),
+  outBuf(NULL) {
+  memset(&zs,0,sizeof(z_stream));
+}
+
+DivVGMStream::~DivVGMStream() {
+  if (f!=NULL) {
+    if (zsActive) deflateEnd(&zs);
+    fclose(f);
+  }
+  if (header!=NULL) delete[] header;
+  if (outBuf!=NULL) delete[] outBuf;
+}
@@ -0,0 +1,99 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _VGMSTREAM_H
+#define _VGMSTREAM_H
+#include <stdio.h>
+#include <zlib.h>
+#include "../ta-utils.h"
+
+/**
+ * writes a VGM file while it is being generated, instead of building it in
+ * memory first.
+ * the header is written first and may be patched until close().
+ * when compressing (.vgz), the header is stored uncompressed in its own gzip
+ * member so that it can be rewritten in place, and the rest of the file goes
+ * into a second, deflated member.
+ */
+class DivVGMStream {
+  FILE* f;
+  bool compress;
+  bool failed;
+  z_stream zs;
+  bool zsActive;
+  unsigned char* header;
+  size_t headerLen;
+  size_t written;
+  unsigned char* outBuf;
+  String lastError;
+
+  bool writeHeaderMember();
+  bool deflateOut(int flush);
+
+  public:
+    /**
+     * open a file for writing.
+     * @param path the path.
+     * @param gzip whether to compress the file (.vgz).
+     * @return whether the file could be opened.
+     */
+    bool open(const char* path, bool gzip);
+
+    /**
+     * write the header. this must be the first write.
+     * @param data the header.
+     * @param len its length.
+     * @return whether it succeeded.
+     */
+    bool writeHeader(const unsigned char* data, size_t len);
+
+    /**
+     * write data after the header.
+     * @return whether it succeeded.
+     */
+    bool write(const unsigned char* data, size_t len);
+
+    /**
+     * patch a 32-bit value in the header.
+     * @param pos position, which must be within the header.
+     * @param val the value.
+     */
+    void patchI(size_t pos, int val);
+
+    /**
+     * @return the number of (uncompressed) bytes written so far.
+     */
+    size_t tell();
+
+    /**
+     * write the patched header and close the file.
+     * @return whether everything was written successfully.
+     */
+    bool close();
+
+    /**
+     * @return the last error.
+     */
+    String getLastError();
+
+    DivVGMStream();
+    ~DivVGMStream();
+};
+
+#endif
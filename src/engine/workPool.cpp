@@ -0,0 +1,124 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "workPool.h"
+#include "../ta-log.h"
+
+static void _runWorkThread(DivWorkPool* pool) {
+  pool->runThread();
+}
+
+void DivWorkPool::runTasks() {
+  while (true) {
+    size_t i=taskPos.fetch_add(1);
+    if (i>=taskCount) break;
+    tasks[i].func(tasks[i].arg);
+    pending--;
+  }
+}
+
+void DivWorkPool::runThread() {
+  unsigned int lastBatch=0;
+  std::unique_lock<std::mutex> l(lock);
+  while (true) {
+    notify.wait(l,[this,&lastBatch]{
+      return terminate || (batchActive && batch!=lastBatch);
+    });
+    if (terminate) break;
+    lastBatch=batch;
+    running++;
+    l.unlock();
+
+    runTasks();
+
+    l.lock();
+    if (--running==0) doneNotify.notify_one();
+  }
+}
+
+void DivWorkPool::push(void (*what)(void*), void* arg) {
+  if (count==0) {
+    what(arg);
+    return;
+  }
+  tasks.push_back(DivWorkTask(what,arg));
+}
+
+void DivWorkPool::wait() {
+  if (tasks.empty()) return;
+  if (tasks.size()==1) {
+    // not worth waking up the workers
+    tasks[0].func(tasks[0].arg);
+    tasks.clear();
+    return;
+  }
+
+  lock.lock();
+  taskPos=0;
+  pending=tasks.size();
+  taskCount=tasks.size();
+  batch++;
+  batchActive=true;
+  lock.unlock();
+  notify.notify_all();
+
+  runTasks();
+
+  std::unique_lock<std::mutex> l(lock);
+  doneNotify.wait(l,[this]{
+    return pending==0 && running==0;
+  });
+  batchActive=false;
+  taskCount=0;
+  l.unlock();
+
+  tasks.clear();
+}
+
+DivWorkPool::DivWorkPool(unsigned int threadCount):
+  threads(NULL),
+  taskPos(0),
+  taskCount(0),
+  pending(0),
+  batch(0),
+  running(0),
+  batchActive(false),
+  terminate(false),
+  count(threadCount) {
+  if (count==0) return;
+  logD("starting work pool with %d threads.",count);
+  tasks.reserve(64);
+  threads=new std::thread*[count];
+  for (unsigned int i=0; i<count; i++) {
+    threads[i]=new std::thread(_runWorkThread,this);
+  }
+}
+
+DivWorkPool::~DivWorkPool() {
+  if (count==0) return;
+  lock.lock();
+  terminate=true;
+  lock.unlock();
+  notify.notify_all();
+  for (unsigned int i=0; i<count; i++) {
+    threads[i]->join();
+    delete threads[i];
+  }
+  delete[] threads;
+}
@@ -0,0 +1,73 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _WORKPOOL_H
+#define _WORKPOOL_H
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+struct DivWorkTask {
+  void (*func)(void*);
+  void* arg;
+  DivWorkTask(void (*f)(void*), void* a):
+    func(f),
+    arg(a) {}
+};
+
+/**
+ * a small pool of worker threads which run batches of tasks.
+ * tasks are queued with push() and executed when wait() is called.
+ * the calling thread takes part in the batch as well.
+ * if the pool has no threads, tasks run immediately on push().
+ */
+class DivWorkPool {
+  std::thread** threads;
+  std::mutex lock;
+  std::condition_variable notify, doneNotify;
+  std::vector<DivWorkTask> tasks;
+  std::atomic<size_t> taskPos;
+  std::atomic<size_t> taskCount;
+  std::atomic<size_t> pending;
+  unsigned int batch;
+  int running;
+  bool batchActive;
+  bool terminate;
+
+  void runTasks();
+
+  public:
+    unsigned int count;
+
+    void runThread();
+
+    // queue a task. it will be run on the next call to wait(), or right
+    // away if the pool has no threads.
+    void push(void (*what)(void*), void* arg);
+
+    // run all queued tasks and wait for them to finish.
+    void wait();
+
+    DivWorkPool(unsigned int threadCount=0);
+    ~DivWorkPool();
+};
+
+#endif
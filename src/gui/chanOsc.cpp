@@ -0,0 +1,121 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gui.h"
+#include "imgui_internal.h"
+
+void FurnaceGUI::drawChanOsc() {
+  if (nextWindow==GUI_WINDOW_CHAN_OSC) {
+    chanOscOpen=true;
+    ImGui::SetNextWindowFocus();
+    nextWindow=GUI_WINDOW_NOTHING;
+  }
+  // the taps cost CPU time, so only run them while this window is open
+  if (chanOscOpen!=chanOscTapOn) {
+    e->enableChanOsc(chanOscOpen);
+    chanOscTapOn=chanOscOpen;
+  }
+  if (!chanOscOpen) return;
+  ImGui::SetNextWindowSizeConstraints(ImVec2(64.0f*dpiScale,32.0f*dpiScale),ImVec2(scrW*dpiScale,scrH*dpiScale));
+  if (ImGui::Begin("Oscilloscope (per-channel)",&chanOscOpen)) {
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text("Columns");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f*dpiScale);
+    if (ImGui::InputInt("##COSCols",&chanOscCols,1,1)) {
+      if (chanOscCols<1) chanOscCols=1;
+      if (chanOscCols>64) chanOscCols=64;
+    }
+    ImGui::SameLine();
+    ImGui::Text("Size (ms)");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f*dpiScale);
+    if (ImGui::InputFloat("##COSWinSize",&chanOscWindowSize,1.0f,10.0f,"%.1f")) {
+      if (chanOscWindowSize<1.0f) chanOscWindowSize=1.0f;
+      if (chanOscWindowSize>50.0f) chanOscWindowSize=50.0f;
+    }
+
+    std::vector<int> oscChans;
+    for (int i=0; i<e->getTotalChannelCount(); i++) {
+      if (e->getOscBuffer(i)!=NULL) oscChans.push_back(i);
+    }
+
+    if (oscChans.empty()) {
+      ImGui::Text("none of the systems in this song provide per-channel output.");
+    } else if (ImGui::BeginTable("ChanOscGrid",chanOscCols,ImGuiTableFlags_SizingStretchSame)) {
+      ImDrawList* dl=ImGui::GetWindowDrawList();
+      ImGuiStyle& style=ImGui::GetStyle();
+      ImU32 color=ImGui::GetColorU32(uiColors[GUI_COLOR_OSC_WAVE]);
+      ImU32 bgColor=ImGui::GetColorU32(uiColors[GUI_COLOR_OSC_BG1]);
+      ImU32 refColor=ImGui::GetColorU32(uiColors[GUI_COLOR_OSC_REF]);
+      ImU32 borderColor=ImGui::GetColorU32(uiColors[GUI_COLOR_OSC_BORDER]);
+      int rows=(oscChans.size()+chanOscCols-1)/chanOscCols;
+      float height=(ImGui::GetContentRegionAvail().y/rows)-style.CellPadding.y*2.0f;
+      if (height<32.0f*dpiScale) height=32.0f*dpiScale;
+
+      ImVec2 waveform[512];
+      for (size_t i=0; i<oscChans.size(); i++) {
+        ImGui::TableNextColumn();
+        DivDispatchOscBuffer* buf=e->getOscBuffer(oscChans[i]);
+        if (buf==NULL) continue;
+
+        ImGuiWindow* window=ImGui::GetCurrentWindow();
+        ImVec2 size=ImVec2(ImGui::GetContentRegionAvail().x,height);
+        ImVec2 minArea=window->DC.CursorPos;
+        ImVec2 maxArea=ImVec2(minArea.x+size.x,minArea.y+size.y);
+        ImRect rect=ImRect(minArea,maxArea);
+        ImGui::ItemSize(size,style.FramePadding.y);
+        if (ImGui::ItemAdd(rect,ImGui::GetID(buf))) {
+          dl->AddRectFilled(rect.Min,rect.Max,bgColor,settings.oscRoundedCorners?(4.0f*dpiScale):0.0f);
+          dl->AddLine(
+            ImLerp(rect.Min,rect.Max,ImVec2(0.0f,0.5f)),
+            ImLerp(rect.Min,rect.Max,ImVec2(1.0f,0.5f)),
+            refColor,
+            dpiScale
+          );
+
+          // show the most recent samples
+          unsigned short needle=buf->readNeedle;
+          int displaySize=(int)((float)buf->rate*chanOscWindowSize/1000.0f);
+          if (displaySize<1) displaySize=1;
+          if (displaySize>32768) displaySize=32768;
+          unsigned short start=needle-displaySize;
+          for (int j=0; j<512; j++) {
+            unsigned short pos=start+(unsigned short)(j*displaySize/512);
+            float y=(float)buf->data[pos]/65536.0f;
+            if (y<-0.5f) y=-0.5f;
+            if (y>0.5f) y=0.5f;
+            waveform[j]=ImLerp(rect.Min,rect.Max,ImVec2((float)j/512.0f,0.5f-y));
+          }
+          dl->AddPolyline(waveform,512,color,ImDrawFlags_None,dpiScale);
+          dl->AddText(ImVec2(rect.Min.x+style.FramePadding.x,rect.Min.y),color,e->getChannelShortName(oscChans[i]));
+          if (settings.oscBorder) {
+            dl->AddRect(rect.Min,rect.Max,borderColor,settings.oscRoundedCorners?(4.0f*dpiScale):0.0f,0,dpiScale);
+          }
+        }
+      }
+      ImGui::EndTable();
+    }
+    if (e->isPlaying()) {
+      WAKE_UP;
+    }
+  }
+  if (ImGui::IsWindowFocused(ImGuiFocusedFlags_ChildWindows)) curWindow=GUI_WINDOW_CHAN_OSC;
+  ImGui::End();
+}
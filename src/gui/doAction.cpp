@@ -189,6 +189,9 @@ void FurnaceGUI::doAction(int what) {
     case GUI_ACTION_WINDOW_OSCILLOSCOPE:
       nextWindow=GUI_WINDOW_OSCILLOSCOPE;
       break;
+    case GUI_ACTION_WINDOW_CHAN_OSC:
+      nextWindow=GUI_WINDOW_CHAN_OSC;
+      break;
     case GUI_ACTION_WINDOW_VOL_METER:
       nextWindow=GUI_WINDOW_VOL_METER;
       break;
@@ -267,6 +270,9 @@ void FurnaceGUI::doAction(int what) {
         case GUI_WINDOW_OSCILLOSCOPE:
           oscOpen=false;
           break;
+        case GUI_WINDOW_CHAN_OSC:
+          chanOscOpen=false;
+          break;
         case GUI_WINDOW_VOL_METER:
           volMeterOpen=false;
           break;
@@ -505,6 +511,7 @@ void FurnaceGUI::doAction(int what) {
         int prevIns=curIns;
         curIns=e->addInstrument(cursor.xCoarse);
         (*e->song.ins[curIns])=(*e->song.ins[prevIns]);
+        e->notifyInsChange(curIns);
         MARK_MODIFIED;
       }
       break;
@@ -548,6 +555,7 @@ void FurnaceGUI::doAction(int what) {
         int prevWave=curWave;
         curWave=e->addWave();
         (*e->song.wave[curWave])=(*e->song.wave[prevWave]);
+        e->notifyWaveChange(curWave);
         MARK_MODIFIED;
       }
       break;
@@ -631,6 +639,7 @@ void FurnaceGUI::doAction(int what) {
       break;
     case GUI_ACTION_SAMPLE_LIST_DELETE:
       e->delSample(curSample);
+      samplePeaks.invalidate();
       MARK_MODIFIED;
       if (curSample>=(int)e->song.sample.size()) {
         curSample--;
@@ -682,6 +691,7 @@ void FurnaceGUI::doAction(int what) {
       e->lockEngine([this,sample,start,end]() {
         sample->strip(start,end);
         updateSampleTex=true;
+        samplePeaks.invalidate();
 
         e->renderSamples();
       });
@@ -730,6 +740,7 @@ void FurnaceGUI::doAction(int what) {
       sampleSelStart=pos;
       sampleSelEnd=pos+sampleClipboardLen;
       updateSampleTex=true;
+      samplePeaks.invalidate();
       MARK_MODIFIED;
       break;
     }
@@ -758,6 +769,7 @@ void FurnaceGUI::doAction(int what) {
       sampleSelEnd=pos+sampleClipboardLen;
       if (sampleSelEnd>(int)sample->samples) sampleSelEnd=sample->samples;
       updateSampleTex=true;
+      samplePeaks.invalidate(pos,pos+sampleClipboardLen);
       MARK_MODIFIED;
       break;
     }
@@ -792,6 +804,7 @@ void FurnaceGUI::doAction(int what) {
       sampleSelEnd=pos+sampleClipboardLen;
       if (sampleSelEnd>(int)sample->samples) sampleSelEnd=sample->samples;
       updateSampleTex=true;
+      samplePeaks.invalidate(pos,pos+sampleClipboardLen);
       MARK_MODIFIED;
       break;
     }
@@ -856,6 +869,7 @@ void FurnaceGUI::doAction(int what) {
         }
 
         updateSampleTex=true;
+        samplePeaks.invalidate(start,end);
 
         e->renderSamples();
       });
@@ -886,6 +900,7 @@ void FurnaceGUI::doAction(int what) {
         }
 
         updateSampleTex=true;
+        samplePeaks.invalidate(start,end);
 
         e->renderSamples();
       });
@@ -916,6 +931,7 @@ void FurnaceGUI::doAction(int what) {
         }
 
         updateSampleTex=true;
+        samplePeaks.invalidate(start,end);
 
         e->renderSamples();
       });
@@ -944,6 +960,7 @@ void FurnaceGUI::doAction(int what) {
         }
 
         updateSampleTex=true;
+        samplePeaks.invalidate(start,end);
 
         e->renderSamples();
       });
@@ -959,6 +976,7 @@ void FurnaceGUI::doAction(int what) {
 
         sample->strip(start,end);
         updateSampleTex=true;
+        samplePeaks.invalidate();
 
         e->renderSamples();
       });
@@ -976,6 +994,7 @@ void FurnaceGUI::doAction(int what) {
 
         sample->trim(start,end);
         updateSampleTex=true;
+        samplePeaks.invalidate();
 
         e->renderSamples();
       });
@@ -1010,6 +1029,7 @@ void FurnaceGUI::doAction(int what) {
         }
 
         updateSampleTex=true;
+        samplePeaks.invalidate(start,end);
 
         e->renderSamples();
       });
@@ -1036,6 +1056,7 @@ void FurnaceGUI::doAction(int what) {
         }
 
         updateSampleTex=true;
+        samplePeaks.invalidate(start,end);
 
         e->renderSamples();
       });
@@ -1060,6 +1081,7 @@ void FurnaceGUI::doAction(int what) {
         }
 
         updateSampleTex=true;
+        samplePeaks.invalidate(start,end);
 
         e->renderSamples();
       });
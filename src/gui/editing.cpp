@@ -114,7 +114,7 @@ void FurnaceGUI::makeUndo(ActionType action) {
       for (int i=0; i<e->getTotalChannelCount(); i++) {
         DivPattern* p=e->song.pat[i].getPattern(e->song.orders.ord[i][curOrder],false);
         for (int j=0; j<e->song.patLen; j++) {
-          for (int k=0; k<32; k++) {
+          for (int k=0; k<DIV_PAT_COLS; k++) {
             if (p->data[j][k]!=oldPat[i]->data[j][k]) {
               s.pat.push_back(UndoPatternData(i,e->song.orders.ord[i][curOrder],j,k,oldPat[i]->data[j][k],p->data[j][k]));
             }
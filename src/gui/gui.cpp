@@ -1383,8 +1383,9 @@ void FurnaceGUI::openFileDialog(FurnaceGUIFileDialogs type) {
       if (!dirExists(workingDirVGMExport)) workingDirVGMExport=getHomeDir();
       hasOpened=fileDialog->openSave(
         "Export VGM",
-        {"VGM file", "*.vgm"},
-        "VGM file{.vgm}",
+        {"VGM file", "*.vgm",
+         "compressed VGM file", "*.vgz"},
+        "VGM file{.vgm},compressed VGM file{.vgz}",
         workingDirVGMExport,
         dpiScale
       );
@@ -1636,6 +1637,7 @@ int FurnaceGUI::load(String path) {
   orderCursor=-1;
   samplePos=0;
   updateSampleTex=true;
+  samplePeaks.invalidate();
   selStart=SelectionPoint();
   selEnd=SelectionPoint();
   cursor=SelectionPoint();
@@ -1731,6 +1733,7 @@ void FurnaceGUI::processDrags(int dragX, int dragY) {
       } else {
         MACRO_DRAG(macroDragTarget);
       }
+      e->notifyInsChange(curIns);
     }
   }
   if (macroLoopDragActive) {
@@ -1740,6 +1743,7 @@ void FurnaceGUI::processDrags(int dragX, int dragY) {
       if (x>=macroLoopDragLen) x=-1;
       x+=macroDragScroll;
       *macroLoopDragTarget=x;
+      e->notifyInsChange(curIns);
     }
   }
   if (waveDragActive) {
@@ -1779,7 +1783,17 @@ void FurnaceGUI::processDrags(int dragX, int dragY) {
         if (val>127) val=127;
         for (int i=x; i<=x1; i++) ((signed char*)sampleDragTarget)[i]=val;
       }
-      updateSampleTex=true;
+      // only the columns under the stroke are redrawn
+      if (x<=x1) {
+        samplePeaks.invalidate(x,x1+1);
+        if (sampleTexDirtyEnd<=sampleTexDirtyStart) {
+          sampleTexDirtyStart=x;
+          sampleTexDirtyEnd=x1+1;
+        } else {
+          if ((unsigned int)x<sampleTexDirtyStart) sampleTexDirtyStart=x;
+          if ((unsigned int)x1+1>sampleTexDirtyEnd) sampleTexDirtyEnd=x1+1;
+        }
+      }
     } else { // select
       if (sampleSelStart<0) {
         sampleSelStart=x;
@@ -2626,6 +2640,10 @@ bool FurnaceGUI::loop() {
           ImGui::EndCombo();
         }
         ImGui::Checkbox("loop",&vgmExportLoop);
+        ImGui::Checkbox("sample-accurate timing",&vgmExportHighRes);
+        if (ImGui::IsItemHovered()) {
+          ImGui::SetTooltip("places register writes at the exact sample they happen at.\nsample playback is written as DAC writes, which makes the file larger.");
+        }
         ImGui::Text("systems to export:");
         bool hasOneAtLeast=false;
         for (int i=0; i<e->song.systemLen; i++) {
@@ -2757,6 +2775,7 @@ bool FurnaceGUI::loop() {
       if (ImGui::MenuItem("play/edit controls",BIND_FOR(GUI_ACTION_WINDOW_EDIT_CONTROLS),editControlsOpen)) editControlsOpen=!editControlsOpen;
       if (ImGui::MenuItem("piano/input pad",BIND_FOR(GUI_ACTION_WINDOW_PIANO),pianoOpen)) pianoOpen=!pianoOpen;
       if (ImGui::MenuItem("oscilloscope",BIND_FOR(GUI_ACTION_WINDOW_OSCILLOSCOPE),oscOpen)) oscOpen=!oscOpen;
+      if (ImGui::MenuItem("oscilloscope (per-channel)",BIND_FOR(GUI_ACTION_WINDOW_CHAN_OSC),chanOscOpen)) chanOscOpen=!chanOscOpen;
       if (ImGui::MenuItem("volume meter",BIND_FOR(GUI_ACTION_WINDOW_VOL_METER),volMeterOpen)) volMeterOpen=!volMeterOpen;
       if (ImGui::MenuItem("register view",BIND_FOR(GUI_ACTION_WINDOW_REGISTER_VIEW),regViewOpen)) regViewOpen=!regViewOpen;
       if (ImGui::MenuItem("log viewer",BIND_FOR(GUI_ACTION_WINDOW_LOG),logOpen)) logOpen=!logOpen;
@@ -2859,6 +2878,7 @@ bool FurnaceGUI::loop() {
     readOsc();
 
     drawOsc();
+    drawChanOsc();
     drawVolMeter();
     drawSettings();
     drawDebug();
@@ -2952,7 +2972,8 @@ bool FurnaceGUI::loop() {
             checkExtension(".fuw");
           }
           if (curFileDialog==GUI_FILE_EXPORT_VGM) {
-            checkExtension(".vgm");
+            const char* fallbackExt=(!settings.sysFileDialog && ImGuiFileDialog::Instance()->GetCurrentFilter()=="compressed VGM file")?".vgz":".vgm";
+            checkExtensionDual(".vgm",".vgz",fallbackExt);
           }
           if (curFileDialog==GUI_FILE_EXPORT_COLORS) {
             checkExtension(".cfgc");
@@ -3075,17 +3096,12 @@ bool FurnaceGUI::loop() {
               MARK_MODIFIED;
               break;
             case GUI_FILE_EXPORT_VGM: {
-              SafeWriter* w=e->saveVGM(willExport,vgmExportLoop,vgmExportVersion);
-              if (w!=NULL) {
-                FILE* f=ps_fopen(copyOfName.c_str(),"wb");
-                if (f!=NULL) {
-                  fwrite(w->getFinalBuf(),1,w->size(),f);
-                  fclose(f);
-                } else {
-                  showError("could not open file!");
-                }
-                w->finish();
-                delete w;
+              String lowerCase=copyOfName;
+              for (char& i: lowerCase) {
+                if (i>='A' && i<='Z') i+='a'-'A';
+              }
+              bool compress=lowerCase.size()>=4 && lowerCase.rfind(".vgz")==lowerCase.size()-4;
+              if (e->saveVGMFile(copyOfName.c_str(),willExport,vgmExportLoop,vgmExportVersion,compress,vgmExportHighRes)) {
                 if (!e->getWarnings().empty()) {
                   showWarning(e->getWarnings(),GUI_WARN_GENERIC);
                 }
@@ -3484,6 +3500,9 @@ bool FurnaceGUI::init() {
   regViewOpen=e->getConfBool("regViewOpen",false);
   logOpen=e->getConfBool("logOpen",false);
   effectListOpen=e->getConfBool("effectListOpen",false);
+  chanOscOpen=e->getConfBool("chanOscOpen",false);
+  chanOscCols=e->getConfInt("chanOscCols",3);
+  chanOscWindowSize=e->getConfFloat("chanOscWindowSize",20.0f);
 
   tempoView=e->getConfBool("tempoView",true);
   waveHex=e->getConfBool("waveHex",false);
@@ -3655,6 +3674,9 @@ bool FurnaceGUI::finish() {
   e->setConf("regViewOpen",regViewOpen);
   e->setConf("logOpen",logOpen);
   e->setConf("effectListOpen",effectListOpen);
+  e->setConf("chanOscOpen",chanOscOpen);
+  e->setConf("chanOscCols",chanOscCols);
+  e->setConf("chanOscWindowSize",chanOscWindowSize);
 
   // commit last window size
   e->setConf("lastWindowWidth",scrW);
@@ -3684,6 +3706,8 @@ FurnaceGUI::FurnaceGUI():
   sampleTexW(0),
   sampleTexH(0),
   updateSampleTex(true),
+  sampleTexDirtyStart(0),
+  sampleTexDirtyEnd(0),
   quit(false),
   warnQuit(false),
   willCommit(false),
@@ -3692,6 +3716,7 @@ FurnaceGUI::FurnaceGUI():
   displayError(false),
   displayExporting(false),
   vgmExportLoop(true),
+  vgmExportHighRes(false),
   wantCaptureKeyboard(false),
   displayNew(false),
   fullScreen(false),
@@ -3763,6 +3788,7 @@ FurnaceGUI::FurnaceGUI():
   regViewOpen(false),
   logOpen(false),
   effectListOpen(false),
+  chanOscOpen(false),
   /*
   editControlsDocked(false),
   ordersDocked(false),
@@ -3904,6 +3930,9 @@ FurnaceGUI::FurnaceGUI():
   oscTotal(0),
   oscZoom(0.5f),
   oscZoomSlider(false),
+  chanOscCols(3),
+  chanOscWindowSize(20.0f),
+  chanOscTapOn(false),
   followLog(true),
   pianoOctaves(7),
   pianoOptions(false),
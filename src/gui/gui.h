@@ -33,6 +33,7 @@
 #include <vector>
 
 #include "fileDialog.h"
+#include "samplePeaks.h"
 
 #define rightClickable if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) ImGui::SetKeyboardFocusHere(-1);
 #define ctrlWheeling ((ImGui::IsKeyDown(ImGuiKey_LeftCtrl) || ImGui::IsKeyDown(ImGuiKey_RightCtrl)) && wheelY!=0)
@@ -226,7 +227,8 @@ enum FurnaceGUIWindows {
   GUI_WINDOW_CHANNELS,
   GUI_WINDOW_REGISTER_VIEW,
   GUI_WINDOW_LOG,
-  GUI_WINDOW_EFFECT_LIST
+  GUI_WINDOW_EFFECT_LIST,
+  GUI_WINDOW_CHAN_OSC
 };
 
 enum FurnaceGUIFileDialogs {
@@ -325,6 +327,7 @@ enum FurnaceGUIActions {
   GUI_ACTION_WINDOW_REGISTER_VIEW,
   GUI_ACTION_WINDOW_LOG,
   GUI_ACTION_WINDOW_EFFECT_LIST,
+  GUI_ACTION_WINDOW_CHAN_OSC,
 
   GUI_ACTION_COLLAPSE_WINDOW,
   GUI_ACTION_CLOSE_WINDOW,
@@ -723,13 +726,16 @@ class FurnaceGUI {
   SDL_Texture* sampleTex;
   int sampleTexW, sampleTexH;
   bool updateSampleTex;
+  // samples whose columns have to be redrawn (when not redrawing everything)
+  unsigned int sampleTexDirtyStart, sampleTexDirtyEnd;
+  FurnaceGUISamplePeaks samplePeaks;
 
   String workingDir, fileName, clipboard, warnString, errorString, lastError, curFileName, nextFile;
   String workingDirSong, workingDirIns, workingDirWave, workingDirSample, workingDirAudioExport, workingDirVGMExport, workingDirFont, workingDirColors, workingDirKeybinds, workingDirLayout;
   String mmlString[17];
   String mmlStringW;
 
-  bool quit, warnQuit, willCommit, edit, modified, displayError, displayExporting, vgmExportLoop, wantCaptureKeyboard;
+  bool quit, warnQuit, willCommit, edit, modified, displayError, displayExporting, vgmExportLoop, vgmExportHighRes, wantCaptureKeyboard;
   bool displayNew, fullScreen;
   bool willExport[32];
   int vgmExportVersion;
@@ -780,6 +786,8 @@ class FurnaceGUI {
     int arcadeCore;
     int ym2612Core;
     int saaCore;
+    int liveCoreQuality;
+    int exportCoreQuality;
     int mainFont;
     int patFont;
     int audioRate;
@@ -841,6 +849,9 @@ class FurnaceGUI {
     int notePreviewBehavior;
     int powerSave;
     int absorbInsInput;
+    int renderPoolThreads;
+    int sampleUndoBudget;
+    int sampleUndoCompress;
     unsigned int maxUndoSteps;
     String mainFontPath;
     String patFontPath;
@@ -857,6 +868,8 @@ class FurnaceGUI {
       arcadeCore(0),
       ym2612Core(0),
       saaCore(1),
+      liveCoreQuality(0),
+      exportCoreQuality(2),
       mainFont(0),
       patFont(0),
       audioRate(44100),
@@ -916,6 +929,9 @@ class FurnaceGUI {
       notePreviewBehavior(1),
       powerSave(1),
       absorbInsInput(0),
+      renderPoolThreads(0),
+      sampleUndoBudget(64),
+      sampleUndoCompress(1),
       maxUndoSteps(100),
       mainFontPath(""),
       patFontPath(""),
@@ -933,7 +949,7 @@ class FurnaceGUI {
   bool editControlsOpen, ordersOpen, insListOpen, songInfoOpen, patternOpen, insEditOpen;
   bool waveListOpen, waveEditOpen, sampleListOpen, sampleEditOpen, aboutOpen, settingsOpen;
   bool mixerOpen, debugOpen, inspectorOpen, oscOpen, volMeterOpen, statsOpen, compatFlagsOpen;
-  bool pianoOpen, notesOpen, channelsOpen, regViewOpen, logOpen, effectListOpen;
+  bool pianoOpen, notesOpen, channelsOpen, regViewOpen, logOpen, effectListOpen, chanOscOpen;
 
   /* there ought to be a better way...
   bool editControlsDocked, ordersDocked, insListDocked, songInfoDocked, patternDocked, insEditDocked;
@@ -1082,6 +1098,11 @@ class FurnaceGUI {
   float oscZoom;
   bool oscZoomSlider;
 
+  // per-channel oscilloscope
+  int chanOscCols;
+  float chanOscWindowSize;
+  bool chanOscTapOn;
+
   // visualizer
   float keyHit[DIV_MAX_CHANS];
   int lastIns[DIV_MAX_CHANS];
@@ -1138,6 +1159,7 @@ class FurnaceGUI {
   void drawOsc();
   void drawVolMeter();
   void drawStats();
+  void drawChanOsc();
   void drawCompatFlags();
   void drawPiano();
   void drawNotes();
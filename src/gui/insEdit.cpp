@@ -1077,13 +1077,14 @@ void FurnaceGUI::drawGBEnv(unsigned char vol, unsigned char len, unsigned char s
   } \
   if (displayLoop) { \
     ImGui::SetNextItemWidth(lenAvail); \
-    if (ImGui::InputScalar("##IMacroLen_" macroName,ImGuiDataType_U8,&macro.len,&_ONE,&_THREE)) { MARK_MODIFIED \
+    if (ImGui::InputScalar("##IMacroLen_" macroName,ImGuiDataType_U8,&macro.len,&_ONE,&_THREE)) { PARAMETER \
       if (macro.len>127) macro.len=127; \
     } \
     if (macroMode) { \
       bool modeVal=macro.mode; \
       if (ImGui::Checkbox("Fixed##IMacroMode_" macroName,&modeVal)) { \
         macro.mode=modeVal; \
+        PARAMETER \
       } \
     } \
   } \
@@ -1150,10 +1151,12 @@ void FurnaceGUI::drawGBEnv(unsigned char vol, unsigned char len, unsigned char s
       } else { \
         macro.loop=-1; \
       } \
+      PARAMETER \
     } \
     ImGui::SetNextItemWidth(availableWidth); \
     if (ImGui::InputText("##IMacroMML_" macroName,&mmlStr)) { \
       decodeMMLStr(mmlStr,macro.val,macro.len,macro.loop,macroAMin,(bitfield)?((1<<(bitfield?macroAMax:0))-1):macroAMax,macro.rel); \
+      PARAMETER \
     } \
     if (!ImGui::IsItemActive()) { \
       encodeMMLStr(mmlStr,macro.val,macro.len,macro.loop,macro.rel); \
@@ -1171,13 +1174,14 @@ void FurnaceGUI::drawGBEnv(unsigned char vol, unsigned char len, unsigned char s
   } \
   if (displayLoop) { \
     ImGui::SetNextItemWidth(lenAvail); \
-    if (ImGui::InputScalar("##IOPMacroLen_" #op macroName,ImGuiDataType_U8,&macro.len,&_ONE,&_THREE)) { MARK_MODIFIED \
+    if (ImGui::InputScalar("##IOPMacroLen_" #op macroName,ImGuiDataType_U8,&macro.len,&_ONE,&_THREE)) { PARAMETER \
       if (macro.len>127) macro.len=127; \
     } \
     if (macroMode) { \
       bool modeVal=macro.mode; \
       if (ImGui::Checkbox("Fixed##IOPMacroMode_" macroName,&modeVal)) { \
         macro.mode=modeVal; \
+        PARAMETER \
       } \
     } \
   } \
@@ -1240,10 +1244,12 @@ void FurnaceGUI::drawGBEnv(unsigned char vol, unsigned char len, unsigned char s
       } else { \
         macro.loop=-1; \
       } \
+      PARAMETER \
     } \
     ImGui::SetNextItemWidth(availableWidth); \
     if (ImGui::InputText("##IOPMacroMML_" macroName,&mmlStr)) { \
       decodeMMLStr(mmlStr,macro.val,macro.len,macro.loop,0,bitfield?((1<<(bitfield?macroHeight:0))-1):(macroHeight),macro.rel); \
+      PARAMETER \
     } \
     if (!ImGui::IsItemActive()) { \
       encodeMMLStr(mmlStr,macro.val,macro.len,macro.loop,macro.rel); \
@@ -1303,6 +1309,7 @@ if (ImGui::BeginTable("MacroSpace",2)) { \
     } else { \
       prop=(block<<10)|fNum; \
     } \
+    PARAMETER \
   } \
   ImGui::TableNextColumn(); \
   if (ImGui::InputInt(df,&fNum,1,1)) { \
@@ -1314,6 +1321,7 @@ if (ImGui::BeginTable("MacroSpace",2)) { \
       if (fNum>1023) fNum=1023; \
       prop=(block<<10)|fNum; \
     } \
+    PARAMETER \
   }
 
 
@@ -1388,6 +1396,7 @@ void FurnaceGUI::drawInsEdit() {
         ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
         if (ImGui::Combo("##Type",&insType,insTypes,DIV_INS_MAX,DIV_INS_MAX)) {
           ins->type=(DivInstrumentType)insType;
+          PARAMETER
         }
 
         ImGui::EndTable();
@@ -1831,12 +1840,14 @@ void FurnaceGUI::drawInsEdit() {
                             if (block<0) block=0;
                             if (block>7) block=7;
                             op.dt=block;
+                            PARAMETER
                           }
                           if (ImGui::InputInt("FreqNum",&freqNum,1,16)) {
                             if (freqNum<0) freqNum=0;
                             if (freqNum>255) freqNum=255;
                             op.mult=freqNum>>4;
                             op.dvb=freqNum&15;
+                            PARAMETER
                           }
                         }
                       } else {
@@ -2533,17 +2544,19 @@ void FurnaceGUI::drawInsEdit() {
         }
         if (ins->type==DIV_INS_FDS) if (ImGui::BeginTabItem("FDS")) {
           float modTable[32];
-          ImGui::Checkbox("Compatibility mode",&ins->fds.initModTableWithFirstWave);
+          P(ImGui::Checkbox("Compatibility mode",&ins->fds.initModTableWithFirstWave));
           if (ImGui::IsItemHovered()) {
             ImGui::SetTooltip("only use for compatibility with .dmf modules!\n- initializes modulation table with first wavetable\n- does not alter modulation parameters on instrument change");
           }
           if (ImGui::InputInt("Modulation depth",&ins->fds.modDepth,1,32)) {
             if (ins->fds.modDepth<0) ins->fds.modDepth=0;
             if (ins->fds.modDepth>63) ins->fds.modDepth=63;
+            PARAMETER
           }
           if (ImGui::InputInt("Modulation speed",&ins->fds.modSpeed,1,4)) {
             if (ins->fds.modSpeed<0) ins->fds.modSpeed=0;
             if (ins->fds.modSpeed>4095) ins->fds.modSpeed=4095;
+            PARAMETER
           }
           ImGui::Text("Modulation table");
           for (int i=0; i<32; i++) {
@@ -2579,7 +2592,7 @@ void FurnaceGUI::drawInsEdit() {
             ins->type==DIV_INS_PCE ||
             ins->type==DIV_INS_SCC) {
           if (ImGui::BeginTabItem("Wavetable")) {
-            ImGui::Checkbox("Enable synthesizer",&ins->ws.enabled);
+            P(ImGui::Checkbox("Enable synthesizer",&ins->ws.enabled));
             ImGui::SameLine();
             ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
             if (ins->ws.effect&0x80) {
@@ -2597,6 +2610,7 @@ void FurnaceGUI::drawInsEdit() {
               for (int i=0; i<DIV_WS_SINGLE_MAX; i++) {
                 if (ImGui::Selectable(singleWSEffects[i])) {
                   ins->ws.effect=i;
+                  PARAMETER
                 }
               }
               ImGui::Unindent();
@@ -2605,6 +2619,7 @@ void FurnaceGUI::drawInsEdit() {
               for (int i=129; i<DIV_WS_DUAL_MAX; i++) {
                 if (ImGui::Selectable(dualWSEffects[i-128])) {
                   ins->ws.effect=i;
+                  PARAMETER
                 }
               }
               ImGui::Unindent();
@@ -2646,6 +2661,7 @@ void FurnaceGUI::drawInsEdit() {
               if (ImGui::InputInt("##SelWave1",&ins->ws.wave1,1,4)) {
                 if (ins->ws.wave1<0) ins->ws.wave1=0;
                 if (ins->ws.wave1>=(int)e->song.wave.size()) ins->ws.wave1=e->song.wave.size()-1;
+                PARAMETER
               }
               ImGui::TableNextColumn();
               ImGui::Text("Wave 2");
@@ -2654,21 +2670,23 @@ void FurnaceGUI::drawInsEdit() {
               if (ImGui::InputInt("##SelWave2",&ins->ws.wave2,1,4)) {
                 if (ins->ws.wave2<0) ins->ws.wave2=0;
                 if (ins->ws.wave2>=(int)e->song.wave.size()) ins->ws.wave2=e->song.wave.size()-1;
+                PARAMETER
               }
               ImGui::EndTable();
             }
 
-            ImGui::InputScalar("Update Rate",ImGuiDataType_U8,&ins->ws.rateDivider,&_ONE,&_SEVEN);
+            P(ImGui::InputScalar("Update Rate",ImGuiDataType_U8,&ins->ws.rateDivider,&_ONE,&_SEVEN));
             int speed=ins->ws.speed+1;
             if (ImGui::InputInt("Speed",&speed,1,16)) {
               if (speed<1) speed=1;
               if (speed>256) speed=256;
               ins->ws.speed=speed-1;
+              PARAMETER
             }
 
-            ImGui::InputScalar("Amount",ImGuiDataType_U8,&ins->ws.param1,&_ONE,&_SEVEN);
+            P(ImGui::InputScalar("Amount",ImGuiDataType_U8,&ins->ws.param1,&_ONE,&_SEVEN));
 
-            ImGui::Checkbox("Global",&ins->ws.global);
+            P(ImGui::Checkbox("Global",&ins->ws.global));
 
             ImGui::EndTabItem();
           }
@@ -2966,10 +2984,12 @@ void FurnaceGUI::drawInsEdit() {
               }
               if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
                 ins->std.volMacro.loop=-1;
+                PARAMETER
               }
               ImGui::PopStyleVar();
               if (ImGui::InputScalar("Length##IVolMacroL",ImGuiDataType_U8,&ins->std.volMacro.len,&_ONE,&_THREE)) {
                 if (ins->std.volMacro.len>127) ins->std.volMacro.len=127;
+                PARAMETER
               }
             }
 
@@ -3006,16 +3026,19 @@ void FurnaceGUI::drawInsEdit() {
             }
             if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
               ins->std.arpMacro.loop=-1;
+              PARAMETER
             }
             ImGui::PopStyleVar();
             if (ImGui::InputScalar("Length##IArpMacroL",ImGuiDataType_U8,&ins->std.arpMacro.len,&_ONE,&_THREE)) {
               if (ins->std.arpMacro.len>127) ins->std.arpMacro.len=127;
+              PARAMETER
             }
             if (ImGui::Checkbox("Fixed",&arpMode)) {
               ins->std.arpMacro.mode=arpMode;
               if (arpMode) {
                 if (arpMacroScroll<0) arpMacroScroll=0;
               }
+              PARAMETER
             }
 
             // duty macro
@@ -3063,10 +3086,12 @@ void FurnaceGUI::drawInsEdit() {
               }
               if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
                 ins->std.dutyMacro.loop=-1;
+                PARAMETER
               }
               ImGui::PopStyleVar();
               if (ImGui::InputScalar("Length##IDutyMacroL",ImGuiDataType_U8,&ins->std.dutyMacro.len,&_ONE,&_THREE)) {
                 if (ins->std.dutyMacro.len>127) ins->std.dutyMacro.len=127;
+                PARAMETER
               }
             }
 
@@ -3119,10 +3144,12 @@ void FurnaceGUI::drawInsEdit() {
               }
               if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
                 ins->std.waveMacro.loop=-1;
+                PARAMETER
               }
               ImGui::PopStyleVar();
               if (ImGui::InputScalar("Length##IWaveMacroL",ImGuiDataType_U8,&ins->std.waveMacro.len,&_ONE,&_THREE)) {
                 if (ins->std.waveMacro.len>127) ins->std.waveMacro.len=127;
+                PARAMETER
               }
             }
 
@@ -3163,10 +3190,12 @@ void FurnaceGUI::drawInsEdit() {
               }
               if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
                 ins->std.ex1Macro.loop=-1;
+                PARAMETER
               }
               ImGui::PopStyleVar();
               if (ImGui::InputScalar("Length##IEx1MacroL",ImGuiDataType_U8,&ins->std.ex1Macro.len,&_ONE,&_THREE)) {
                 if (ins->std.ex1Macro.len>127) ins->std.ex1Macro.len=127;
+                PARAMETER
               }
             }
           }
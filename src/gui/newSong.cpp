@@ -81,6 +81,7 @@ void FurnaceGUI::drawNewSong() {
     orderCursor=-1;
     samplePos=0;
     updateSampleTex=true;
+    samplePeaks.invalidate();
     selStart=SelectionPoint();
     selEnd=SelectionPoint();
     cursor=SelectionPoint();
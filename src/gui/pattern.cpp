@@ -31,9 +31,41 @@ inline float randRange(float min, float max) {
   return min+((float)rand()/(float)RAND_MAX)*(max-min);
 }
 
+// cell labels only depend on the value, so they are formatted once.
+// field 0 is the instrument, 1 the volume, then up to 8 effect/value pairs.
+// index 0 is an empty cell, 1-256 the values and 257 an invalid effect.
+#define PAT_LABEL_FIELDS 18
+static char patLabels[PAT_LABEL_FIELDS][258][8];
+static bool patLabelsReady=false;
+
+static void preparePatLabels() {
+  if (patLabelsReady) return;
+  for (int i=0; i<PAT_LABEL_FIELDS; i++) {
+    char suffix[4];
+    if (i==0) {
+      strcpy(suffix,"I");
+    } else if (i==1) {
+      strcpy(suffix,"V");
+    } else {
+      snprintf(suffix,4,"%c%d",(i&1)?'F':'E',(i-2)>>1);
+    }
+    snprintf(patLabels[i][0],8,"..##%s",suffix);
+    for (int j=0; j<256; j++) {
+      snprintf(patLabels[i][j+1],8,"%.2X##%s",j,suffix);
+    }
+    snprintf(patLabels[i][257],8,"??##%s",suffix);
+  }
+  patLabelsReady=true;
+}
+
+static inline const char* patLabel(int field, short val) {
+  if (val<0) return patLabels[field][0];
+  if (val>0xff) return patLabels[field][257];
+  return patLabels[field][val+1];
+}
+
 // draw a pattern row
 inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int chans, int ord, const DivPattern** patCache, bool inhibitSel) {
-  static char id[32];
   bool selectedRow=(i>=sel1.y && i<=sel2.y && !inhibitSel);
   ImGui::TableNextRow(0,lineHeight);
   ImGui::TableNextColumn();
@@ -87,6 +119,7 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
       isPushing=false;
     }
   }
+  ImGui::PushID(i);
   // row number
   if (settings.patRowsBase==1) {
     ImGui::TextColored(rowIndexColor," %.2X ",i);
@@ -105,6 +138,7 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
     const DivPattern* pat=patCache[j];
     ImGui::TableNextColumn();
     patChanX[j]=ImGui::GetCursorPosX();
+    ImGui::PushID(j);
 
     // selection highlight flags
     int sel1XSum=sel1.xCoarse*32+sel1.xFine;
@@ -118,7 +152,7 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
     bool cursorVol=(cursor.y==i && cursor.xCoarse==j && cursor.xFine==2);
 
     // note
-    sprintf(id,"%s##PN_%d_%d",noteName(pat->data[i][0],pat->data[i][1]),i,j);
+    const char* id=noteName(pat->data[i][0],pat->data[i][1]);
     if (pat->data[i][0]==0 && pat->data[i][1]==0) {
       ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
     } else {
@@ -147,9 +181,9 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
     // the following is only visible when the channel is not collapsed
     if (!e->song.chanCollapse[j]) {
       // instrument
+      id=patLabel(0,pat->data[i][2]);
       if (pat->data[i][2]==-1) {
         ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
-        sprintf(id,"..##PI_%d_%d",i,j);
       } else {
         if (pat->data[i][2]<0 || pat->data[i][2]>=e->song.insLen) {
           ImGui::PushStyleColor(ImGuiCol_Text,uiColors[GUI_COLOR_PATTERN_INS_ERROR]);
@@ -161,7 +195,6 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
             ImGui::PushStyleColor(ImGuiCol_Text,uiColors[GUI_COLOR_PATTERN_INS]);
           }
         }
-        sprintf(id,"%.2X##PI_%d_%d",pat->data[i][2],i,j);
       }
       ImGui::SameLine(0.0f,0.0f);
       if (cursorIns) {
@@ -185,14 +218,13 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
       ImGui::PopStyleColor();
 
       // volume
+      id=patLabel(1,pat->data[i][3]);
       if (pat->data[i][3]==-1) {
-        sprintf(id,"..##PV_%d_%d",i,j);
         ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
       } else {
         int volColor=(pat->data[i][3]*127)/chanVolMax;
         if (volColor>127) volColor=127;
         if (volColor<0) volColor=0;
-        sprintf(id,"%.2X##PV_%d_%d",pat->data[i][3],i,j);
         ImGui::PushStyleColor(ImGuiCol_Text,volColors[volColor]);
       }
       ImGui::SameLine(0.0f,0.0f);
@@ -225,16 +257,14 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
         bool cursorEffectVal=(cursor.y==i && cursor.xCoarse==j && cursor.xFine==index);
         
         // effect
+        id=patLabel(2+(k<<1),pat->data[i][index]);
         if (pat->data[i][index]==-1) {
-          sprintf(id,"..##PE%d_%d_%d",k,i,j);
           ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
         } else {
           if (pat->data[i][index]>0xff) {
-            sprintf(id,"??##PE%d_%d_%d",k,i,j);
             ImGui::PushStyleColor(ImGuiCol_Text,uiColors[GUI_COLOR_PATTERN_EFFECT_INVALID]);
           } else {
             const unsigned char data=pat->data[i][index];
-            sprintf(id,"%.2X##PE%d_%d_%d",data,k,i,j);
             if (data<0x10) {
               ImGui::PushStyleColor(ImGuiCol_Text,uiColors[fxColors[data]]);
             } else if (data<0x20) {
@@ -279,11 +309,7 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
         }
 
         // effect value
-        if (pat->data[i][index+1]==-1) {
-          sprintf(id,"..##PF%d_%d_%d",k,i,j);
-        } else {
-          sprintf(id,"%.2X##PF%d_%d_%d",pat->data[i][index+1],k,i,j);
-        }
+        id=patLabel(3+(k<<1),pat->data[i][index+1]);
         ImGui::SameLine(0.0f,0.0f);
         if (cursorEffectVal) {
           ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_CURSOR]);  
@@ -306,10 +332,12 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
         ImGui::PopStyleColor();
       }
     }
+    ImGui::PopID();
   }
   if (isPushing) {
     ImGui::PopStyleColor();
   }
+  ImGui::PopID();
   ImGui::TableNextColumn();
   patChanX[chans]=ImGui::GetCursorPosX();
 }
@@ -489,7 +517,8 @@ void FurnaceGUI::drawPattern() {
           e->toggleSolo(i);
         }
         if (extraChannelButtons==2) {
-          DivPattern* pat=e->song.pat[i].getPattern(e->song.orders.ord[i][ord],true);
+          // only create the pattern when its name is being edited
+          DivPattern* pat=e->song.pat[i].getPattern(e->song.orders.ord[i][ord],patNameTarget==i);
           ImGui::PushFont(mainFont);
           if (patNameTarget==i) {
             snprintf(chanID,2048,"##PatNameI%d_%d",i,ord);
@@ -552,45 +581,45 @@ void FurnaceGUI::drawPattern() {
       //ImVec2 oneChar=ImVec2(oneCharSize,lineHeight);
       dummyRows=(ImGui::GetWindowSize().y/lineHeight)/2;
       // オップナー2608 i owe you one more for this horrible code
-      // previous pattern
-      ImGui::BeginDisabled();
-      if (settings.viewPrevPattern) {
-        if ((ord-1)>=0) for (int i=0; i<chans; i++) {
-          patCache[i]=e->song.pat[i].getPattern(e->song.orders.ord[i][ord-1],true);
-        }
-        for (int i=0; i<dummyRows-1; i++) {
-          patternRow(e->song.patLen+i-dummyRows+1,e->isPlaying(),lineHeight,chans,ord-1,patCache,true);
-        }
-      } else {
-        for (int i=0; i<dummyRows-1; i++) {
-          ImGui::TableNextRow(0,lineHeight);
-          ImGui::TableNextColumn();
-        }
-      }
-      ImGui::EndDisabled();
-      // active area
+      // the previous pattern's tail, the active pattern and the next pattern's
+      // head are laid out as one list, and only the visible rows are drawn.
+      int prevRows=dummyRows-1;
+      int nextRows=dummyRows+1;
+      if (prevRows<0) prevRows=0;
+      const DivPattern* prevPatCache[DIV_MAX_CHANS];
+      const DivPattern* nextPatCache[DIV_MAX_CHANS];
       for (int i=0; i<chans; i++) {
-        patCache[i]=e->song.pat[i].getPattern(e->song.orders.ord[i][ord],true);
-      }
-      for (int i=0; i<e->song.patLen; i++) {
-        patternRow(i,e->isPlaying(),lineHeight,chans,ord,patCache,false);
-      }
-      // next pattern
-      ImGui::BeginDisabled();
-      if (settings.viewPrevPattern) {
-        if ((ord+1)<e->song.ordersLen) for (int i=0; i<chans; i++) {
-          patCache[i]=e->song.pat[i].getPattern(e->song.orders.ord[i][ord+1],true);
-        }
-        for (int i=0; i<=dummyRows; i++) {
-          patternRow(i,e->isPlaying(),lineHeight,chans,ord+1,patCache,true);
+        patCache[i]=e->song.pat[i].getPattern(e->song.orders.ord[i][ord],false);
+        if (settings.viewPrevPattern) {
+          if ((ord-1)>=0) prevPatCache[i]=e->song.pat[i].getPattern(e->song.orders.ord[i][ord-1],false);
+          if ((ord+1)<e->song.ordersLen) nextPatCache[i]=e->song.pat[i].getPattern(e->song.orders.ord[i][ord+1],false);
         }
-      } else {
-        for (int i=0; i<=dummyRows; i++) {
-          ImGui::TableNextRow(0,lineHeight);
-          ImGui::TableNextColumn();
+      }
+      preparePatLabels();
+      bool isPlaying=e->isPlaying();
+      ImGuiListClipper clipper;
+      clipper.Begin(prevRows+e->song.patLen+nextRows,lineHeight);
+      while (clipper.Step()) {
+        for (int i=clipper.DisplayStart; i<clipper.DisplayEnd; i++) {
+          if (i>=prevRows && i<prevRows+e->song.patLen) {
+            // active area
+            patternRow(i-prevRows,isPlaying,lineHeight,chans,ord,patCache,false);
+          } else if (settings.viewPrevPattern) {
+            // previous/next pattern
+            ImGui::BeginDisabled();
+            if (i<prevRows) {
+              patternRow(e->song.patLen+i-prevRows,isPlaying,lineHeight,chans,ord-1,prevPatCache,true);
+            } else {
+              patternRow(i-prevRows-e->song.patLen,isPlaying,lineHeight,chans,ord+1,nextPatCache,true);
+            }
+            ImGui::EndDisabled();
+          } else {
+            ImGui::TableNextRow(0,lineHeight);
+            ImGui::TableNextColumn();
+          }
         }
       }
-      ImGui::EndDisabled();
+      clipper.End();
       oldRow=curRow;
       if (demandScrollX) {
         int totalDemand=demandX-ImGui::GetScrollX();
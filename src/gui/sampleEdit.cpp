@@ -68,6 +68,7 @@ void FurnaceGUI::drawSampleEdit() {
                 sample->depth=i;
                 e->renderSamplesP();
                 updateSampleTex=true;
+                samplePeaks.invalidate();
                 MARK_MODIFIED;
               }
             }
@@ -170,6 +171,7 @@ void FurnaceGUI::drawSampleEdit() {
               e->renderSamples();
             });
             updateSampleTex=true;
+            samplePeaks.invalidate();
             sampleSelStart=-1;
             sampleSelEnd=-1;
             MARK_MODIFIED;
@@ -225,6 +227,7 @@ void FurnaceGUI::drawSampleEdit() {
               e->renderSamples();
             });
             updateSampleTex=true;
+            samplePeaks.invalidate();
             sampleSelStart=-1;
             sampleSelEnd=-1;
             MARK_MODIFIED;
@@ -292,6 +295,7 @@ void FurnaceGUI::drawSampleEdit() {
               }
 
               updateSampleTex=true;
+              samplePeaks.invalidate(start,end);
 
               e->renderSamples();
             });
@@ -345,6 +349,7 @@ void FurnaceGUI::drawSampleEdit() {
               e->renderSamples();
             });
             updateSampleTex=true;
+            samplePeaks.invalidate();
             sampleSelStart=pos;
             sampleSelEnd=pos+silenceSize;
             MARK_MODIFIED;
@@ -501,6 +506,7 @@ void FurnaceGUI::drawSampleEdit() {
               }
 
               updateSampleTex=true;
+              samplePeaks.invalidate(start,end);
 
               e->renderSamples();
             });
@@ -581,6 +587,7 @@ void FurnaceGUI::drawSampleEdit() {
                 sample->depth=i;
                 e->renderSamplesP();
                 updateSampleTex=true;
+                samplePeaks.invalidate();
                 MARK_MODIFIED;
               }
             }
@@ -684,6 +691,7 @@ void FurnaceGUI::drawSampleEdit() {
               e->renderSamples();
             });
             updateSampleTex=true;
+            samplePeaks.invalidate();
             sampleSelStart=-1;
             sampleSelEnd=-1;
             MARK_MODIFIED;
@@ -739,6 +747,7 @@ void FurnaceGUI::drawSampleEdit() {
               e->renderSamples();
             });
             updateSampleTex=true;
+            samplePeaks.invalidate();
             sampleSelStart=-1;
             sampleSelEnd=-1;
             MARK_MODIFIED;
@@ -855,6 +864,7 @@ void FurnaceGUI::drawSampleEdit() {
               }
 
               updateSampleTex=true;
+              samplePeaks.invalidate(start,end);
 
               e->renderSamples();
             });
@@ -907,6 +917,7 @@ void FurnaceGUI::drawSampleEdit() {
               }
 
               updateSampleTex=true;
+              samplePeaks.invalidate(start,end);
 
               e->renderSamples();
             });
@@ -1001,6 +1012,7 @@ void FurnaceGUI::drawSampleEdit() {
               e->renderSamples();
             });
             updateSampleTex=true;
+            samplePeaks.invalidate();
             sampleSelStart=pos;
             sampleSelEnd=pos+silenceSize;
             MARK_MODIFIED;
@@ -1124,77 +1136,69 @@ void FurnaceGUI::drawSampleEdit() {
       }
 
       if (sampleTex!=NULL) {
+        // redraw everything, or only the columns under an edited range
+        int colStart=0;
+        int colEnd=0;
         if (updateSampleTex) {
+          colEnd=availX;
+        } else if (sampleTexDirtyEnd>sampleTexDirtyStart && sampleZoom>0.0) {
+          // the column before also reaches into the range
+          colStart=floor(((double)sampleTexDirtyStart-samplePos)/sampleZoom)-1;
+          colEnd=ceil(((double)sampleTexDirtyEnd-samplePos)/sampleZoom)+1;
+          if (colStart<0) colStart=0;
+          if (colEnd>availX) colEnd=availX;
+        }
+        sampleTexDirtyStart=0;
+        sampleTexDirtyEnd=0;
+        if (colEnd>colStart) {
           unsigned int* data=NULL;
           int pitch=0;
-          logD("updating sample texture.");
-          if (SDL_LockTexture(sampleTex,NULL,(void**)&data,&pitch)!=0) {
+          SDL_Rect rect;
+          rect.x=colStart;
+          rect.y=0;
+          rect.w=colEnd-colStart;
+          rect.h=availY;
+          if (updateSampleTex) logD("updating sample texture.");
+          if (SDL_LockTexture(sampleTex,&rect,(void**)&data,&pitch)!=0) {
             logE("error while locking sample texture! %s",SDL_GetError());
           } else {
             ImU32 bgColor=ImGui::GetColorU32(ImGuiCol_FrameBg);
             ImU32 bgColorLoop=ImAlphaBlendColors(bgColor,ImGui::GetColorU32(ImGuiCol_FrameBgHovered,0.5));
             ImU32 lineColor=ImGui::GetColorU32(ImGuiCol_PlotLines);
             ImU32 centerLineColor=ImAlphaBlendColors(bgColor,ImGui::GetColorU32(ImGuiCol_PlotLines,0.25));
-            for (int i=0; i<availY; i++) {
-              for (int j=0; j<availX; j++) {
-                int scaledPos=samplePos+(j*sampleZoom);
-                if (sample->loopStart>=0 && sample->loopStart<(int)sample->samples && scaledPos>=sample->loopStart) {
-                  data[i*availX+j]=bgColorLoop;
-                } else {
-                  data[i*availX+j]=bgColor;
-                }
-              }
-            }
-            if (availY>0) {
-              for (int i=availX*(availY>>1); i<availX*(1+(availY>>1)); i++) {
-                data[i]=centerLineColor;
+            int stride=pitch>>2;
+            samplePeaks.update(sample);
+            for (int i=colStart; i<colEnd; i++) {
+              unsigned int* col=data+(i-colStart);
+              unsigned int scaledPos=samplePos+(i*sampleZoom);
+              ImU32 colBg=bgColor;
+              if (sample->loopStart>=0 && sample->loopStart<(int)sample->samples && scaledPos>=(unsigned int)sample->loopStart) {
+                colBg=bgColorLoop;
               }
-            }
-            unsigned int xCoarse=samplePos;
-            unsigned int xFine=0;
-            unsigned int xAdvanceCoarse=sampleZoom;
-            unsigned int xAdvanceFine=fmod(sampleZoom,1.0)*16777216;
-            for (unsigned int i=0; i<(unsigned int)availX; i++) {
-              if (xCoarse>=sample->samples) break;
-              int y1, y2;
-              int totalAdvance=0;
-              if (sample->depth==8) {
-                y1=((unsigned char)sample->data8[xCoarse]^0x80)*availY/256;
-              } else {
-                y1=((unsigned short)sample->data16[xCoarse]^0x8000)*availY/65536;
+              for (int j=0; j<availY; j++) {
+                col[j*stride]=colBg;
               }
-              xFine+=xAdvanceFine;
-              if (xFine>=16777216) {
-                xFine-=16777216;
-                totalAdvance++;
+              if (availY>0) col[(availY>>1)*stride]=centerLineColor;
+              if (scaledPos>=sample->samples) continue;
+
+              // the column goes up to the first sample of the next one
+              unsigned int nextPos=samplePos+((i+1)*sampleZoom);
+              int min, max;
+              samplePeaks.get(scaledPos,nextPos+1,min,max);
+              int y1=((unsigned short)min^0x8000)*availY/65536;
+              int y2=((unsigned short)max^0x8000)*availY/65536;
+              if (y1<0) y1=0;
+              if (y1>=availY) y1=availY-1;
+              if (y2<0) y2=0;
+              if (y2>=availY) y2=availY-1;
+              for (int j=y1; j<=y2; j++) {
+                col[stride*(availY-j-1)]=lineColor;
               }
-              totalAdvance+=xAdvanceCoarse;
-              if (xCoarse>=sample->samples) break;
-              do {
-                if (sample->depth==8) {
-                  y2=((unsigned char)sample->data8[xCoarse]^0x80)*availY/256;
-                } else {
-                  y2=((unsigned short)sample->data16[xCoarse]^0x8000)*availY/65536;
-                }
-                if (y1>y2) {
-                  y2^=y1;
-                  y1^=y2;
-                  y2^=y1;
-                }
-                if (y1<0) y1=0;
-                if (y1>=availY) y1=availY-1;
-                if (y2<0) y2=0;
-                if (y2>=availY) y2=availY-1;
-                for (int j=y1; j<=y2; j++) {
-                  data[i+availX*(availY-j-1)]=lineColor;
-                }
-                if (totalAdvance>0) xCoarse++;
-              } while ((totalAdvance--)>0);
             }
             SDL_UnlockTexture(sampleTex);
           }
-          updateSampleTex=false;
         }
+        updateSampleTex=false;
 
         ImGui::ImageButton(sampleTex,avail,ImVec2(0,0),ImVec2(1,1),0);
 
@@ -1349,6 +1353,7 @@ void FurnaceGUI::doUndoSample() {
     if (sample->undo()==2) {
       e->renderSamples();
       updateSampleTex=true;
+      samplePeaks.invalidate();
     }
   });
 }
@@ -1361,6 +1366,7 @@ void FurnaceGUI::doRedoSample() {
     if (sample->redo()==2) {
       e->renderSamples();
       updateSampleTex=true;
+      samplePeaks.invalidate();
     }
   });
 }
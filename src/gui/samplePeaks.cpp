@@ -0,0 +1,124 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "samplePeaks.h"
+
+#define BLOCK_SIZE(l) (1U<<(SAMPLE_PEAKS_SHIFT+(l)))
+
+static inline int readSample(const DivSample* s, unsigned int pos) {
+  if (s->depth==8) return s->data8[pos]<<8;
+  return s->data16[pos];
+}
+
+void FurnaceGUISamplePeaks::invalidate(unsigned int start, unsigned int end) {
+  if (end<=start) return;
+  if (dirtyEnd<=dirtyStart) {
+    dirtyStart=start;
+    dirtyEnd=end;
+    return;
+  }
+  if (start<dirtyStart) dirtyStart=start;
+  if (end>dirtyEnd) dirtyEnd=end;
+}
+
+void FurnaceGUISamplePeaks::invalidate() {
+  sample=NULL;
+}
+
+void FurnaceGUISamplePeaks::update(const DivSample* s) {
+  const void* sData=(s->depth==8)?(const void*)s->data8:(const void*)s->data16;
+  unsigned int sSamples=(sData==NULL)?0:s->samples;
+  if (s!=sample || sData!=data || sSamples!=samples || s->depth!=depth) {
+    sample=s;
+    data=sData;
+    samples=sSamples;
+    depth=s->depth;
+    levelCount=0;
+    for (int i=0; i<SAMPLE_PEAKS_MAX_LEVELS; i++) {
+      unsigned int blocks=samples>>(SAMPLE_PEAKS_SHIFT+i);
+      if (blocks<1) {
+        levels[i].clear();
+        continue;
+      }
+      levels[i].resize(blocks*2);
+      levelCount=i+1;
+    }
+    dirtyStart=0;
+    dirtyEnd=samples;
+  }
+  if (dirtyEnd>samples) dirtyEnd=samples;
+  if (dirtyEnd<=dirtyStart) return;
+
+  // first level from the sample data
+  unsigned int blockStart=dirtyStart>>SAMPLE_PEAKS_SHIFT;
+  unsigned int blockEnd=(dirtyEnd+BLOCK_SIZE(0)-1)>>SAMPLE_PEAKS_SHIFT;
+  for (int l=0; l<levelCount; l++) {
+    unsigned int blocks=levels[l].size()>>1;
+    if (blockEnd>blocks) blockEnd=blocks;
+    short* out=levels[l].data();
+    for (unsigned int i=blockStart; i<blockEnd; i++) {
+      int min=32767;
+      int max=-32768;
+      if (l==0) {
+        for (unsigned int j=i<<SAMPLE_PEAKS_SHIFT; j<((i+1)<<SAMPLE_PEAKS_SHIFT); j++) {
+          int val=readSample(s,j);
+          if (val<min) min=val;
+          if (val>max) max=val;
+        }
+      } else {
+        // combine the two blocks below
+        const short* in=levels[l-1].data()+(i<<2);
+        min=MIN(in[0],in[2]);
+        max=MAX(in[1],in[3]);
+      }
+      out[i<<1]=min;
+      out[(i<<1)+1]=max;
+    }
+    blockStart>>=1;
+    blockEnd=(blockEnd+1)>>1;
+  }
+  dirtyStart=0;
+  dirtyEnd=0;
+}
+
+void FurnaceGUISamplePeaks::get(unsigned int start, unsigned int end, int& min, int& max) {
+  min=32767;
+  max=-32768;
+  if (end>samples) end=samples;
+  while (start<end) {
+    // take the largest block which starts here and fits
+    int level=-1;
+    for (int l=0; l<levelCount; l++) {
+      if (start&(BLOCK_SIZE(l)-1)) break;
+      if (start+BLOCK_SIZE(l)>end) break;
+      level=l;
+    }
+    if (level<0) {
+      int val=readSample(sample,start);
+      if (val<min) min=val;
+      if (val>max) max=val;
+      start++;
+      continue;
+    }
+    const short* block=levels[level].data()+((start>>(SAMPLE_PEAKS_SHIFT+level))<<1);
+    if (block[0]<min) min=block[0];
+    if (block[1]>max) max=block[1];
+    start+=BLOCK_SIZE(level);
+  }
+}
@@ -0,0 +1,76 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _GUI_SAMPLE_PEAKS_H
+#define _GUI_SAMPLE_PEAKS_H
+#include "../engine/sample.h"
+#include <vector>
+
+// samples per block in the first level. each level after it halves the blocks.
+#define SAMPLE_PEAKS_SHIFT 4
+#define SAMPLE_PEAKS_MAX_LEVELS 28
+
+/**
+ * a min/max peak pyramid of a sample, for drawing it at any zoom without
+ * walking every sample under a pixel.
+ * it is built lazily and only the invalidated range is rebuilt.
+ */
+struct FurnaceGUISamplePeaks {
+  const DivSample* sample;
+  const void* data;
+  unsigned int samples;
+  unsigned char depth;
+  int levelCount;
+  // min/max pairs of each block, scaled to 16-bit
+  std::vector<short> levels[SAMPLE_PEAKS_MAX_LEVELS];
+  unsigned int dirtyStart, dirtyEnd;
+
+  /**
+   * mark a range of samples as changed.
+   * @param start the first sample.
+   * @param end the sample after the last one.
+   */
+  void invalidate(unsigned int start, unsigned int end);
+
+  // mark the whole sample as changed.
+  void invalidate();
+
+  /**
+   * bring the pyramid up to date.
+   * a different sample (or a change in length or depth) rebuilds it from scratch.
+   */
+  void update(const DivSample* s);
+
+  /**
+   * get the lowest and highest value in a range, scaled to 16-bit.
+   * update() must be called before.
+   */
+  void get(unsigned int start, unsigned int end, int& min, int& max);
+
+  FurnaceGUISamplePeaks():
+    sample(NULL),
+    data(NULL),
+    samples(0),
+    depth(0),
+    levelCount(0),
+    dirtyStart(0),
+    dirtyEnd(0) {}
+};
+
+#endif
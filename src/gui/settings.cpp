@@ -83,6 +83,12 @@ const char* saaCores[]={
   "SAASound"
 };
 
+const char* coreQualities[]={
+  "Use the cores above",
+  "Fastest",
+  "Most accurate"
+};
+
 const char* valueInputStyles[]={
   "Disabled/custom",
   "Two octaves (0 is C-4, F is D#5)",
@@ -288,6 +294,18 @@ void FurnaceGUI::drawSettings() {
           settings.cursorMoveNoScroll=cursorMoveNoScrollB;
         }
 
+        ImGui::Text("Sample undo memory per sample (MB)");
+        ImGui::SameLine();
+        if (ImGui::InputInt("##SampleUndoBudget",&settings.sampleUndoBudget)) {
+          if (settings.sampleUndoBudget<1) settings.sampleUndoBudget=1;
+          if (settings.sampleUndoBudget>4096) settings.sampleUndoBudget=4096;
+        }
+
+        bool sampleUndoCompressB=settings.sampleUndoCompress;
+        if (ImGui::Checkbox("Compress sample undo history",&sampleUndoCompressB)) {
+          settings.sampleUndoCompress=sampleUndoCompressB;
+        }
+
         bool allowEditDockingB=settings.allowEditDocking;
         if (ImGui::Checkbox("Allow docking editors",&allowEditDockingB)) {
           settings.allowEditDocking=allowEditDockingB;
@@ -452,6 +470,24 @@ void FurnaceGUI::drawSettings() {
           settings.forceMono=forceMonoB;
         }
 
+        bool renderPoolB=(settings.renderPoolThreads>0);
+        if (ImGui::Checkbox("Render chips in parallel",&renderPoolB)) {
+          settings.renderPoolThreads=renderPoolB?MAX(1,(int)std::thread::hardware_concurrency()-1):0;
+        }
+        if (ImGui::IsItemHovered()) {
+          ImGui::SetTooltip("renders each chip on its own thread.\nmay help songs with many chips at small buffer sizes.");
+        }
+        if (renderPoolB) {
+          ImGui::Indent();
+          ImGui::Text("Threads");
+          ImGui::SameLine();
+          if (ImGui::InputInt("##RenderPoolThreads",&settings.renderPoolThreads)) {
+            if (settings.renderPoolThreads<1) settings.renderPoolThreads=1;
+            if (settings.renderPoolThreads>32) settings.renderPoolThreads=32;
+          }
+          ImGui::Unindent();
+        }
+
         TAAudioDesc& audioWant=e->getAudioDescWant();
         TAAudioDesc& audioGot=e->getAudioDescGot();
 
@@ -741,6 +777,16 @@ void FurnaceGUI::drawSettings() {
         ImGui::SameLine();
         ImGui::Combo("##SAACore",&settings.saaCore,saaCores,2);
 
+        ImGui::Separator();
+
+        ImGui::Text("Cores for playback");
+        ImGui::SameLine();
+        ImGui::Combo("##LiveCoreQuality",&settings.liveCoreQuality,coreQualities,3);
+
+        ImGui::Text("Cores for audio export");
+        ImGui::SameLine();
+        ImGui::Combo("##ExportCoreQuality",&settings.exportCoreQuality,coreQualities,3);
+
         ImGui::EndTabItem();
       }
       if (ImGui::BeginTabItem("Appearance")) {
@@ -1278,6 +1324,7 @@ void FurnaceGUI::drawSettings() {
           UI_KEYBIND_CONFIG(GUI_ACTION_WINDOW_MIXER);
           UI_KEYBIND_CONFIG(GUI_ACTION_WINDOW_DEBUG);
           UI_KEYBIND_CONFIG(GUI_ACTION_WINDOW_OSCILLOSCOPE);
+          UI_KEYBIND_CONFIG(GUI_ACTION_WINDOW_CHAN_OSC);
           UI_KEYBIND_CONFIG(GUI_ACTION_WINDOW_VOL_METER);
           UI_KEYBIND_CONFIG(GUI_ACTION_WINDOW_STATS);
           UI_KEYBIND_CONFIG(GUI_ACTION_WINDOW_COMPAT_FLAGS);
@@ -1592,6 +1639,8 @@ void FurnaceGUI::syncSettings() {
   settings.arcadeCore=e->getConfInt("arcadeCore",0);
   settings.ym2612Core=e->getConfInt("ym2612Core",0);
   settings.saaCore=e->getConfInt("saaCore",1);
+  settings.liveCoreQuality=e->getConfInt("liveCoreQuality",0);
+  settings.exportCoreQuality=e->getConfInt("exportCoreQuality",2);
   settings.mainFont=e->getConfInt("mainFont",0);
   settings.patFont=e->getConfInt("patFont",0);
   settings.mainFontPath=e->getConfString("mainFontPath","");
@@ -1651,6 +1700,9 @@ void FurnaceGUI::syncSettings() {
   settings.notePreviewBehavior=e->getConfInt("notePreviewBehavior",1);
   settings.powerSave=e->getConfInt("powerSave",POWER_SAVE_DEFAULT);
   settings.absorbInsInput=e->getConfInt("absorbInsInput",0);
+  settings.renderPoolThreads=e->getConfInt("renderPoolThreads",0);
+  settings.sampleUndoBudget=e->getConfInt("sampleUndoBudget",64);
+  settings.sampleUndoCompress=e->getConfInt("sampleUndoCompress",1);
 
   clampSetting(settings.mainFontSize,2,96);
   clampSetting(settings.patFontSize,2,96);
@@ -1662,6 +1714,8 @@ void FurnaceGUI::syncSettings() {
   clampSetting(settings.arcadeCore,0,1);
   clampSetting(settings.ym2612Core,0,1);
   clampSetting(settings.saaCore,0,1);
+  clampSetting(settings.liveCoreQuality,0,2);
+  clampSetting(settings.exportCoreQuality,0,2);
   clampSetting(settings.mainFont,0,6);
   clampSetting(settings.patFont,0,6);
   clampSetting(settings.patRowsBase,0,1);
@@ -1715,6 +1769,9 @@ void FurnaceGUI::syncSettings() {
   clampSetting(settings.notePreviewBehavior,0,3);
   clampSetting(settings.powerSave,0,1);
   clampSetting(settings.absorbInsInput,0,1);
+  clampSetting(settings.renderPoolThreads,0,32);
+  clampSetting(settings.sampleUndoBudget,1,4096);
+  clampSetting(settings.sampleUndoCompress,0,1);
 
   // keybinds
   for (int i=0; i<GUI_ACTION_MAX; i++) {
@@ -1747,6 +1804,8 @@ void FurnaceGUI::commitSettings() {
   e->setConf("arcadeCore",settings.arcadeCore);
   e->setConf("ym2612Core",settings.ym2612Core);
   e->setConf("saaCore",settings.saaCore);
+  e->setConf("liveCoreQuality",settings.liveCoreQuality);
+  e->setConf("exportCoreQuality",settings.exportCoreQuality);
   e->setConf("mainFont",settings.mainFont);
   e->setConf("patFont",settings.patFont);
   e->setConf("mainFontPath",settings.mainFontPath);
@@ -1806,6 +1865,9 @@ void FurnaceGUI::commitSettings() {
   e->setConf("notePreviewBehavior",settings.notePreviewBehavior);
   e->setConf("powerSave",settings.powerSave);
   e->setConf("absorbInsInput",settings.absorbInsInput);
+  e->setConf("renderPoolThreads",settings.renderPoolThreads);
+  e->setConf("sampleUndoBudget",settings.sampleUndoBudget);
+  e->setConf("sampleUndoCompress",settings.sampleUndoCompress);
 
   // colors
   for (int i=0; i<GUI_COLOR_MAX; i++) {
@@ -2475,6 +2537,7 @@ void FurnaceGUI::applyUISettings(bool updateFonts) {
   ImGuiFileDialog::Instance()->SetFileStyle(IGFD_FileStyleByExtension,".wav",uiColors[GUI_COLOR_FILE_AUDIO],ICON_FA_FILE_AUDIO_O);
   ImGuiFileDialog::Instance()->SetFileStyle(IGFD_FileStyleByExtension,".dmc",uiColors[GUI_COLOR_FILE_AUDIO],ICON_FA_FILE_AUDIO_O);
   ImGuiFileDialog::Instance()->SetFileStyle(IGFD_FileStyleByExtension,".vgm",uiColors[GUI_COLOR_FILE_VGM],ICON_FA_FILE_AUDIO_O);
+  ImGuiFileDialog::Instance()->SetFileStyle(IGFD_FileStyleByExtension,".vgz",uiColors[GUI_COLOR_FILE_VGM],ICON_FA_FILE_AUDIO_O);
   ImGuiFileDialog::Instance()->SetFileStyle(IGFD_FileStyleByExtension,".ttf",uiColors[GUI_COLOR_FILE_FONT],ICON_FA_FONT);
   ImGuiFileDialog::Instance()->SetFileStyle(IGFD_FileStyleByExtension,".otf",uiColors[GUI_COLOR_FILE_FONT],ICON_FA_FONT);
   ImGuiFileDialog::Instance()->SetFileStyle(IGFD_FileStyleByExtension,".ttc",uiColors[GUI_COLOR_FILE_FONT],ICON_FA_FONT);
@@ -111,6 +111,12 @@ void FurnaceGUI::drawSongInfo() {
       if (ImGui::InputInt("##PatLength",&patLen,1,3)) { MARK_MODIFIED
         if (patLen<1) patLen=1;
         if (patLen>256) patLen=256;
+        if (patLen>e->song.pat[0].rows) {
+          // patterns only hold as many rows as needed, so grow them first
+          e->lockEngine([this,patLen]() {
+            e->song.setPatternRows(patLen);
+          });
+        }
         e->song.patLen=patLen;
       }
 
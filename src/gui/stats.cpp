@@ -20,12 +20,24 @@
 #include "gui.h"
 #include <fmt/printf.h>
 
+static void drawProfileRow(const char* name, DivProfileTime& t) {
+  ImGui::TableNextRow();
+  ImGui::TableNextColumn();
+  ImGui::Text("%s",name);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.3fms",1000.0f*t.avg.load(std::memory_order_relaxed));
+  ImGui::TableNextColumn();
+  ImGui::Text("%.3fms",1000.0f*t.peak.load(std::memory_order_relaxed));
+}
+
 void FurnaceGUI::drawStats() {
   if (nextWindow==GUI_WINDOW_STATS) {
     statsOpen=true;
     ImGui::SetNextWindowFocus();
     nextWindow=GUI_WINDOW_NOTHING;
   }
+  // only measure the audio thread while the window is open
+  if (e->isProfiling()!=statsOpen) e->setProfiling(statsOpen);
   if (!statsOpen) return;
   if (ImGui::Begin("Statistics",&statsOpen)) {
     String adpcmAUsage=fmt::sprintf("%d/16384KB",e->adpcmAMemLen/1024);
@@ -44,6 +56,35 @@ void FurnaceGUI::drawStats() {
     ImGui::Text("X1-010");
     ImGui::SameLine();
     ImGui::ProgressBar(((float)e->x1_010MemLen)/1048576.0f,ImVec2(-FLT_MIN,0),x1_010Usage.c_str());
+
+    ImGui::Separator();
+    DivProfile& prof=e->getProfile();
+    TAAudioDesc& audioDesc=e->getAudioDescGot();
+    float loadAvg=prof.load.avg.load(std::memory_order_relaxed);
+    float loadPeak=prof.load.peak.load(std::memory_order_relaxed);
+    String loadText=fmt::sprintf("%.0f%% (peak %.0f%%)",100.0f*loadAvg,100.0f*loadPeak);
+    ImGui::Text("Audio load");
+    ImGui::SameLine();
+    ImGui::ProgressBar(MIN(loadAvg,1.0f),ImVec2(-FLT_MIN,0),loadText.c_str());
+    if (audioDesc.rate>0) {
+      ImGui::Text("Buffer deadline: %.2fms",1000.0*audioDesc.bufsize/audioDesc.rate);
+    }
+    ImGui::Text("Buffers over deadline: %d/%d",prof.overruns.load(std::memory_order_relaxed),prof.buffers.load(std::memory_order_relaxed));
+
+    if (ImGui::BeginTable("ProfileTimes",3,ImGuiTableFlags_Borders)) {
+      ImGui::TableSetupColumn("Stage",ImGuiTableColumnFlags_WidthStretch,0.0);
+      ImGui::TableSetupColumn("Average",ImGuiTableColumnFlags_WidthFixed,0.0);
+      ImGui::TableSetupColumn("Peak",ImGuiTableColumnFlags_WidthFixed,0.0);
+      ImGui::TableHeadersRow();
+      drawProfileRow("Sequencer",prof.tick);
+      for (int i=0; i<e->song.systemLen; i++) {
+        drawProfileRow(e->getSystemName(e->song.system[i]),prof.acquire[i]);
+        drawProfileRow("- resampling",prof.fill[i]);
+      }
+      drawProfileRow("Mixing",prof.mix);
+      drawProfileRow("Total",prof.total);
+      ImGui::EndTable();
+    }
   }
   if (ImGui::IsWindowFocused(ImGuiFocusedFlags_ChildWindows)) curWindow=GUI_WINDOW_STATS;
   ImGui::End();
@@ -29,8 +29,9 @@ static constexpr unsigned int TA_LOG_MASK=TA_LOG_SIZE-1;
 
 int writeLog(int level, const char* msg, fmt::printf_args args) {
   time_t thisMakesNoSense=time(NULL);
-  int pos=logPosition;
-  logPosition=(logPosition+1)&TA_LOG_MASK;
+  // reserve an entry atomically since several engines may log at once
+  unsigned short pos=logPosition;
+  while (!logPosition.compare_exchange_weak(pos,(pos+1)&TA_LOG_MASK));
 
   logEntries[pos].text=fmt::vsprintf(msg,args);
   // why do I have to pass a pointer
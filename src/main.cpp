@@ -18,21 +18,32 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #ifdef HAVE_GUI
 #include "SDL_events.h"
 #endif
 #include "ta-log.h"
 #include "fileutils.h"
 #include "engine/engine.h"
+#include "engine/vgmPlayer.h"
+#include "engine/regLog.h"
+#include "engine/macroInt.h"
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <shellapi.h>
+#include "utfutils.h"
 #else
 #include <unistd.h>
+#include <dirent.h>
 #endif
 
 #ifdef HAVE_GUI
@@ -47,7 +58,16 @@ FurnaceGUI g;
 
 String outName;
 String vgmOutName;
+String batchName;
+String benchName;
+String regLogName;
+String regReplayName;
+String regDiffName;
+int batchJobs=0;
+int stressThreads=0;
 int loops=1;
+bool vgmHighRes=false;
+bool profileExport=false;
 DivAudioExportModes outMode=DIV_EXPORT_MODE_ONE;
 
 #ifdef HAVE_GUI
@@ -213,6 +233,72 @@ bool pVGMOut(String val) {
   return true;
 }
 
+bool pVGMExact(String) {
+  vgmHighRes=true;
+  return true;
+}
+
+bool pProfile(String) {
+  profileExport=true;
+  return true;
+}
+
+bool pRegLog(String val) {
+  regLogName=val;
+  return true;
+}
+
+bool pRegReplay(String val) {
+  regReplayName=val;
+  e.setAudio(DIV_AUDIO_DUMMY);
+  return true;
+}
+
+bool pRegDiff(String val) {
+  regDiffName=val;
+  return true;
+}
+
+bool pBatch(String val) {
+  batchName=val;
+  return true;
+}
+
+bool pJobs(String val) {
+  try {
+    batchJobs=std::stoi(val);
+    if (batchJobs<0) batchJobs=0;
+  } catch (std::exception& e) {
+    logE("job count shall be a number.");
+    return false;
+  }
+  return true;
+}
+
+bool pStress(String val) {
+  try {
+    stressThreads=std::stoi(val);
+    if (stressThreads<1) {
+      logE("thread count shall be at least 1.");
+      return false;
+    }
+  } catch (std::exception& e) {
+    logE("thread count shall be a number.");
+    return false;
+  }
+  return true;
+}
+
+bool pBenchmark(String val) {
+  if (val=="mix" || val=="load" || val=="cores" || val=="resample" || val=="macro") {
+    benchName=val;
+  } else {
+    logE("invalid value for benchmark! valid values are: mix, load, cores, resample and macro.");
+    return false;
+  }
+  return true;
+}
+
 bool needsValue(String param) {
   for (size_t i=0; i<params.size(); i++) {
     if (params[i].name==param) {
@@ -226,19 +312,589 @@ void initParams() {
   params.push_back(TAParam("h","help",false,pHelp,"","display this help"));
 
   params.push_back(TAParam("a","audio",true,pAudio,"jack|sdl","set audio engine (SDL by default)"));
-  params.push_back(TAParam("o","output",true,pOutput,"<filename>","output audio to file"));
-  params.push_back(TAParam("O","vgmout",true,pVGMOut,"<filename>","output .vgm data"));
+  params.push_back(TAParam("o","output",true,pOutput,"<filename>","output audio to file (also renders .vgm/.vgz files)"));
+  params.push_back(TAParam("O","vgmout",true,pVGMOut,"<filename>","output .vgm data (compressed if the name ends in .vgz)"));
+  params.push_back(TAParam("X","vgmexact",false,pVGMExact,"","place VGM register writes at the exact sample they happen at"));
   params.push_back(TAParam("L","loglevel",true,pLogLevel,"debug|info|warning|error","set the log level (info by default)"));
   params.push_back(TAParam("v","view",true,pView,"pattern|commands|nothing","set visualization (pattern by default)"));
   params.push_back(TAParam("c","console",false,pConsole,"","enable console mode"));
 
   params.push_back(TAParam("l","loops",true,pLoops,"<count>","set number of loops (-1 means loop forever)"));
   params.push_back(TAParam("o","outmode",true,pOutMode,"one|persys|perchan","set file output mode"));
+  params.push_back(TAParam("P","profile",false,pProfile,"","report where the CPU time goes when rendering to a file"));
+
+  params.push_back(TAParam("R","reglog",true,pRegLog,"<filename>","capture the register writes of the song to a log"));
+  params.push_back(TAParam("r","regreplay",true,pRegReplay,"<filename>","replay a register log without the sequencer and time the chip cores (renders to -output if given)"));
+  params.push_back(TAParam("D","regdiff",true,pRegDiff,"<filename>","compare a register log against the one given as the file and exit"));
+
+  params.push_back(TAParam("B","batch",true,pBatch,"<list|directory>","render many songs at once (list lines are \"input[<tab>output]\"). -output sets the output directory"));
+  params.push_back(TAParam("b","benchmark",true,pBenchmark,"mix|load|cores|resample|macro","run a performance benchmark of an engine component and exit (load and cores need a song file)"));
+  params.push_back(TAParam("S","stress",true,pStress,"<threads>","play the song in several engines at once and check that they all render the same output and that chip states load back correctly"));
+  params.push_back(TAParam("j","jobs",true,pJobs,"<count>","set number of songs to render at once in batch mode (number of CPU cores by default)"));
 
   params.push_back(TAParam("V","version",false,pVersion,"","view information about Furnace."));
   params.push_back(TAParam("W","warranty",false,pWarranty,"","view warranty disclaimer."));
 }
 
+struct BatchJob {
+  String inName, outName;
+  bool success;
+  double wallTime, renderTime, songTime;
+  BatchJob(const String& i, const String& o):
+    inName(i),
+    outName(o),
+    success(false),
+    wallTime(0),
+    renderTime(0),
+    songTime(0) {}
+};
+
+static bool isSongFile(const String& name) {
+  String lowerCase=name;
+  for (char& i: lowerCase) {
+    if (i>='A' && i<='Z') i+='a'-'A';
+  }
+  for (const char* i: {".fur", ".dmf", ".mod"}) {
+    if (lowerCase.size()>=4 && lowerCase.compare(lowerCase.size()-4,4,i)==0) return true;
+  }
+  return false;
+}
+
+static String batchOutputName(const String& inName) {
+  String baseName=inName;
+  size_t extPos=baseName.rfind('.');
+  size_t sepPos=baseName.find_last_of("/\\");
+  if (extPos!=String::npos && (sepPos==String::npos || extPos>sepPos)) {
+    baseName=baseName.substr(0,extPos);
+  }
+  if (!outName.empty()) {
+    if (sepPos!=String::npos) baseName=baseName.substr(sepPos+1);
+    return outName+DIR_SEPARATOR_STR+baseName+".wav";
+  }
+  return baseName+".wav";
+}
+
+// gather the songs to render from a list file or a directory.
+static bool collectBatchJobs(const String& what, std::vector<BatchJob>& jobs) {
+  std::vector<String> dirEntries;
+  bool isDir=false;
+#ifdef _WIN32
+  WIN32_FIND_DATAW entry;
+  HANDLE dir=FindFirstFileW(utf8To16((what+"\\*").c_str()).c_str(),&entry);
+  if (dir!=INVALID_HANDLE_VALUE) {
+    isDir=true;
+    do {
+      if (entry.dwFileAttributes&FILE_ATTRIBUTE_DIRECTORY) continue;
+      dirEntries.push_back(utf16To8(entry.cFileName));
+    } while (FindNextFileW(dir,&entry));
+    FindClose(dir);
+  }
+#else
+  DIR* dir=opendir(what.c_str());
+  if (dir!=NULL) {
+    isDir=true;
+    struct dirent* entry;
+    while ((entry=readdir(dir))!=NULL) {
+      if (entry->d_name[0]=='.') continue;
+      dirEntries.push_back(entry->d_name);
+    }
+    closedir(dir);
+  }
+#endif
+
+  if (isDir) {
+    std::sort(dirEntries.begin(),dirEntries.end());
+    for (String& i: dirEntries) {
+      if (!isSongFile(i)) continue;
+      String inName=what+DIR_SEPARATOR_STR+i;
+      jobs.push_back(BatchJob(inName,batchOutputName(inName)));
+    }
+    return true;
+  }
+
+  FILE* f=ps_fopen(what.c_str(),"rb");
+  if (f==NULL) {
+    logE("could not open batch list! %s",strerror(errno));
+    return false;
+  }
+  char line[4096];
+  while (fgets(line,4095,f)!=NULL) {
+    String inName=line;
+    while (!inName.empty() && (inName.back()=='\n' || inName.back()=='\r')) inName.pop_back();
+    if (inName.empty() || inName[0]=='#') continue;
+    size_t tabPos=inName.find('\t');
+    if (tabPos!=String::npos) {
+      jobs.push_back(BatchJob(inName.substr(0,tabPos),inName.substr(tabPos+1)));
+    } else {
+      jobs.push_back(BatchJob(inName,batchOutputName(inName)));
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static unsigned char* readSongFile(const String& path, size_t& len) {
+  FILE* f=ps_fopen(path.c_str(),"rb");
+  if (f==NULL) {
+    logE("%s: could not open file! %s",path,strerror(errno));
+    return NULL;
+  }
+  if (fseek(f,0,SEEK_END)<0) {
+    logE("%s: could not seek! %s",path,strerror(errno));
+    fclose(f);
+    return NULL;
+  }
+  ssize_t fileLen=ftell(f);
+  if (fileLen<1 || fseek(f,0,SEEK_SET)<0) {
+    logE("%s: could not get file length!",path);
+    fclose(f);
+    return NULL;
+  }
+  unsigned char* file=new unsigned char[fileLen];
+  if (fread(file,1,(size_t)fileLen,f)!=(size_t)fileLen) {
+    logE("%s: could not read file!",path);
+    fclose(f);
+    delete[] file;
+    return NULL;
+  }
+  fclose(f);
+  len=fileLen;
+  return file;
+}
+
+static void runBatchJob(BatchJob& job) {
+  std::chrono::steady_clock::time_point timeStart=std::chrono::steady_clock::now();
+  size_t len=0;
+  unsigned char* file=readSongFile(job.inName,len);
+  if (file==NULL) return;
+
+  DivEngine* engine=new DivEngine;
+  engine->setConfigReadOnly(true);
+  engine->setConsoleMode(true);
+  engine->setAudio(DIV_AUDIO_DUMMY);
+  if (!engine->load(file,len)) {
+    logE("%s: could not load song! %s",job.inName,engine->getLastError());
+    delete engine;
+    return;
+  }
+  if (!engine->init()) {
+    logE("%s: could not initialize engine!",job.inName);
+    engine->quit();
+    delete engine;
+    return;
+  }
+
+  std::chrono::steady_clock::time_point renderStart=std::chrono::steady_clock::now();
+  engine->saveAudio(job.outName.c_str(),loops,outMode);
+  engine->waitAudioFile();
+  std::chrono::steady_clock::time_point renderEnd=std::chrono::steady_clock::now();
+
+  job.songTime=(double)engine->getTotalSeconds()+(double)engine->getTotalTicks()/1000000.0;
+  engine->quit();
+  delete engine;
+
+  job.renderTime=std::chrono::duration<double>(renderEnd-renderStart).count();
+  job.wallTime=std::chrono::duration<double>(std::chrono::steady_clock::now()-timeStart).count();
+  job.success=true;
+  logI("%s: %.2fs (rendered %.2fs of audio at %.1fx realtime)",job.inName,job.wallTime,job.songTime,(job.renderTime>0)?(job.songTime/job.renderTime):0.0);
+}
+
+// play a minute of the song with each core tier and report the CPU time
+// each system takes per second of audio.
+static int runCoreBenchmark(const String& fileName) {
+  size_t len=0;
+  unsigned char* file=readSongFile(fileName,len);
+  if (file==NULL) return 1;
+
+  DivEngine* engine=new DivEngine;
+  engine->setConfigReadOnly(true);
+  engine->setConsoleMode(true);
+  engine->setAudio(DIV_AUDIO_DUMMY);
+  if (!engine->load(file,len)) {
+    logE("%s: could not load song! %s",fileName,engine->getLastError());
+    delete engine;
+    return 1;
+  }
+  if (!engine->init()) {
+    logE("%s: could not initialize engine!",fileName);
+    engine->quit();
+    delete engine;
+    return 1;
+  }
+
+  float outL[1024];
+  float outR[1024];
+  float* out[2]={outL,outR};
+  unsigned int rate=engine->getAudioDescGot().rate;
+  const DivCoreQuality tiers[2]={DIV_CORE_FAST, DIV_CORE_ACCURATE};
+  const char* tierNames[2]={"fast", "accurate"};
+
+  for (int i=0; i<2; i++) {
+    engine->setCoreQuality(tiers[i]);
+    engine->setCoreTiming(true);
+    size_t frames=0;
+    engine->play();
+    while (engine->isPlaying() && frames<(size_t)rate*60) {
+      engine->nextBuf(NULL,out,0,2,1024);
+      frames+=1024;
+    }
+    engine->stop();
+    double seconds=(double)frames/(double)rate;
+    logI("%s cores (%.1fs of audio):",tierNames[i],seconds);
+    for (int j=0; j<engine->song.systemLen; j++) {
+      const char* coreName=engine->getSystemCoreName(j);
+      logI("- %s (%s): %.2fms per second",
+        engine->getSystemName(engine->song.system[j]),
+        (coreName==NULL)?"only core":coreName,
+        (seconds>0)?(1000.0*engine->getCoreTime(j)/seconds):0.0
+      );
+    }
+    engine->setCoreTiming(false);
+  }
+
+  engine->quit();
+  delete engine;
+  return 0;
+}
+
+static int runBenchmark(const String& fileName) {
+  if (benchName=="mix") {
+    // 32 systems is the maximum a song may have
+    divMixBenchmark(32,1024,4096);
+    divMixBenchmark(32,8192,512);
+  } else if (benchName=="load") {
+    // run once per song, as peak memory usage is per process
+    if (fileName.empty()) {
+      logE("load benchmark needs a song file.");
+      return 1;
+    }
+    size_t len=0;
+    unsigned char* file=readSongFile(fileName,len);
+    if (file==NULL) return 1;
+    DivEngine* engine=new DivEngine;
+    engine->setConfigReadOnly(true);
+    engine->setConsoleMode(true);
+    // load() reports the time taken and peak memory usage
+    bool success=engine->load(file,len);
+    if (!success) logE("%s: could not load song! %s",fileName,engine->getLastError());
+    delete engine;
+    return success?0:1;
+  } else if (benchName=="cores") {
+    if (fileName.empty()) {
+      logE("cores benchmark needs a song file.");
+      return 1;
+    }
+    return runCoreBenchmark(fileName);
+  } else if (benchName=="resample") {
+    // 10 minutes
+    divResampleBenchmark(600);
+  } else if (benchName=="macro") {
+    // a large song: 63 channels
+    divMacroBenchmark(63,200000);
+  }
+  return 0;
+}
+
+// play a VGM through the chip cores and render it to a file.
+static int runVGM(const unsigned char* data, size_t len) {
+  if (outName.empty()) {
+    logE("VGM files can only be rendered to a file. use -output.");
+    return 1;
+  }
+  if (!e.init()) {
+    logE("could not initialize engine!");
+    return 1;
+  }
+  DivVGMPlayer* player=new DivVGMPlayer;
+  bool success=player->load(&e,data,len,44100,(loops>0)?(loops-1):0);
+  if (!success) {
+    logE("could not load VGM! %s",player->getLastError());
+  } else {
+    logI("rendering %.2fs of VGM...",player->getLength());
+    success=player->renderWAV(outName.c_str());
+    if (!success) logE("could not render VGM! %s",player->getLastError());
+  }
+  delete player;
+  e.quit();
+  return success?0:1;
+}
+
+// replay a register log through the chip cores.
+static int runRegReplay() {
+  size_t len=0;
+  unsigned char* data=readSongFile(regReplayName,len);
+  if (data==NULL) return 1;
+  if (!e.init()) {
+    logE("could not initialize engine!");
+    delete[] data;
+    return 1;
+  }
+  DivRegLogPlayer* player=new DivRegLogPlayer;
+  bool success=player->load(&e,data,len,44100);
+  delete[] data;
+  if (!success) {
+    logE("could not load register log! %s",player->getLastError());
+  } else {
+    const DivRegLog& log=player->getLog();
+    logI("replaying %d writes (%.2fs)...",(int)log.writes.size(),(double)log.length/log.rate);
+    player->setTiming(true);
+    std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+    success=player->renderWAV(outName.empty()?NULL:outName.c_str());
+    double elapsed=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    if (!success) {
+      logE("could not replay register log! %s",player->getLastError());
+    } else {
+      for (int i=0; i<player->getChipCount(); i++) {
+        logI("%d. %s: %.3fs",i+1,e.getSystemName(log.systems[i].sys),player->getChipTime(i));
+      }
+      if (elapsed>0) logI("total: %.3fs (%.1fx realtime)",elapsed,((double)log.length/log.rate)/elapsed);
+    }
+  }
+  delete player;
+  e.quit();
+  return success?0:1;
+}
+
+// compare two register logs.
+static int runRegDiff(const String& fileName) {
+  size_t lenA=0, lenB=0;
+  unsigned char* dataA=readSongFile(fileName,lenA);
+  if (dataA==NULL) return 1;
+  unsigned char* dataB=readSongFile(regDiffName,lenB);
+  if (dataB==NULL) {
+    delete[] dataA;
+    return 1;
+  }
+  DivRegLog a, b;
+  String error;
+  bool success=a.read(&e,dataA,lenA,error);
+  if (!success) {
+    logE("%s: %s",fileName,error);
+  } else {
+    success=b.read(&e,dataB,lenB,error);
+    if (!success) logE("%s: %s",regDiffName,error);
+  }
+  delete[] dataA;
+  delete[] dataB;
+  if (!success) return 1;
+  if (!divRegLogDiff(a,b)) {
+    logI("register logs differ.");
+    return 1;
+  }
+  logI("register logs are identical.");
+  return 0;
+}
+
+// render many songs concurrently, each using its own engine.
+static int runBatch() {
+  std::vector<BatchJob> jobs;
+  if (!collectBatchJobs(batchName,jobs)) return 1;
+  if (jobs.empty()) {
+    logE("nothing to render.");
+    return 1;
+  }
+
+  int threadCount=batchJobs;
+  if (threadCount<1) threadCount=std::thread::hardware_concurrency();
+  if (threadCount<1) threadCount=1;
+  if (threadCount>(int)jobs.size()) threadCount=jobs.size();
+  logI("rendering %d songs using %d threads...",(int)jobs.size(),threadCount);
+
+  std::chrono::steady_clock::time_point timeStart=std::chrono::steady_clock::now();
+  std::atomic<size_t> nextJob(0);
+  std::vector<std::thread> threads;
+  for (int i=0; i<threadCount; i++) {
+    threads.push_back(std::thread([&jobs,&nextJob]() {
+      size_t which;
+      while ((which=nextJob++)<jobs.size()) {
+        runBatchJob(jobs[which]);
+      }
+    }));
+  }
+  for (std::thread& i: threads) {
+    i.join();
+  }
+  double totalTime=std::chrono::duration<double>(std::chrono::steady_clock::now()-timeStart).count();
+
+  int failed=0;
+  double totalSongTime=0;
+  printf("%-9s %-9s %-9s %s\n","wall","audio","speed","file");
+  for (BatchJob& i: jobs) {
+    if (!i.success) {
+      printf("%-9s %-9s %-9s %s\n","FAILED","-","-",i.inName.c_str());
+      failed++;
+      continue;
+    }
+    totalSongTime+=i.songTime;
+    printf("%-9.2f %-9.2f %-9.1f %s\n",i.wallTime,i.songTime,(i.renderTime>0)?(i.songTime/i.renderTime):0.0,i.inName.c_str());
+  }
+  printf("total: %d songs (%d failed) in %.2fs, %.2fs of audio (%.1fx realtime)\n",(int)jobs.size(),failed,totalTime,totalSongTime,(totalTime>0)?(totalSongTime/totalTime):0.0);
+  return (failed>0)?1:0;
+}
+
+// check that every chip state survives a round trip: save it, render a bit,
+// load it back and render again. both renders must match.
+// the state is loaded once more afterwards, so the song goes on as before.
+// returns how many chips did not match.
+static int checkChipStates(DivEngine* engine) {
+  short bufL[2][256];
+  short bufR[2][256];
+  int failed=0;
+  for (int i=0; i<engine->song.systemLen; i++) {
+    DivDispatch* disp=engine->getDispatch(i);
+    if (disp==NULL) continue;
+    SafeWriter* w=new SafeWriter;
+    w->init();
+    if (!disp->saveState(w)) {
+      w->finish();
+      delete w;
+      continue;
+    }
+    bool ok=true;
+    for (int j=0; j<2; j++) {
+      memset(bufL[j],0,sizeof(bufL[j]));
+      memset(bufR[j],0,sizeof(bufR[j]));
+      if (j>0) {
+        SafeReader r(w->getFinalBuf(),w->size());
+        if (!disp->loadState(r) || r.tell()!=w->size()) {
+          logE("system %d (%s): could not load chip state!",i,engine->getSystemName(engine->song.system[i]));
+          ok=false;
+          break;
+        }
+      }
+      disp->acquire(bufL[j],bufR[j],0,256);
+    }
+    if (ok && (memcmp(bufL[0],bufL[1],sizeof(bufL[0]))!=0 || memcmp(bufR[0],bufR[1],sizeof(bufR[0]))!=0)) {
+      logE("system %d (%s): output differs after loading chip state!",i,engine->getSystemName(engine->song.system[i]));
+      ok=false;
+    }
+    SafeReader r(w->getFinalBuf(),w->size());
+    disp->loadState(r);
+    w->finish();
+    delete w;
+    if (!ok) failed++;
+  }
+  return failed;
+}
+
+// render a song in one engine, hashing the output (FNV-1a).
+// if stateFailures is not NULL, chip states are checked along the way (see
+// checkChipStates()) and the failures are counted there.
+// returns false if the engine could not be started.
+static bool runStressEngine(const unsigned char* data, size_t len, uint64_t& hash, size_t& frames, int* stateFailures=NULL) {
+  // load() takes ownership of the buffer
+  unsigned char* file=new unsigned char[len];
+  memcpy(file,data,len);
+
+  DivEngine* engine=new DivEngine;
+  engine->setConfigReadOnly(true);
+  engine->setConsoleMode(true);
+  engine->setAudio(DIV_AUDIO_DUMMY);
+  if (!engine->load(file,len)) {
+    logE("could not load song! %s",engine->getLastError());
+    delete engine;
+    return false;
+  }
+  if (!engine->init()) {
+    logE("could not initialize engine!");
+    engine->quit();
+    delete engine;
+    return false;
+  }
+
+  float outL[1024];
+  float outR[1024];
+  float* out[2]={outL,outR};
+  unsigned int rate=engine->getAudioDescGot().rate;
+  // give up after an hour of audio in case the song never ends
+  size_t maxFrames=(size_t)rate*3600;
+
+  hash=0xcbf29ce484222325ULL;
+  frames=0;
+  engine->play();
+  engine->setLoops(loops);
+  while (engine->isPlaying() && frames<maxFrames) {
+    // about once per second
+    if (stateFailures!=NULL && (frames&0xffff)==0) {
+      *stateFailures+=checkChipStates(engine);
+    }
+    engine->nextBuf(NULL,out,0,2,1024);
+    for (int i=0; i<2; i++) {
+      const unsigned char* b=(const unsigned char*)out[i];
+      for (size_t j=0; j<sizeof(outL); j++) {
+        hash^=b[j];
+        hash*=0x100000001b3ULL;
+      }
+    }
+    frames+=1024;
+  }
+
+  engine->quit();
+  delete engine;
+  return true;
+}
+
+// play the same song in several engines at once. they share nothing, so every
+// engine must produce the exact same output as when running on its own.
+static int runStress(const String& fileName) {
+  if (fileName.empty()) {
+    logE("stress test needs a song file.");
+    return 1;
+  }
+  size_t len=0;
+  unsigned char* file=readSongFile(fileName,len);
+  if (file==NULL) return 1;
+
+  // reference run on its own
+  uint64_t refHash=0;
+  size_t refFrames=0;
+  int stateFailures=0;
+  logI("rendering reference and checking chip states...");
+  if (!runStressEngine(file,len,refHash,refFrames,&stateFailures)) {
+    delete[] file;
+    return 1;
+  }
+  logI("reference: %zu frames, hash %.16" PRIx64,refFrames,refHash);
+  if (stateFailures>0) {
+    logE("%d chip state checks failed.",stateFailures);
+  }
+
+  std::vector<uint64_t> hashes(stressThreads,0);
+  std::vector<size_t> frameCount(stressThreads,0);
+  std::vector<char> started(stressThreads,0);
+  std::vector<std::thread> threads;
+  logI("rendering in %d engines at once...",stressThreads);
+  std::chrono::steady_clock::time_point timeStart=std::chrono::steady_clock::now();
+  for (int i=0; i<stressThreads; i++) {
+    threads.push_back(std::thread([&,i]() {
+      started[i]=runStressEngine(file,len,hashes[i],frameCount[i]);
+    }));
+  }
+  for (std::thread& i: threads) {
+    i.join();
+  }
+  double totalTime=std::chrono::duration<double>(std::chrono::steady_clock::now()-timeStart).count();
+  delete[] file;
+
+  int failed=0;
+  for (int i=0; i<stressThreads; i++) {
+    if (!started[i]) {
+      logE("engine %d: could not start!",i);
+      failed++;
+    } else if (hashes[i]!=refHash || frameCount[i]!=refFrames) {
+      logE("engine %d: output mismatch! (%zu frames, hash %.16" PRIx64 ")",i,frameCount[i],hashes[i]);
+      failed++;
+    }
+  }
+  if (failed>0) {
+    logE("%d of %d engines did not match the reference.",failed,stressThreads);
+    return 1;
+  }
+  if (stateFailures>0) return 1;
+  logI("all %d engines match the reference (%.2fs).",stressThreads,totalTime);
+  return 0;
+}
+
 // TODO: CoInitializeEx on Windows?
 // TODO: add crash log
 int main(int argc, char** argv) {
@@ -292,6 +948,26 @@ int main(int argc, char** argv) {
     }
   }
 
+  if (!batchName.empty()) {
+    return runBatch();
+  }
+
+  if (!benchName.empty()) {
+    return runBenchmark(fileName);
+  }
+
+  if (stressThreads>0) {
+    return runStress(fileName);
+  }
+
+  if (!regReplayName.empty()) {
+    return runRegReplay();
+  }
+
+  if (!regDiffName.empty()) {
+    return runRegDiff(fileName);
+  }
+
   e.setConsoleMode(consoleMode);
 
 #ifdef _WIN32
@@ -355,6 +1031,11 @@ int main(int argc, char** argv) {
       return 1;
     }
     fclose(f);
+    if (DivVGMPlayer::isVGM(file,(size_t)len)) {
+      int ret=runVGM(file,(size_t)len);
+      delete[] file;
+      return ret;
+    }
     if (!e.load(file,(size_t)len)) {
       logE("could not open file!");
       return 1;
@@ -368,28 +1049,29 @@ int main(int argc, char** argv) {
       displayEngineFailError=true;
     }
   }
+  if (!regLogName.empty()) {
+    if (!e.startRegLog(regLogName.c_str())) {
+      logE("could not capture register log! %s",e.getLastError());
+    }
+  }
   if (outName!="" || vgmOutName!="") {
     if (vgmOutName!="") {
-      SafeWriter* w=e.saveVGM();
-      if (w!=NULL) {
-        FILE* f=fopen(vgmOutName.c_str(),"wb");
-        if (f!=NULL) {
-          fwrite(w->getFinalBuf(),1,w->size(),f);
-          fclose(f);
-        } else {
-          logE("could not open file! %s",strerror(errno));
-        }
-        w->finish();
-        delete w;
-      } else {
-        logE("could not write VGM!");
+      bool compress=vgmOutName.size()>=4 && vgmOutName.rfind(".vgz")==vgmOutName.size()-4;
+      if (!e.saveVGMFile(vgmOutName.c_str(),NULL,true,0x171,compress,vgmHighRes)) {
+        logE("could not write VGM! %s",e.getLastError());
       }
     }
     if (outName!="") {
       e.setConsoleMode(true);
+      if (profileExport) e.setProfiling(true);
       e.saveAudio(outName.c_str(),loops,outMode);
       e.waitAudioFile();
+      if (profileExport) {
+        e.reportProfile();
+        e.setProfiling(false);
+      }
     }
+    if (!regLogName.empty()) e.stopRegLog();
     return 0;
   }
 